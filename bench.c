@@ -0,0 +1,388 @@
+/* GNU C++ symbol name demangler
+ * Benchmark file.
+ *
+ * Without arguments, the program times demangle() over the test vectors. With
+ * the -corpus option, it replays every file in a directory (a regression
+ * corpus of inputs that were found to be slow, see fuzz/fuzz_slow.c) and fails
+ * if any single input takes longer than the time limit.
+ *
+ * When compiled with BENCH_CXA defined, it also compares the __cxa_demangle()
+ * replacement (with its cache) against the one of the system's libstdc++:
+ *
+ *     cc -O2 -DBENCH_CXA bench.c cxa_demangle.c dcache.c demangle.c -lpthread -ldl
+ *
+ * When compiled with BENCH_NAMESTORE defined, option -names builds a
+ * front-coded name store (see namestore.c) from a file with mangled names (one
+ * per line), and compares its size and lookup time against a sorted table of
+ * plain strings:
+ *
+ *     cc -O2 -DBENCH_NAMESTORE bench.c namestore.c demangle.c
+ *
+ * Usage: bench [-rounds n] [-corpus directory] [-limit microseconds] [-names file]
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "demangle.h"
+#if defined BENCH_CXA
+# include <dlfcn.h>
+#endif
+#if defined BENCH_NAMESTORE
+# include "namestore.h"
+#endif
+
+#define DEFAULT_ROUNDS    2000
+#define DEFAULT_LIMIT     10000 /* microseconds, per input */
+#define CORPUS_ROUNDS     10
+#define MAX_INPUT         65536
+
+static const char *testcases[] = {
+#define TESTCASE(m, p)  m,
+#include "testcases.h"
+#undef TESTCASE
+};
+
+static double timestamp(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench_testcases(long rounds)
+{
+  char plain[1024];
+  size_t count = sizeof testcases / sizeof testcases[0];
+  size_t ok = 0;
+  double start = timestamp();
+  for (long r = 0; r < rounds; r++)
+    for (size_t i = 0; i < count; i++)
+      ok += demangle(plain, sizeof plain, testcases[i]);
+  double elapsed = timestamp() - start;
+  printf("test vectors: %lu symbols x %ld rounds, %.1f ns/symbol (%lu ok)\n",
+         (unsigned long)count, rounds, elapsed * 1e9 / (count * rounds), (unsigned long)ok);
+}
+
+/** make_substitutions() builds a symbol with "count" distinct class-type
+ *  parameters (each one adds a substitution), followed by "refs" references to
+ *  the last substitution.
+ */
+static void make_substitutions(char *buffer, int count, int refs)
+{
+  strcpy(buffer, "_Z1f");
+  char *p = buffer + strlen(buffer);
+  for (int i = 0; i < count; i++) {
+    p[0] = '3';
+    p[1] = (char)('a' + i / (26 * 26) % 26);
+    p[2] = (char)('a' + i / 26 % 26);
+    p[3] = (char)('a' + i % 26);
+    p += 4;
+  }
+  /* <seq-id> for entry n is the base-36 number of n - 1 (and empty for 0) */
+  char seq[16];
+  int len = 0;
+  for (int v = count - 2; v >= 0 && len < 15; v = v / 36 - 1) {
+    seq[len++] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ"[v % 36];
+    if (v < 36)
+      break;
+  }
+  for (int r = 0; r < refs; r++) {
+    *p++ = 'S';
+    for (int i = len - 1; i >= 0; i--)
+      *p++ = seq[i];
+    *p++ = '_';
+  }
+  *p = '\0';
+}
+
+/** bench_substitutions() shows that the cost per substitution reference does
+ *  not depend on the size of the substitution table.
+ */
+static void bench_substitutions(long rounds)
+{
+  static char mangled[32768];
+  static char plain[65536];
+  const int refs = 64;
+  for (int count = 16; count <= 1024; count *= 4) {
+    double elapsed[2];
+    for (int pass = 0; pass < 2; pass++) {
+      make_substitutions(mangled, count, pass * refs);
+      if (!demangle(plain, sizeof plain, mangled)) {
+        printf("substitutions: %d failed\n", count);
+        return;
+      }
+      double start = timestamp();
+      for (long r = 0; r < rounds / 10; r++)
+        demangle(plain, sizeof plain, mangled);
+      elapsed[pass] = (timestamp() - start) / (rounds / 10);
+    }
+    printf("substitutions: %4d entries, %8.1f us/symbol, %6.1f ns/reference\n",
+           count, elapsed[1] * 1e6, (elapsed[1] - elapsed[0]) * 1e9 / refs);
+  }
+}
+
+#if defined BENCH_CXA
+
+typedef char *(*cxa_demangle_t)(const char *mangled_name, char *output_buffer, size_t *length, int *status);
+char *__cxa_demangle(const char *mangled_name, char *output_buffer, size_t *length, int *status);
+
+static double time_cxa(cxa_demangle_t func, long rounds, size_t *ok)
+{
+  size_t count = sizeof testcases / sizeof testcases[0];
+  *ok = 0;
+  double start = timestamp();
+  for (long r = 0; r < rounds; r++) {
+    for (size_t i = 0; i < count; i++) {
+      int status;
+      char *plain = func(testcases[i], NULL, NULL, &status);
+      if (status == 0)
+        *ok += 1;
+      free(plain);
+    }
+  }
+  return (timestamp() - start) * 1e9 / (count * rounds);
+}
+
+static void bench_cxa(long rounds)
+{
+  size_t ok;
+  void *lib = dlopen("libstdc++.so.6", RTLD_NOW | RTLD_LOCAL);
+  cxa_demangle_t system = (lib != NULL) ? (cxa_demangle_t)dlsym(lib, "__cxa_demangle") : NULL;
+  if (system != NULL) {
+    double ns = time_cxa(system, rounds, &ok);
+    printf("__cxa_demangle (libstdc++): %.1f ns/symbol (%lu ok)\n", ns, (unsigned long)ok);
+  } else {
+    printf("__cxa_demangle (libstdc++): not found\n");
+  }
+  double ns = time_cxa(__cxa_demangle, rounds, &ok);
+  printf("__cxa_demangle (cached):    %.1f ns/symbol (%lu ok)\n", ns, (unsigned long)ok);
+  if (lib != NULL)
+    dlclose(lib);
+}
+
+#endif /* BENCH_CXA */
+
+#if defined BENCH_NAMESTORE
+
+#define LOOKUPS   200000
+
+static int compare_strings(const void *a, const void *b)
+{
+  return strcmp(*(const char * const *)a, *(const char * const *)b);
+}
+
+static int bench_namestore(const char *filename)
+{
+  FILE *fp = fopen(filename, "r");
+  if (fp == NULL) {
+    fprintf(stderr, "cannot open %s\n", filename);
+    return 1;
+  }
+  /* demangle all names into a plain string table, and into the builder */
+  struct namestore_builder *builder = namestore_builder_create();
+  size_t textsize = 0, textmax = 1 << 20, count = 0, max = 1024;
+  char *text = malloc(textmax);
+  size_t *offsets = malloc(max * sizeof(size_t));
+  static char mangled[MAX_INPUT], plain[4 * MAX_INPUT];
+  while (fgets(mangled, sizeof mangled, fp) != NULL) {
+    mangled[strcspn(mangled, "\r\n")] = '\0';
+    if (!demangle(plain, sizeof plain, mangled))
+      continue;
+    size_t length = strlen(plain) + 1;
+    if (textsize + length > textmax) {
+      while (textsize + length > textmax)
+        textmax *= 2;
+      text = realloc(text, textmax);
+    }
+    if (count == max)
+      offsets = realloc(offsets, (max *= 2) * sizeof(size_t));
+    if (builder == NULL || text == NULL || offsets == NULL) {
+      fprintf(stderr, "out of memory\n");
+      return 1;
+    }
+    memcpy(text + textsize, plain, length);
+    offsets[count++] = textsize;
+    textsize += length;
+    namestore_builder_add_plain(builder, plain);
+  }
+  fclose(fp);
+
+  /* the plain table: sorted, without duplicates, with a pointer per name */
+  const char **table = malloc((count + 1) * sizeof(char*));
+  for (size_t i = 0; i < count; i++)
+    table[i] = text + offsets[i];
+  qsort(table, count, sizeof(char*), compare_strings);
+  size_t unique = 0, tablesize = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (unique == 0 || strcmp(table[unique - 1], table[i]) != 0) {
+      table[unique++] = table[i];
+      tablesize += strlen(table[i]) + 1 + sizeof(uint64_t);
+    }
+  }
+
+  const char *storefile = "bench_namestore.tmp";
+  double start = timestamp();
+  if (!namestore_builder_write(builder, storefile)) {
+    fprintf(stderr, "cannot write %s\n", storefile);
+    return 1;
+  }
+  double built = timestamp() - start;
+  namestore_builder_destroy(builder);
+  struct namestore *store = namestore_open(storefile);
+  fp = fopen(storefile, "rb");
+  fseek(fp, 0, SEEK_END);
+  long storesize = ftell(fp);
+  fclose(fp);
+  printf("%lu names, %lu unique; plain table %lu bytes, name store %ld bytes (%.1f%%), built in %.2f s\n",
+         (unsigned long)count, (unsigned long)unique, (unsigned long)tablesize, storesize,
+         100.0 * storesize / tablesize, built);
+
+  /* look up names in a pseudo-random order */
+  uint32_t seed = 12345;
+  size_t found = 0;
+  start = timestamp();
+  for (long i = 0; i < LOOKUPS; i++) {
+    seed = seed * 1103515245 + 12345;
+    const char *name = table[seed % unique];
+    size_t low = 0, high = unique;
+    while (low < high) {
+      size_t mid = (low + high) / 2;
+      if (strcmp(table[mid], name) < 0)
+        low = mid + 1;
+      else
+        high = mid;
+    }
+    found += (low < unique && strcmp(table[low], name) == 0);
+  }
+  double t_table = timestamp() - start;
+  seed = 12345;
+  start = timestamp();
+  for (long i = 0; i < LOOKUPS; i++) {
+    seed = seed * 1103515245 + 12345;
+    found += namestore_find(store, table[seed % unique], NULL);
+  }
+  double t_store = timestamp() - start;
+  seed = 12345;
+  start = timestamp();
+  for (long i = 0; i < LOOKUPS; i++) {
+    seed = seed * 1103515245 + 12345;
+    found += (namestore_get(store, seed % unique, plain, sizeof plain) > 0);
+  }
+  double t_get = timestamp() - start;
+  printf("lookup by name: plain table %.0f ns, name store %.0f ns; by id: name store %.0f ns (%lu found)\n",
+         t_table * 1e9 / LOOKUPS, t_store * 1e9 / LOOKUPS, t_get * 1e9 / LOOKUPS, (unsigned long)found);
+
+  namestore_close(store);
+  remove(storefile);
+  free(table);
+  free(offsets);
+  free(text);
+  return 0;
+}
+
+#endif /* BENCH_NAMESTORE */
+
+/** load_input() reads a corpus file; a trailing newline is stripped. */
+static char *load_input(const char *path, size_t *length)
+{
+  FILE *fp = fopen(path, "rb");
+  if (fp == NULL)
+    return NULL;
+  char *buffer = malloc(MAX_INPUT + 1);
+  if (buffer == NULL) {
+    fclose(fp);
+    return NULL;
+  }
+  size_t len = fread(buffer, 1, MAX_INPUT, fp);
+  fclose(fp);
+  while (len > 0 && (buffer[len - 1] == '\n' || buffer[len - 1] == '\r'))
+    len--;
+  buffer[len] = '\0';
+  *length = len;
+  return buffer;
+}
+
+static int bench_corpus(const char *dirname, long limit_us)
+{
+  DIR *dir = opendir(dirname);
+  if (dir == NULL) {
+    fprintf(stderr, "cannot open corpus directory %s\n", dirname);
+    return 1;
+  }
+  size_t plainsize = 4 * MAX_INPUT;
+  char *plain = malloc(plainsize);
+  if (plain == NULL) {
+    closedir(dir);
+    return 1;
+  }
+
+  int failures = 0;
+  int count = 0;
+  struct dirent *entry;
+  while ((entry = readdir(dir)) != NULL) {
+    if (entry->d_name[0] == '.')
+      continue;
+    char path[1024];
+    snprintf(path, sizeof path, "%s/%s", dirname, entry->d_name);
+    size_t length;
+    char *mangled = load_input(path, &length);
+    if (mangled == NULL)
+      continue;
+    /* take the fastest of a few runs, to filter out scheduling noise */
+    double best = 0;
+    for (int r = 0; r < CORPUS_ROUNDS; r++) {
+      double start = timestamp();
+      demangle(plain, plainsize, mangled);
+      double elapsed = timestamp() - start;
+      if (r == 0 || elapsed < best)
+        best = elapsed;
+    }
+    long us = (long)(best * 1e6);
+    bool slow = (us > limit_us);
+    if (slow)
+      failures++;
+    count++;
+    printf("%-40s %6lu bytes %8ld us%s\n", entry->d_name, (unsigned long)length, us, slow ? "  ** over limit **" : "");
+    free(mangled);
+  }
+  closedir(dir);
+  free(plain);
+
+  printf("corpus %s: %d inputs, %d over the limit of %ld us\n", dirname, count, failures, limit_us);
+  return failures > 0;
+}
+
+int main(int argc, char *argv[])
+{
+  long rounds = DEFAULT_ROUNDS;
+  long limit = DEFAULT_LIMIT;
+  const char *corpus = NULL;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-rounds") == 0 && i + 1 < argc) {
+      rounds = strtol(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "-corpus") == 0 && i + 1 < argc) {
+      corpus = argv[++i];
+    } else if (strcmp(argv[i], "-limit") == 0 && i + 1 < argc) {
+      limit = strtol(argv[++i], NULL, 10);
+#if defined BENCH_NAMESTORE
+    } else if (strcmp(argv[i], "-names") == 0 && i + 1 < argc) {
+      return bench_namestore(argv[++i]);
+#endif
+    } else {
+      fprintf(stderr, "Usage: bench [-rounds n] [-corpus directory] [-limit microseconds] [-names file]\n");
+      return 1;
+    }
+  }
+
+  if (corpus != NULL)
+    return bench_corpus(corpus, limit);
+  bench_testcases(rounds);
+  bench_substitutions(rounds);
+# if defined BENCH_CXA
+    bench_cxa(rounds);
+# endif
+  return 0;
+}
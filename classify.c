@@ -0,0 +1,813 @@
+/* GNU C++ symbol name demangler
+ * Classification of mangled names, without demangling them.
+ *
+ * The classifier walks the same productions as the demangler (<encoding>,
+ * <name>, <nested-name>, <type>, <template-args>), but it only skips over them:
+ * there is no output, and substitutions and template parameters need not be
+ * resolved (their codes are self-delimiting). This is much cheaper than a full
+ * demangle(), and it is enough to tell what kind of entity a symbol is.
+ *
+ * Copyright 2022-2024, CompuPhase
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <assert.h>
+#include <string.h>
+#include "classify.h"
+#include "demangle_tables.h"
+
+#define sizearray(a)        (sizeof(a) / sizeof((a)[0]))
+#if !defined MAX_PARSE_DEPTH
+# define MAX_PARSE_DEPTH    128   /* same limit as in demangle.c */
+#endif
+
+struct scan {
+  const char *pos;      /**< current position */
+  bool valid;
+  short level;          /**< recursion depth */
+  unsigned flags;       /**< flags of the last component of the name */
+  int depth;            /**< number of components of the name */
+  struct name_component *components;  /**< output of classify_name(), or NULL */
+  int max_components;
+  int count;            /**< number of components found by classify_name() */
+};
+
+static void skip_type(struct scan *scan);
+static void skip_name(struct scan *scan);
+static void skip_encoding(struct scan *scan);
+static void skip_expression(struct scan *scan);
+
+static bool is_digit(char c)
+{
+  return c >= '0' && c <= '9';
+}
+
+static bool is_upper(char c)
+{
+  return c >= 'A' && c <= 'Z';
+}
+
+static bool match(struct scan *scan, const char *keyword)
+{
+  size_t len = strlen(keyword);
+  if (scan->valid && strncmp(scan->pos, keyword, len) == 0) {
+    scan->pos += len;
+    return true;
+  }
+  return false;
+}
+
+static void expect(struct scan *scan, const char *keyword)
+{
+  if (scan->valid && !match(scan, keyword))
+    scan->valid = false;
+}
+
+static bool on_sentinel(const struct scan *scan)
+{
+  return !scan->valid || *scan->pos == '\0' || *scan->pos == '.'
+         || (*scan->pos == '@' && *(scan->pos + 1) == '@');
+}
+
+static bool enter_level(struct scan *scan)
+{
+  scan->level += 1;
+  if (scan->level > MAX_PARSE_DEPTH)
+    scan->valid = false;
+  return scan->valid;
+}
+
+static void leave_level(struct scan *scan)
+{
+  assert(scan->level > 0);
+  scan->level -= 1;
+}
+
+static void skip_digits(struct scan *scan)
+{
+  while (is_digit(*scan->pos))
+    scan->pos += 1;
+}
+
+/** skip_source_name() - returns the length of the identifier (which ends at
+ *  the new position), or 0 on error.
+ */
+static size_t skip_source_name(struct scan *scan)
+{
+  if (!scan->valid)
+    return 0;
+  if (!is_digit(*scan->pos)) {
+    scan->valid = false;
+    return 0;
+  }
+  size_t count = 0;
+  while (is_digit(*scan->pos)) {
+    count = count * 10 + (*scan->pos - '0');
+    if (count > 0xffff) {
+      scan->valid = false;
+      return 0;
+    }
+    scan->pos += 1;
+  }
+  if (memchr(scan->pos, '\0', count) != NULL) {
+    scan->valid = false;
+    return 0;
+  }
+  scan->pos += count;
+  return count;
+}
+
+/** add_component() - records a component of the name of the symbol, for
+ *  classify_name(). Components are only recorded outside of types and
+ *  template arguments (see skip_type() and skip_template_args()).
+ */
+static void add_component(struct scan *scan, int kind, const char *text, size_t length)
+{
+  if (scan->components == NULL || !scan->valid)
+    return;
+  if (scan->count < scan->max_components) {
+    struct name_component *c = &scan->components[scan->count];
+    c->text = text;
+    c->length = (unsigned short)length;
+    c->kind = (unsigned char)kind;
+    c->templated = 0;
+  }
+  scan->count += 1;
+}
+
+/** add_abbreviation() - records the components of "std::string" and the like. */
+static void add_abbreviation(struct scan *scan, const char *code)
+{
+  for (size_t i = 0; i < sizearray(abbreviations); i++) {
+    if (strncmp(code, abbreviations[i].abbrev, 2) == 0) {
+      const char *text = abbreviations[i].name;
+      const char *sep;
+      while ((sep = strstr(text, "::")) != NULL) {
+        add_component(scan, COMPONENT_NAME, text, sep - text);
+        text = sep + 2;
+      }
+      add_component(scan, COMPONENT_NAME, text, strlen(text));
+      return;
+    }
+  }
+}
+
+static void mark_template(struct scan *scan)
+{
+  scan->flags |= SYMBOL_TEMPLATE;
+  if (scan->components != NULL && scan->count > 0 && scan->count <= scan->max_components)
+    scan->components[scan->count - 1].templated = 1;
+}
+
+/** is_operator() - returns the index in the operators table, or -1. */
+static int is_operator(const struct scan *scan)
+{
+  if (scan->pos[0] == '\0' || scan->pos[1] == '\0')
+    return -1;
+  for (size_t i = 0; i < sizearray(operators); i++)
+    if (strncmp(scan->pos, operators[i].abbrev, strlen(operators[i].abbrev)) == 0)
+      return i;
+  return -1;
+}
+
+static bool is_builtin_type(struct scan *scan)
+{
+  for (size_t i = 0; i < sizearray(types); i++) {
+    size_t len = strlen(types[i].abbrev);
+    if (strncmp(scan->pos, types[i].abbrev, len) == 0) {
+      scan->pos += len;
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool is_abbreviation(const struct scan *scan)
+{
+  for (size_t i = 0; i < sizearray(abbreviations); i++)
+    if (strncmp(scan->pos, abbreviations[i].abbrev, 2) == 0)
+      return true;
+  return false;
+}
+
+static bool is_substitution(const struct scan *scan)
+{
+  char c = scan->pos[1];
+  return scan->pos[0] == 'S' && (is_digit(c) || is_upper(c) || c == '_');
+}
+
+static bool is_template_param(const struct scan *scan)
+{
+  char c = scan->pos[1];
+  return scan->pos[0] == 'T' && (is_digit(c) || c == '_');
+}
+
+static void skip_seq_id(struct scan *scan, char prefix)
+{
+  /* S [<seq-id>] _   or   T [<number>] _ */
+  expect(scan, prefix == 'S' ? "S" : "T");
+  while (scan->valid && (is_digit(*scan->pos) || is_upper(*scan->pos)))
+    scan->pos += 1;
+  expect(scan, "_");
+}
+
+static void skip_discriminator(struct scan *scan)
+{
+  if (match(scan, "_")) {
+    if (match(scan, "_")) {
+      skip_digits(scan);
+      expect(scan, "_");
+    } else if (is_digit(*scan->pos)) {
+      scan->pos += 1;
+    } else {
+      scan->valid = false;
+    }
+  }
+}
+
+static void skip_template_args(struct scan *scan)
+{
+  /* I <template-arg>* E */
+  struct name_component *components = scan->components;
+  scan->components = NULL;
+  expect(scan, "I");
+  while (scan->valid && !match(scan, "E")) {
+    if (*scan->pos == '\0') {
+      scan->valid = false;
+    } else if (match(scan, "J")) {
+      while (scan->valid && !match(scan, "E")) {
+        if (*scan->pos == '\0')
+          scan->valid = false;
+        else
+          skip_type(scan);
+      }
+    } else if (match(scan, "X")) {
+      skip_expression(scan);
+      expect(scan, "E");
+    } else {
+      skip_type(scan);  /* also handles L <expr-primary> */
+    }
+  }
+  scan->components = components;
+}
+
+static void skip_expr_primary(struct scan *scan)
+{
+  /* L <type> <value> E, L _Z <encoding> E */
+  expect(scan, "L");
+  if (match(scan, "_Z")) {
+    skip_encoding(scan);
+  } else if (scan->valid) {
+    skip_type(scan);
+    while (scan->valid && *scan->pos != 'E' && *scan->pos != '\0')
+      scan->pos += 1;   /* number, float or nothing (string literal) */
+  }
+  expect(scan, "E");
+}
+
+static void skip_expression(struct scan *scan)
+{
+  if (!enter_level(scan)) {
+    /* nesting too deep */
+  } else if (strncmp(scan->pos, "fp", 2) == 0 && (scan->pos[2] == '_' || is_digit(scan->pos[2]))) {
+    scan->pos += 2;
+    skip_digits(scan);
+    expect(scan, "_");
+  } else if (is_digit(*scan->pos)) {
+    skip_source_name(scan);
+  } else if (is_substitution(scan)) {
+    skip_seq_id(scan, 'S');
+  } else if (is_template_param(scan)) {
+    skip_seq_id(scan, 'T');
+  } else if (*scan->pos == 'L') {
+    skip_expr_primary(scan);
+  } else if (is_operator(scan) >= 0) {
+    int index = is_operator(scan);
+    scan->pos += strlen(operators[index].abbrev);
+    for (int i = 0; i < operators[index].operands && scan->valid; i++)
+      skip_expression(scan);
+    if (operators[index].operands == 0 || operators[index].operands == 3)
+      scan->valid = false;  /* not supported by demangle() either */
+  } else {
+    scan->valid = false;
+  }
+  leave_level(scan);
+}
+
+/** skip_unqualified_name() - skips one component of a name, and sets the
+ *  flags for it.
+ */
+static void add_class_component(struct scan *scan, int kind)
+{
+  /* the name of a constructor or destructor is that of its class */
+  const struct name_component *prev = NULL;
+  if (scan->components != NULL && scan->count > 0 && scan->count <= scan->max_components)
+    prev = &scan->components[scan->count - 1];
+  if (prev != NULL && prev->kind == COMPONENT_NAME)
+    add_component(scan, kind, prev->text, prev->length);
+  else
+    add_component(scan, kind, "", 0);
+}
+
+static void skip_unqualified_name(struct scan *scan)
+{
+  if (!scan->valid)
+    return;
+  scan->flags &= ~(SYMBOL_TEMPLATE | SYMBOL_CTOR | SYMBOL_DTOR | SYMBOL_OPERATOR);
+  scan->depth += 1;
+  const char *p = scan->pos;
+  if ((p[0] == 'C' && (p[1] == '1' || p[1] == '2' || p[1] == '3'))
+      || (p[0] == 'C' && p[1] == 'I' && (p[2] == '1' || p[2] == '2'))) {
+    scan->flags |= SYMBOL_CTOR;
+    scan->pos += (p[1] == 'I') ? 3 : 2;
+    if (p[1] == 'I')
+      skip_type(scan);  /* base class type */
+    add_class_component(scan, COMPONENT_CTOR);
+  } else if (p[0] == 'D' && (p[1] == '0' || p[1] == '1' || p[1] == '2')) {
+    scan->flags |= SYMBOL_DTOR;
+    scan->pos += 2;
+    add_class_component(scan, COMPONENT_DTOR);
+  } else if (is_digit(*p)) {
+    size_t len = skip_source_name(scan);
+    add_component(scan, COMPONENT_NAME, scan->pos - len, len);
+  } else if (match(scan, "L")) {
+    size_t len = skip_source_name(scan);
+    add_component(scan, COMPONENT_NAME, scan->pos - len, len);
+    skip_discriminator(scan);
+  } else if (match(scan, "DC")) {
+    while (scan->valid && is_digit(*scan->pos))
+      skip_source_name(scan);
+    expect(scan, "E");
+    add_component(scan, COMPONENT_OTHER, p, scan->pos - p);
+  } else if (match(scan, "Ut")) {
+    skip_digits(scan);
+    expect(scan, "_");
+    add_component(scan, COMPONENT_OTHER, p, scan->pos - p);
+  } else if (match(scan, "Ul")) {
+    while (scan->valid && !match(scan, "E")) {
+      if (*scan->pos == '\0')
+        scan->valid = false;
+      else
+        skip_type(scan);
+    }
+    skip_digits(scan);
+    expect(scan, "_");
+    add_component(scan, COMPONENT_OTHER, p, scan->pos - p);
+  } else if (is_operator(scan) >= 0) {
+    int index = is_operator(scan);
+    scan->flags |= SYMBOL_OPERATOR;
+    scan->pos += strlen(operators[index].abbrev);
+    if (index == 0) {
+      skip_type(scan);  /* conversion operator: "cv" <type> */
+      add_component(scan, COMPONENT_OPERATOR, "", 0);
+    } else {
+      add_component(scan, COMPONENT_OPERATOR, operators[index].name, strlen(operators[index].name));
+    }
+  } else {
+    scan->valid = false;
+  }
+  /* <abi-tag>* */
+  while (scan->valid && match(scan, "B"))
+    skip_source_name(scan);
+}
+
+static void skip_nested_name(struct scan *scan)
+{
+  /* N [<CV-qualifiers>] [<ref-qualifier>] <prefix> <name-param>* E */
+  expect(scan, "N");
+  while (*scan->pos == 'r' || *scan->pos == 'V' || *scan->pos == 'K')
+    scan->pos += 1;
+  if (*scan->pos == 'R' || *scan->pos == 'O')
+    scan->pos += 1;
+  while (scan->valid && !match(scan, "E")) {
+    if (*scan->pos == '\0') {
+      scan->valid = false;
+    } else if (*scan->pos == 'I') {
+      skip_template_args(scan);
+      mark_template(scan);
+    } else if (match(scan, "M")) {
+      /* closure prefix, ignore */
+    } else if (is_abbreviation(scan) || is_substitution(scan)) {
+      const char *start = scan->pos;
+      if (is_abbreviation(scan)) {
+        add_abbreviation(scan, start);
+        scan->pos += 2;
+      } else {
+        skip_seq_id(scan, 'S');
+        add_component(scan, COMPONENT_OTHER, start, scan->pos - start);
+      }
+      scan->flags = scan->flags & SYMBOL_LOCAL;
+      scan->depth += 1;
+    } else if (is_template_param(scan)) {
+      const char *start = scan->pos;
+      skip_seq_id(scan, 'T');
+      add_component(scan, COMPONENT_OTHER, start, scan->pos - start);
+      scan->flags = scan->flags & SYMBOL_LOCAL;
+      scan->depth += 1;
+    } else if (*scan->pos == 'D' && (scan->pos[1] == 't' || scan->pos[1] == 'T')) {
+      const char *start = scan->pos;
+      struct name_component *components = scan->components;
+      scan->components = NULL;
+      scan->pos += 2;
+      skip_expression(scan);
+      expect(scan, "E");
+      scan->components = components;
+      add_component(scan, COMPONENT_OTHER, start, scan->pos - start);
+      scan->depth += 1;
+    } else {
+      skip_unqualified_name(scan);
+    }
+  }
+}
+
+static void skip_local_name(struct scan *scan)
+{
+  /* Z <function-encoding> E <(entity) name> [<discriminator>]
+     Z <function-encoding> E s [<discriminator>] */
+  expect(scan, "Z");
+  skip_encoding(scan);
+  expect(scan, "E");
+  scan->flags = SYMBOL_LOCAL;
+  if (match(scan, "s")) {
+    scan->depth += 1;   /* string literal */
+    add_component(scan, COMPONENT_OTHER, "string literal", 14);
+  } else
+    skip_name(scan);
+  scan->flags |= SYMBOL_LOCAL;
+  skip_discriminator(scan);
+}
+
+static void skip_name(struct scan *scan)
+{
+  /* <name> := <nested-name> | <local-name> | <unscoped-name> [<template-args>]
+               | <substitution> <template-args> */
+  if (!enter_level(scan)) {
+    /* nesting too deep */
+  } else if (*scan->pos == 'N') {
+    skip_nested_name(scan);
+  } else if (*scan->pos == 'Z') {
+    skip_local_name(scan);
+  } else {
+    const char *start = scan->pos;
+    if (match(scan, "St")) {
+      scan->depth += 1;
+      add_abbreviation(scan, start);
+      skip_unqualified_name(scan);
+    } else if (is_substitution(scan) || is_abbreviation(scan)) {
+      if (is_abbreviation(scan)) {
+        add_abbreviation(scan, start);
+        scan->pos += 2;
+      } else {
+        skip_seq_id(scan, 'S');
+        add_component(scan, COMPONENT_OTHER, start, scan->pos - start);
+      }
+      scan->depth += 1;
+    } else {
+      skip_unqualified_name(scan);
+    }
+    if (scan->valid && *scan->pos == 'I') {
+      skip_template_args(scan);
+      mark_template(scan);
+    }
+  }
+  leave_level(scan);
+}
+
+static void skip_type(struct scan *scan)
+{
+  if (!enter_level(scan)) {
+    leave_level(scan);
+    return;
+  }
+  /* a type may hold names (template arguments, nested types); these must not
+     change the flags and depth of the name of the symbol */
+  unsigned flags = scan->flags;
+  int depth = scan->depth;
+  struct name_component *components = scan->components;
+  scan->components = NULL;
+  char c = *scan->pos;
+  if (c == '\0') {
+    scan->valid = false;
+  } else if (c == 'r' || c == 'V' || c == 'K' || c == 'P' || c == 'R' || c == 'O' || c == 'C' || c == 'G') {
+    scan->pos += 1;
+    skip_type(scan);
+  } else if (match(scan, "U")) {
+    skip_source_name(scan);
+    if (*scan->pos == 'I')
+      skip_template_args(scan);
+    skip_type(scan);
+  } else if (match(scan, "Do") || match(scan, "Dx")) {
+    skip_type(scan);   /* exception specification before a function type */
+  } else if (match(scan, "DO")) {
+    skip_expression(scan);
+    expect(scan, "E");
+    skip_type(scan);
+  } else if (match(scan, "Dw")) {
+    while (scan->valid && !match(scan, "E"))
+      skip_type(scan);
+    skip_type(scan);
+  } else if (match(scan, "F")) {
+    match(scan, "Y");
+    while (scan->valid && !match(scan, "E")) {
+      if (*scan->pos == '\0')
+        scan->valid = false;
+      else if ((*scan->pos == 'R' || *scan->pos == 'O') && scan->pos[1] == 'E')
+        scan->pos += 1;   /* <ref-qualifier> */
+      else
+        skip_type(scan);
+    }
+  } else if (match(scan, "A")) {
+    if (*scan->pos == '_' || is_digit(*scan->pos))
+      skip_digits(scan);
+    else
+      skip_expression(scan);
+    expect(scan, "_");
+    skip_type(scan);
+  } else if (match(scan, "M")) {
+    skip_type(scan);
+    skip_type(scan);
+  } else if (match(scan, "Dp")) {
+    skip_type(scan);
+  } else if (match(scan, "Dt") || match(scan, "DT")) {
+    skip_expression(scan);
+    expect(scan, "E");
+  } else if (match(scan, "Dv")) {
+    if (is_digit(*scan->pos))
+      skip_digits(scan);
+    else
+      skip_expression(scan);
+    expect(scan, "_");
+    skip_type(scan);
+  } else if (is_builtin_type(scan)) {
+    /* nothing else to skip */
+  } else if (c == 'u' && is_digit(scan->pos[1])) {
+    scan->pos += 1;
+    skip_source_name(scan);
+  } else if (c == 'L') {
+    skip_expr_primary(scan);
+  } else if (is_template_param(scan)) {
+    skip_seq_id(scan, 'T');
+    if (*scan->pos == 'I')
+      skip_template_args(scan);
+  } else {
+    skip_name(scan);  /* class/enum type, <substitution>, "St" */
+  }
+  scan->flags = flags;
+  scan->depth = depth;
+  scan->components = components;
+  leave_level(scan);
+}
+
+static void skip_encoding(struct scan *scan)
+{
+  if (!enter_level(scan)) {
+    leave_level(scan);
+    return;
+  }
+  if (match(scan, "Th")) {
+    match(scan, "n");   /* negative offset */
+    skip_digits(scan);
+    expect(scan, "_");
+    skip_encoding(scan);
+  } else if (match(scan, "Tv")) {
+    match(scan, "n");
+    skip_digits(scan);
+    expect(scan, "_");
+    match(scan, "n");
+    skip_digits(scan);
+    expect(scan, "_");
+    skip_encoding(scan);
+  } else {
+    skip_name(scan);
+    /* parameter types (absent for variables) */
+    while (scan->valid && !on_sentinel(scan) && *scan->pos != 'E')
+      skip_type(scan);
+  }
+  leave_level(scan);
+}
+
+static void init_scan(struct scan *scan, const char *mangled)
+{
+  scan->pos = mangled + 2;
+  scan->valid = true;
+  scan->level = 0;
+  scan->flags = 0;
+  scan->depth = 0;
+  scan->components = NULL;
+  scan->max_components = 0;
+  scan->count = 0;
+}
+
+static bool is_name_start(char c)
+{
+  return is_digit(c) || c == 'N' || c == 'Z' || c == 'S';
+}
+
+/** scan_symbol() - skips the special-name prefix and the name of a symbol
+ *  (the part after "_Z"), and returns its kind. The parameter types of a
+ *  function are only skipped when "full" is true.
+ */
+static enum symbol_kind scan_symbol(struct scan *scan, bool full)
+{
+  enum symbol_kind kind;
+  const char *p = scan->pos;
+  if (p[0] == 'T') {
+    switch (p[1]) {
+    case 'V':
+    case 'C':   /* construction vtable */
+      kind = SYMBOL_VTABLE;
+      break;
+    case 'T':
+      kind = SYMBOL_VTT;
+      break;
+    case 'I':
+      kind = SYMBOL_TYPEINFO;
+      break;
+    case 'S':
+      kind = SYMBOL_TYPEINFO_NAME;
+      break;
+    case 'h':
+    case 'v':
+    case 'c':
+      kind = SYMBOL_THUNK;
+      break;
+    default:
+      kind = SYMBOL_SPECIAL;  /* TH, TW, TA, ... */
+    }
+    if (kind == SYMBOL_THUNK) {
+      skip_encoding(scan);
+    } else if (p[1] == 'C') {
+      /* TC <(derived) type> <number> _ <(base) type> */
+      scan->pos += 2;
+      skip_type(scan);
+      skip_digits(scan);
+      expect(scan, "_");
+      skip_type(scan);
+    } else if (kind != SYMBOL_SPECIAL) {
+      scan->pos += 2;
+      /* for classify_name(), the components are those of the class */
+      if (scan->components != NULL && is_name_start(*scan->pos))
+        skip_name(scan);
+      else
+        skip_type(scan);
+    } else {
+      scan->pos += 2;
+      skip_name(scan);
+    }
+  } else if (p[0] == 'G') {
+    if (p[1] == 'V') {
+      kind = SYMBOL_GUARD;
+      scan->pos += 2;
+      skip_name(scan);
+    } else if (p[1] == 'R') {
+      kind = SYMBOL_TEMPORARY;
+      scan->pos += 2;
+      skip_name(scan);
+      while (is_digit(*scan->pos) || is_upper(*scan->pos))
+        scan->pos += 1;  /* optional <seq-id> */
+      expect(scan, "_");
+    } else {
+      kind = SYMBOL_SPECIAL;  /* GTt, ... */
+      scan->pos += 2;
+      while (*scan->pos >= 'a' && *scan->pos <= 'z')
+        scan->pos += 1;
+      skip_encoding(scan);
+    }
+  } else {
+    skip_name(scan);
+    kind = on_sentinel(scan) ? SYMBOL_VARIABLE : SYMBOL_FUNCTION;
+    while (full && scan->valid && !on_sentinel(scan))
+      skip_type(scan);
+  }
+  return kind;
+}
+
+/** classify() - determines the kind of entity that a mangled name refers to,
+ *  and the shape of its name, without demangling it. Returns false if the name
+ *  is not a (valid) mangled name; info->kind is set in all cases.
+ */
+bool classify(const char *mangled, struct symbol_info *info)
+{
+  assert(mangled != NULL);
+  assert(info != NULL);
+  info->kind = SYMBOL_NOT_MANGLED;
+  info->flags = 0;
+  info->depth = 0;
+  if (mangled[0] != '_' || mangled[1] != 'Z')
+    return false;
+
+  struct scan scan;
+  init_scan(&scan, mangled);
+  enum symbol_kind kind = scan_symbol(&scan, true);
+
+  if (scan.valid && *scan.pos == '.')
+    scan.flags |= SYMBOL_CLONE;
+  else if (scan.valid && *scan.pos != '\0' && *scan.pos != '@')
+    scan.valid = false;
+  if (!scan.valid) {
+    info->kind = SYMBOL_INVALID;
+    return false;
+  }
+  info->kind = kind;
+  info->flags = scan.flags;
+  info->depth = scan.depth;
+  return true;
+}
+
+/** classify_name() - splits the qualified name of the entity that a mangled
+ *  name refers to into its components ("foo", "Bar", "baz" for foo::Bar::baz),
+ *  without demangling it. The text of a component points into the mangled
+ *  name (or into a static string for abbreviations like "std::string"), and it
+ *  is not zero-terminated.
+ *
+ *  For special names, the components are those of the entity that the special
+ *  name refers to (the class for a vtable, the function for a thunk). The
+ *  parameter types of a function are not checked.
+ *
+ *  Returns the number of components, which may be larger than "max" (only the
+ *  first "max" components are stored then), or -1 if the name is not a valid
+ *  mangled name.
+ */
+int classify_name(const char *mangled, struct name_component *components, int max)
+{
+  assert(mangled != NULL);
+  assert(components != NULL || max == 0);
+  if (mangled[0] != '_' || mangled[1] != 'Z')
+    return -1;
+
+  struct name_component dummy;
+  struct scan scan;
+  init_scan(&scan, mangled);
+  scan.components = (max > 0) ? components : &dummy;
+  scan.max_components = max;
+  scan_symbol(&scan, false);
+  return scan.valid ? scan.count : -1;
+}
+
+/** classify_batch() - classifies an array of names. */
+void classify_batch(const char *const *names, size_t count, struct symbol_info *info)
+{
+  assert(names != NULL || count == 0);
+  assert(info != NULL || count == 0);
+  for (size_t i = 0; i < count; i++) {
+    const char *name = names[i];
+    /* prefilter: most symbols of a mixed C/C++ program are rejected on the
+       first byte, without the function call */
+    if (name[0] != '_' || name[1] != 'Z') {
+      info[i].kind = SYMBOL_NOT_MANGLED;
+      info[i].flags = 0;
+      info[i].depth = 0;
+    } else {
+      classify(name, &info[i]);
+    }
+  }
+}
+
+/** classify_strtab() - classifies all names in a string table (a block of
+ *  zero-terminated strings, such as the .strtab or .dynstr section of an ELF
+ *  file), and calls the callback for the names whose kind is in "kindmask"
+ *  (see SYMBOL_KIND_MASK). Returns the number of names passed to the callback.
+ *
+ *  Names without "_Z" prefix are skipped with memchr(), which the C library
+ *  implements with vector instructions.
+ */
+size_t classify_strtab(const char *strtab, size_t size, unsigned kindmask,
+                       void (*callback)(const char *name, const struct symbol_info *info, void *arg),
+                       void *arg)
+{
+  assert(strtab != NULL || size == 0);
+  assert(callback != NULL);
+  size_t matches = 0;
+  const char *end = strtab + size;
+  const char *p = strtab;
+  bool want_plain = (kindmask & SYMBOL_KIND_MASK(SYMBOL_NOT_MANGLED)) != 0;
+  while (p < end) {
+    const char *next = memchr(p, '\0', end - p);
+    if (next == NULL)
+      break;    /* last string is not terminated, ignore it */
+    if (p[0] == '_' && next - p >= 2 && p[1] == 'Z') {
+      struct symbol_info info;
+      classify(p, &info);
+      if (kindmask & SYMBOL_KIND_MASK(info.kind)) {
+        callback(p, &info, arg);
+        matches++;
+      }
+    } else if (want_plain && next > p) {
+      struct symbol_info info = { SYMBOL_NOT_MANGLED, 0, 0 };
+      callback(p, &info, arg);
+      matches++;
+    }
+    p = next + 1;
+  }
+  return matches;
+}
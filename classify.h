@@ -0,0 +1,86 @@
+/* GNU C++ symbol name demangler
+ * Classification of mangled names, without demangling them.
+ *
+ * Copyright 2022-2024, CompuPhase
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _CLASSIFY_H
+#define _CLASSIFY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+enum symbol_kind {
+  SYMBOL_NOT_MANGLED,   /* no "_Z" prefix (C symbol, or not a symbol at all) */
+  SYMBOL_INVALID,       /* "_Z" prefix, but not a valid mangled name */
+  SYMBOL_FUNCTION,
+  SYMBOL_VARIABLE,      /* global or static data (including local statics) */
+  SYMBOL_VTABLE,        /* TV */
+  SYMBOL_VTT,           /* TT */
+  SYMBOL_TYPEINFO,      /* TI */
+  SYMBOL_TYPEINFO_NAME, /* TS */
+  SYMBOL_THUNK,         /* Th, Tv, Tc */
+  SYMBOL_GUARD,         /* GV, guard variable of a local static */
+  SYMBOL_TEMPORARY,     /* GR, lifetime-extended reference temporary */
+  SYMBOL_SPECIAL,       /* other special names (TLS wrappers, transaction clones, ...) */
+  SYMBOL_KINDS          /* number of kinds */
+};
+
+/* flags for symbol_info.flags */
+#define SYMBOL_TEMPLATE   0x01  /* the entity has template arguments */
+#define SYMBOL_CTOR       0x02  /* constructor */
+#define SYMBOL_DTOR       0x04  /* destructor */
+#define SYMBOL_OPERATOR   0x08  /* operator function (including conversion operators) */
+#define SYMBOL_LOCAL      0x10  /* entity is local to a function (e.g. local static) */
+#define SYMBOL_CLONE      0x20  /* has a clone suffix (e.g. ".constprop.0", ".cold") */
+
+#define SYMBOL_KIND_MASK(kind)  (1u << (kind))
+
+struct symbol_info {
+  enum symbol_kind kind;
+  unsigned flags;
+  int depth;            /* number of components in the qualified name (1 for "f", 2 for "ns::f") */
+};
+
+enum component_kind {
+  COMPONENT_NAME,       /* identifier (including "std" and parts of "std::string" etc.) */
+  COMPONENT_CTOR,       /* constructor, the text is the class name */
+  COMPONENT_DTOR,       /* destructor, the text is the class name */
+  COMPONENT_OPERATOR,   /* the text is the operator ("+", "new[]"), empty for conversion operators */
+  COMPONENT_OTHER       /* lambda, unnamed type, substitution, decltype; the text is the mangled form */
+};
+
+struct name_component {
+  const char *text;     /* not zero-terminated */
+  unsigned short length;
+  unsigned char kind;   /* one of enum component_kind */
+  unsigned char templated; /* component is followed by template arguments */
+};
+
+bool classify(const char *mangled, struct symbol_info *info);
+void classify_batch(const char *const *names, size_t count, struct symbol_info *info);
+size_t classify_strtab(const char *strtab, size_t size, unsigned kindmask,
+                       void (*callback)(const char *name, const struct symbol_info *info, void *arg),
+                       void *arg);
+int classify_name(const char *mangled, struct name_component *components, int max);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif /* _CLASSIFY_H */
@@ -0,0 +1,183 @@
+/* GNU C++ symbol name demangler
+ * Drop-in replacement for abi::__cxa_demangle(), with a memoization cache.
+ *
+ * Build it as a shared library, then link to it or preload it:
+ *
+ *     cc -O2 -shared -fPIC -o libcxademangle.so cxa_demangle.c dcache.c demangle.c -lpthread
+ *     LD_PRELOAD=./libcxademangle.so ./application
+ *
+ * The interface follows the Itanium C++ ABI: the function returns a buffer
+ * allocated with malloc() (or the output_buffer, possibly enlarged with
+ * realloc()), and sets the status to:
+ *   0   success
+ *  -1   memory allocation failure
+ *  -2   mangled_name is not a valid name under the C++ ABI mangling rules
+ *  -3   one of the arguments is invalid
+ * Names that do not start with "_Z" are decoded as a type (as returned by
+ * std::type_info::name()).
+ *
+ * Note that the formatting of the demangled names follows demangle(), which
+ * differs in white space from libstdc++ (e.g. "f(int,char)" instead of
+ * "f(int, char)").
+ *
+ * Copyright 2022-2024, CompuPhase
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dcache.h"
+#include "demangle.h"
+
+#define CACHE_ENTRIES   4096
+#define INIT_PLAIN      1024
+#define INIT_SCRATCH    4096
+#define MAX_PLAIN       (1024 * 1024)       /* a name that needs more is refused */
+#define MAX_SCRATCH     (16 * 1024 * 1024)
+
+#if defined __GNUC__
+# define EXPORT   __attribute__((visibility("default")))
+#else
+# define EXPORT
+#endif
+
+static struct dcache *cache = NULL;
+static pthread_once_t cache_once = PTHREAD_ONCE_INIT;
+
+static void cache_init(void)
+{
+  cache = dcache_create(CACHE_ENTRIES);
+}
+
+/** run_demangle() demangles into a malloc-ed buffer, growing the output and
+ *  scratch buffers as needed, up to MAX_PLAIN and MAX_SCRATCH (a crafted name
+ *  of a few hundred bytes can expand to gigabytes). Names without "_Z" prefix
+ *  are decoded as types.
+ */
+static char *run_demangle(const char *mangled_name, int *status)
+{
+  bool type = (mangled_name[0] != '_' || mangled_name[1] != 'Z');
+  size_t plainsize = INIT_PLAIN;
+  size_t scratchsize = INIT_SCRATCH;
+  char *plain = NULL;
+  char *scratch = NULL;
+  int result;
+  do {
+    char *p = realloc(plain, plainsize);
+    char *s = (p != NULL) ? realloc(scratch, scratchsize) : NULL;
+    if (p != NULL)
+      plain = p;
+    if (s != NULL)
+      scratch = s;
+    if (p == NULL || s == NULL) {
+      free(plain);
+      free(scratch);
+      *status = -1;
+      return NULL;
+    }
+    if (type)
+      result = demangle_type_n(plain, plainsize, mangled_name, strlen(mangled_name), scratch, scratchsize);
+    else
+      result = demangle_n(plain, plainsize, mangled_name, strlen(mangled_name), scratch, scratchsize);
+    if (result == DEMANGLE_OVERFLOW)
+      plainsize *= 2;
+    else if (result == DEMANGLE_NOSCRATCH)
+      scratchsize *= 2;
+  } while ((result == DEMANGLE_OVERFLOW && plainsize <= MAX_PLAIN)
+           || (result == DEMANGLE_NOSCRATCH && scratchsize <= MAX_SCRATCH));
+  free(scratch);
+
+  if (result == DEMANGLE_OVERFLOW || result == DEMANGLE_NOSCRATCH) {
+    free(plain);
+    *status = -1;   /* it would need more memory than is allowed */
+    return NULL;
+  }
+  if (result != DEMANGLE_OK) {
+    free(plain);
+    *status = -2;
+    return NULL;
+  }
+  *status = 0;
+  return plain;
+}
+
+EXPORT char *__cxa_demangle(const char *mangled_name, char *output_buffer, size_t *length, int *status)
+{
+  int dummy;
+  if (status == NULL)
+    status = &dummy;
+  if (mangled_name == NULL || (output_buffer != NULL && length == NULL)) {
+    *status = -3;
+    return NULL;
+  }
+
+  pthread_once(&cache_once, cache_init);
+
+  /* try the cache, directly into the output buffer if there is one, and into
+     a local buffer otherwise (so that a hit needs only a single lookup) */
+  char local[INIT_PLAIN];
+  char *target = (output_buffer != NULL) ? output_buffer : local;
+  size_t size = (output_buffer != NULL) ? *length : sizeof local;
+  size_t needed = 0;
+  if (cache != NULL)
+    needed = dcache_lookup(cache, mangled_name, target, size);
+  if (needed == DCACHE_INVALID) {
+    *status = -2;
+    return NULL;
+  }
+  if (needed > 0 && needed <= size) {
+    if (output_buffer == NULL) {
+      output_buffer = malloc(needed);
+      if (output_buffer == NULL) {
+        *status = -1;
+        return NULL;
+      }
+      memcpy(output_buffer, local, needed);
+      if (length != NULL)
+        *length = needed;
+    }
+    /* a buffer that is large enough keeps its size, as on a cache miss */
+    *status = 0;
+    return output_buffer;
+  }
+
+  char *plain = run_demangle(mangled_name, status);
+  if (plain == NULL) {
+    if (*status == -2 && cache != NULL)
+      dcache_insert(cache, mangled_name, NULL);
+    return NULL;
+  }
+  if (cache != NULL)
+    dcache_insert(cache, mangled_name, plain);
+
+  needed = strlen(plain) + 1;
+  if (output_buffer == NULL) {
+    if (length != NULL)
+      *length = needed;
+    return plain;
+  }
+  if (needed > size) {
+    char *buffer = realloc(output_buffer, needed);
+    if (buffer == NULL) {
+      free(plain);
+      *status = -1;
+      return NULL;
+    }
+    output_buffer = buffer;
+    *length = needed;
+  }
+  memcpy(output_buffer, plain, needed);
+  free(plain);
+  return output_buffer;
+}
@@ -0,0 +1,350 @@
+/* GNU C++ symbol name demangler
+ * Thread-safe memoization cache for demangled names.
+ *
+ * The cache maps mangled names to their demangled text. It is split in
+ * shards, each with its own lock, so that threads rarely contend. Each shard
+ * is a direct-mapped table: on a collision, the older entry is replaced. This
+ * keeps the memory use bounded (by the capacity) without any bookkeeping for
+ * an LRU policy.
+ *
+ * Next to it, there is a small table for type names, keyed on the pointer
+ * returned by std::type_info::name(). That pointer is stable for the lifetime
+ * of the process, so a lookup is a pointer hash and compare, and a lookup that
+ * finds its name takes no lock (it only does atomic loads). New entries are
+ * published in a slot with a compare-and-swap. When all slots in the probe
+ * sequence of a new name are taken, the last one is replaced. A replaced entry
+ * is not freed, because readers do not take locks or reference counts and may
+ * still be copying it; it is kept aside, in chains that are protected by a
+ * mutex ("typelock"), and reused when its name comes back. So a lookup that
+ * misses takes that mutex (to look for a replaced entry, and to put away the
+ * entry that it replaces), and the memory stays bounded by the number of
+ * distinct type names (which is finite in a program).
+ *
+ * Copyright 2022-2024, CompuPhase
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dcache.h"
+#include "demangle.h"
+
+#define NUM_SHARDS  16  /* must be a power of 2 */
+#define TYPE_SLOTS  1024  /* must be a power of 2 */
+#define TYPE_PROBES 8
+
+struct entry {
+  uint64_t hash;
+  size_t keylength;
+  bool invalid;         /**< negative entry: the name failed to demangle */
+  char *text;           /**< mangled name, a zero byte, then the demangled name */
+};
+
+struct shard {
+  pthread_mutex_t lock;
+  struct entry *slots;
+  size_t mask;          /**< number of slots - 1 */
+};
+
+struct typeentry {
+  const char *name;     /**< the type_info name pointer (the key) */
+  struct typeentry *next; /**< in the list of replaced entries */
+  char text[];          /**< the demangled name */
+};
+
+struct dcache {
+  struct shard shards[NUM_SHARDS];
+  struct typeentry *types[TYPE_SLOTS];
+  struct typeentry *replaced[TYPE_SLOTS]; /**< entries that were replaced in "types", chained per slot */
+  pthread_mutex_t typelock;     /**< for "replaced" */
+};
+
+#if defined __GNUC__
+# define LOAD_ACQUIRE(p)            __atomic_load_n((p), __ATOMIC_ACQUIRE)
+# define CAS_RELEASE(p, old, new)   __atomic_compare_exchange_n((p), (old), (new), false, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE)
+#endif
+
+static uint64_t hash_string(const char *str, size_t *length)
+{
+  /* FNV-1a */
+  uint64_t hash = 14695981039346656037ULL;
+  const char *p = str;
+  while (*p != '\0') {
+    hash = (hash ^ (uint8_t)*p) * 1099511628211ULL;
+    p++;
+  }
+  *length = p - str;
+  return hash;
+}
+
+/** dcache_create() allocates a cache for (at most) "capacity" entries; the
+ *  capacity is rounded up to a power of 2.
+ */
+struct dcache *dcache_create(size_t capacity)
+{
+  struct dcache *cache = malloc(sizeof(struct dcache));
+  if (cache == NULL)
+    return NULL;
+  memset(cache->types, 0, sizeof cache->types);
+  memset(cache->replaced, 0, sizeof cache->replaced);
+  pthread_mutex_init(&cache->typelock, NULL);
+  size_t slots = 1;
+  while (slots * NUM_SHARDS < capacity)
+    slots *= 2;
+  for (int i = 0; i < NUM_SHARDS; i++) {
+    struct shard *shard = &cache->shards[i];
+    pthread_mutex_init(&shard->lock, NULL);
+    shard->slots = calloc(slots, sizeof(struct entry));
+    shard->mask = slots - 1;
+    if (shard->slots == NULL) {
+      while (i >= 0) {
+        pthread_mutex_destroy(&cache->shards[i].lock);
+        free(cache->shards[i].slots);
+        i--;
+      }
+      pthread_mutex_destroy(&cache->typelock);
+      free(cache);
+      return NULL;
+    }
+  }
+  return cache;
+}
+
+void dcache_destroy(struct dcache *cache)
+{
+  if (cache == NULL)
+    return;
+  for (int i = 0; i < NUM_SHARDS; i++) {
+    struct shard *shard = &cache->shards[i];
+    for (size_t s = 0; s <= shard->mask; s++)
+      free(shard->slots[s].text);
+    free(shard->slots);
+    pthread_mutex_destroy(&shard->lock);
+  }
+  for (int i = 0; i < TYPE_SLOTS; i++) {
+    free(cache->types[i]);
+    while (cache->replaced[i] != NULL) {
+      struct typeentry *next = cache->replaced[i]->next;
+      free(cache->replaced[i]);
+      cache->replaced[i] = next;
+    }
+  }
+  pthread_mutex_destroy(&cache->typelock);
+  free(cache);
+}
+
+static struct entry *find_slot(struct dcache *cache, uint64_t hash, struct shard **shard)
+{
+  *shard = &cache->shards[hash & (NUM_SHARDS - 1)];
+  return &(*shard)->slots[(hash / NUM_SHARDS) & (*shard)->mask];
+}
+
+/** dcache_lookup() looks up a mangled name, and copies the demangled text into
+ *  "plain" if it fits. Like snprintf(), it returns the size that is needed for
+ *  the text (including the zero terminator), so that the caller can retry
+ *  with a larger buffer if the return value exceeds "size". It returns 0 if
+ *  the name is not in the cache, and DCACHE_INVALID if the cache holds a
+ *  negative entry for the name.
+ */
+size_t dcache_lookup(struct dcache *cache, const char *mangled, char *plain, size_t size)
+{
+  assert(cache != NULL);
+  assert(mangled != NULL);
+  size_t keylength;
+  uint64_t hash = hash_string(mangled, &keylength);
+  struct shard *shard;
+  struct entry *entry = find_slot(cache, hash, &shard);
+  size_t result = 0;
+  pthread_mutex_lock(&shard->lock);
+  if (entry->text != NULL && entry->hash == hash && entry->keylength == keylength
+      && memcmp(entry->text, mangled, keylength) == 0) {
+    if (entry->invalid) {
+      result = DCACHE_INVALID;
+    } else {
+      const char *text = entry->text + keylength + 1;
+      result = strlen(text) + 1;
+      if (plain != NULL && result <= size)
+        memcpy(plain, text, result);
+    }
+  }
+  pthread_mutex_unlock(&shard->lock);
+  return result;
+}
+
+/** dcache_insert() adds a name to the cache, replacing any entry that maps
+ *  to the same slot. If "plain" is NULL, a negative entry is added (for a
+ *  name that could not be demangled).
+ */
+void dcache_insert(struct dcache *cache, const char *mangled, const char *plain)
+{
+  assert(cache != NULL);
+  assert(mangled != NULL);
+  size_t keylength;
+  uint64_t hash = hash_string(mangled, &keylength);
+  size_t textlength = (plain != NULL) ? strlen(plain) : 0;
+  char *text = malloc(keylength + textlength + 2);
+  if (text == NULL)
+    return;
+  memcpy(text, mangled, keylength + 1);
+  memcpy(text + keylength + 1, (plain != NULL) ? plain : "", textlength + 1);
+
+  struct shard *shard;
+  struct entry *entry = find_slot(cache, hash, &shard);
+  pthread_mutex_lock(&shard->lock);
+  char *old = entry->text;
+  entry->hash = hash;
+  entry->keylength = keylength;
+  entry->invalid = (plain == NULL);
+  entry->text = text;
+  pthread_mutex_unlock(&shard->lock);
+  free(old);
+}
+
+/** dcache_demangle() has the same parameters as demangle(), but it looks up
+ *  the name in the cache first, and adds it to the cache after demangling.
+ *  It returns the result codes of demangle_scratch(). Only a name that is
+ *  invalid gets a negative entry: an output buffer that is too small says
+ *  nothing about the name.
+ */
+int dcache_demangle(struct dcache *cache, char *plain, size_t size, const char *mangled)
+{
+  assert(cache != NULL);
+  assert(plain != NULL && size > 0);
+  size_t length = dcache_lookup(cache, mangled, plain, size);
+  if (length == DCACHE_INVALID)
+    return DEMANGLE_INVALID;
+  if (length > 0 && length <= size)
+    return DEMANGLE_OK;
+  if (length > size) {
+    plain[0] = '\0';
+    return DEMANGLE_OVERFLOW;
+  }
+  int result = demangle_n(plain, size, mangled, strlen(mangled), NULL, 0);
+  if (result == DEMANGLE_OK)
+    dcache_insert(cache, mangled, plain);
+  else if (result == DEMANGLE_INVALID && strncmp(mangled, "_Z", 2) == 0)
+    dcache_insert(cache, mangled, NULL);
+  return result;
+}
+
+#if defined __GNUC__
+
+static size_t type_slot(const char *name)
+{
+  /* Fibonacci hashing of the pointer; the low bits are alignment */
+  return (size_t)(((uint64_t)(uintptr_t)name * 11400714819323198485ULL) >> 32) & (TYPE_SLOTS - 1);
+}
+
+/** take_replaced() removes the entry for "name" from the replaced entries,
+ *  and returns it; or it returns NULL if there is none.
+ */
+static struct typeentry *take_replaced(struct dcache *cache, const char *name)
+{
+  struct typeentry *entry = NULL;
+  pthread_mutex_lock(&cache->typelock);
+  for (struct typeentry **link = &cache->replaced[type_slot(name)]; *link != NULL; link = &(*link)->next) {
+    if ((*link)->name == name) {
+      entry = *link;
+      *link = entry->next;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&cache->typelock);
+  return entry;
+}
+
+static void put_replaced(struct dcache *cache, struct typeentry *entry)
+{
+  size_t slot = type_slot(entry->name);
+  pthread_mutex_lock(&cache->typelock);
+  entry->next = cache->replaced[slot];
+  cache->replaced[slot] = entry;
+  pthread_mutex_unlock(&cache->typelock);
+}
+
+#endif
+
+/** dcache_typename() decodes a type name returned by std::type_info::name(),
+ *  with the same interface as demangle_type(). The cache is keyed on the
+ *  address of "name" (not on its contents), so it may only be used for
+ *  strings that stay valid and unchanged for the lifetime of the cache, as the
+ *  type_info names do. A lookup that finds its name is lock-free; on a miss,
+ *  the name is demangled and inserted, which takes the mutex of the replaced
+ *  entries (see the top of this file).
+ */
+bool dcache_typename(struct dcache *cache, char *plain, size_t size, const char *name)
+{
+  assert(cache != NULL);
+  assert(name != NULL);
+# if defined __GNUC__
+    size_t start = type_slot(name);
+    size_t idx = start;
+    for (int probe = 0; probe < TYPE_PROBES; probe++) {
+      struct typeentry *entry = LOAD_ACQUIRE(&cache->types[idx]);
+      if (entry == NULL)
+        break;
+      if (entry->name == name) {
+        size_t length = strlen(entry->text) + 1;
+        if (length > size)
+          return false;
+        memcpy(plain, entry->text, length);
+        return true;
+      }
+      idx = (idx + 1) & (TYPE_SLOTS - 1);
+    }
+
+    if (!demangle_type(plain, size, name))
+      return false;
+    size_t length = strlen(plain) + 1;
+    bool reused = true;
+    struct typeentry *entry = take_replaced(cache, name);
+    if (entry == NULL) {
+      reused = false;
+      entry = malloc(sizeof(struct typeentry) + length);
+      if (entry == NULL)
+        return true;
+      entry->name = name;
+      memcpy(entry->text, plain, length);
+    }
+    /* claim the first free slot in the probe sequence, or replace the entry in
+       the last slot; when another thread inserted the same name in the mean
+       time, drop this entry */
+    idx = start;
+    for (int probe = 0; probe < TYPE_PROBES; probe++) {
+      struct typeentry *expected = LOAD_ACQUIRE(&cache->types[idx]);
+      bool last = (probe == TYPE_PROBES - 1);
+      if ((expected == NULL || (last && expected->name != name))
+          && CAS_RELEASE(&cache->types[idx], &expected, entry)) {
+        if (expected != NULL)
+          put_replaced(cache, expected);
+        return true;
+      }
+      /* the slot is taken (on a failed CAS, "expected" is what is in it) */
+      if (expected->name == name)
+        break;
+      idx = (idx + 1) & (TYPE_SLOTS - 1);
+    }
+    /* duplicate: an entry that was published before may still be in use */
+    if (reused)
+      put_replaced(cache, entry);
+    else
+      free(entry);
+    return true;
+# else
+    (void)cache;
+    return demangle_type(plain, size, name);
+# endif
+}
@@ -0,0 +1,35 @@
+/* GNU C++ symbol name demangler
+ * Thread-safe memoization cache for demangled names.
+ *
+ * Copyright 2022-2024, CompuPhase
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _DCACHE_H
+#define _DCACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define DCACHE_INVALID  ((size_t)-1)  /* dcache_lookup(): name is known to be invalid */
+
+struct dcache;
+
+struct dcache *dcache_create(size_t capacity);
+void dcache_destroy(struct dcache *cache);
+size_t dcache_lookup(struct dcache *cache, const char *mangled, char *plain, size_t size);
+void dcache_insert(struct dcache *cache, const char *mangled, const char *plain);
+int dcache_demangle(struct dcache *cache, char *plain, size_t size, const char *mangled);
+bool dcache_typename(struct dcache *cache, char *plain, size_t size, const char *name);
+
+#endif /* _DCACHE_H */
@@ -18,23 +18,64 @@
  * limitations under the License.
  */
 #include <assert.h>
-#include <ctype.h>
-#include <malloc.h>
-#include <stdio.h>
+#include <limits.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include "demangle.h"
+#include "demangle_tables.h"
 
-#if defined _MSC_VER
-# define alloca(a)   _alloca(a)
-#elif defined __linux__
-# include <alloca.h>
+#define sizearray(a)        (sizeof(a) / sizeof((a)[0]))
+#define ARENA_INLINE        2048  /* bytes of pool memory on the stack, before heap blocks are allocated */
+#define INIT_SUBSTITUTIONS  32    /* initial table sizes, tables grow by doubling */
+#define INIT_TEMPLATE_SUBST 16
+#define INIT_FUNC_NESTING   8
+#define NUL_TERMINATED      ((size_t)-1)  /* "length" of a zero-terminated input */
+#define NO_TEMPLATE_LIMIT   (-1)          /* all levels of template arguments are shown */
+#define ELIDE_BUFFER        4096  /* initial output buffer for elided template arguments, see demangle_abbrev() */
+#define ELIDE_OVERFLOW      (-1)  /* internal result of demangle_run(): the buffer for elided arguments was full */
+#define MAX_HASH_TEXT       (1024 * 1024)  /* longest demangled name that demangle_hash() handles */
+#if !defined MAX_PARSE_DEPTH
+# define MAX_PARSE_DEPTH    128   /* limit on recursion for small stacks, this bounds the native stack usage (see readme.md) */
+#endif
+#if !defined MAX_DEEP_PARSE_DEPTH
+# define MAX_DEEP_PARSE_DEPTH 2048  /* limit on recursion on normal thread stacks (the same as in libiberty) */
 #endif
+#define MEMO_MINLENGTH      8     /* shorter fragments are not worth a lookup */
+#define MEMO_MAXLENGTH      512   /* longer fragments are not stored; this bounds the scan of a lookup */
+#define MEMO_CAPACITY       (16 * 1024 * 1024)  /* default size limit of a demangle_memo */
+#define MEMO_BLOCK          (64 * 1024)
+#define MEMO_PREFIXES       4096  /* size of the filter on the first bytes of a fragment, must be a power of 2 */
+
+/** An arena holds all working memory of a single demangle() call: the
+ *  substitution strings and the tables that refer to them. Memory is never
+ *  freed individually; heap blocks (only needed for large symbols) are all
+ *  released at the end of the call.
+ *
+ *  The top end of the current block is used as a work stack, for temporary
+ *  strings of the parser functions (instead of buffers on the native stack).
+ *  These are released in LIFO order.
+ */
+struct arena_block {
+  struct arena_block *next;
+};
 
-#define sizearray(a)        (sizeof(a) / sizeof((a)[0]))
-#define MAX_SUBSTITUTIONS   32
-#define MAX_TEMPLATE_SUBST  16
-#define MAX_FUNC_NESTING    5
+struct arena {
+  char *base;           /**< current block */
+  size_t size;          /**< size of the current block */
+  size_t top;           /**< first free byte in the current block */
+  size_t bottom;        /**< start of the work stack (grows downwards) */
+  struct arena_block *chain;  /**< list of heap-allocated blocks */
+  bool fixed;           /**< caller-provided scratch buffer, no heap blocks */
+  bool exhausted;       /**< an allocation failed */
+};
+
+/** A table of strings that grows on demand (from the arena). */
+struct table {
+  char **item;
+  size_t count;
+  size_t capacity;
+};
 
 struct mangle {
   char *plain;          /**< [output] demangled name */
@@ -42,18 +83,74 @@ struct mangle {
   const char *mangled;  /**< [input] mangled name */
   const char *mpos;     /**< current position, look-ahead pointer */
   bool valid;           /**< whether the mangled name is valid */
+  bool overflow;        /**< whether the "plain" buffer was too small */
   bool is_typecast_op;  /**< whether this a typecast operator */
   bool pack_expansion;  /**< whether template parameter substitution refers to a pack */
   short nest;           /**< nesting level for names */
   short func_nest;      /**< function nesting level (of parameter lists) */
+  short depth;          /**< recursion depth of the parser */
+  short max_depth;      /**< limit on "depth" */
+  short tpl_depth;      /**< nesting level of template argument lists */
+  short tpl_limit;      /**< template argument lists nested deeper are elided, or NO_TEMPLATE_LIMIT */
+  size_t elide_size;    /**< size of the output buffer for elided template arguments */
+  bool elide_overflow;  /**< whether that buffer was too small */
   char qualifiers[8];   /**< const, reference, and others */
-  char *parameter_base[MAX_FUNC_NESTING];
-  char *substitions[MAX_SUBSTITUTIONS];
-  size_t subst_count;
-  char *tpl_subst[MAX_TEMPLATE_SUBST];  /**< lookup table */
-  size_t tpl_subst_count;
-  char *tpl_parse[MAX_TEMPLATE_SUBST];  /**< work table, while parsing a template */
-  size_t tpl_parse_count;
+  char **parameter_base;      /**< indexed by func_nest */
+  size_t parameter_size;      /**< number of entries in parameter_base */
+  struct table substitions;
+  struct table tpl_subst;     /**< lookup table */
+  struct table tpl_parse;     /**< work table, while parsing a template */
+  struct arena arena;
+  bool (*step)(void *arg);    /**< called on every parse step, or NULL */
+  void *step_arg;
+  struct demangle_memo *memo; /**< rendered fragments of earlier names, or NULL */
+  unsigned context_refs;      /**< count of lookups of state outside the current fragment */
+  short peak_depth;           /**< deepest recursion level in the current fragment */
+};
+
+/** Optional extensions of a call to demangle_run(). */
+struct run_hooks {
+  bool (*step)(void *arg);    /**< see demangle_steps() */
+  void *step_arg;
+  struct demangle_memo *memo; /**< see demangle_memoized() */
+  size_t elide_size;          /**< see demangle_abbrev(), zero for ELIDE_BUFFER */
+};
+
+/** A memo entry holds the result of parsing a class type (a <nested-name>) or
+ *  a template argument list that does not refer to anything outside itself:
+ *  the output text, and the substitutions and template parameters that it
+ *  defines. The key is the mangled fragment, plus the parts of the parser
+ *  state that the fragment depends on.
+ */
+struct memo_entry {
+  struct memo_entry *next;    /**< hash chain */
+  uint64_t hash;              /**< FNV-1a of the mangled fragment */
+  unsigned short length;      /**< length of the mangled fragment */
+  unsigned short substitutions; /**< number of substitutions that it adds */
+  short templates;            /**< number of template parameters that it sets, or -1 */
+  short depth;                /**< recursion depth that its parse needs */
+  char before;                /**< class of the output before the fragment, see memo_context() */
+  bool toplevel;              /**< whether the fragment is not nested in a name */
+  char qualifiers[8];         /**< qualifiers that a top-level name leaves */
+  char data[];                /**< mangled fragment, then the zero-terminated
+                                   text, substitutions and template parameters */
+};
+
+struct memo_block {
+  struct memo_block *next;
+  size_t used;
+  char data[];
+};
+
+struct demangle_memo {
+  struct memo_entry **buckets;
+  size_t mask;                /**< number of buckets - 1 */
+  size_t count;
+  size_t used;                /**< bytes in entries */
+  size_t capacity;
+  struct memo_block *blocks;
+  unsigned long hits, misses;
+  unsigned short prefix_max[MEMO_PREFIXES]; /**< longest fragment per hash of the first bytes */
 };
 
 static int is_operator(struct mangle *mangle);
@@ -83,118 +180,84 @@ static void _type(struct mangle *mangle);
 static void _function_encoding(struct mangle *mangle);
 static void _encoding(struct mangle *mangle);
 
-struct operator_def {
-  const char *abbrev;
-  const char *name;
-  short operands;
-};
+/* Character classification and number conversion. These do not use the
+   functions from ctype.h and stdlib.h, because those depend on the locale
+   (and demangle_scratch() must be safe to call from a signal handler). */
+static bool is_digit(char c)
+{
+  return c >= '0' && c <= '9';
+}
 
-static const struct operator_def operators[] = {
-  { "cv", "(?)", 1 },           /* type cast */
-  { "nw", "new", 1 },
-  { "na", "new[]", 1 },
-  { "dl", "delete", 1 },
-  { "da", "delete[]", 1 },
-  { "ng", "-", 1 },             /* (unary) */
-  { "ad", "&", 1 },             /* (unary) */
-  { "de", "*", 1 },             /* (unary) */
-  { "co", "~", 2 },
-  { "pl", "+", 2 },
-  { "mi", "-", 2 },
-  { "ml", "*", 2 },
-  { "dv", "/", 2 },
-  { "rm", "%", 2 },
-  { "an", "&", 2 },
-  { "or", "|", 2 },
-  { "eo", "^", 2 },
-  { "aS", "=", 2 },
-  { "pL", "+=", 2 },
-  { "mI", "-=", 2 },
-  { "mL", "*=", 2 },
-  { "dV", "/=", 2 },
-  { "rM", "%=", 2 },
-  { "aN", "&=", 2 },
-  { "oR", "|=", 2 },
-  { "eO", "^=", 2 },
-  { "ls", "<<", 2 },
-  { "rs", ">>", 2 },
-  { "lS", "<<=", 2 },
-  { "rS", ">>=", 2 },
-  { "eq", "==", 2 },
-  { "ne", "!=", 2 },
-  { "lt", "<", 2 },
-  { "gt", ">", 2 },
-  { "le", "<=", 2 },
-  { "ge", ">=", 2 },
-  { "ss", "<=>", 2 },
-  { "nt", "!", 1 },
-  { "aa", "&&", 2 },
-  { "oo", "||", 2 },
-  { "pp", "++", 1 },            /* postfix in <expression> context */
-  { "mm", "--", 1 },            /* postfix in <expression> context */
-  { "cm", ",", 2 },
-  { "pm", "->*", 2 },
-  { "pt", "->", 2 },
-  { "cl", "()", 0 },            /* arbitrary number of operands */
-  { "ix", "[]", 2 },
-  { "qu", "?", 3 },
-  /* ----- for use in <expression> context only */
-  { "pp_", "++", 1 },           /* prefix */
-  { "mm_", "--", 1 },           /* prefix */
-  { "dt", ".", 2 },
-  { "pt", "->", 2 },
-  { "ds", ".*", 2 },
-  { "sr", "::", 2 },
-};
+static bool is_upper(char c)
+{
+  return c >= 'A' && c <= 'Z';
+}
 
-struct stringpair {
-  const char *abbrev;
-  const char *name;
-};
+static bool is_alpha(char c)
+{
+  return is_upper(c) || (c >= 'a' && c <= 'z');
+}
 
-static const struct stringpair types[] = {
-  { "v", "void" },
-  { "w", "wchar_t" },
-  { "b", "bool" },
-  { "c", "char" },
-  { "a", "signed char" },
-  { "h", "unsigned char" },
-  { "s", "short" },
-  { "t", "unsigned short" },
-  { "i", "int" },
-  { "j", "unsigned int" },
-  { "l", "long" },
-  { "m", "unsigned long" },
-  { "x", "long long" },         /* __int64 */
-  { "y", "unsigned long long" },/* __int64 */
-  { "n", "__int128" },
-  { "o", "unsigned __int128" },
-  { "f", "float" },
-  { "d", "double" },
-  { "e", "long double" },       /* __float80 */
-  { "g", "__float128" },
-  { "z", "..." },
-  { "Da","auto" },
-  { "Dc","decltype(auto)" },
-  { "Dn","decltype(nullptr)" },
-  { "Dh","decimal16" },
-  { "Df","decimal32" },
-  { "Dd","decimal64" },
-  { "De","decimal128" },
-  { "Du","char8_t" },
-  { "Ds","char16_t" },
-  { "Di","char32_t" },
-};
+static bool is_alnum(char c)
+{
+  return is_alpha(c) || is_digit(c);
+}
 
-static const struct stringpair abbreviations[] = {
-  { "St", "std" },              /* also ::std:: */
-  { "Sa", "std::allocator" },
-  { "Sb", "std::basic_string" },
-  { "Ss", "std::string" },      /* std::basic_string<char,::std::char_traits<char>,::std::allocator<char>>*/
-  { "Si", "std::istream" },     /* std::basic_istream<char,std::char_traits<char>> */
-  { "So", "std::ostream" },     /* std::basic_ostream<char,std::char_traits<char>> */
-  { "Sd", "std::iostream" },    /* std::basic_iostream<char,std::char_traits<char>> */
-};
+static bool is_xdigit(char c)
+{
+  return is_digit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+/** parse_number() - reads a decimal number and advances the position past
+ *  it. The value saturates at INT_MAX (lengths and indices in a mangled name
+ *  never come close).
+ */
+static long parse_number(const char **pos)
+{
+  assert(pos != NULL && *pos != NULL);
+  long value = 0;
+  while (is_digit(**pos)) {
+    int digit = **pos - '0';
+    value = (value <= (INT_MAX - digit) / 10) ? value * 10 + digit : INT_MAX;
+    *pos += 1;
+  }
+  return value;
+}
+
+/** parse_ulong() - reads a decimal number like parse_number(), for a value
+ *  that is printed rather than used (an array dimension). It saturates at
+ *  ULONG_MAX, like strtoul().
+ */
+static unsigned long parse_ulong(const char **pos)
+{
+  assert(pos != NULL && *pos != NULL);
+  unsigned long value = 0;
+  while (is_digit(**pos)) {
+    unsigned digit = (unsigned)(**pos - '0');
+    value = (value <= (ULONG_MAX - digit) / 10) ? value * 10 + digit : ULONG_MAX;
+    *pos += 1;
+  }
+  return value;
+}
+
+/** format_number() - stores the decimal representation of the value in the
+ *  buffer (which must have room for 21 characters), and returns a pointer to
+ *  the zero terminator.
+ */
+static char *format_number(char *buffer, unsigned long value)
+{
+  assert(buffer != NULL);
+  char digits[24];
+  int count = 0;
+  do {
+    digits[count++] = (char)('0' + value % 10);
+    value /= 10;
+  } while (value > 0);
+  while (count > 0)
+    *buffer++ = digits[--count];
+  *buffer = '\0';
+  return buffer;
+}
 
 /** peek() - match, but don't change the current position. */
 static int peek(struct mangle *mangle, const char *keyword)
@@ -234,8 +297,8 @@ static int expect_number(struct mangle *mangle, char sentinel, long *value)
       negate = 1;
       mangle->mpos += 1;
     }
-    char *ptr;
-    long v = strtol(mangle->mpos, &ptr, 10);
+    const char *ptr = mangle->mpos;
+    long v = parse_number(&ptr);
     if (ptr == mangle->mpos || v < 0) {
       mangle->valid=false;
     } else {
@@ -274,8 +337,10 @@ static bool has_return_type(struct mangle *mangle)
   size_t len = strlen(mangle->plain);
   if (len < 1 || mangle->plain[len - 1] != '>')
     return false;
-  if (len >= 2 && (isalnum(mangle->plain[len - 2]) || strchr(" ])*&", mangle->plain[len - 2]) != NULL))
+  if (len >= 2 && (is_alnum(mangle->plain[len - 2]) || strchr(" ])*&", mangle->plain[len - 2]) != NULL))
     return true;
+  if (len >= 5 && strcmp(mangle->plain + len - 5, "<...>") == 0)
+    return true;    /* elided template arguments (see demangle_abbrev()) */
 
   return false;
 }
@@ -359,6 +424,8 @@ static char *check_func_array(struct mangle *mangle, const char *base)
     assert(p != NULL);  /* otherwise, constructed plain string was invalid */
     p -= 1;             /* point to last character before matching ')' */
   }
+  if (p < base + 4 && strncmp(base, "const" + 5 - (p - base + 1), p - base + 1) == 0)
+    mangle->context_refs += 1;  /* the test below looks at the text before "base" */
   if (p >= mangle->plain + 5 && strcmp(p - 4, "const") == 0)
     p -= 5;
   if (p > mangle->plain && *p == ' ')
@@ -376,6 +443,8 @@ static char *check_func_array(struct mangle *mangle, const char *base)
         p -= 1;
     }
   }
+  if (p < base)
+    mangle->context_refs += 1;
   return (p >= base && (*p == '(' || *p == '[')) ? (char*)p : NULL;
 }
 
@@ -403,7 +472,7 @@ static char *insertion_point(struct mangle *mangle, const char *base)
     if (*tail == '*') {
       while (*(tail + 1) == '*')
         tail++;
-    } else if (isalpha(*tail) || *tail == '_') {
+    } else if (is_alpha(*tail) || *tail == '_') {
       while (*tail != '\0' && *tail != ')' && *tail != ':')
         tail++;
       if (*tail == ':' && *(tail + 1) == ':' && *(tail + 2) == '*') {
@@ -442,7 +511,7 @@ static size_t get_number(struct mangle *mangle, char *field, size_t size, int he
   assert(size > 0);
   memset(field, 0, size);
   size_t i = 0;
-  while (isdigit(*mangle->mpos) || (hex && isxdigit(*mangle->mpos))) {
+  while (is_digit(*mangle->mpos) || (hex && is_xdigit(*mangle->mpos))) {
     if (i < size - 1)
       field[i] = *mangle->mpos++;
     i++;
@@ -450,25 +519,44 @@ static size_t get_number(struct mangle *mangle, char *field, size_t size, int he
   return i;
 }
 
-/** append() - appends text at the end of the result string (demangled string).
- *  If the text would not fit, the result is set to invalid.
+/** append_n() - appends "count" characters of the text at the end of the
+ *  result string (demangled string). If the text would not fit, the result is
+ *  set to invalid; the part that fits is still added (for demangle_abbrev()).
  */
-static void append(struct mangle *mangle, const char *text)
+static void append_n(struct mangle *mangle, const char *text, size_t count)
 {
   assert(mangle != NULL);
   assert(text != NULL);
   if (mangle->valid) {
     size_t len = strlen(mangle->plain);
-    /* add a space to avoid ambiguity */
-    if (len > 0 && mangle->plain[len - 1] == *text && (mangle->plain[len - 1] == '<' || mangle->plain[len - 1] == '>'))
-      strcpy(mangle->plain + len++, " ");
-    if (len + strlen(text) < mangle->size)
-      strcpy(mangle->plain + len, text);
-    else
+    /* add a space to avoid ambiguity (it counts for the size check) */
+    size_t space = (len > 0 && count > 0 && mangle->plain[len - 1] == *text && (mangle->plain[len - 1] == '<' || mangle->plain[len - 1] == '>')) ? 1 : 0;
+    if (len + space + count < mangle->size) {
+      if (space)
+        mangle->plain[len++] = ' ';
+      memcpy(mangle->plain + len, text, count);
+      mangle->plain[len + count] = '\0';
+    } else {
+      size_t room = mangle->size - 1 - len;
+      if (space && room > 0) {
+        mangle->plain[len++] = ' ';
+        room--;
+      }
+      memcpy(mangle->plain + len, text, room);
+      mangle->plain[len + room] = '\0';
       mangle->valid = false;
+      mangle->overflow = true;
+    }
   }
 }
 
+/** append() - appends text at the end of the result string. */
+static void append(struct mangle *mangle, const char *text)
+{
+  assert(text != NULL);
+  append_n(mangle, text, strlen(text));
+}
+
 /** append_space() adds a space to the result string, unless the character
  *  currently at the end is a separator too. (This still adds more spaces than
  *  strictly necessary, but it avoids glueing words together.)
@@ -503,11 +591,184 @@ static void insert(struct mangle *mangle, char *mark, const char *text)
         size_t num = len - (mark - mangle->plain) + 1;
         memmove((char*)mark + ln2, mark, num * sizeof(char));
         memmove((char*)mark, text, ln2 * sizeof(char));
+      } else {
+        /* keep the part that fits (for demangle_abbrev()) */
+        size_t room = mangle->size - 1 - (mark - mangle->plain);
+        if (ln2 < room) {
+          memmove((char*)mark + ln2, mark, (room - ln2) * sizeof(char));
+          memmove((char*)mark, text, ln2 * sizeof(char));
+        } else {
+          memmove((char*)mark, text, room * sizeof(char));
+        }
+        mark[room] = '\0';
+        mangle->valid = false;
+        mangle->overflow = true;
       }
     }
   }
 }
 
+/** arena_grow() switches to a new block that has at least "size" bytes
+ *  free. Memory allocated in the previous blocks remains valid. When the arena
+ *  is a caller-provided scratch buffer, it cannot grow.
+ */
+static bool arena_grow(struct mangle *mangle, size_t size)
+{
+  assert(mangle != NULL);
+  struct arena *arena = &mangle->arena;
+  size_t blocksize = 2 * arena->size;
+  if (blocksize < size + sizeof(struct arena_block))
+    blocksize = size + sizeof(struct arena_block);
+  struct arena_block *block = arena->fixed ? NULL : malloc(blocksize);
+  if (block == NULL) {
+    mangle->valid = false;
+    arena->exhausted = true;
+    return false;
+  }
+  block->next = arena->chain;
+  arena->chain = block;
+  arena->base = (char*)block;
+  arena->size = blocksize;
+  arena->top = sizeof(struct arena_block);
+  arena->bottom = blocksize;
+  return true;
+}
+
+/** arena_alloc() returns a block of memory that stays valid until the end of
+ *  the demangle() call. On failure, the mangled name is flagged as invalid.
+ */
+static void *arena_alloc(struct mangle *mangle, size_t size)
+{
+  assert(mangle != NULL);
+  struct arena *arena = &mangle->arena;
+  size = (size + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+  if (arena->top + size > arena->bottom && !arena_grow(mangle, size))
+    return NULL;
+  void *ptr = arena->base + arena->top;
+  arena->top += size;
+  return ptr;
+}
+
+/** work_mark() returns the current top of the work stack, to be passed to
+ *  work_release() later.
+ */
+static char *work_mark(struct mangle *mangle)
+{
+  assert(mangle != NULL);
+  return mangle->arena.base + mangle->arena.bottom;
+}
+
+/** work_alloc() allocates a temporary buffer on the work stack. On failure,
+ *  the mangled name is flagged as invalid.
+ */
+static char *work_alloc(struct mangle *mangle, size_t size)
+{
+  assert(mangle != NULL);
+  struct arena *arena = &mangle->arena;
+  size = (size + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+  if (arena->top + size > arena->bottom && !arena_grow(mangle, size))
+    return NULL;
+  arena->bottom -= size;
+  return arena->base + arena->bottom;
+}
+
+/** work_release() frees all work stack buffers that were allocated after the
+ *  mark was taken. If the arena has switched to a new block in the mean time,
+ *  the buffers are simply left until the end of the demangle() call.
+ */
+static void work_release(struct mangle *mangle, const char *mark)
+{
+  assert(mangle != NULL);
+  struct arena *arena = &mangle->arena;
+  if (mark >= arena->base + arena->bottom && mark <= arena->base + arena->size)
+    arena->bottom = mark - arena->base;
+}
+
+/** parse_step() calls the step hook of demangle_steps() (if set), and
+ *  flags the mangled name as invalid when the hook returns false.
+ */
+static bool parse_step(struct mangle *mangle)
+{
+  assert(mangle != NULL);
+  if (mangle->step != NULL && mangle->valid && !mangle->step(mangle->step_arg))
+    mangle->valid = false;
+  return mangle->valid;
+}
+
+/** enter_level() increments the recursion depth, and flags the mangled name
+ *  as invalid when it exceeds the limit; leave_level() decrements it again.
+ *  Every cycle in the grammar passes through one of the functions that keep
+ *  track of the depth, so the native stack usage is bounded. For the same
+ *  reason, each call counts as a parse step.
+ */
+static bool enter_level(struct mangle *mangle)
+{
+  assert(mangle != NULL);
+  mangle->depth += 1;
+  if (mangle->depth > mangle->max_depth)
+    mangle->valid = false;
+  if (mangle->depth > mangle->peak_depth)
+    mangle->peak_depth = mangle->depth;
+  return parse_step(mangle);
+}
+
+static void leave_level(struct mangle *mangle)
+{
+  assert(mangle != NULL);
+  assert(mangle->depth > 0);
+  mangle->depth -= 1;
+}
+
+static void arena_free(struct arena *arena)
+{
+  assert(arena != NULL);
+  while (arena->chain != NULL) {
+    struct arena_block *block = arena->chain;
+    arena->chain = block->next;
+    free((void*)block);
+  }
+}
+
+/** table_add() appends an item to a table, doubling its capacity when it is
+ *  full. Lookups remain a simple (constant-time) index.
+ */
+static void table_add(struct mangle *mangle, struct table *table, char *item, size_t initial)
+{
+  assert(mangle != NULL);
+  assert(table != NULL);
+  if (table->count == table->capacity) {
+    size_t capacity = (table->capacity > 0) ? 2 * table->capacity : initial;
+    char **list = arena_alloc(mangle, capacity * sizeof(char*));
+    if (list == NULL)
+      return;
+    if (table->count > 0)
+      memcpy(list, table->item, table->count * sizeof(char*));
+    table->item = list;
+    table->capacity = capacity;
+  }
+  table->item[table->count++] = item;
+}
+
+/** reserve_nesting() grows the table with parameter base pointers, so that
+ *  it has an entry for the current function nesting level.
+ */
+static bool reserve_nesting(struct mangle *mangle)
+{
+  assert(mangle != NULL);
+  if ((size_t)mangle->func_nest >= mangle->parameter_size) {
+    size_t size = (mangle->parameter_size > 0) ? 2 * mangle->parameter_size : INIT_FUNC_NESTING;
+    char **list = arena_alloc(mangle, size * sizeof(char*));
+    if (list == NULL)
+      return false;
+    memset(list, 0, size * sizeof(char*));
+    if (mangle->parameter_size > 0)
+      memcpy(list, mangle->parameter_base, mangle->parameter_size * sizeof(char*));
+    mangle->parameter_base = list;
+    mangle->parameter_size = size;
+  }
+  return true;
+}
+
 static char *current_position(struct mangle *mangle)
 {
   assert(mangle != NULL);
@@ -526,56 +787,256 @@ static void add_substitution(struct mangle *mangle, const char *text, int tpl)
      implies that they are) */
 # if 0
     if (!tpl) {
-      for (int i = 0; i < mangle->subst_count; i++) {
-        if (strcmp(text, mangle->substitions[i]) == 0)
+      for (int i = 0; i < mangle->substitions.count; i++) {
+        if (strcmp(text, mangle->substitions.item[i]) == 0)
           return; /* substition already exists, do not add again */
       }
     }
 # endif
 
   size_t length = strlen(text);
-  char *str = malloc((length + 1) * sizeof(char));
+  char *str = arena_alloc(mangle, (length + 1) * sizeof(char));
   if (str != NULL) {
     memcpy(str, text, length);
     str[length] = '\0';
-    if (tpl) {
-      /* insert in the work table */
-      assert(mangle->tpl_parse_count < MAX_TEMPLATE_SUBST);
-      if (mangle->subst_count < MAX_TEMPLATE_SUBST) {
-        mangle->tpl_parse[mangle->tpl_parse_count] = str;
-        mangle->tpl_parse_count += 1;
-      } else {
-        free((void*)str);
-      }
-    } else {
-      assert(mangle->subst_count < MAX_SUBSTITUTIONS);
-      if (mangle->subst_count < MAX_SUBSTITUTIONS) {
-        mangle->substitions[mangle->subst_count] = str;
-        mangle->subst_count += 1;
-      } else {
-        free((void*)str);
-      }
-    }
+    if (tpl)
+      table_add(mangle, &mangle->tpl_parse, str, INIT_TEMPLATE_SUBST); /* insert in the work table */
+    else
+      table_add(mangle, &mangle->substitions, str, INIT_SUBSTITUTIONS);
   }
 }
 
 static void tpl_subst_swap(struct mangle *mangle)
 {
   assert(mangle != NULL);
-  /* free the look-up table */
-  for (size_t i = 0; i < mangle->tpl_subst_count; i++) {
-    assert(mangle->tpl_subst[i] != NULL);
-    free((void*)mangle->tpl_subst[i]);
-    mangle->tpl_subst[i] = NULL;
+  /* the work table becomes the look-up table (the strings of the previous
+     look-up table stay in the arena), and the work table is reset */
+  mangle->tpl_subst = mangle->tpl_parse;
+  mangle->tpl_parse.item = NULL;
+  mangle->tpl_parse.count = 0;
+  mangle->tpl_parse.capacity = 0;
+}
+
+/** memo_apply() appends the text of a memoized fragment, and adds the
+ *  substitutions and the template parameters that parsing the fragment would
+ *  have added.
+ */
+static void memo_apply(struct mangle *mangle, const struct memo_entry *entry)
+{
+  assert(mangle != NULL);
+  assert(entry != NULL);
+  const char *text = entry->data + entry->length;
+  append(mangle, text);
+  const char *str = text + strlen(text) + 1;
+  for (int i = 0; i < entry->substitutions; i++) {
+    add_substitution(mangle, str, 0);
+    str += strlen(str) + 1;
   }
-  /* copy the work table into the look-up table */
-  for (size_t i = 0; i < mangle->tpl_parse_count; i++) {
-    assert(mangle->tpl_parse[i] != NULL);
-    mangle->tpl_subst[i] = mangle->tpl_parse[i];
-    mangle->tpl_parse[i] = NULL;
+  if (entry->templates >= 0) {
+    /* same as at the end of _template_args() */
+    struct table save_parse = mangle->tpl_parse;
+    mangle->tpl_parse.item = NULL;
+    mangle->tpl_parse.count = 0;
+    mangle->tpl_parse.capacity = 0;
+    for (int i = 0; i < entry->templates; i++) {
+      add_substitution(mangle, str, 1);
+      str += strlen(str) + 1;
+    }
+    tpl_subst_swap(mangle);
+    mangle->tpl_parse = save_parse;
   }
-  mangle->tpl_subst_count = mangle->tpl_parse_count;
-  mangle->tpl_parse_count = 0;
+  if (entry->toplevel)
+    memcpy(mangle->qualifiers, entry->qualifiers, sizeof mangle->qualifiers);
+  mangle->mpos += entry->length;
+}
+
+/** memo_context() classifies the last character of the output, for the rules
+ *  in append_n() and append_space() that look at it; the output of a fragment
+ *  depends on nothing else before it.
+ */
+static char memo_context(struct mangle *mangle)
+{
+  assert(mangle != NULL);
+  size_t len = strlen(mangle->plain);
+  char c = (len > 0) ? mangle->plain[len - 1] : '\0';
+  if (c == '<' || c == '>')
+    return c;
+  if (c == '\0' || strchr(" ([,:", c) != NULL)
+    return ' ';
+  return 'a';
+}
+
+/** memo_replay() looks up the fragment at the current position in the memo,
+ *  and applies it on a hit. The length of the fragment is not known before it
+ *  is parsed, but a fragment ends with an "E"; so the input is hashed
+ *  incrementally, and the table is probed at every "E", up to the length of
+ *  the longest fragment that starts with the same bytes.
+ */
+static bool memo_replay(struct mangle *mangle)
+{
+  assert(mangle != NULL && mangle->memo != NULL);
+  struct demangle_memo *memo = mangle->memo;
+  char before = memo_context(mangle);
+  bool toplevel = (mangle->nest == 0);
+  const char *mpos = mangle->mpos;
+  uint64_t hash = UINT64_C(14695981039346656037);
+  size_t limit = MEMO_MINLENGTH;
+  for (size_t n = 0; n < limit && mpos[n] != '\0'; n++) {
+    hash = (hash ^ (unsigned char)mpos[n]) * UINT64_C(1099511628211);
+    if (n + 1 == MEMO_MINLENGTH)
+      limit = memo->prefix_max[hash & (MEMO_PREFIXES - 1)];
+    if (mpos[n] != 'E' || n + 1 < MEMO_MINLENGTH)
+      continue;
+    for (const struct memo_entry *entry = memo->buckets[hash & memo->mask]; entry != NULL; entry = entry->next) {
+      if (entry->hash == hash && entry->length == n + 1 && entry->before == before
+          && entry->toplevel == toplevel && memcmp(entry->data, mpos, n + 1) == 0) {
+        if (mangle->depth + entry->depth > mangle->max_depth)
+          return false;   /* too deep, let the parser reject it */
+        memo_apply(mangle, entry);
+        memo->hits++;
+        return true;
+      }
+    }
+  }
+  memo->misses++;
+  return false;
+}
+
+static void *memo_alloc(struct demangle_memo *memo, size_t size)
+{
+  assert(memo != NULL);
+  size = (size + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+  struct memo_block *block = memo->blocks;
+  if (block == NULL || block->used + size > MEMO_BLOCK) {
+    size_t blocksize = (size > MEMO_BLOCK) ? size : MEMO_BLOCK;
+    block = malloc(sizeof(struct memo_block) + blocksize);
+    if (block == NULL)
+      return NULL;
+    block->used = 0;
+    block->next = memo->blocks;
+    memo->blocks = block;
+  }
+  void *ptr = block->data + block->used;
+  block->used += size;
+  memo->used += size;
+  return ptr;
+}
+
+static void memo_rehash(struct demangle_memo *memo)
+{
+  assert(memo != NULL);
+  size_t size = 2 * (memo->mask + 1);
+  struct memo_entry **buckets = calloc(size, sizeof(struct memo_entry*));
+  if (buckets == NULL)
+    return;   /* keep the current table, with longer chains */
+  for (size_t i = 0; i <= memo->mask; i++) {
+    while (memo->buckets[i] != NULL) {
+      struct memo_entry *entry = memo->buckets[i];
+      memo->buckets[i] = entry->next;
+      entry->next = buckets[entry->hash & (size - 1)];
+      buckets[entry->hash & (size - 1)] = entry;
+    }
+  }
+  free(memo->buckets);
+  memo->buckets = buckets;
+  memo->mask = size - 1;
+}
+
+/** memo_store() adds the fragment that was just parsed to the memo. The
+ *  arguments are the parser state from before the fragment.
+ */
+static void memo_store(struct mangle *mangle, const char *start, size_t textpos, char before, bool toplevel,
+                       size_t substitutions, const struct table *tpl_subst, short depth)
+{
+  assert(mangle != NULL && mangle->memo != NULL);
+  struct demangle_memo *memo = mangle->memo;
+  size_t length = mangle->mpos - start;
+  if (length < MEMO_MINLENGTH || length > MEMO_MAXLENGTH || memo->used >= memo->capacity)
+    return;
+  assert(start[length - 1] == 'E');
+  assert(MEMO_MAXLENGTH <= USHRT_MAX);
+  const char *text = mangle->plain + textpos;
+  size_t size = sizeof(struct memo_entry) + length + strlen(text) + 1;
+  size_t nsubst = mangle->substitions.count - substitutions;
+  for (size_t i = 0; i < nsubst; i++)
+    size += strlen(mangle->substitions.item[substitutions + i]) + 1;
+  bool tpl = (mangle->tpl_subst.item != tpl_subst->item || mangle->tpl_subst.count != tpl_subst->count);
+  if (tpl)
+    for (size_t i = 0; i < mangle->tpl_subst.count; i++)
+      size += strlen(mangle->tpl_subst.item[i]) + 1;
+  if (nsubst > USHRT_MAX || mangle->tpl_subst.count > SHRT_MAX)
+    return;
+  struct memo_entry *entry = memo_alloc(memo, size);
+  if (entry == NULL)
+    return;
+
+  entry->hash = demangle_hash_text(start, length);
+  entry->length = (unsigned short)length;
+  entry->substitutions = (unsigned short)nsubst;
+  entry->templates = tpl ? (short)mangle->tpl_subst.count : -1;
+  entry->depth = depth;
+  entry->before = before;
+  entry->toplevel = toplevel;
+  memcpy(entry->qualifiers, mangle->qualifiers, sizeof entry->qualifiers);
+  char *ptr = entry->data;
+  memcpy(ptr, start, length);
+  ptr += length;
+  strcpy(ptr, text);
+  ptr += strlen(ptr) + 1;
+  for (size_t i = 0; i < nsubst; i++) {
+    strcpy(ptr, mangle->substitions.item[substitutions + i]);
+    ptr += strlen(ptr) + 1;
+  }
+  if (tpl) {
+    for (size_t i = 0; i < mangle->tpl_subst.count; i++) {
+      strcpy(ptr, mangle->tpl_subst.item[i]);
+      ptr += strlen(ptr) + 1;
+    }
+  }
+
+  entry->next = memo->buckets[entry->hash & memo->mask];
+  memo->buckets[entry->hash & memo->mask] = entry;
+  unsigned short *prefix_max = &memo->prefix_max[demangle_hash_text(start, MEMO_MINLENGTH) & (MEMO_PREFIXES - 1)];
+  if (length > *prefix_max)
+    *prefix_max = (unsigned short)length;
+  if (++memo->count > memo->mask)
+    memo_rehash(memo);
+}
+
+/** memo_parse() parses a fragment (a class type or a template argument list)
+ *  through the memo of demangle_memoized(), if it is set. The fragment is
+ *  only stored if its parse did not look at any state from outside it (such
+ *  as the substitutions and template parameters of the name around it), and
+ *  if it did not leave state for the name around it other than its
+ *  substitutions, its template parameters and (at the top level) its
+ *  qualifiers.
+ */
+static void memo_parse(struct mangle *mangle, void (*parse)(struct mangle *mangle))
+{
+  assert(mangle != NULL);
+  assert(parse != NULL);
+  if (mangle->memo == NULL || mangle->tpl_limit != NO_TEMPLATE_LIMIT || mangle->pack_expansion) {
+    parse(mangle);
+    return;
+  }
+  if (memo_replay(mangle))
+    return;
+
+  const char *start = mangle->mpos;
+  size_t textpos = strlen(mangle->plain);
+  char before = memo_context(mangle);
+  bool toplevel = (mangle->nest == 0);
+  size_t substitutions = mangle->substitions.count;
+  struct table tpl_subst = mangle->tpl_subst;
+  unsigned context_refs = mangle->context_refs;
+  short peak_depth = mangle->peak_depth;
+  mangle->peak_depth = mangle->depth;
+  parse(mangle);
+  short depth = mangle->peak_depth - mangle->depth;
+  if (mangle->peak_depth < peak_depth)
+    mangle->peak_depth = peak_depth;
+  if (mangle->valid && mangle->context_refs == context_refs && !mangle->pack_expansion)
+    memo_store(mangle, start, textpos, before, toplevel, substitutions, &tpl_subst, depth);
 }
 
 /** _qualifier_pre() handles <cv-qualifier> plus optionally <ref-qualifier>, but
@@ -670,7 +1131,7 @@ static bool _abi_tags(struct mangle *mangle)
   return count > 0;
 }
 
-static bool _template_args(struct mangle *mangle)
+static void _template_arg_list(struct mangle *mangle)
 {
   /* <template-args> ::= I <template-arg>* E
 
@@ -680,16 +1141,46 @@ static bool _template_args(struct mangle *mangle)
                         <type>
   */
   assert(mangle != NULL);
-  if (!match(mangle, "I"))
-    return false;
-
-  /* save a copy of the current parse list, for nested template declarations */
-  int save_parse_count = mangle->tpl_parse_count;
-  char *save_parse[MAX_TEMPLATE_SUBST];
-  assert(sizeof mangle->tpl_parse == sizeof save_parse);
-  memcpy(save_parse, mangle->tpl_parse, sizeof save_parse);
-  mangle->tpl_parse_count = 0;
+  if (!expect(mangle, "I"))
+    return;
 
+  /* save the current parse list, for nested template declarations */
+  struct table save_parse = mangle->tpl_parse;
+  mangle->tpl_parse.item = NULL;
+  mangle->tpl_parse.count = 0;
+  mangle->tpl_parse.capacity = 0;
+
+  /* arguments that are elided from the output are still parsed, for the
+     substitutions that they define; while doing so, the output goes to a
+     buffer of its own (so that it is not limited by the room that is left in
+     the output), and for nested lists, the start of the output is moved to
+     the end of the current text, so that the scans of the output (on every
+     append) only see the arguments of this list */
+  char *save_plain = mangle->plain;
+  size_t save_size = mangle->size;
+  char *save_base = mangle->parameter_base[mangle->func_nest];
+  char *start = NULL;
+  char *wmark = NULL;
+  bool overflow = mangle->overflow;
+  mangle->tpl_depth += 1;
+  bool elide = mangle->tpl_limit != NO_TEMPLATE_LIMIT && mangle->tpl_depth > mangle->tpl_limit;
+  if (elide) {
+    start = current_position(mangle);
+    char *buffer = NULL;
+    if (mangle->tpl_depth == mangle->tpl_limit + 1) {
+      wmark = work_mark(mangle);
+      buffer = work_alloc(mangle, mangle->elide_size);
+    }
+    if (buffer != NULL) {
+      *buffer = '\0';
+      mangle->plain = buffer;
+      mangle->size = mangle->elide_size;
+    } else {
+      mangle->plain = start;
+      mangle->size -= start - save_plain;
+    }
+    mangle->parameter_base[mangle->func_nest] = mangle->plain;
+  }
   append(mangle, "<");
   int count = 0;
   while (mangle->valid && !match(mangle, "E")) {
@@ -709,11 +1200,30 @@ static bool _template_args(struct mangle *mangle)
     add_substitution(mangle, mark, 1);
   }
   append(mangle, ">");
+  if (elide) {
+    mangle->plain = save_plain;
+    mangle->size = save_size;
+    mangle->parameter_base[mangle->func_nest] = save_base;
+    *start = '\0';
+    if (wmark != NULL) {
+      work_release(mangle, wmark);
+      if (mangle->overflow && !overflow)
+        mangle->elide_overflow = true;  /* not the visible output, see demangle_abbrev() */
+    }
+    append(mangle, "<...>");
+  }
+  mangle->tpl_depth -= 1;
 
   tpl_subst_swap(mangle); /* swap any previous (or nested) template parameters by the new ones */
-  memcpy(mangle->tpl_parse, save_parse, sizeof save_parse);
-  mangle->tpl_parse_count = save_parse_count;
+  mangle->tpl_parse = save_parse;
+}
 
+static bool _template_args(struct mangle *mangle)
+{
+  assert(mangle != NULL);
+  if (!peek(mangle, "I"))
+    return false;
+  memo_parse(mangle, _template_arg_list);
   return true;
 }
 
@@ -740,7 +1250,7 @@ static void _discriminator(struct mangle *mangle)
   assert(mangle != NULL);
   if (match(mangle, "_")) {
     if (match(mangle, "_")) {
-      while (isdigit(*mangle->mpos))
+      while (is_digit(*mangle->mpos))
         mangle->mpos += 1;      /* skip (ignore) all following digits */
       expect(mangle, "_");
     } else {
@@ -755,19 +1265,16 @@ static void _source_name(struct mangle *mangle)
    */
   assert(mangle != NULL);
   if (mangle->valid) {
-    if (!isdigit(*mangle->mpos)) {
+    if (!is_digit(*mangle->mpos)) {
       mangle->valid = false;
       return;
     }
-    int count = (int)strtol(mangle->mpos, (char**)&mangle->mpos, 10);
-    if ((int)strlen(mangle->mpos) < count) {
+    long count = parse_number(&mangle->mpos);
+    if (memchr(mangle->mpos, '\0', count) != NULL) {
       mangle->valid = false;
       return;
     }
-    char *tmpname = alloca(count + 1);
-    memcpy(tmpname, mangle->mpos, count);
-    tmpname[count] = '\0';
-    append(mangle, tmpname);
+    append_n(mangle, mangle->mpos, count);
     mangle->mpos += count;
   }
 }
@@ -788,13 +1295,13 @@ static void _unqualified_name(struct mangle *mangle)
       _operator(mangle);
     } else if (is_ctor_dtor_name(mangle)) {
       _ctor_dtor_name(mangle);
-    } else if (isdigit(*mangle->mpos)) {
+    } else if (is_digit(*mangle->mpos)) {
       _source_name(mangle);
     } else if (match(mangle, "L")) {
       _source_name(mangle);
       _discriminator(mangle);
     } else if (match(mangle, "DC")) {
-      while (isdigit(*mangle->mpos))
+      while (is_digit(*mangle->mpos))
         _source_name(mangle);
       expect(mangle, "E");
     } else if (peek(mangle, "Ut")) {
@@ -815,12 +1322,14 @@ static void _function_type(struct mangle *mangle)
    */
   assert(mangle != NULL);
   if (expect(mangle, "F")) {
+    mangle->context_refs += 1;  /* uses the parameter base of the enclosing level */
     _type(mangle);
 
     /* get the parameter list */
     char *plist = current_position(mangle);
     mangle->func_nest += 1;
-    assert(mangle->func_nest < MAX_FUNC_NESTING);
+    if (!reserve_nesting(mangle))
+      return;
     append(mangle, "(");
     int count = 0;
     while (mangle->valid && !peek(mangle, "E")) {
@@ -841,11 +1350,15 @@ static void _function_type(struct mangle *mangle)
     /* move the parameter list into position */
     if (mangle->parameter_base[mangle->func_nest] != 0) {
       size_t len = strlen(plist);
-      char *buffer = alloca((len + 1) * sizeof(char));
+      char *wmark = work_mark(mangle);
+      char *buffer = work_alloc(mangle, (len + 1) * sizeof(char));
+      if (buffer == NULL)
+        return;
       strcpy(buffer, plist);
       *plist = '\0';
       char *pos = insertion_point(mangle, mangle->parameter_base[mangle->func_nest]);
       insert(mangle, pos, buffer);
+      work_release(mangle, wmark);
     }
   }
 }
@@ -870,12 +1383,13 @@ static void _closure_type(struct mangle *mangle)
     }
     expect(mangle, "E");
     int sequence = 1;
-    while (isdigit(*mangle->mpos)) {
+    while (is_digit(*mangle->mpos)) {
       sequence = *mangle->mpos - '0' + 2;
       mangle->mpos += 1;
     }
-    char field[10];
-    sprintf(field, ")#%d}", sequence);
+    char field[32];
+    strcpy(field, ")#");
+    strcat(format_number(field + 2, sequence), "}");
     append(mangle, field);
     expect(mangle, "_");
   }
@@ -888,7 +1402,7 @@ static void _unnamed_type_name(struct mangle *mangle)
   assert(mangle != NULL);
   if (expect(mangle, "Ut")) {
     /* ignore the sequence number */
-    while (isdigit(*mangle->mpos))
+    while (is_digit(*mangle->mpos))
       mangle->mpos += 1;
     expect(mangle, "_");
     append(mangle, "{unnamed type}");
@@ -906,7 +1420,10 @@ static void _pointer_to_member_type(struct mangle *mangle)
        the member type */
     _type(mangle);
     size_t len = strlen(mark);
-    char *classtype = alloca((len + 10) * sizeof(char));  /* add some space, because of characters concatenated */
+    char *wmark = work_mark(mangle);
+    char *classtype = work_alloc(mangle, (len + 10) * sizeof(char));  /* add some space, because of characters concatenated */
+    if (classtype == NULL)
+      return;
     strcpy(classtype, mark);
     strcat(classtype, "::*");
     *mark = '\0';   /* restore plain string */
@@ -923,6 +1440,7 @@ static void _pointer_to_member_type(struct mangle *mangle)
       p += 1;
     }
     insert(mangle, p, classtype);
+    work_release(mangle, wmark);
     add_substitution(mangle, mark, 0);
   }
 }
@@ -957,10 +1475,12 @@ static void _array(struct mangle *mangle)
     for (int i = count - 1; i >= 0; i--) {
       mangle->mpos = mpos_stack[i];
       char field[40];
-      if (isdigit(*mangle->mpos))
-        sprintf(field, "[%lu]", strtoul(mangle->mpos, NULL, 10));
-      else
+      if (is_digit(*mangle->mpos)) {
+        field[0] = '[';
+        strcat(format_number(field + 1, parse_ulong(&mangle->mpos)), "]");
+      } else {
         strcpy(field, "[]");
+      }
       insert(mangle, insert_pos, field);
       add_substitution(mangle, mark, 0);
     }
@@ -975,7 +1495,7 @@ static void _array(struct mangle *mangle)
 static int is_abbreviation(struct mangle *mangle)
 {
   assert(mangle != NULL);
-  if (strlen(mangle->mpos) < 2)
+  if (mangle->mpos[0] == '\0' || mangle->mpos[1] == '\0')
     return -1;
   for (size_t i = 0; i < sizearray(abbreviations); i++) {
     assert(strlen(abbreviations[i].abbrev) == 2);
@@ -996,9 +1516,9 @@ static void _substitution(struct mangle *mangle)
     if (*mangle->mpos != '_') {
       while (*mangle->mpos != '_' && !on_sentinel(mangle)) {
         int digit;
-        if (isdigit(*mangle->mpos)) {
+        if (is_digit(*mangle->mpos)) {
           digit = *mangle->mpos - '0';
-        } else if (isupper(*mangle->mpos)) {
+        } else if (is_upper(*mangle->mpos)) {
           digit = *mangle->mpos - 'A' + 10;
         } else {
           mangle->valid = false;
@@ -1010,12 +1530,13 @@ static void _substitution(struct mangle *mangle)
       index += 1;
     }
     expect(mangle, "_");
-    if (index >= mangle->subst_count) {
+    mangle->context_refs += 1;
+    if (index >= mangle->substitions.count) {
       mangle->valid = false;
       return;
     }
-    assert(mangle->substitions[index] != NULL);
-    append(mangle, mangle->substitions[index]);
+    assert(mangle->substitions.item[index] != NULL);
+    append(mangle, mangle->substitions.item[index]);
   }
 }
 
@@ -1028,30 +1549,36 @@ static void _template_param(struct mangle *mangle)
   if (expect(mangle, "T")) {
     size_t index = 0;
     if (*mangle->mpos != '_')
-      index = (int)strtol(mangle->mpos, (char**)&mangle->mpos, 10) + 1;
+      index = (size_t)parse_number(&mangle->mpos) + 1;
     expect(mangle, "_");
-    if (index >= mangle->tpl_subst_count) {
+    mangle->context_refs += 1;
+    if (index >= mangle->tpl_subst.count) {
       mangle->valid = false;
       return;
     }
-    assert(mangle->tpl_subst[index] != NULL);
-    size_t len = strlen(mangle->tpl_subst[index]);
+    const char *text = mangle->tpl_subst.item[index];
+    assert(text != NULL);
+    size_t len = strlen(text);
     if (len == 0) {
       mangle->valid = false;
       return;
     }
-    char *buffer = alloca((len + 10) * sizeof(char));
-    if (mangle->pack_expansion && strchr(mangle->tpl_subst[index], ',') == NULL) {
+    char *wmark = work_mark(mangle);
+    char *buffer = work_alloc(mangle, (len + 10) * sizeof(char));
+    if (buffer == NULL)
+      return;
+    if (mangle->pack_expansion && strchr(text, ',') == NULL) {
       /* pack expansion is requested, but the paramater does not refer to a pack */
       buffer[0] = '(';
-      memcpy(buffer + 1, mangle->tpl_subst[index], len);
+      memcpy(buffer + 1, text, len);
       memcpy(buffer + 1 + len, ")...", 5);  /* length = 5 to include the zero terminator */
     } else {
-      strcpy(buffer, mangle->tpl_subst[index]);
+      strcpy(buffer, text);
     }
     append(mangle, buffer);
     /* a template expansion is added as a substitution */
     add_substitution(mangle, buffer, 0);
+    work_release(mangle, wmark);
     mangle->pack_expansion = false;
   }
 }
@@ -1064,6 +1591,8 @@ static void _local_name(struct mangle *mangle)
   assert(mangle != NULL);
   if (expect(mangle, "Z")) {
     mangle->func_nest += 1;
+    if (!reserve_nesting(mangle))
+      return;
     _function_encoding(mangle);
     mangle->func_nest -= 1;
     append(mangle, "::");
@@ -1097,6 +1626,7 @@ static void _ctor_dtor_name(struct mangle *mangle)
                           D2                    # base object destructor
    */
   assert(mangle != NULL);
+  mangle->context_refs += 1;  /* the class name is taken from the output */
   if (mangle->valid) {
     const char *tail = mangle->plain + strlen(mangle->plain);
     if (tail > mangle->plain + 2 && *(tail - 1) == ':' && *(tail - 2) == ':')
@@ -1108,7 +1638,7 @@ static void _ctor_dtor_name(struct mangle *mangle)
       head = find_matching(mangle->plain, head - 1, '}');
       assert(head != NULL);
       if (head >= mangle->plain + 3 && *(head - 1) == ':' && *(head - 2) == ':'
-          && (isalpha(*(head - 3)) || isdigit(*(head - 3)) || *(head - 3)== '_' || *(head - 3)== ')')) {
+          && (is_alpha(*(head - 3)) || is_digit(*(head - 3)) || *(head - 3)== '_' || *(head - 3)== ')')) {
         head -= 2;
         tail = head;
       } else {
@@ -1118,20 +1648,23 @@ static void _ctor_dtor_name(struct mangle *mangle)
     if (goback && head >= mangle->plain + 1 && (*(head - 1) == ')' || *(head - 1) == '>')) {
       head = find_matching(mangle->plain, head - 1, *(head - 1));
       assert(head != NULL);
-      if (head > mangle->plain + 1 && (isalpha(*(head - 1)) || isdigit(*(head - 1)) || *(head - 1)== '_'))
+      if (head > mangle->plain + 1 && (is_alpha(*(head - 1)) || is_digit(*(head - 1)) || *(head - 1)== '_'))
         tail = head;
       else
         goback = false;
     }
     if (goback)
-      while (head != mangle->plain && (isalpha(*(head - 1)) || isdigit(*(head - 1)) || *(head - 1) == '_'))
+      while (head != mangle->plain && (is_alpha(*(head - 1)) || is_digit(*(head - 1)) || *(head - 1) == '_'))
         head -= 1;
     if (head == tail) {
       mangle->valid = false;
       return;
     }
     size_t len = tail - head;
-    char *cname = alloca((len + 1) * sizeof(char));
+    char *wmark = work_mark(mangle);
+    char *cname = work_alloc(mangle, (len + 1) * sizeof(char));
+    if (cname == NULL)
+      return;
     memcpy(cname, head, len);
     cname[len] = '\0';
     tail = mangle->plain + strlen(mangle->plain);
@@ -1141,10 +1674,11 @@ static void _ctor_dtor_name(struct mangle *mangle)
     if (*mangle->mpos == 'D')
       append(mangle, "~");
     append(mangle, cname);
+    work_release(mangle, wmark);
     mangle->mpos += 1;  /* skip 'C' or 'D' */
     if (*mangle->mpos == 'I')
       mangle->mpos += 1;
-    assert(isdigit(*mangle->mpos));
+    assert(is_digit(*mangle->mpos));
     mangle->mpos += 1;  /* skip type id */
   }
 }
@@ -1156,7 +1690,7 @@ static void _ctor_dtor_name(struct mangle *mangle)
 static int is_operator(struct mangle *mangle)
 {
   assert(mangle != NULL);
-  if (strlen(mangle->mpos) < 2)
+  if (mangle->mpos[0] == '\0' || mangle->mpos[1] == '\0')
     return -1;
   for (size_t i = 0; i < sizearray(operators); i++) {
     if (strncmp(mangle->mpos, operators[i].abbrev, strlen(operators[i].abbrev)) == 0)
@@ -1182,8 +1716,9 @@ static void _operator(struct mangle *mangle)
       append(mangle, " ");
       _type(mangle);
       mangle->is_typecast_op = true;
+      mangle->context_refs += 1;
     } else {
-      if (isalpha(operators[i].name[0]))
+      if (is_alpha(operators[i].name[0]))
         append(mangle, " ");
       append(mangle, operators[i].name);
     }
@@ -1250,7 +1785,7 @@ static void _expr_primary(struct mangle *mangle)
       }
     } else if (t == 'A') {
       mangle->mpos += 1;
-      long len = strtol(mangle->mpos, (char**)&mangle->mpos, 10);
+      long len = parse_number(&mangle->mpos);
       expect(mangle, "_");
       if (match(mangle, "Kc"))
         append(mangle, "\"");
@@ -1273,20 +1808,23 @@ static void _expr_primary(struct mangle *mangle)
 
 static void _expression(struct mangle *mangle)
 {
-  if (peek(mangle, "fp") && (*(mangle->mpos + 2) == '_' || isdigit(*(mangle->mpos + 2)))) {
+  if (!enter_level(mangle)) {
+    /* nesting too deep, nothing to parse */
+  } else if (peek(mangle, "fp") && (*(mangle->mpos + 2) == '_' || is_digit(*(mangle->mpos + 2)))) {
     mangle->mpos += 2;
     long index = 0;
-    if (isdigit(*mangle->mpos))
-      index = strtol(mangle->mpos, (char**)&mangle->mpos, 10) + 1;
+    if (is_digit(*mangle->mpos))
+      index = parse_number(&mangle->mpos) + 1;
     expect(mangle, "_");
     char field[32];
-    sprintf(field, "{parm#%ld}", index);
+    strcpy(field, "{parm#");
+    strcat(format_number(field + 6, (unsigned long)index), "}");
     append(mangle, field);
-  } else if (isdigit(*mangle->mpos)) {
+  } else if (is_digit(*mangle->mpos)) {
     _source_name(mangle);
-  } else if (peek(mangle, "S") && (isdigit(mangle->mpos[1]) || isupper(mangle->mpos[1]) || mangle->mpos[1]== '_')) {
+  } else if (peek(mangle, "S") && (is_digit(mangle->mpos[1]) || is_upper(mangle->mpos[1]) || mangle->mpos[1]== '_')) {
     _substitution(mangle);
-  } else if (peek(mangle, "T") && (isdigit(mangle->mpos[1]) || mangle->mpos[1] == '_')) {
+  } else if (peek(mangle, "T") && (is_digit(mangle->mpos[1]) || mangle->mpos[1] == '_')) {
     _template_param(mangle);
   } else if (peek(mangle, "L")) {
     _expr_primary(mangle);
@@ -1307,6 +1845,7 @@ static void _expression(struct mangle *mangle)
   } else {
     mangle->valid = false;
   }
+  leave_level(mangle);
 }
 
 static void _decltype(struct mangle *mangle)
@@ -1360,9 +1899,9 @@ static void _nested_name(struct mangle *mangle)
       assert(strlen(abbreviations[i].abbrev) == 2);
       mangle->mpos += 2;
       append(mangle, abbreviations[i].name);
-    } else if (peek(mangle, "S") && (isdigit(mangle->mpos[1]) || isupper(mangle->mpos[1]) || mangle->mpos[1]== '_')) {
+    } else if (peek(mangle, "S") && (is_digit(mangle->mpos[1]) || is_upper(mangle->mpos[1]) || mangle->mpos[1]== '_')) {
       _substitution(mangle);
-    } else if (peek(mangle, "T") && (isdigit(mangle->mpos[1]) || mangle->mpos[1] == '_')) {
+    } else if (peek(mangle, "T") && (is_digit(mangle->mpos[1]) || mangle->mpos[1] == '_')) {
       _template_param(mangle);
     } else {
       _unqualified_name(mangle);
@@ -1387,6 +1926,10 @@ static void _nested_name(struct mangle *mangle)
 
     int sentinel = 0;
     do {
+      /* each component copies the prefix into a substitution, but does not
+         recurse, so it counts as a parse step by itself */
+      if (!parse_step(mangle))
+        break;
       if (peek(mangle, "M")) {
         mangle->mpos += 1;
         continue;               /* closure type, ignore */
@@ -1445,19 +1988,19 @@ static void _name(struct mangle *mangle)
       append(mangle, abbreviations[0].name);
       append(mangle, "::");
       _unqualified_name(mangle);
-    } else if (peek(mangle, "S") && (isdigit(mangle->mpos[1]) || isupper(mangle->mpos[1]) || mangle->mpos[1] == '_')) {
+    } else if (peek(mangle, "S") && (is_digit(mangle->mpos[1]) || is_upper(mangle->mpos[1]) || mangle->mpos[1] == '_')) {
       _substitution(mangle);
     } else if (is_operator(mangle) >= 0) {
       _operator(mangle);
     } else if (is_ctor_dtor_name(mangle)) {
       _ctor_dtor_name(mangle);
-    } else if (isdigit(*mangle->mpos)) {
+    } else if (is_digit(*mangle->mpos)) {
       _source_name(mangle);
     } else if (match(mangle, "L")) {
       _source_name(mangle);
       _discriminator(mangle);
     } else if (match(mangle, "DC")) {
-      while (isdigit(*mangle->mpos))
+      while (is_digit(*mangle->mpos))
         _source_name(mangle);
       expect(mangle, "E");
     } else if (peek(mangle, "Ut")) {
@@ -1484,12 +2027,13 @@ static void _name(struct mangle *mangle)
 static int is_builtin_type(struct mangle *mangle)
 {
   assert(mangle != NULL);
-  size_t remaining = strlen(mangle->mpos);
-  if (remaining < 1)
+  if (mangle->mpos[0] == '\0')
     return -1;
   for (size_t i = 0; i < sizearray(types); i++) {
+    /* strncmp() stops at the end of the mangled name, so there is no need to
+       check the remaining length */
     size_t len = strlen(types[i].abbrev);
-    if (len <= remaining && strncmp(mangle->mpos, types[i].abbrev, len) == 0)
+    if (strncmp(mangle->mpos, types[i].abbrev, len) == 0)
       return i;
   }
   return -1;
@@ -1530,7 +2074,7 @@ static void _type(struct mangle *mangle)
                           Dw <type>+ E          # throw(type, ...)
    */
   assert(mangle != NULL);
-  if (mangle->valid) {
+  if (enter_level(mangle)) {
     char *mark = current_position(mangle);
     if (is_builtin_type(mangle) >= 0) {
       int i = is_builtin_type(mangle);
@@ -1588,14 +2132,14 @@ static void _type(struct mangle *mangle)
       }
       if (_template_args(mangle))
         add_substitution(mangle, mark, 0);
-    } else if (peek(mangle, "S") && (isdigit(mangle->mpos[1]) || isupper(mangle->mpos[1]) || mangle->mpos[1]== '_')) {
+    } else if (peek(mangle, "S") && (is_digit(mangle->mpos[1]) || is_upper(mangle->mpos[1]) || mangle->mpos[1]== '_')) {
       _substitution(mangle);
       _template_args(mangle);
-    } else if (peek(mangle, "T") && (isdigit(mangle->mpos[1]) || mangle->mpos[1] == '_')) {
+    } else if (peek(mangle, "T") && (is_digit(mangle->mpos[1]) || mangle->mpos[1] == '_')) {
       _template_param(mangle);
       _template_args(mangle);
     } else if (peek(mangle, "N")) {
-      _nested_name(mangle);
+      memo_parse(mangle, _nested_name);
     } else if (peek(mangle, "Z")) {
       _local_name(mangle);
     } else if (peek(mangle, "M")) {
@@ -1604,11 +2148,12 @@ static void _type(struct mangle *mangle)
       _expr_primary(mangle);
     } else if (match(mangle, "Dp")) {
       mangle->pack_expansion = true;
+      mangle->context_refs += 1;
       _type(mangle);
     } else if (peek(mangle, "Dt") || peek(mangle, "DT")) {
       _decltype(mangle);
       add_substitution(mangle, mark, 0);
-    } else if (isdigit(*mangle->mpos) || (*mangle->mpos == 'u' && isdigit(*(mangle->mpos + 1)))) {
+    } else if (is_digit(*mangle->mpos) || (*mangle->mpos == 'u' && is_digit(*(mangle->mpos + 1)))) {
       if (*mangle->mpos == 'u')
         mangle->mpos += 1;  /* ignore "vendor-extended" type (N.B. Itanium ABI uses upper-case 'U', but c++filt only accepts lower-case 'u') */
       _source_name(mangle);
@@ -1617,22 +2162,26 @@ static void _type(struct mangle *mangle)
         add_substitution(mangle, mark, 0);
     } else {
       mangle->valid = false;
-      return;
     }
   }
+  leave_level(mangle);
 }
 
 static void _function_encoding(struct mangle *mangle)
 {
-  _name(mangle);
+  mangle->context_refs += 1;
+  if (enter_level(mangle))
+    _name(mangle);
 
   if (on_sentinel(mangle) || (mangle->nest > 0 && peek(mangle, "E"))) {
     if (mangle->func_nest > 0)
       mangle->valid = false;
+    leave_level(mangle);
     return;
   }
   if (strlen(mangle->plain) == 0) {
     mangle->valid = false;
+    leave_level(mangle);
     return;
   }
 
@@ -1643,15 +2192,18 @@ static void _function_encoding(struct mangle *mangle)
    */
   mangle->nest += 1;
   /* check whether a return type is present; save it but process it later */
+  char *wmark = work_mark(mangle);
   char *type_string = NULL;
   size_t type_ins_point = 0;
   if (has_return_type(mangle)) {
     char *mark = current_position(mangle);
     _type(mangle);
-    type_string = alloca((strlen(mark) + 5) * sizeof(char));
-    strcpy(type_string, mark);
-    char *ipos = insertion_point(mangle, mark);
-    type_ins_point = ipos - mark;
+    type_string = work_alloc(mangle, (strlen(mark) + 5) * sizeof(char));
+    if (type_string != NULL) {
+      strcpy(type_string, mark);
+      char *ipos = insertion_point(mangle, mark);
+      type_ins_point = ipos - mark;
+    }
     *mark = '\0';
   }
 
@@ -1687,6 +2239,8 @@ static void _function_encoding(struct mangle *mangle)
     }
     insert(mangle, mangle->plain, type_string);
   }
+  work_release(mangle, wmark);
+  leave_level(mangle);
 }
 
 static void _encoding(struct mangle *mangle)
@@ -1700,7 +2254,9 @@ static void _encoding(struct mangle *mangle)
                     Tv <number> _ <number> _ <encoding>   # virtual override thunk
   */
   assert(mangle != NULL);
-  if (match(mangle, "TV")) {
+  if (!enter_level(mangle)) {
+    /* nesting too deep, nothing to parse */
+  } else if (match(mangle, "TV")) {
     append(mangle, "vtable for ");
     _type(mangle);
   } else if (match(mangle, "TT")) {
@@ -1724,9 +2280,20 @@ static void _encoding(struct mangle *mangle)
   } else {
     _function_encoding(mangle);
   }
+  leave_level(mangle);
 }
 
-bool demangle(char *plain, size_t size, const char *mangled)
+/** demangle_run() - the common part of demangle() and demangle_scratch(): the
+ *  arena starts in the "pool" memory. If "type" is true, the input is a bare
+ *  <type> (as returned by std::type_info::name()) instead of a <mangled-name>.
+ *  If "length" is not NUL_TERMINATED, the input is not necessarily zero-
+ *  terminated; it is then copied into the arena first. The recursion depth is
+ *  limited to "max_depth": MAX_PARSE_DEPTH for the entry points that are meant
+ *  for small stacks, MAX_DEEP_PARSE_DEPTH for the others.
+ */
+static int demangle_run(char *plain, size_t size, const char *mangled, size_t length,
+                        char *pool, size_t poolsize, bool fixed, bool type, short tpl_limit,
+                        short max_depth, const struct run_hooks *hooks)
 {
   assert(plain != NULL);
   assert(size > 0);
@@ -1735,38 +2302,369 @@ bool demangle(char *plain, size_t size, const char *mangled)
   /* <mangled-name> := _Z <encoding>
                        _Z <encoding> . <vendor-specific suffix>   #not currently handled
    */
-  if (mangled[0] != '_' || mangled[1] != 'Z')
-    return false;
+  plain[0] = '\0';
+  bool bounded = (length != NUL_TERMINATED);
+  if (!bounded)
+    length = strlen(mangled);
+  if (!type && (length < 2 || mangled[0] != '_' || mangled[1] != 'Z'))
+    return DEMANGLE_INVALID;
+  if (type && length == 0)
+    return DEMANGLE_INVALID;
 
   struct mangle mangle;
+  memset(&mangle, 0, sizeof mangle);  /* also clears the tables */
   mangle.plain = plain;
   mangle.size = size;
+
+  mangle.arena.base = pool;
+  mangle.arena.size = poolsize;
+  mangle.arena.top = 0;
+  mangle.arena.bottom = poolsize;
+  mangle.arena.chain = NULL;
+  mangle.arena.fixed = fixed;
+  mangle.arena.exhausted = false;
+
+  if (bounded) {
+    char *copy = arena_alloc(&mangle, length + 1);
+    if (copy == NULL) {
+      arena_free(&mangle.arena);
+      return DEMANGLE_NOSCRATCH;
+    }
+    memcpy(copy, mangled, length);
+    copy[length] = '\0';
+    mangled = copy;
+  }
   mangle.mangled = mangled;
-  mangle.mpos = mangle.mangled + 2; /* skip "_Z" */
-
-  memset(mangle.substitions, 0, MAX_SUBSTITUTIONS * sizeof(char *));
-  mangle.subst_count = 0;
-  memset(mangle.tpl_subst, 0, MAX_TEMPLATE_SUBST * sizeof(char*));
-  mangle.tpl_subst_count = 0;
-  memset(mangle.tpl_parse, 0, MAX_TEMPLATE_SUBST * sizeof(char*));
-  mangle.tpl_parse_count = 0;
-  memset(mangle.parameter_base, 0, MAX_FUNC_NESTING * sizeof(char*));
-  mangle.func_nest = 0;
-  memset(mangle.qualifiers, 0, sizeof mangle.qualifiers);
+  mangle.mpos = type ? mangle.mangled : mangle.mangled + 2; /* skip "_Z" */
 
   mangle.valid = true;
+  mangle.overflow = false;
   mangle.is_typecast_op = false;
   mangle.pack_expansion = false;
   mangle.nest = 0;
-  mangle.plain[0] = '\0';
-  _encoding(&mangle);
+  mangle.func_nest = 0;
+  mangle.depth = 0;
+  mangle.max_depth = max_depth;
+  mangle.tpl_depth = 0;
+  mangle.tpl_limit = tpl_limit;
+  mangle.elide_size = ELIDE_BUFFER;
+  if (hooks != NULL) {
+    mangle.step = hooks->step;
+    mangle.step_arg = hooks->step_arg;
+    mangle.memo = hooks->memo;
+    if (hooks->elide_size > 0)
+      mangle.elide_size = hooks->elide_size;
+  }
+  if (reserve_nesting(&mangle)) {
+    if (type) {
+      _type(&mangle);
+      if (*mangle.mpos != '\0')
+        mangle.valid = false; /* trailing characters after the type */
+    } else {
+      _encoding(&mangle);
+    }
+  }
+
+  arena_free(&mangle.arena);
+  if (mangle.valid)
+    return DEMANGLE_OK;
+  if (mangle.arena.exhausted)
+    return DEMANGLE_NOSCRATCH;
+  if (mangle.overflow)
+    return mangle.elide_overflow ? ELIDE_OVERFLOW : DEMANGLE_OVERFLOW;
+  return DEMANGLE_INVALID;
+}
 
-  tpl_subst_swap(&mangle);  /* this frees the lookup table & moves the work table to lookup */
-  tpl_subst_swap(&mangle);  /* free the lookup table again, in case the work table still held left-overs */
-  for (size_t i = 0; i < mangle.subst_count; i++) {
-    assert(mangle.substitions[i] != NULL);
-    free((void*)mangle.substitions[i]);
+bool demangle(char *plain, size_t size, const char *mangled)
+{
+  /* the first block of the arena is on the stack, so that the common case
+     (short symbols) needs no heap allocation at all */
+  void *pool[ARENA_INLINE / sizeof(void*)];
+  return demangle_run(plain, size, mangled, NUL_TERMINATED, (char*)pool, sizeof pool, false, false, NO_TEMPLATE_LIMIT, MAX_DEEP_PARSE_DEPTH, NULL) == DEMANGLE_OK;
+}
+
+/** demangle_type() - decodes a type name, such as the string returned by
+ *  std::type_info::name() (e.g. "N3foo3BarIiEE" or "PKc"), which has no "_Z"
+ *  prefix. The parameters and return value are the same as for demangle().
+ */
+bool demangle_type(char *plain, size_t size, const char *name)
+{
+  void *pool[ARENA_INLINE / sizeof(void*)];
+  return demangle_run(plain, size, name, NUL_TERMINATED, (char*)pool, sizeof pool, false, true, NO_TEMPLATE_LIMIT, MAX_DEEP_PARSE_DEPTH, NULL) == DEMANGLE_OK;
+}
+
+static int scratch_run(char *plain, size_t size, const char *mangled, size_t length,
+                       void *scratch, size_t scratch_size, bool type, short max_depth)
+{
+  if (scratch == NULL) {
+    void *pool[ARENA_INLINE / sizeof(void*)];
+    return demangle_run(plain, size, mangled, length, (char*)pool, sizeof pool, false, type, NO_TEMPLATE_LIMIT, max_depth, NULL);
   }
-  return mangle.valid;
+  /* align the start and the size of the scratch buffer to pointer size */
+  size_t skip = (sizeof(void*) - (uintptr_t)scratch % sizeof(void*)) % sizeof(void*);
+  if (scratch_size <= skip)
+    return DEMANGLE_NOSCRATCH;
+  scratch_size = (scratch_size - skip) & ~(sizeof(void*) - 1);
+  return demangle_run(plain, size, mangled, length, (char*)scratch + skip, scratch_size, true, type, NO_TEMPLATE_LIMIT, max_depth, NULL);
 }
 
+int demangle_scratch(char *plain, size_t size, const char *mangled, void *scratch, size_t scratch_size)
+{
+  assert(scratch != NULL);
+  return scratch_run(plain, size, mangled, NUL_TERMINATED, scratch, scratch_size, false, MAX_PARSE_DEPTH);
+}
+
+/** demangle_type_scratch() - the type name variant of demangle_scratch().
+ */
+int demangle_type_scratch(char *plain, size_t size, const char *name, void *scratch, size_t scratch_size)
+{
+  assert(scratch != NULL);
+  return scratch_run(plain, size, name, NUL_TERMINATED, scratch, scratch_size, true, MAX_PARSE_DEPTH);
+}
+
+/** demangle_n() - like demangle_scratch(), but the input is given by a pointer
+ *  and a length (it need not be zero-terminated), and the scratch buffer is
+ *  optional. When "scratch" is NULL, the working memory comes from the stack
+ *  and the heap, as for demangle().
+ */
+int demangle_n(char *plain, size_t size, const char *mangled, size_t length, void *scratch, size_t scratch_size)
+{
+  assert(length != NUL_TERMINATED);
+  return scratch_run(plain, size, mangled, length, scratch, scratch_size, false, MAX_DEEP_PARSE_DEPTH);
+}
+
+/** demangle_type_n() - the type name variant of demangle_n().
+ */
+int demangle_type_n(char *plain, size_t size, const char *name, size_t length, void *scratch, size_t scratch_size)
+{
+  assert(length != NUL_TERMINATED);
+  return scratch_run(plain, size, name, length, scratch, scratch_size, true, MAX_DEEP_PARSE_DEPTH);
+}
+
+/** demangle_grow() - like demangle_n() without a scratch buffer, but on
+ *  overflow, the output buffer "*plain" of "*size" bytes is replaced by one
+ *  that is four times as large, up to DEMANGLE_MAX_PLAIN bytes. A buffer that
+ *  is replaced is freed, unless it is "local" (the caller's buffer on the
+ *  stack, or NULL if the buffer is always on the heap). The caller must free
+ *  "*plain" when it differs from "local".
+ *  The result codes are those of demangle_n(); DEMANGLE_OVERFLOW means that
+ *  the name needs more than DEMANGLE_MAX_PLAIN bytes (a short mangled name can
+ *  expand to gigabytes), and DEMANGLE_NOSCRATCH that memory ran out. The
+ *  buffer in "*plain" stays valid in all cases.
+ */
+int demangle_grow(char **plain, size_t *size, const char *local, const char *mangled, size_t length)
+{
+  assert(plain != NULL && *plain != NULL);
+  assert(size != NULL && *size > 0);
+  assert(mangled != NULL);
+  int result;
+  while ((result = demangle_n(*plain, *size, mangled, length, NULL, 0)) == DEMANGLE_OVERFLOW) {
+    if (*size >= DEMANGLE_MAX_PLAIN)
+      break;
+    size_t newsize = (*size < DEMANGLE_MAX_PLAIN / 4) ? *size * 4 : DEMANGLE_MAX_PLAIN;
+    char *buffer = malloc(newsize);
+    if (buffer == NULL)
+      return DEMANGLE_NOSCRATCH;
+    if (*plain != local)
+      free(*plain);
+    *plain = buffer;
+    *size = newsize;
+  }
+  return result;
+}
+
+/** demangle_steps() - like demangle_scratch() without a scratch buffer, but
+ *  "step" is called at every parse step (every <encoding>, <type> and
+ *  <expression> in the mangled name). When it returns false, the parser stops
+ *  and the function returns DEMANGLE_INVALID. This is the hook that dstep.c
+ *  uses to suspend the parser; the number of steps is roughly the number of
+ *  types in the name, so that it bounds the work between two calls.
+ */
+int demangle_steps(char *plain, size_t size, const char *mangled, bool (*step)(void *arg), void *arg)
+{
+  assert(step != NULL);
+  void *pool[ARENA_INLINE / sizeof(void*)];
+  struct run_hooks hooks = { step, arg, NULL, 0 };
+  return demangle_run(plain, size, mangled, NUL_TERMINATED, (char*)pool, sizeof pool, false, false, NO_TEMPLATE_LIMIT, MAX_PARSE_DEPTH, &hooks);
+}
+
+/** demangle_memo_create() - creates a memo for demangle_memoized(), which
+ *  holds at most about "capacity" bytes of fragments (0 for the default of
+ *  16 MiB). When the memo is full, the fragments in it are still used, but no
+ *  new ones are added. Returns NULL when out of memory.
+ */
+struct demangle_memo *demangle_memo_create(size_t capacity)
+{
+  struct demangle_memo *memo = calloc(1, sizeof(struct demangle_memo));
+  if (memo == NULL)
+    return NULL;
+  memo->mask = 1023;
+  memo->buckets = calloc(memo->mask + 1, sizeof(struct memo_entry*));
+  if (memo->buckets == NULL) {
+    free(memo);
+    return NULL;
+  }
+  memo->capacity = (capacity > 0) ? capacity : MEMO_CAPACITY;
+  return memo;
+}
+
+void demangle_memo_destroy(struct demangle_memo *memo)
+{
+  if (memo == NULL)
+    return;
+  while (memo->blocks != NULL) {
+    struct memo_block *next = memo->blocks->next;
+    free(memo->blocks);
+    memo->blocks = next;
+  }
+  free(memo->buckets);
+  free(memo);
+}
+
+/** demangle_memo_stats() - returns the number of lookups in the memo that
+ *  were hits and misses.
+ */
+void demangle_memo_stats(const struct demangle_memo *memo, unsigned long *hits, unsigned long *misses)
+{
+  assert(memo != NULL);
+  if (hits != NULL)
+    *hits = memo->hits;
+  if (misses != NULL)
+    *misses = memo->misses;
+}
+
+/** demangle_memoized() - decodes a name, like demangle_n() without a scratch
+ *  buffer, for a batch of names that share class types (typically, all
+ *  symbols of a binary). Class types that occur in earlier names of the batch
+ *  are taken from the memo, instead of being parsed and rendered again. The
+ *  output is the same as that of demangle().
+ *
+ *  The memo is not thread-safe; each thread needs its own.
+ */
+int demangle_memoized(struct demangle_memo *memo, char *plain, size_t size, const char *mangled)
+{
+  assert(memo != NULL);
+  void *pool[ARENA_INLINE / sizeof(void*)];
+  struct run_hooks hooks = { NULL, NULL, memo, 0 };
+  return demangle_run(plain, size, mangled, NUL_TERMINATED, (char*)pool, sizeof pool, false, false, NO_TEMPLATE_LIMIT, MAX_DEEP_PARSE_DEPTH, &hooks);
+}
+
+/** demangle_abbrev() - decodes a mangled name into an abbreviated form that
+ *  fits in "size" characters (including the terminating zero), for display in
+ *  fixed-width columns and in flame graphs. Template arguments that are nested
+ *  deeper than "depth" levels are replaced by "<...>" (with "depth" zero, all
+ *  template arguments are); a negative "depth" shows all levels. If the name
+ *  is still too long, its tail is cut off and replaced by "...".
+ *
+ *  The name is decoded in a single pass into a buffer of fixed size (or into
+ *  "plain" if that is larger). When it is full, the parser stops, so the time
+ *  and memory do not depend on the length of the complete name (which may be
+ *  many times that of the mangled name); the consequence is that the part of
+ *  the mangled name after the cut is not checked for errors.
+ *
+ *  The elided template arguments are still parsed (for the substitutions that
+ *  they define), but their text is removed from the output as soon as each
+ *  argument list is complete, and while it is parsed, it is kept apart from
+ *  the text before it. This keeps the demangler's scans of the output short,
+ *  for deeply nested types. That buffer grows (by parsing the name again)
+ *  when the elided text does not fit in it, up to DEMANGLE_MAX_PLAIN bytes;
+ *  the text is discarded anyway, so it does not cut off the visible name.
+ *  The return codes are those of demangle_scratch(), except that
+ *  DEMANGLE_OVERFLOW does not occur.
+ */
+int demangle_abbrev(char *plain, size_t size, const char *mangled, int depth)
+{
+  assert(plain != NULL);
+  assert(size > 0);
+  assert(mangled != NULL);
+  /* a small output buffer is replaced by one with some room to spare, for
+     text that the demangler removes again (such as the "void" in "f(void)") */
+  char local[1024];
+  char *work = (size < sizeof local) ? local : plain;
+  size_t worksize = (size < sizeof local) ? sizeof local : size;
+  void *pool[ARENA_INLINE / sizeof(void*)];
+  short limit = (depth < 0) ? NO_TEMPLATE_LIMIT : (depth < SHRT_MAX) ? (short)depth : SHRT_MAX;
+  struct run_hooks hooks = { NULL, NULL, NULL, ELIDE_BUFFER };
+  int result;
+  while ((result = demangle_run(work, worksize, mangled, NUL_TERMINATED, (char*)pool, sizeof pool, false, false, limit, MAX_DEEP_PARSE_DEPTH, &hooks)) == ELIDE_OVERFLOW) {
+    if (hooks.elide_size >= DEMANGLE_MAX_PLAIN) {
+      result = DEMANGLE_OVERFLOW;
+      break;
+    }
+    hooks.elide_size *= 4;
+  }
+  if (result == DEMANGLE_OK || result == DEMANGLE_OVERFLOW) {
+    /* on overflow, the text up to the point where the output was full is kept
+       (the text of elided arguments may have been removed from it) */
+    size_t length = strlen(work);
+    if (result == DEMANGLE_OK && length < size) {
+      memmove(plain, work, length + 1);
+    } else if (size > 3) {
+      if (length > size - 4)
+        length = size - 4;
+      memmove(plain, work, length);
+      strcpy(plain + length, "...");
+    } else {
+      memmove(plain, work, size - 1);
+      plain[size - 1] = '\0';
+    }
+    result = DEMANGLE_OK;
+  } else {
+    plain[0] = '\0';
+  }
+  return result;
+}
+
+/** demangle_hash_text() - returns the 64-bit FNV-1a hash of a demangled name
+ *  (or of any text of the given length). This is the hash that
+ *  demangle_hash() returns for the mangled form of the name.
+ */
+uint64_t demangle_hash_text(const char *plain, size_t length)
+{
+  assert(plain != NULL || length == 0);
+  uint64_t hash = UINT64_C(14695981039346656037);
+  for (size_t i = 0; i < length; i++) {
+    hash ^= (unsigned char)plain[i];
+    hash *= UINT64_C(1099511628211);
+  }
+  return hash;
+}
+
+/** demangle_hash() - returns the hash of the demangled name in "hash", as an
+ *  identity of the symbol for deduplication and aggregation; the text itself
+ *  is not returned. The result code is that of demangle_scratch();
+ *  DEMANGLE_OVERFLOW is returned for a name whose demangled text is longer
+ *  than MAX_HASH_TEXT (a short mangled name can expand to gigabytes).
+ *
+ *  The demangler builds its output by insertion (the declarator of a function
+ *  pointer is moved into the middle of its type, for example), so the text is
+ *  only final when the parser finishes, and the hash is computed from it then.
+ *  The output goes to a buffer on the stack, which is only replaced by a heap
+ *  buffer for very long names (up to MAX_HASH_TEXT); the caller never
+ *  allocates or stores the text.
+ */
+int demangle_hash(uint64_t *hash, const char *mangled)
+{
+  assert(hash != NULL);
+  assert(mangled != NULL);
+  char local[1024];
+  char *plain = local;
+  size_t size = sizeof local;
+  void *pool[ARENA_INLINE / sizeof(void*)];
+  int result;
+  while ((result = demangle_run(plain, size, mangled, NUL_TERMINATED, (char*)pool, sizeof pool, false, false, NO_TEMPLATE_LIMIT, MAX_DEEP_PARSE_DEPTH, NULL)) == DEMANGLE_OVERFLOW) {
+    if (plain != local)
+      free(plain);
+    plain = local;
+    size *= 4;
+    if (size > MAX_HASH_TEXT)
+      break;
+    plain = malloc(size);
+    if (plain == NULL)
+      return DEMANGLE_NOSCRATCH;
+  }
+  *hash = (result == DEMANGLE_OK) ? demangle_hash_text(plain, strlen(plain)) : 0;
+  if (plain != local)
+    free(plain);
+  return result;
+}
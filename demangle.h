@@ -21,7 +21,45 @@
 #define _DEMANGLE_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* result codes of demangle_scratch() */
+#define DEMANGLE_OK         0
+#define DEMANGLE_INVALID    1   /* not a valid (or not a supported) mangled name */
+#define DEMANGLE_OVERFLOW   2   /* the output buffer is too small */
+#define DEMANGLE_NOSCRATCH  3   /* the scratch buffer is too small (or out of memory) */
+#define DEMANGLE_PENDING    4   /* not finished yet, see dstep_run() */
+#define DEMANGLE_AMBIGUOUS  5   /* the name has more than one encoding, see mangle() */
+
+#if !defined DEMANGLE_MAX_PLAIN
+# define DEMANGLE_MAX_PLAIN (1024 * 1024)  /* largest output buffer of demangle_grow() */
+#endif
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+struct demangle_memo;
 
 bool demangle(char *plain, size_t size, const char *mangled);
+int demangle_scratch(char *plain, size_t size, const char *mangled, void *scratch, size_t scratch_size);
+bool demangle_type(char *plain, size_t size, const char *name);
+int demangle_type_scratch(char *plain, size_t size, const char *name, void *scratch, size_t scratch_size);
+int demangle_n(char *plain, size_t size, const char *mangled, size_t length, void *scratch, size_t scratch_size);
+int demangle_type_n(char *plain, size_t size, const char *name, size_t length, void *scratch, size_t scratch_size);
+int demangle_grow(char **plain, size_t *size, const char *local, const char *mangled, size_t length);
+int demangle_steps(char *plain, size_t size, const char *mangled, bool (*step)(void *arg), void *arg);
+struct demangle_memo *demangle_memo_create(size_t capacity);
+void demangle_memo_destroy(struct demangle_memo *memo);
+int demangle_memoized(struct demangle_memo *memo, char *plain, size_t size, const char *mangled);
+void demangle_memo_stats(const struct demangle_memo *memo, unsigned long *hits, unsigned long *misses);
+int demangle_abbrev(char *plain, size_t size, const char *mangled, int depth);
+int demangle_hash(uint64_t *hash, const char *mangled);
+uint64_t demangle_hash_text(const char *plain, size_t length);
+
+#if defined __cplusplus
+}
+#endif
 
 #endif /* _DEMANGLE_H */
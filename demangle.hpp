@@ -0,0 +1,253 @@
+/* GNU C++ symbol name demangler
+ * Header-only C++ interface (C++17 or later).
+ *
+ * The functions take the input as a std::string_view (it need not be
+ * zero-terminated), and write the output into a std::basic_string that the
+ * caller passes in, so that a string that is reused keeps its capacity. Any
+ * allocator works, including std::pmr::polymorphic_allocator:
+ *
+ *     demangling::context ctx;               // or demangling::context::local()
+ *     std::pmr::string name{&resource};
+ *     if (ctx.demangle(symbol, name)) ...    // replaces the contents of name
+ *     ctx.append(symbol, line);              // appends to line
+ *     std::string_view v = ctx.demangle(symbol);  // view valid until next call
+ *
+ * A context owns the scratch memory for the parser and a buffer for the
+ * output; both only grow, up to max_output and max_scratch (a name that needs
+ * more is refused, like in __cxa_demangle). Once they are large enough for the
+ * symbols at hand, demangling does not allocate memory.
+ *
+ * Copyright 2022-2024, CompuPhase
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _DEMANGLE_HPP
+#define _DEMANGLE_HPP
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include "demangle.h"
+
+namespace demangling {
+
+/** small_name - result type with inline storage for "N" characters; longer
+ *  names spill to the heap.
+ */
+template<std::size_t N = 256>
+class small_name {
+public:
+  small_name() { inline_buf[0] = '\0'; }
+  small_name(const small_name &other) { assign(other.view()); }
+  small_name &operator=(const small_name &other) { if (this != &other) assign(other.view()); return *this; }
+
+  const char *c_str() const { return heap ? heap.get() : inline_buf; }
+  std::string_view view() const { return std::string_view(c_str(), len); }
+  operator std::string_view() const { return view(); }
+  std::size_t size() const { return len; }
+  bool empty() const { return len == 0; }
+
+  /* for the demangling functions: a writable buffer of at least "count" bytes */
+  char *reserve(std::size_t count)
+  {
+    if (heap ? count <= heap_size : count <= N)
+      return c_str_mutable();
+    heap.reset(new char[count]);
+    heap_size = count;
+    return heap.get();
+  }
+  void resize(std::size_t count) { len = count; }
+  std::size_t capacity() const { return heap ? heap_size : N; }
+
+private:
+  char *c_str_mutable() { return heap ? heap.get() : inline_buf; }
+  void assign(std::string_view text)
+  {
+    char *buf = reserve(text.size() + 1);
+    std::memcpy(buf, text.data(), text.size());
+    buf[text.size()] = '\0';
+    len = text.size();
+  }
+
+  char inline_buf[N];
+  std::unique_ptr<char[]> heap;
+  std::size_t heap_size = 0;
+  std::size_t len = 0;
+};
+
+/** context - owns the scratch and output memory for demangling. A context is
+ *  not thread-safe; use one per thread (see local()).
+ */
+class context {
+public:
+  static constexpr std::size_t max_output = 1024 * 1024;
+  static constexpr std::size_t max_scratch = 16 * 1024 * 1024;
+
+  explicit context(std::size_t scratch_size = 4096, std::size_t output_size = 1024)
+    : scratch(new char[scratch_size]), scratch_size(scratch_size),
+      output(new char[output_size]), output_size(output_size)
+  {
+    output[0] = '\0';
+  }
+  context(const context&) = delete;
+  context &operator=(const context&) = delete;
+
+  /** local() returns a context for the calling thread, that lives until the
+   *  thread exits.
+   */
+  static context &local()
+  {
+    static thread_local context ctx;
+    return ctx;
+  }
+
+  /** demangle() returns a view on the demangled name, which stays valid until
+   *  the next call on this context. It returns an empty view on failure (an
+   *  invalid name, or one that needs more than max_output or max_scratch).
+   */
+  std::string_view demangle(std::string_view mangled) { return into_output(mangled, false); }
+  std::string_view demangle_type(std::string_view name) { return into_output(name, true); }
+
+  /** demangle() replaces the contents of "out" by the demangled name; append()
+   *  adds it to the end. Both return false if the name is invalid or too long;
+   *  "out" is then empty (demangle) or unchanged (append).
+   */
+  template<class Traits, class Alloc>
+  bool demangle(std::string_view mangled, std::basic_string<char, Traits, Alloc> &out)
+  {
+    out.clear();
+    return append(mangled, out);
+  }
+  template<class Traits, class Alloc>
+  bool append(std::string_view mangled, std::basic_string<char, Traits, Alloc> &out)
+  {
+    return append_string(mangled, out, false);
+  }
+  template<class Traits, class Alloc>
+  bool demangle_type(std::string_view name, std::basic_string<char, Traits, Alloc> &out)
+  {
+    out.clear();
+    return append_string(name, out, true);
+  }
+  template<std::size_t N>
+  bool demangle(std::string_view mangled, small_name<N> &out) { return into_small(mangled, out, false); }
+  template<std::size_t N>
+  bool demangle_type(std::string_view name, small_name<N> &out) { return into_small(name, out, true); }
+
+private:
+  /* runs the C demangler, growing the scratch memory as needed; the output
+     buffer is grown by the callback "grow" (which returns the new buffer);
+     returns false past max_output or max_scratch */
+  template<class Grow>
+  bool run(std::string_view mangled, bool type, char *plain, std::size_t size, Grow grow)
+  {
+    if (mangled.empty())
+      return false;
+    for (;;) {
+      int result = type ? demangle_type_n(plain, size, mangled.data(), mangled.size(), scratch.get(), scratch_size)
+                        : demangle_n(plain, size, mangled.data(), mangled.size(), scratch.get(), scratch_size);
+      if (result == DEMANGLE_OK)
+        return true;
+      if (result == DEMANGLE_INVALID)
+        return false;
+      if (result == DEMANGLE_NOSCRATCH) {
+        if (scratch_size >= max_scratch)
+          return false;
+        /* allocate first, so that a bad_alloc leaves the size and the buffer
+           consistent */
+        std::unique_ptr<char[]> buffer(new char[2 * scratch_size]);
+        scratch = std::move(buffer);
+        scratch_size *= 2;
+      } else {
+        if (size >= max_output)
+          return false;
+        size *= 2;
+        plain = grow(size);
+      }
+    }
+  }
+
+  std::string_view into_output(std::string_view mangled, bool type)
+  {
+    bool ok = run(mangled, type, output.get(), output_size,
+                  [this](std::size_t size) {
+                    output.reset(new char[size]);
+                    output_size = size;
+                    return output.get();
+                  });
+    if (!ok)
+      return std::string_view();
+    return std::string_view(output.get());
+  }
+
+  template<class Traits, class Alloc>
+  bool append_string(std::string_view mangled, std::basic_string<char, Traits, Alloc> &out, bool type)
+  {
+    /* demangle into the output buffer of the context and append the result;
+       resizing the string to make room would zero-fill it on every call */
+    std::string_view text = into_output(mangled, type);
+    if (text.empty())
+      return false;
+    out.append(text.data(), text.size());
+    return true;
+  }
+
+  template<std::size_t N>
+  bool into_small(std::string_view mangled, small_name<N> &out, bool type)
+  {
+    std::size_t size = out.capacity();
+    bool ok = run(mangled, type, out.reserve(size), size,
+                  [&out](std::size_t size) { return out.reserve(size); });
+    out.resize(ok ? std::strlen(out.c_str()) : 0);
+    return ok;
+  }
+
+  std::unique_ptr<char[]> scratch;
+  std::size_t scratch_size;
+  std::unique_ptr<char[]> output;
+  std::size_t output_size;
+};
+
+/** Convenience functions that use the context of the calling thread. */
+template<class Traits, class Alloc>
+inline bool demangle(std::string_view mangled, std::basic_string<char, Traits, Alloc> &out)
+{
+  return context::local().demangle(mangled, out);
+}
+template<class Traits, class Alloc>
+inline bool append(std::string_view mangled, std::basic_string<char, Traits, Alloc> &out)
+{
+  return context::local().append(mangled, out);
+}
+template<class Traits, class Alloc>
+inline bool demangle_type(std::string_view name, std::basic_string<char, Traits, Alloc> &out)
+{
+  return context::local().demangle_type(name, out);
+}
+template<std::size_t N>
+inline bool demangle(std::string_view mangled, small_name<N> &out)
+{
+  return context::local().demangle(mangled, out);
+}
+inline std::string demangle(std::string_view mangled)
+{
+  std::string out;
+  context::local().demangle(mangled, out);
+  return out;
+}
+
+} // namespace demangling
+
+#endif /* _DEMANGLE_HPP */
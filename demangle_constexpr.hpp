@@ -0,0 +1,2097 @@
+/* GNU C++ symbol name demangler
+ * constexpr C++20 port of the demangler, for use in constant evaluation.
+ *
+ * This is a transcription of demangle.c: the same grammar productions, the
+ * same substitution rules and the same output. Only the memory management
+ * differs (constant evaluation allows neither the arena nor the C string
+ * functions), so that it can run at compile time:
+ *
+ *     constexpr auto name = demangling::compile_time::demangle("_ZN3foo3barEv");
+ *     static_assert(name.view() == "foo::bar()");
+ *
+ * The result is a fixed_name<N> that holds at most N - 1 characters (default
+ * 256); on failure, valid() returns false. The functions can be called at run
+ * time too, but demangle() (the C version) is faster there.
+ *
+ * Changes in the grammar of demangle.c must be made in this file too; test_cpp
+ * checks that both produce the same output on all test vectors, at compile
+ * time and at run time.
+ *
+ * Copyright 2022-2024, CompuPhase
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _DEMANGLE_CONSTEXPR_HPP
+#define _DEMANGLE_CONSTEXPR_HPP
+
+#include <cassert>
+#include <climits>
+#include <cstddef>
+#include <iterator>
+#include <string_view>
+#include <vector>
+
+namespace demangling {
+namespace compile_time {
+
+namespace detail {
+
+using std::size_t;
+
+constexpr size_t INIT_FUNC_NESTING = 8;
+#if defined MAX_DEEP_PARSE_DEPTH
+  constexpr int max_parse_depth = MAX_DEEP_PARSE_DEPTH;
+#else
+  constexpr int max_parse_depth = 2048; /* must match demangle() in demangle.c */
+#endif
+
+/* constexpr replacements for the functions of string.h */
+constexpr size_t cx_strlen(const char *s)
+{
+  size_t len = 0;
+  while (s[len] != '\0')
+    len++;
+  return len;
+}
+
+constexpr int cx_strncmp(const char *a, const char *b, size_t n)
+{
+  for (size_t i = 0; i < n; i++) {
+    if (a[i] != b[i])
+      return (unsigned char)a[i] < (unsigned char)b[i] ? -1 : 1;
+    if (a[i] == '\0')
+      break;
+  }
+  return 0;
+}
+
+constexpr int cx_strcmp(const char *a, const char *b)
+{
+  while (*a != '\0' && *a == *b) {
+    a++;
+    b++;
+  }
+  return (unsigned char)*a - (unsigned char)*b;
+}
+
+constexpr const char *cx_strchr(const char *s, char c)
+{
+  for ( ;; s++) {
+    if (*s == c)
+      return s;
+    if (*s == '\0')
+      return NULL;
+  }
+}
+
+/* stops at the first match, so it never reads beyond a zero terminator */
+constexpr const char *cx_memchr(const char *s, char c, size_t n)
+{
+  for (size_t i = 0; i < n; i++)
+    if (s[i] == c)
+      return s + i;
+  return NULL;
+}
+
+constexpr void cx_memcpy(char *dest, const char *src, size_t n)
+{
+  for (size_t i = 0; i < n; i++)
+    dest[i] = src[i];
+}
+
+constexpr void cx_memmove(char *dest, const char *src, size_t n)
+{
+  /* in constant evaluation, pointers into different objects cannot be compared,
+     so copy through a temporary buffer */
+  std::vector<char> tmp(src, src + n);
+  for (size_t i = 0; i < n; i++)
+    dest[i] = tmp[i];
+}
+
+constexpr void cx_memset(char *dest, char c, size_t n)
+{
+  for (size_t i = 0; i < n; i++)
+    dest[i] = c;
+}
+
+constexpr char *cx_strcpy(char *dest, const char *src)
+{
+  size_t i = 0;
+  do {
+    dest[i] = src[i];
+  } while (src[i++] != '\0');
+  return dest;
+}
+
+constexpr char *cx_strcat(char *dest, const char *src)
+{
+  cx_strcpy(dest + cx_strlen(dest), src);
+  return dest;
+}
+
+struct table {
+  std::vector<char*> item;
+  size_t count = 0;
+};
+
+struct mangle {
+  char *plain = NULL;           /**< [output] demangled name */
+  size_t size = 0;              /**< size (in characters) of the "plain" buffer */
+  const char *mangled = NULL;   /**< [input] mangled name */
+  const char *mpos = NULL;      /**< current position, look-ahead pointer */
+  bool valid = true;            /**< whether the mangled name is valid */
+  bool overflow = false;        /**< whether the "plain" buffer was too small */
+  bool is_typecast_op = false;  /**< whether this a typecast operator */
+  bool pack_expansion = false;  /**< whether template parameter substitution refers to a pack */
+  short nest = 0;               /**< nesting level for names */
+  short func_nest = 0;          /**< function nesting level (of parameter lists) */
+  short depth = 0;              /**< recursion depth of the parser */
+  char qualifiers[8] = {};      /**< const, reference, and others */
+  std::vector<char*> parameter_base;  /**< indexed by func_nest */
+  struct table substitions;
+  struct table tpl_subst;       /**< lookup table */
+  struct table tpl_parse;       /**< work table, while parsing a template */
+  std::vector<char*> arena;     /**< all allocations, freed at the end */
+};
+
+/* ----- below this line, the code follows demangle.c ----- */
+
+constexpr int is_operator(struct mangle *mangle);
+constexpr int is_builtin_type(struct mangle *mangle);
+constexpr int is_abbreviation(struct mangle *mangle);
+constexpr bool is_ctor_dtor_name(struct mangle *mangle);
+
+constexpr bool _abi_tags(struct mangle *mangle);
+constexpr bool _template_args(struct mangle *mangle);
+constexpr void _template_args_pack(struct mangle *mangle);
+constexpr void _source_name(struct mangle *mangle);
+constexpr void _unqualified_name(struct mangle *mangle);
+constexpr void _function_type(struct mangle *mangle);
+constexpr void _closure_type(struct mangle *mangle);
+constexpr void _unnamed_type_name(struct mangle *mangle);
+constexpr void _substitution(struct mangle *mangle);
+constexpr void _template_param(struct mangle *mangle);
+constexpr void _local_name(struct mangle *mangle);
+constexpr void _ctor_dtor_name(struct mangle *mangle);
+constexpr void _operator(struct mangle *mangle);
+constexpr void _expr_primary(struct mangle *mangle);
+constexpr void _expression(struct mangle *mangle);
+constexpr void _decltype(struct mangle *mangle);
+constexpr void _nested_name(struct mangle *mangle);
+constexpr void _name(struct mangle *mangle);
+constexpr void _type(struct mangle *mangle);
+constexpr void _function_encoding(struct mangle *mangle);
+constexpr void _encoding(struct mangle *mangle);
+
+struct operator_def {
+  const char *abbrev;
+  const char *name;
+  short operands;
+};
+
+inline constexpr operator_def operators[] = {
+  { "cv", "(?)", 1 },           /* type cast */
+  { "nw", "new", 1 },
+  { "na", "new[]", 1 },
+  { "dl", "delete", 1 },
+  { "da", "delete[]", 1 },
+  { "ng", "-", 1 },             /* (unary) */
+  { "ad", "&", 1 },             /* (unary) */
+  { "de", "*", 1 },             /* (unary) */
+  { "co", "~", 2 },
+  { "pl", "+", 2 },
+  { "mi", "-", 2 },
+  { "ml", "*", 2 },
+  { "dv", "/", 2 },
+  { "rm", "%", 2 },
+  { "an", "&", 2 },
+  { "or", "|", 2 },
+  { "eo", "^", 2 },
+  { "aS", "=", 2 },
+  { "pL", "+=", 2 },
+  { "mI", "-=", 2 },
+  { "mL", "*=", 2 },
+  { "dV", "/=", 2 },
+  { "rM", "%=", 2 },
+  { "aN", "&=", 2 },
+  { "oR", "|=", 2 },
+  { "eO", "^=", 2 },
+  { "ls", "<<", 2 },
+  { "rs", ">>", 2 },
+  { "lS", "<<=", 2 },
+  { "rS", ">>=", 2 },
+  { "eq", "==", 2 },
+  { "ne", "!=", 2 },
+  { "lt", "<", 2 },
+  { "gt", ">", 2 },
+  { "le", "<=", 2 },
+  { "ge", ">=", 2 },
+  { "ss", "<=>", 2 },
+  { "nt", "!", 1 },
+  { "aa", "&&", 2 },
+  { "oo", "||", 2 },
+  { "pp", "++", 1 },            /* postfix in <expression> context */
+  { "mm", "--", 1 },            /* postfix in <expression> context */
+  { "cm", ",", 2 },
+  { "pm", "->*", 2 },
+  { "pt", "->", 2 },
+  { "cl", "()", 0 },            /* arbitrary number of operands */
+  { "ix", "[]", 2 },
+  { "qu", "?", 3 },
+  /* ----- for use in <expression> context only */
+  { "pp_", "++", 1 },           /* prefix */
+  { "mm_", "--", 1 },           /* prefix */
+  { "dt", ".", 2 },
+  { "pt", "->", 2 },
+  { "ds", ".*", 2 },
+  { "sr", "::", 2 },
+};
+
+struct stringpair {
+  const char *abbrev;
+  const char *name;
+};
+
+inline constexpr stringpair types[] = {
+  { "v", "void" },
+  { "w", "wchar_t" },
+  { "b", "bool" },
+  { "c", "char" },
+  { "a", "signed char" },
+  { "h", "unsigned char" },
+  { "s", "short" },
+  { "t", "unsigned short" },
+  { "i", "int" },
+  { "j", "unsigned int" },
+  { "l", "long" },
+  { "m", "unsigned long" },
+  { "x", "long long" },         /* __int64 */
+  { "y", "unsigned long long" },/* __int64 */
+  { "n", "__int128" },
+  { "o", "unsigned __int128" },
+  { "f", "float" },
+  { "d", "double" },
+  { "e", "long double" },       /* __float80 */
+  { "g", "__float128" },
+  { "z", "..." },
+  { "Da","auto" },
+  { "Dc","decltype(auto)" },
+  { "Dn","decltype(nullptr)" },
+  { "Dh","decimal16" },
+  { "Df","decimal32" },
+  { "Dd","decimal64" },
+  { "De","decimal128" },
+  { "Du","char8_t" },
+  { "Ds","char16_t" },
+  { "Di","char32_t" },
+};
+
+inline constexpr stringpair abbreviations[] = {
+  { "St", "std" },              /* also ::std:: */
+  { "Sa", "std::allocator" },
+  { "Sb", "std::basic_string" },
+  { "Ss", "std::string" },      /* std::basic_string<char,::std::char_traits<char>,::std::allocator<char>>*/
+  { "Si", "std::istream" },     /* std::basic_istream<char,std::char_traits<char>> */
+  { "So", "std::ostream" },     /* std::basic_ostream<char,std::char_traits<char>> */
+  { "Sd", "std::iostream" },    /* std::basic_iostream<char,std::char_traits<char>> */
+};
+
+/* Character classification and number conversion. These do not use the
+   functions from ctype.h and stdlib.h, because those depend on the locale
+   (and demangle_scratch() must be safe to call from a signal handler). */
+constexpr bool is_digit(char c)
+{
+  return c >= '0' && c <= '9';
+}
+
+constexpr bool is_upper(char c)
+{
+  return c >= 'A' && c <= 'Z';
+}
+
+constexpr bool is_alpha(char c)
+{
+  return is_upper(c) || (c >= 'a' && c <= 'z');
+}
+
+constexpr bool is_alnum(char c)
+{
+  return is_alpha(c) || is_digit(c);
+}
+
+constexpr bool is_xdigit(char c)
+{
+  return is_digit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+/** parse_number() - reads a decimal number and advances the position past
+ *  it. The value saturates at INT_MAX (lengths and indices in a mangled name
+ *  never come close).
+ */
+constexpr long parse_number(const char **pos)
+{
+  assert(pos != NULL && *pos != NULL);
+  long value = 0;
+  while (is_digit(**pos)) {
+    int digit = **pos - '0';
+    value = (value <= (INT_MAX - digit) / 10) ? value * 10 + digit : INT_MAX;
+    *pos += 1;
+  }
+  return value;
+}
+
+/** parse_ulong() - reads a decimal number like parse_number(), for a value
+ *  that is printed rather than used (an array dimension). It saturates at
+ *  ULONG_MAX, like strtoul().
+ */
+constexpr unsigned long parse_ulong(const char **pos)
+{
+  assert(pos != NULL && *pos != NULL);
+  unsigned long value = 0;
+  while (is_digit(**pos)) {
+    unsigned digit = (unsigned)(**pos - '0');
+    value = (value <= (ULONG_MAX - digit) / 10) ? value * 10 + digit : ULONG_MAX;
+    *pos += 1;
+  }
+  return value;
+}
+
+/** format_number() - stores the decimal representation of the value in the
+ *  buffer (which must have room for 21 characters), and returns a pointer to
+ *  the zero terminator.
+ */
+constexpr char *format_number(char *buffer, unsigned long value)
+{
+  assert(buffer != NULL);
+  char digits[24];
+  int count = 0;
+  do {
+    digits[count++] = (char)('0' + value % 10);
+    value /= 10;
+  } while (value > 0);
+  while (count > 0)
+    *buffer++ = digits[--count];
+  *buffer = '\0';
+  return buffer;
+}
+
+/** peek() - match, but don't change the current position. */
+constexpr int peek(struct mangle *mangle, const char *keyword)
+{
+  assert(mangle != NULL);
+  return mangle->valid && cx_strncmp(mangle->mpos, keyword, cx_strlen(keyword)) == 0;
+}
+
+/** match() - advance the current position on a match (do not move on
+ *  mismatch). Never matches anything after the mangled name has been flagged as
+ *  invalid.
+ */
+constexpr int match(struct mangle *mangle, const char *keyword)
+{
+  assert(mangle != NULL);
+  int result = peek(mangle, keyword);
+  if (result)
+    mangle->mpos += cx_strlen(keyword);
+  return result;
+}
+
+/** expect() - advance (skip) on match, but flag as invalid on mismatch. */
+constexpr int expect(struct mangle *mangle, const char *keyword)
+{
+  assert(mangle != NULL);
+  if (mangle->valid && !match(mangle, keyword))
+    mangle->valid = false;
+  return mangle->valid;
+}
+
+constexpr int expect_number(struct mangle *mangle, char sentinel, long *value)
+{
+  assert(mangle != NULL);
+  if (mangle->valid) {
+    int negate = 0;
+    if (*mangle->mpos == 'n') {
+      negate = 1;
+      mangle->mpos += 1;
+    }
+    const char *ptr = mangle->mpos;
+    long v = parse_number(&ptr);
+    if (ptr == mangle->mpos || v < 0) {
+      mangle->valid=false;
+    } else {
+      mangle->mpos = ptr;
+      if (negate)
+        v = -v;
+      if (value != NULL)
+        *value = v;
+    }
+    if (sentinel != '\0') {
+      if (*mangle->mpos == sentinel)
+        mangle->mpos += 1;
+      else
+        mangle->valid = false;
+    }
+  }
+  return mangle->valid;
+}
+
+/** on_sentinel() - returns true if arrived at the end of the mangled symbol. */
+constexpr int on_sentinel(struct mangle *mangle)
+{
+  assert(mangle != NULL);
+  return !mangle->valid
+         || *mangle->mpos == '\0'
+         || *mangle->mpos == '.'                                  /* clone suffix */
+         || (*mangle->mpos == '@' && *(mangle->mpos + 1) == '@'); /* library suffix */
+}
+
+constexpr bool has_return_type(struct mangle *mangle)
+{
+  assert(mangle != NULL);
+  if (mangle->is_typecast_op)
+    return false;
+
+  size_t len = cx_strlen(mangle->plain);
+  if (len < 1 || mangle->plain[len - 1] != '>')
+    return false;
+  if (len >= 2 && (is_alnum(mangle->plain[len - 2]) || cx_strchr(" ])*&", mangle->plain[len - 2]) != NULL))
+    return true;
+
+  return false;
+}
+
+constexpr const char *find_matching(const char *head, const char *tail, char c)
+{
+  assert(head != NULL);
+  assert(tail != NULL && tail >= head);
+  int dir;
+  char m;
+  switch (c) {
+  case '(':
+    m = ')';
+    dir = 1;
+    break;
+  case ')':
+    m = '(';
+    dir = -1;
+    break;
+  case '[':
+    m = ']';
+    dir = 1;
+    break;
+  case ']':
+    m = '[';
+    dir = -1;
+    break;
+  case '<':
+    m = '>';
+    dir = 1;
+    break;
+  case '>':
+    m = '<';
+    dir = -1;
+    break;
+  case '{':
+    m = '}';
+    dir = 1;
+    break;
+  case '}':
+    m = '{';
+    dir = -1;
+    break;
+  default:
+    assert(0);
+  }
+  int nest = 0;
+  const char *iter;
+  if (dir < 0) {
+    iter = tail;
+    while (iter != head && (*iter != m || nest > 0)) {
+      iter -= 1;
+      if (*iter == c)
+        nest++;
+      else if (*iter == m)
+        nest--;
+    }
+  } else {
+    iter = head;
+    while (iter != tail && (*iter != m || nest > 0)) {
+      iter += 1;
+      if (*iter == c)
+        nest++;
+      else if (*iter == m)
+        nest--;
+    }
+  }
+  return (*iter == m) ? iter : NULL;
+}
+
+constexpr char *check_func_array(struct mangle *mangle, const char *base)
+{
+  assert(mangle != NULL);
+  assert(base != NULL && base >= mangle->plain);
+  if (!mangle->valid || cx_strlen(base) == 0)
+    return NULL;
+  /* go to the end (either of the string, or of the parenthesized section) */
+  const char *p = base + cx_strlen(base) - 1;
+  if (*base == '(') {
+    p = find_matching(base, p, *base);
+    assert(p != NULL);  /* otherwise, constructed plain string was invalid */
+    p -= 1;             /* point to last character before matching ')' */
+  }
+  if (p >= mangle->plain + 5 && cx_strcmp(p - 4, "const") == 0)
+    p -= 5;
+  if (p > mangle->plain && *p == ' ')
+    p -= 1;
+  if (*p == ')') {
+    p = find_matching(mangle->plain, p, *p);
+    assert(p != NULL && *p == '(');
+    if (p >= base + 8 && cx_strncmp(p - 8, "decltype", 8) == 0)
+      p -= 8;
+  } else if (*p == ']') {
+    while (*p == ']') {
+      p = find_matching(mangle->plain, p,*p);
+      assert(p != NULL && *p == '[');
+      if (p > base && *(p - 1) == ']')
+        p -= 1;
+    }
+  }
+  return (p >= base && (*p == '(' || *p == '[')) ? const_cast<char*>(p) : NULL;
+}
+
+constexpr char *insertion_point(struct mangle *mangle, const char *base)
+{
+  /* find the most deeply nested "(*" or "(..::*)", skipping templates */
+  const char *mark = base;
+  const char *post_mark = mark;
+  int advance = 0;
+  for ( ;; ) {
+    const char *head = mark + advance;
+    while (*head != '\0') {
+      if (*head == '(')
+        break;
+      if (*head == '<') {
+        while (*head != '\0' && *head != '>')
+          head++;
+      }
+      if (*head != '\0')
+        head++;
+    }
+    if (*head != '(')
+      break;
+    const char *tail = head + 1;
+    if (*tail == '*') {
+      while (*(tail + 1) == '*')
+        tail++;
+    } else if (is_alpha(*tail) || *tail == '_') {
+      while (*tail != '\0' && *tail != ')' && *tail != ':')
+        tail++;
+      if (*tail == ':' && *(tail + 1) == ':' && *(tail + 2) == '*') {
+        tail += 2;
+        while (*(tail + 1) == '*')
+          tail++;
+      }
+    }
+    if (*head != '(' || *tail != '*')
+      break;
+    mark = head;
+    post_mark = tail;
+    advance = 1;
+  }
+
+  /* if a function definition is enclosed in it, get the insertion point from it;
+     otherwise skip any '*' characters */
+  char *p = check_func_array(mangle, mark);
+  if (p == NULL) {
+    if (*mark == '(' && *post_mark == '*')
+      p = const_cast<char*>(post_mark) + 1;
+    else
+      p = const_cast<char*>((mark == base) ? base + cx_strlen(base) : mark);
+  }
+
+  return p;
+}
+
+/** get_number() - extracts the number, but does not interpret it (the number
+ *  is simply stored as a string).
+ */
+constexpr size_t get_number(struct mangle *mangle, char *field, size_t size, int hex)
+{
+  assert(mangle != NULL);
+  assert(field != NULL);
+  assert(size > 0);
+  cx_memset(field, 0, size);
+  size_t i = 0;
+  while (is_digit(*mangle->mpos) || (hex && is_xdigit(*mangle->mpos))) {
+    if (i < size - 1)
+      field[i] = *mangle->mpos++;
+    i++;
+  }
+  return i;
+}
+
+/** append_n() - appends "count" characters of the text at the end of the
+ *  result string (demangled string). If the text would not fit, the result is
+ *  set to invalid.
+ */
+constexpr void append_n(struct mangle *mangle, const char *text, size_t count)
+{
+  assert(mangle != NULL);
+  assert(text != NULL);
+  if (mangle->valid) {
+    size_t len = cx_strlen(mangle->plain);
+    /* add a space to avoid ambiguity (it counts for the size check) */
+    size_t space = (len > 0 && count > 0 && mangle->plain[len - 1] == *text && (mangle->plain[len - 1] == '<' || mangle->plain[len - 1] == '>')) ? 1 : 0;
+    if (len + space + count < mangle->size) {
+      if (space)
+        mangle->plain[len++] = ' ';
+      cx_memcpy(mangle->plain + len, text, count);
+      mangle->plain[len + count] = '\0';
+    } else {
+      mangle->valid = false;
+      mangle->overflow = true;
+    }
+  }
+}
+
+/** append() - appends text at the end of the result string. */
+constexpr void append(struct mangle *mangle, const char *text)
+{
+  assert(text != NULL);
+  append_n(mangle, text, cx_strlen(text));
+}
+
+/** append_space() adds a space to the result string, unless the character
+ *  currently at the end is a separator too. (This still adds more spaces than
+ *  strictly necessary, but it avoids glueing words together.)
+ */
+constexpr void append_space(struct mangle *mangle)
+{
+  /* optionally appends a space character */
+  assert(mangle != NULL);
+  size_t len = cx_strlen(mangle->plain);
+  if (len > 0) {
+    const char separators[]= " ([<,:";
+    if (cx_strchr(separators, mangle->plain[len - 1]) == NULL)
+      append(mangle, " ");
+  }
+}
+
+constexpr void insert(struct mangle *mangle, char *mark, const char *text)
+{
+  assert(mangle != NULL);
+  assert(text != NULL);
+
+  if (mangle->valid) {
+    assert(mark >= mangle->plain && mark <= mangle->plain + cx_strlen(mangle->plain));
+    if (*mark == '\0') {
+      /* inserting at the end is appending */
+      append(mangle, text);
+    } else {
+      size_t len = cx_strlen(mangle->plain);
+      size_t ln2 = cx_strlen(text);
+      assert(ln2 > 0);
+      if (len + ln2 < mangle->size) {
+        size_t num = len - (mark - mangle->plain) + 1;
+        cx_memmove(mark + ln2, mark, num * sizeof(char));
+        cx_memmove(mark, text, ln2 * sizeof(char));
+      } else {
+        mangle->valid = false;
+        mangle->overflow = true;
+      }
+    }
+  }
+}
+
+/** enter_level() increments the recursion depth, and flags the mangled name
+ *  as invalid when it exceeds the limit; leave_level() decrements it again.
+ *  Every cycle in the grammar passes through one of the functions that keep
+ *  track of the depth, so the native stack usage is bounded.
+ */
+constexpr bool enter_level(struct mangle *mangle)
+{
+  assert(mangle != NULL);
+  mangle->depth += 1;
+  if (mangle->depth > max_parse_depth)
+    mangle->valid = false;
+  return mangle->valid;
+}
+
+constexpr void leave_level(struct mangle *mangle)
+{
+  assert(mangle != NULL);
+  assert(mangle->depth > 0);
+  mangle->depth -= 1;
+}
+
+/** arena_alloc() returns a block of memory that stays valid until the end of
+ *  the demangling; work_alloc() allocates a temporary buffer. In constant
+ *  evaluation, all allocations must be released before it ends, so both are
+ *  tracked in a list that is freed at the end (work_release() is a no-op).
+ */
+constexpr char *arena_alloc(struct mangle *mangle, size_t size)
+{
+  assert(mangle != NULL);
+  char *block = new char[size]();
+  mangle->arena.push_back(block);
+  return block;
+}
+
+constexpr char *work_mark(struct mangle *mangle)
+{
+  (void)mangle;
+  return NULL;
+}
+
+constexpr char *work_alloc(struct mangle *mangle, size_t size)
+{
+  return arena_alloc(mangle, size);
+}
+
+constexpr void work_release(struct mangle *mangle, const char *mark)
+{
+  (void)mangle;
+  (void)mark;
+}
+
+constexpr void table_add(struct mangle *mangle, struct table *table, char *item)
+{
+  (void)mangle;
+  table->item.push_back(item);
+  table->count = table->item.size();
+}
+
+constexpr bool reserve_nesting(struct mangle *mangle)
+{
+  assert(mangle != NULL);
+  if ((size_t)mangle->func_nest >= mangle->parameter_base.size())
+    mangle->parameter_base.resize(mangle->func_nest + INIT_FUNC_NESTING, NULL);
+  return true;
+}
+
+constexpr char *current_position(struct mangle *mangle)
+{
+  assert(mangle != NULL);
+  return mangle->plain + cx_strlen(mangle->plain);
+}
+
+constexpr void add_substitution(struct mangle *mangle, const char *text, int tpl)
+{
+  assert(mangle != NULL);
+  assert(text != NULL);
+
+  if (!mangle->valid)
+    return;
+
+
+  size_t length = cx_strlen(text);
+  char *str = arena_alloc(mangle, (length + 1) * sizeof(char));
+  if (str != NULL) {
+    cx_memcpy(str, text, length);
+    str[length] = '\0';
+    if (tpl)
+      table_add(mangle, &mangle->tpl_parse, str); /* insert in the work table */
+    else
+      table_add(mangle, &mangle->substitions, str);
+  }
+}
+
+constexpr void tpl_subst_swap(struct mangle *mangle)
+{
+  assert(mangle != NULL);
+  /* the work table becomes the look-up table, and the work table is reset */
+  mangle->tpl_subst = mangle->tpl_parse;
+  mangle->tpl_parse.item.clear();
+  mangle->tpl_parse.count = 0;
+}
+
+/** _qualifier_pre() handles <cv-qualifier> plus optionally <ref-qualifier>, but
+ *  stores codes in a list (because these need to be appended after the type).
+ */
+constexpr void _qualifier_pre(struct mangle *mangle, char *qualifiers, size_t size, int include_ref)
+{
+  assert(mangle != NULL);
+  assert(qualifiers != NULL);
+  assert(size > 0);
+  size_t count = 0;
+  while (count < size - 1 && (*mangle->mpos == 'r' || *mangle->mpos == 'V' || *mangle->mpos == 'K')) {
+    qualifiers[count++] = *mangle->mpos;
+    mangle->mpos += 1;
+  }
+  if (include_ref) {
+    while (count < size - 1 && (*mangle->mpos == 'R' || *mangle->mpos == 'O')) {
+      qualifiers[count++] = *mangle->mpos;
+      mangle->mpos += 1;
+    }
+  }
+  assert(count < size);
+  qualifiers[count] = '\0';
+}
+
+constexpr void _qualifier_post(struct mangle *mangle, const char *qualifiers)
+{
+  assert(mangle != NULL);
+  assert(qualifiers != NULL);
+  for (int i = 0; qualifiers[i] != '\0'; i++) {
+    if (qualifiers[i] != 'R' && qualifiers[i] != 'O')
+      append_space(mangle);
+    if (qualifiers[i] == 'r')
+      append(mangle, "restrict");
+    else if (qualifiers[i] == 'V')
+      append(mangle, "volatile");
+    else if (qualifiers[i] == 'K')
+      append(mangle, "const");
+    else if (qualifiers[i] == 'R')
+      append(mangle, "&");
+    else if (qualifiers[i] == 'O')
+      append(mangle, "&&");
+    else
+      assert(0);
+  }
+}
+
+constexpr void _extended_qualifier(struct mangle *mangle)
+{
+  /* <extended-qualifier> ::= ( U <source-name> <template-arg>* )+ <type>
+   */
+  assert(mangle != NULL);
+  if (match(mangle, "U")) {
+    /* find the end of extended-qualifiers */
+    constexpr int MAX_EXTQ = 10;
+    char *base = current_position(mangle);
+    const char *mpos_stack[MAX_EXTQ];
+    int count = 0;
+    do {
+      mpos_stack[count++] = mangle->mpos;
+      _source_name(mangle);
+      _template_args(mangle);
+    } while (count < MAX_EXTQ && mangle->valid && match(mangle, "U"));
+
+    *base = '\0'; /* restore state */
+    _type(mangle);
+
+    const char *mpos_save = mangle->mpos;
+    for (int i = count - 1; i >= 0; i--) {
+      mangle->mpos = mpos_stack[i];
+      append_space(mangle);
+      _source_name(mangle);
+      add_substitution(mangle, base, 0);
+    }
+    mangle->mpos = mpos_save;
+  }
+}
+
+constexpr bool _abi_tags(struct mangle *mangle)
+{
+  /* <abi-tag> := B <source-name>               # right-to-left associative
+   */
+  assert(mangle != NULL);
+  int count = 0;
+  while (match(mangle, "B")) {
+    append(mangle, (count++ == 0) ? "[" : ",");
+    append(mangle, "abi:");
+    _source_name(mangle);
+  }
+  if (count > 0)
+    append(mangle, "]");
+  return count > 0;
+}
+
+constexpr bool _template_args(struct mangle *mangle)
+{
+  /* <template-args> ::= I <template-arg>* E
+
+     <template-arg> ::= J <template-arg>* E     # argument pack
+                        X <expression> E        # expression
+                        <expr-primary>          # simple expressions
+                        <type>
+  */
+  assert(mangle != NULL);
+  if (!match(mangle, "I"))
+    return false;
+
+  /* save the current parse list, for nested template declarations */
+  struct table save_parse = mangle->tpl_parse;
+  mangle->tpl_parse.item.clear();
+  mangle->tpl_parse.count = 0;
+
+  append(mangle, "<");
+  int count = 0;
+  while (mangle->valid && !match(mangle, "E")) {
+    if (count++ > 0)
+      append(mangle, ",");
+    char *mark = current_position(mangle);
+    if (peek(mangle, "J")) {
+      _template_args_pack(mangle);
+    } else if (match(mangle, "X")) {
+      _expression(mangle);
+      expect(mangle, "E");
+    } else if (peek(mangle, "L")) {
+      _expr_primary(mangle);
+    } else {
+      _type(mangle);
+    }
+    add_substitution(mangle, mark, 1);
+  }
+  append(mangle, ">");
+
+  tpl_subst_swap(mangle); /* swap any previous (or nested) template parameters by the new ones */
+  mangle->tpl_parse = save_parse;
+
+  return true;
+}
+
+constexpr void _template_args_pack(struct mangle *mangle)
+{
+  /* <template->args-pack> ::= J <template-arg>* E
+  */
+  assert(mangle != NULL);
+  if (expect(mangle, "J")) {
+    int count = 0;
+    while (mangle->valid && !match(mangle, "E")) {
+      if (count++ > 0)
+        append(mangle, ",");
+      _type(mangle);
+    }
+  }
+}
+
+constexpr void _discriminator(struct mangle *mangle)
+{
+  /* <discriminator> ::= _ <digit> _
+                         _ _ <digit> <digit>+ _
+  */
+  assert(mangle != NULL);
+  if (match(mangle, "_")) {
+    if (match(mangle, "_")) {
+      while (is_digit(*mangle->mpos))
+        mangle->mpos += 1;      /* skip (ignore) all following digits */
+      expect(mangle, "_");
+    } else {
+      mangle->mpos += 1;        /* skip (ignore) single digit discriminator */
+    }
+  }
+}
+
+constexpr void _source_name(struct mangle *mangle)
+{
+  /* <source-name> ::= <number> <character>+    #string with length prefix
+   */
+  assert(mangle != NULL);
+  if (mangle->valid) {
+    if (!is_digit(*mangle->mpos)) {
+      mangle->valid = false;
+      return;
+    }
+    long count = parse_number(&mangle->mpos);
+    if (cx_memchr(mangle->mpos, '\0', count) != NULL) {
+      mangle->valid = false;
+      return;
+    }
+    append_n(mangle, mangle->mpos, count);
+    mangle->mpos += count;
+  }
+}
+
+constexpr void _unqualified_name(struct mangle *mangle)
+{
+  /* <unqualified-name> ::= <operator-name>
+                            <ctor-dtor-name>
+                            <source-name>
+                            L <source-name> <discriminator> # <local-source-name>
+                            DC <source-name>+ E             # structured binding declaration
+                            Ut [ <number> ] _               # <unnamed-type-name>
+                            Ul <type>+ E [ <number> ] _     # <closure-type-name>
+  */
+  assert(mangle != NULL);
+  if (mangle->valid) {
+    if (is_operator(mangle) >= 0) {
+      _operator(mangle);
+    } else if (is_ctor_dtor_name(mangle)) {
+      _ctor_dtor_name(mangle);
+    } else if (is_digit(*mangle->mpos)) {
+      _source_name(mangle);
+    } else if (match(mangle, "L")) {
+      _source_name(mangle);
+      _discriminator(mangle);
+    } else if (match(mangle, "DC")) {
+      while (is_digit(*mangle->mpos))
+        _source_name(mangle);
+      expect(mangle, "E");
+    } else if (peek(mangle, "Ut")) {
+      _unnamed_type_name(mangle);
+    } else if (peek(mangle, "Ul")) {
+      _closure_type(mangle);
+    } else if (is_operator(mangle) >= 0) {
+      _operator(mangle);
+    } else {
+      mangle->valid = false;
+    }
+  }
+}
+
+constexpr void _function_type(struct mangle *mangle)
+{
+  /* <function-type> ::= F [Y] <return-type> <parameter-type>* [<ref-qualifier>] E
+   */
+  assert(mangle != NULL);
+  if (expect(mangle, "F")) {
+    _type(mangle);
+
+    /* get the parameter list */
+    char *plist = current_position(mangle);
+    mangle->func_nest += 1;
+    if (!reserve_nesting(mangle))
+      return;
+    append(mangle, "(");
+    int count = 0;
+    while (mangle->valid && !peek(mangle, "E")) {
+      if (count > 0)
+        append(mangle, ",");
+      char *mark = current_position(mangle);
+      mangle->parameter_base[mangle->func_nest] = mark;
+      _type(mangle);
+      /* special case for functions without parameters: erase "void" */
+      if (count == 0 && cx_strcmp(mark, "void") == 0 && peek(mangle, "E"))
+        *mark = '\0';
+      count++;
+    }
+    append(mangle, ")");
+    expect(mangle, "E");
+    mangle->func_nest -= 1;
+
+    /* move the parameter list into position */
+    if (mangle->parameter_base[mangle->func_nest] != 0) {
+      size_t len = cx_strlen(plist);
+      char *wmark = work_mark(mangle);
+      char *buffer = work_alloc(mangle, (len + 1) * sizeof(char));
+      if (buffer == NULL)
+        return;
+      cx_strcpy(buffer, plist);
+      *plist = '\0';
+      char *pos = insertion_point(mangle, mangle->parameter_base[mangle->func_nest]);
+      insert(mangle, pos, buffer);
+      work_release(mangle, wmark);
+    }
+  }
+}
+
+constexpr void _closure_type(struct mangle *mangle)
+{
+  /* <closure-type> ::= Ul <type>+ E [ <number> ] _
+   */
+  assert(mangle != NULL);
+  if (expect(mangle, "Ul")) {
+    append(mangle, "{lambda(");
+    int count = 0;
+    while (mangle->valid && !peek(mangle, "E")) {
+      if (count > 0)
+        append(mangle, ",");
+      char *mark = current_position(mangle);
+      _type(mangle);
+      /* special case for functions without parameters: erase "void" */
+      if (count == 0 && cx_strcmp(mark, "void") == 0 && peek(mangle, "E"))
+        *mark = '\0';
+      count++;
+    }
+    expect(mangle, "E");
+    int sequence = 1;
+    while (is_digit(*mangle->mpos)) {
+      sequence = *mangle->mpos - '0' + 2;
+      mangle->mpos += 1;
+    }
+    char field[32];
+    cx_strcpy(field, ")#");
+    cx_strcat(format_number(field + 2, sequence), "}");
+    append(mangle, field);
+    expect(mangle, "_");
+  }
+}
+
+constexpr void _unnamed_type_name(struct mangle *mangle)
+{
+  /* <unnamed-type-name> ::= Ut [ <number> ] _
+   */
+  assert(mangle != NULL);
+  if (expect(mangle, "Ut")) {
+    /* ignore the sequence number */
+    while (is_digit(*mangle->mpos))
+      mangle->mpos += 1;
+    expect(mangle, "_");
+    append(mangle, "{unnamed type}");
+  }
+}
+
+constexpr void _pointer_to_member_type(struct mangle *mangle)
+{
+  /* <pointer-to-member-type> ::= M <(class) type> <(member) type>
+   */
+  assert(mangle != NULL);
+  if (expect(mangle, "M")) {
+    char *mark = current_position(mangle);
+    /* class type, copy to local buffer because it must be moved relative to
+       the member type */
+    _type(mangle);
+    size_t len = cx_strlen(mark);
+    char *wmark = work_mark(mangle);
+    char *classtype = work_alloc(mangle, (len + 10) * sizeof(char));  /* add some space, because of characters concatenated */
+    if (classtype == NULL)
+      return;
+    cx_strcpy(classtype, mark);
+    cx_strcat(classtype, "::*");
+    *mark = '\0';   /* restore plain string */
+    /* member type */
+    _type(mangle);  /* member type */
+    /* check for parentheses (function pointer) */
+    char *p = insertion_point(mangle, mark);
+    assert(p != NULL);
+    if (*p == '(') {
+      insert(mangle, p, " ()");
+      p += 2;
+    } else {
+      insert(mangle, p, " ");
+      p += 1;
+    }
+    insert(mangle, p, classtype);
+    work_release(mangle, wmark);
+    add_substitution(mangle, mark, 0);
+  }
+}
+
+constexpr void _array(struct mangle *mangle)
+{
+  /* <array-type> ::= A [ <number> ] _ <type>   # right-to-left associative
+   */
+  assert(mangle != NULL);
+  if (expect(mangle, "A")) {
+    /* collect & skip the array specifications (without parsing them) */
+    constexpr int MAX_ARRAYDIM = 10;
+    const char *mpos_stack[MAX_ARRAYDIM];
+    int count = 0;
+    do {
+      mpos_stack[count++] = mangle->mpos;
+      while (*mangle->mpos != '_' && *mangle->mpos != '\0') {
+        if (on_sentinel(mangle))
+          mangle->valid = false;
+        mangle->mpos += 1;
+      }
+      expect(mangle, "_");
+    } while (count < MAX_ARRAYDIM && match(mangle, "A"));
+
+    char *mark = current_position(mangle);
+    _type(mangle);  /* type of the array elements */
+    if (!mangle->valid)
+      return;
+
+    const char *mpos_save = mangle->mpos;
+    char *insert_pos = current_position(mangle);
+    for (int i = count - 1; i >= 0; i--) {
+      mangle->mpos = mpos_stack[i];
+      char field[40];
+      if (is_digit(*mangle->mpos)) {
+        field[0] = '[';
+        cx_strcat(format_number(field + 1, parse_ulong(&mangle->mpos)), "]");
+      } else {
+        cx_strcpy(field, "[]");
+      }
+      insert(mangle, insert_pos, field);
+      add_substitution(mangle, mark, 0);
+    }
+    mangle->mpos = mpos_save;
+  }
+}
+
+/** is_abbreviation() - returns the index of an operator record if the current
+ *  position points to the code for a predefined substitution; or -1 if it does
+ *  not point to a substitution.
+ */
+constexpr int is_abbreviation(struct mangle *mangle)
+{
+  assert(mangle != NULL);
+  if (mangle->mpos[0] == '\0' || mangle->mpos[1] == '\0')
+    return -1;
+  for (size_t i = 0; i < std::size(abbreviations); i++) {
+    assert(cx_strlen(abbreviations[i].abbrev) == 2);
+    if (cx_strncmp(mangle->mpos, abbreviations[i].abbrev, 2) == 0)
+      return i;
+  }
+  return -1;
+}
+
+constexpr void _substitution(struct mangle *mangle)
+{
+  /* <substitution> ::= S <seq-id> _
+                        S_
+   */
+  assert(mangle != NULL);
+  if (expect(mangle, "S")) {
+    size_t index = 0;
+    if (*mangle->mpos != '_') {
+      while (*mangle->mpos != '_' && !on_sentinel(mangle)) {
+        int digit;
+        if (is_digit(*mangle->mpos)) {
+          digit = *mangle->mpos - '0';
+        } else if (is_upper(*mangle->mpos)) {
+          digit = *mangle->mpos - 'A' + 10;
+        } else {
+          mangle->valid = false;
+          return;
+        }
+        index = index * 36 + digit;
+        mangle->mpos += 1;
+      }
+      index += 1;
+    }
+    expect(mangle, "_");
+    if (index >= mangle->substitions.count) {
+      mangle->valid = false;
+      return;
+    }
+    assert(mangle->substitions.item[index] != NULL);
+    append(mangle, mangle->substitions.item[index]);
+  }
+}
+
+constexpr void _template_param(struct mangle *mangle)
+{
+  /* <template-param> ::= T_                    # first template parameter
+                          T <parameter-2 non-negative number> _
+   */
+  assert(mangle != NULL);
+  if (expect(mangle, "T")) {
+    size_t index = 0;
+    if (*mangle->mpos != '_')
+      index = (size_t)parse_number(&mangle->mpos) + 1;
+    expect(mangle, "_");
+    if (index >= mangle->tpl_subst.count) {
+      mangle->valid = false;
+      return;
+    }
+    const char *text = mangle->tpl_subst.item[index];
+    assert(text != NULL);
+    size_t len = cx_strlen(text);
+    if (len == 0) {
+      mangle->valid = false;
+      return;
+    }
+    char *wmark = work_mark(mangle);
+    char *buffer = work_alloc(mangle, (len + 10) * sizeof(char));
+    if (buffer == NULL)
+      return;
+    if (mangle->pack_expansion && cx_strchr(text, ',') == NULL) {
+      /* pack expansion is requested, but the paramater does not refer to a pack */
+      buffer[0] = '(';
+      cx_memcpy(buffer + 1, text, len);
+      cx_memcpy(buffer + 1 + len, ")...", 5);  /* length = 5 to include the zero terminator */
+    } else {
+      cx_strcpy(buffer, text);
+    }
+    append(mangle, buffer);
+    /* a template expansion is added as a substitution */
+    add_substitution(mangle, buffer, 0);
+    work_release(mangle, wmark);
+    mangle->pack_expansion = false;
+  }
+}
+
+constexpr void _local_name(struct mangle *mangle)
+{
+  /* <local-name> ::= Z <function-encoding> E <(entity) name> [<discriminator>]
+                      Z <function-encoding> E s [<discriminator>]
+   */
+  assert(mangle != NULL);
+  if (expect(mangle, "Z")) {
+    mangle->func_nest += 1;
+    if (!reserve_nesting(mangle))
+      return;
+    _function_encoding(mangle);
+    mangle->func_nest -= 1;
+    append(mangle, "::");
+
+    expect(mangle, "E");
+    if (match(mangle, "s"))
+      append(mangle, "{string-literal}");
+    else
+      _name(mangle);
+
+    _discriminator(mangle);
+  }
+}
+
+constexpr bool is_ctor_dtor_name(struct mangle *mangle)
+{
+  return peek(mangle, "C1") || peek(mangle, "C2") || peek(mangle, "C3")
+         || peek(mangle, "CI1") || peek(mangle, "CI2")
+         || peek(mangle, "D0") || peek(mangle, "D1") || peek(mangle, "D2");
+}
+
+constexpr void _ctor_dtor_name(struct mangle *mangle)
+{
+  /* <ctor-dtor-name> ::= C1                    # complete object constructor
+                          C2                    # base object constructor
+                          C3                    # complete object allocating constructor
+                          CI1 <base class type> # complete object inheriting constructor
+                          CI2 <base class type> # base object inheriting constructor
+                          D0                    # deleting destructor
+                          D1                    # complete object destructor
+                          D2                    # base object destructor
+   */
+  assert(mangle != NULL);
+  if (mangle->valid) {
+    const char *tail = mangle->plain + cx_strlen(mangle->plain);
+    if (tail > mangle->plain + 2 && *(tail - 1) == ':' && *(tail - 2) == ':')
+      tail -= 2;
+    bool goback = true;
+    const char *head = tail;
+    /* find start of class name */
+    if (head != mangle->plain && *(head - 1) == '}') {
+      head = find_matching(mangle->plain, head - 1, '}');
+      assert(head != NULL);
+      if (head >= mangle->plain + 3 && *(head - 1) == ':' && *(head - 2) == ':'
+          && (is_alpha(*(head - 3)) || is_digit(*(head - 3)) || *(head - 3)== '_' || *(head - 3)== ')')) {
+        head -= 2;
+        tail = head;
+      } else {
+        goback = false;
+      }
+    }
+    if (goback && head >= mangle->plain + 1 && (*(head - 1) == ')' || *(head - 1) == '>')) {
+      head = find_matching(mangle->plain, head - 1, *(head - 1));
+      assert(head != NULL);
+      if (head > mangle->plain + 1 && (is_alpha(*(head - 1)) || is_digit(*(head - 1)) || *(head - 1)== '_'))
+        tail = head;
+      else
+        goback = false;
+    }
+    if (goback)
+      while (head != mangle->plain && (is_alpha(*(head - 1)) || is_digit(*(head - 1)) || *(head - 1) == '_'))
+        head -= 1;
+    if (head == tail) {
+      mangle->valid = false;
+      return;
+    }
+    size_t len = tail - head;
+    char *wmark = work_mark(mangle);
+    char *cname = work_alloc(mangle, (len + 1) * sizeof(char));
+    if (cname == NULL)
+      return;
+    cx_memcpy(cname, head, len);
+    cname[len] = '\0';
+    tail = mangle->plain + cx_strlen(mangle->plain);
+    if (tail <= mangle->plain + 2 || *(tail - 1) != ':' || *(tail - 2) != ':')
+      append(mangle, "::");
+    assert(*mangle->mpos == 'C' || *mangle->mpos == 'D');
+    if (*mangle->mpos == 'D')
+      append(mangle, "~");
+    append(mangle, cname);
+    work_release(mangle, wmark);
+    mangle->mpos += 1;  /* skip 'C' or 'D' */
+    if (*mangle->mpos == 'I')
+      mangle->mpos += 1;
+    assert(is_digit(*mangle->mpos));
+    mangle->mpos += 1;  /* skip type id */
+  }
+}
+
+/** is_operator() - returns the index of an operator record if the current
+ *  position points to the code for an (overloaded) operator; or -1 if it does
+ *  not point to an operator code.
+ */
+constexpr int is_operator(struct mangle *mangle)
+{
+  assert(mangle != NULL);
+  if (mangle->mpos[0] == '\0' || mangle->mpos[1] == '\0')
+    return -1;
+  for (size_t i = 0; i < std::size(operators); i++) {
+    if (cx_strncmp(mangle->mpos, operators[i].abbrev, cx_strlen(operators[i].abbrev)) == 0)
+      return i;
+  }
+  return -1;
+}
+
+constexpr void _operator(struct mangle *mangle)
+{
+  assert(mangle != NULL);
+  if (mangle->valid) {
+    int i = is_operator(mangle);
+    if (i < 0) {
+      mangle->valid = false;
+      return;
+    }
+    mangle->mpos += cx_strlen(operators[i].abbrev);
+    append_space(mangle);
+    append(mangle, "operator");
+    if (i == 0) {
+      /* special case for typecast operator */
+      append(mangle, " ");
+      _type(mangle);
+      mangle->is_typecast_op = true;
+    } else {
+      if (is_alpha(operators[i].name[0]))
+        append(mangle, " ");
+      append(mangle, operators[i].name);
+    }
+  }
+}
+
+constexpr void _expr_primary(struct mangle *mangle)
+{
+  /* <expr-primary> ::= L <type> <number> E                              # integer literal
+                        L <type> <float> E                               # floating literal
+                        L <string type> E                                # string literal
+                        L <nullptr type> E                               # nullptr literal (i.e., "LDnE")
+                        L <pointer type> 0 E                             # null pointer template argument
+                        L <type> <(real) float> _ <(imaginary) float> E  # complex floating point literal (C 2000)
+                        L _Z <encoding> E                                # external name
+   */
+  assert(mangle != NULL);
+  if (expect(mangle, "L")) {
+    char t = *mangle->mpos;
+    char field[64];
+    if (t == 's' || t == 'i' || t == 'l' || t == 'x') {
+      mangle->mpos += 1;
+      if (*mangle->mpos == 'n') {
+        append(mangle, "-");
+        mangle->mpos += 1;
+      }
+      get_number(mangle, field, std::size(field), 0);
+      append(mangle, field);
+    } else if (t == 't' || t == 'j' || t == 'm' || t == 'y') {
+      mangle->mpos += 1;
+      get_number(mangle, field, std::size(field), 0);
+      append(mangle, field);
+    } else if (t == 'f' || t == 'd' || t == 'e') {
+      mangle->mpos += 1;
+      get_number(mangle, field, std::size(field), 1);
+      if (t == 'f')
+        append(mangle, "(float){");
+      else if (t == 'd')
+        append(mangle, "(double){");
+      else
+        append(mangle, "(long double){");
+      append(mangle, field);
+      append(mangle, "}");
+    } else if (t == 'c' || t == 'a' || t == 'h') {
+      mangle->mpos += 1;
+      get_number(mangle, field, std::size(field), 0);
+      if (t == 'c')
+        append(mangle, "(char)");
+      else if (t == 'a')
+        append(mangle, "(signed char)");
+      else if (t == 'h')
+        append(mangle, "(unsigned char)");
+      append(mangle, field);
+    } else if (t == 'b') {
+      mangle->mpos += 1;
+      get_number(mangle, field, std::size(field), 0);
+      if (cx_strcmp(field, "0") == 0) {
+        append(mangle, "false");
+      } else if (cx_strcmp(field, "1") == 0) {
+        append(mangle, "true");
+      } else {
+        append(mangle, "(bool)");
+        append(mangle, field);
+      }
+    } else if (t == 'A') {
+      mangle->mpos += 1;
+      long len = parse_number(&mangle->mpos);
+      expect(mangle, "_");
+      if (match(mangle, "Kc"))
+        append(mangle, "\"");
+      else if (match(mangle, "Kw"))
+        append(mangle, "L\"");
+      for (long i = 0; i < len; i++)
+        append(mangle, "?");
+      append(mangle, "\"");
+    } else if (match(mangle, "_Z")) {
+      _function_encoding(mangle);
+    } else if (match(mangle, "Dn")) {
+      append(mangle, "nullptr");
+    } else {
+      mangle->valid = false;
+      return;
+    }
+    expect(mangle, "E");
+  }
+}
+
+constexpr void _expression(struct mangle *mangle)
+{
+  if (!enter_level(mangle)) {
+    /* nesting too deep, nothing to parse */
+  } else if (peek(mangle, "fp") && (*(mangle->mpos + 2) == '_' || is_digit(*(mangle->mpos + 2)))) {
+    mangle->mpos += 2;
+    long index = 0;
+    if (is_digit(*mangle->mpos))
+      index = parse_number(&mangle->mpos) + 1;
+    expect(mangle, "_");
+    char field[32];
+    cx_strcpy(field, "{parm#");
+    cx_strcat(format_number(field + 6, (unsigned long)index), "}");
+    append(mangle, field);
+  } else if (is_digit(*mangle->mpos)) {
+    _source_name(mangle);
+  } else if (peek(mangle, "S") && (is_digit(mangle->mpos[1]) || is_upper(mangle->mpos[1]) || mangle->mpos[1]== '_')) {
+    _substitution(mangle);
+  } else if (peek(mangle, "T") && (is_digit(mangle->mpos[1]) || mangle->mpos[1] == '_')) {
+    _template_param(mangle);
+  } else if (peek(mangle, "L")) {
+    _expr_primary(mangle);
+  } else if (is_operator(mangle) >= 0) {
+    int index = is_operator(mangle);
+    mangle->mpos += cx_strlen(operators[index].abbrev);
+    if (operators[index].operands == 1) {
+      append(mangle, operators[index].name);
+      _expression(mangle);
+    } else if (operators[index].operands == 2) {
+      _expression(mangle);
+      append(mangle, operators[index].name);
+      _expression(mangle);
+    } else {
+      assert(operators[index].operands == 0 || operators[index].operands == 3);
+      //???
+    }
+  } else {
+    mangle->valid = false;
+  }
+  leave_level(mangle);
+}
+
+constexpr void _decltype(struct mangle *mangle)
+{
+  /* <decltype>  ::= Dt <expression> E          # decltype of an id-expression or class member access
+                     DT <expression> E          # decltype of an expression
+
+   */
+  assert(mangle != NULL);
+  if (!match(mangle, "Dt"))
+    expect(mangle, "DT");
+  if (mangle->valid) {
+    append(mangle, "decltype(");
+    _expression(mangle);
+    append(mangle, ")");
+    expect(mangle, "E");
+  }
+}
+
+constexpr void _nested_name(struct mangle *mangle)
+{
+  /* <nested-name> ::= N [<CV-qualifiers>] [<ref-qualifier>] <prefix> <name-param>* E
+
+     <prefix> ::= <unqualified-name> <abi-tag*> # global class or namespace
+              ::= <decltype>                    # decltype qualifier
+              ::= <substitution>
+              ::= <template-param>              # template parameter (T_, T0_, etc.)
+
+     <name-param> ::= <unqualified-name>        # nested class or namespace (left-recursion!)
+                  ::= <template-arg>*           #   <template-prefix> class template specialization
+                  ::= M                         # <closure-prefix> initializer of a variable or data member
+   */
+  assert(mangle != NULL);
+  if (expect(mangle, "N")) {
+    mangle->nest += 1;
+
+    /* <CV-qualifiers> and <ref-qualifier> (append at end) */
+    char qualifiers[8];
+    _qualifier_pre(mangle, qualifiers, std::size(qualifiers), 1);
+
+    char *mark = current_position(mangle);
+
+    /* prefix */
+    bool abi_tag = false;
+    if (peek(mangle, "Dt") || peek(mangle, "DT")) {
+      _decltype(mangle);
+      add_substitution(mangle, mark, 0);
+    } else if (is_abbreviation(mangle) >= 0) {
+      int i = is_abbreviation(mangle);
+      assert(i >= 0 && i < (int)std::size(abbreviations));
+      assert(cx_strlen(abbreviations[i].abbrev) == 2);
+      mangle->mpos += 2;
+      append(mangle, abbreviations[i].name);
+    } else if (peek(mangle, "S") && (is_digit(mangle->mpos[1]) || is_upper(mangle->mpos[1]) || mangle->mpos[1]== '_')) {
+      _substitution(mangle);
+    } else if (peek(mangle, "T") && (is_digit(mangle->mpos[1]) || mangle->mpos[1] == '_')) {
+      _template_param(mangle);
+    } else {
+      _unqualified_name(mangle);
+      abi_tag = _abi_tags(mangle);
+      if (!peek(mangle, "E"))
+        add_substitution(mangle, mark, 0);
+    }
+    /* at least one name should follow, so separator can be appended; however,
+       ABI tags are also enveloped in <nested-name> */
+    if (match(mangle, "E")) {
+      if (abi_tag) {
+        if (mangle->nest > 1)
+          _qualifier_post(mangle, qualifiers);
+        else
+          cx_strcpy(mangle->qualifiers, qualifiers);  /* special case: see below */
+      } else {
+        mangle->valid = false;
+      }
+      mangle->nest -= 1;
+      return;
+    }
+
+    int sentinel = 0;
+    do {
+      if (peek(mangle, "M")) {
+        mangle->mpos += 1;
+        continue;               /* closure type, ignore */
+      } else if (peek(mangle, "I")) {
+        _template_args(mangle);
+      } else {
+        append(mangle, "::");
+        _unqualified_name(mangle);
+      }
+      sentinel = match(mangle, "E");
+      if (!sentinel || mangle->nest > 1)
+        add_substitution(mangle, mark, 0);  /* don't add function name at global level */
+    } while (mangle->valid && !sentinel);
+
+    if (mangle->nest > 1)
+      _qualifier_post(mangle, qualifiers);
+    else
+      cx_strcpy(mangle->qualifiers, qualifiers);  /* special case: appended after
+                                                  handling function parameters (if any) */
+    mangle->nest -= 1;
+  }
+}
+
+constexpr void _name(struct mangle *mangle)
+{
+  /* <name> := N <nested-name> E
+               Z <local-name> E (<name> | s) [ (_ <number> | _ _ <number> _ )
+               <unscoped-name> <abi-tag>* <template-arg>*
+
+     <unscoped-name> := St <unqualified-name>   #::std::
+                        <subtitution>           # S <base-36-number>
+                        <unqualified-name>
+
+     <unqualified-name> := <operator-name>
+                           <ctor-dtor-name>
+                           <source-name>        # <number> <text>
+                           DC <source-name>+ E
+                           Ut <unnamed-type-name> _
+                           Ul <type>+ E [ <number> ] _    # <closure-type-name>
+
+     <abi-tag> := B <source-name>               # right-to-left associative
+   */
+  assert(mangle != NULL);
+  char *mark = current_position(mangle);
+  bool is_unscoped = true;
+  if (mangle->valid) {
+    if (peek(mangle, "N")) {
+      _nested_name(mangle);
+      is_unscoped = false;
+    } else if (peek(mangle, "Z")) {
+      _local_name(mangle);
+      is_unscoped = false;
+    } else if (is_abbreviation(mangle) == 0) {
+      assert(cx_strlen(abbreviations[0].abbrev) == 2);
+      mangle->mpos += 2;
+      append(mangle, abbreviations[0].name);
+      append(mangle, "::");
+      _unqualified_name(mangle);
+    } else if (peek(mangle, "S") && (is_digit(mangle->mpos[1]) || is_upper(mangle->mpos[1]) || mangle->mpos[1] == '_')) {
+      _substitution(mangle);
+    } else if (is_operator(mangle) >= 0) {
+      _operator(mangle);
+    } else if (is_ctor_dtor_name(mangle)) {
+      _ctor_dtor_name(mangle);
+    } else if (is_digit(*mangle->mpos)) {
+      _source_name(mangle);
+    } else if (match(mangle, "L")) {
+      _source_name(mangle);
+      _discriminator(mangle);
+    } else if (match(mangle, "DC")) {
+      while (is_digit(*mangle->mpos))
+        _source_name(mangle);
+      expect(mangle, "E");
+    } else if (peek(mangle, "Ut")) {
+      _unnamed_type_name(mangle);
+    } else if (peek(mangle, "Ul")) {
+      _closure_type(mangle);
+    } else {
+      mangle->valid = false;
+    }
+  }
+
+  if (is_unscoped)
+    _abi_tags(mangle);
+  if (is_unscoped && peek(mangle, "I")) {
+    add_substitution(mangle, mark, 0);
+    _template_args(mangle);
+  }
+}
+
+/** is_stdtype() - returns the index of an operator record if the current
+ *  position points to the code for a standard type; or -1 if it does not point
+ *  to a standard type.
+ */
+constexpr int is_builtin_type(struct mangle *mangle)
+{
+  assert(mangle != NULL);
+  if (mangle->mpos[0] == '\0')
+    return -1;
+  for (size_t i = 0; i < std::size(types); i++) {
+    /* cx_strncmp() stops at the end of the mangled name, so there is no need to
+       check the remaining length */
+    size_t len = cx_strlen(types[i].abbrev);
+    if (cx_strncmp(mangle->mpos, types[i].abbrev, len) == 0)
+      return i;
+  }
+  return -1;
+}
+
+constexpr void _type(struct mangle *mangle)
+{
+  /* <type> ::= <builtin-type>
+                <cv-qualifier>+ <type>          # qualifier is appended at the end
+                <function-type>
+                <class-enum-type>
+                <array-type>
+                <pointer-to-member-type>
+                <source-name> <template-arg>*
+                <template-param> <template-arg>*  # template parameter (T_, T0_, etc.)
+                <substitution> <template-arg>*    # S_, S0_, etc.
+                <decltype>
+                <nested-name>
+                <local-name>
+                Dp <type>                       # pack expansion
+                P <type>                        # pointer
+                R <type>                        # l-value reference
+                O <type>                        # r-value reference (C++11)
+                C <type>                        # complex pair (C99)
+                G <type>                        # imaginary (C99)
+                L <type> <value>                # literal
+
+     <vector-type> ::= Dv <number> _ <type>
+                   ::= Dv _ <expression> _ <type>
+
+     <cv-qualifier> ::= U <source-name> <template-arg>* # vendor extended type qualifier
+                        r    # restrict (C99)
+                        V    # volatile
+                        K    # const
+
+     <exception-spec> ::= Do                    # noexcept
+                          DO <expression> E     # noexcept(...)
+                          Dw <type>+ E          # throw(type, ...)
+   */
+  assert(mangle != NULL);
+  if (enter_level(mangle)) {
+    char *mark = current_position(mangle);
+    if (is_builtin_type(mangle) >= 0) {
+      int i = is_builtin_type(mangle);
+      assert(i >= 0 && i < (int)std::size(types));
+      mangle->mpos += cx_strlen(types[i].abbrev);
+      append(mangle, types[i].name);
+    } else if (peek(mangle, "r") || peek(mangle, "V") || peek(mangle, "K")) {
+      char qualifiers[8];
+      _qualifier_pre(mangle, qualifiers, std::size(qualifiers), 0);
+      _type(mangle);
+      _qualifier_post(mangle, qualifiers);
+      add_substitution(mangle, mark, 0);
+    } else if (peek(mangle, "U")) {
+      _extended_qualifier(mangle);
+    } else if (peek(mangle, "F")) {
+      _function_type(mangle);
+      add_substitution(mangle, mark, 0);
+    } else if (peek(mangle, "A")) {
+      _array(mangle);
+    } else if (match(mangle, "P")) {
+      _type(mangle);
+      char *p = insertion_point(mangle, mark);
+      assert(p != NULL);
+      if (*p == '(' || *p == '[')
+        insert(mangle, p, "(*)");
+      else
+        insert(mangle, p, "*");
+      add_substitution(mangle, mark, 0);
+    } else if (match(mangle, "R")) {
+      _type(mangle);
+      char *p = insertion_point(mangle, mark);
+      assert(p != NULL);
+      if (*p == '(' || *p == '[')
+        insert(mangle, p, "(&)");
+      else
+        insert(mangle, p, "&");
+      add_substitution(mangle, mark, 0);
+    } else if (match(mangle, "O")) {
+      _type(mangle);
+      assert(cx_strlen(mangle->plain) > 0);
+      const char *p = mangle->plain + cx_strlen(mangle->plain) - 1;
+      if (*p != '&')            /* don't add r-value reference for types that are already references */
+        append(mangle, "&&");
+      add_substitution(mangle, mark, 0);
+    } else if (is_abbreviation(mangle) >= 0) {
+      int i = is_abbreviation(mangle);
+      assert(i >= 0 && i < (int)std::size(abbreviations));
+      assert(cx_strlen(abbreviations[i].abbrev) == 2);
+      mangle->mpos += 2;
+      append(mangle, abbreviations[i].name);
+      if (i == 0) {
+        append(mangle, "::");   /* special case for std:: */
+        _unqualified_name(mangle);
+        add_substitution(mangle, mark, 0);
+      }
+      if (_template_args(mangle))
+        add_substitution(mangle, mark, 0);
+    } else if (peek(mangle, "S") && (is_digit(mangle->mpos[1]) || is_upper(mangle->mpos[1]) || mangle->mpos[1]== '_')) {
+      _substitution(mangle);
+      _template_args(mangle);
+    } else if (peek(mangle, "T") && (is_digit(mangle->mpos[1]) || mangle->mpos[1] == '_')) {
+      _template_param(mangle);
+      _template_args(mangle);
+    } else if (peek(mangle, "N")) {
+      _nested_name(mangle);
+    } else if (peek(mangle, "Z")) {
+      _local_name(mangle);
+    } else if (peek(mangle, "M")) {
+      _pointer_to_member_type(mangle);
+    } else if (peek(mangle, "L")) {
+      _expr_primary(mangle);
+    } else if (match(mangle, "Dp")) {
+      mangle->pack_expansion = true;
+      _type(mangle);
+    } else if (peek(mangle, "Dt") || peek(mangle, "DT")) {
+      _decltype(mangle);
+      add_substitution(mangle, mark, 0);
+    } else if (is_digit(*mangle->mpos) || (*mangle->mpos == 'u' && is_digit(*(mangle->mpos + 1)))) {
+      if (*mangle->mpos == 'u')
+        mangle->mpos += 1;  /* ignore "vendor-extended" type (N.B. Itanium ABI uses upper-case 'U', but c++filt only accepts lower-case 'u') */
+      _source_name(mangle);
+      add_substitution(mangle, mark, 0);
+      if (_template_args(mangle))
+        add_substitution(mangle, mark, 0);
+    } else {
+      mangle->valid = false;
+    }
+  }
+  leave_level(mangle);
+}
+
+constexpr void _function_encoding(struct mangle *mangle)
+{
+  if (enter_level(mangle))
+    _name(mangle);
+
+  if (on_sentinel(mangle) || (mangle->nest > 0 && peek(mangle, "E"))) {
+    if (mangle->func_nest > 0)
+      mangle->valid = false;
+    leave_level(mangle);
+    return;
+  }
+  if (cx_strlen(mangle->plain) == 0) {
+    mangle->valid = false;
+    leave_level(mangle);
+    return;
+  }
+
+  /* function parameter list
+     list of types (absent for variables, at least one type for functions
+     first type is the function return type, but it is only present when
+     functions are template instantiations.
+   */
+  mangle->nest += 1;
+  /* check whether a return type is present; save it but process it later */
+  char *wmark = work_mark(mangle);
+  char *type_string = NULL;
+  size_t type_ins_point = 0;
+  if (has_return_type(mangle)) {
+    char *mark = current_position(mangle);
+    _type(mangle);
+    type_string = work_alloc(mangle, (cx_strlen(mark) + 5) * sizeof(char));
+    if (type_string != NULL) {
+      cx_strcpy(type_string, mark);
+      char *ipos = insertion_point(mangle, mark);
+      type_ins_point = ipos - mark;
+    }
+    *mark = '\0';
+  }
+
+  /* handle parameters */
+  append(mangle, "(");
+  int count = 0;
+  while (!on_sentinel(mangle) && !(mangle->func_nest > 0 && peek(mangle, "E"))) {
+    if (count > 0)
+      append(mangle, ",");
+    char *mark = current_position(mangle);
+    mangle->parameter_base[mangle->func_nest] = mark;
+    _type(mangle);
+    /* special case for functions without parameters: erase "void" */
+    if (count == 0 && cx_strcmp(mark, "void") == 0
+        && (on_sentinel(mangle) || (mangle->func_nest > 0 && peek(mangle, "E"))))
+      *mark = '\0';
+    count++;
+  }
+  mangle->nest -= 1;
+  append(mangle, ")");
+  if (mangle->nest == 0)
+    _qualifier_post(mangle, mangle->qualifiers);
+
+  /* prefix function type (saved earlier), but only for the outer nesting */
+  if (type_string != NULL && on_sentinel(mangle)) {
+    assert(type_ins_point <= cx_strlen(type_string));
+    if (type_ins_point == cx_strlen(type_string)) {
+      cx_strcat(type_string, " ");
+    } else {
+      /* split the buffer in two, append the last part (insert the first part) */
+      append(mangle, type_string + type_ins_point);
+      type_string[type_ins_point] = '\0';
+    }
+    insert(mangle, mangle->plain, type_string);
+  }
+  work_release(mangle, wmark);
+  leave_level(mangle);
+}
+
+constexpr void _encoding(struct mangle *mangle)
+{
+  /* <encoding> ::= <name> [J]<type>*           # type list is present for functions, absent for variables
+                    TV <type>                   # vtable
+                    TT <type>                   # vtable index
+                    TI <type>                   # typeinfo struct
+                    TS <type>                   # typeinfo name
+                    Th <number> _ <encoding>    # non-virtual override thunk
+                    Tv <number> _ <number> _ <encoding>   # virtual override thunk
+  */
+  assert(mangle != NULL);
+  if (!enter_level(mangle)) {
+    /* nesting too deep, nothing to parse */
+  } else if (match(mangle, "TV")) {
+    append(mangle, "vtable for ");
+    _type(mangle);
+  } else if (match(mangle, "TT")) {
+    append(mangle, "vtable index for ");
+    _type(mangle);
+  } else if (match(mangle, "TI")) {
+    append(mangle, "typeinfo for ");
+    _type(mangle);
+  } else if (match(mangle, "TS")) {
+    append(mangle, "typeinfo name for ");
+    _type(mangle);
+  } else if (match(mangle, "Th")) {
+    append(mangle, "non-virtual thunk to ");
+    expect_number(mangle, '_', NULL);
+    _encoding(mangle);
+  } else if (match(mangle, "Tv")) {
+    append(mangle, "virtual thunk to ");
+    expect_number(mangle, '_', NULL);
+    expect_number(mangle, '_', NULL);
+    _encoding(mangle);
+  } else {
+    _function_encoding(mangle);
+  }
+  leave_level(mangle);
+}
+
+
+/* ----- above this line, the code follows demangle.c ----- */
+
+/** run() - the counterpart of demangle_run() in demangle.c. The input is
+ *  copied into a zero-padded buffer, and the output buffer is zero-filled,
+ *  because constant evaluation rejects reads of uninitialized memory or reads
+ *  beyond the end of an array (where the C version may peek one character
+ *  beyond a zero terminator).
+ */
+constexpr bool run(char *plain, size_t size, std::string_view input, bool type)
+{
+  assert(plain != NULL);
+  assert(size > 0);
+  plain[0] = '\0';
+  size_t length = input.size();
+  if (!type && (length < 2 || input[0] != '_' || input[1] != 'Z'))
+    return false;
+  if (type && length == 0)
+    return false;
+
+  const size_t padding = 8;
+  char *mangled = new char[length + padding]();
+  for (size_t i = 0; i < length; i++)
+    mangled[i] = input[i];
+  char *output = new char[size + padding]();
+
+  struct mangle mangle;
+  mangle.plain = output;
+  mangle.size = size;
+  mangle.mangled = mangled;
+  mangle.mpos = type ? mangle.mangled : mangle.mangled + 2; /* skip "_Z" */
+  if (reserve_nesting(&mangle)) {
+    if (type) {
+      _type(&mangle);
+      if (*mangle.mpos != '\0')
+        mangle.valid = false; /* trailing characters after the type */
+    } else {
+      _encoding(&mangle);
+    }
+  }
+
+  if (mangle.valid)
+    cx_strcpy(plain, output);
+  for (char *block : mangle.arena)
+    delete[] block;
+  delete[] output;
+  delete[] mangled;
+  return mangle.valid;
+}
+
+} // namespace detail
+
+/** fixed_name - holds the result of constant evaluation: a string of at most
+ *  N - 1 characters.
+ */
+template<std::size_t N>
+struct fixed_name {
+  char text[N] = {};
+  bool ok = false;
+
+  constexpr bool valid() const { return ok; }
+  constexpr const char *c_str() const { return text; }
+  constexpr std::string_view view() const { return std::string_view(text); }
+  constexpr operator std::string_view() const { return view(); }
+};
+
+/** demangle() - decodes a mangled name into a plain buffer; the parameters and
+ *  return value are the same as those of the C function ::demangle().
+ */
+constexpr bool demangle(char *plain, std::size_t size, std::string_view mangled)
+{
+  return detail::run(plain, size, mangled, false);
+}
+
+/** demangle_type() - as ::demangle_type(), for type names without "_Z". */
+constexpr bool demangle_type(char *plain, std::size_t size, std::string_view name)
+{
+  return detail::run(plain, size, name, true);
+}
+
+template<std::size_t N = 256>
+constexpr fixed_name<N> demangle(std::string_view mangled)
+{
+  fixed_name<N> result;
+  result.ok = detail::run(result.text, N, mangled, false);
+  return result;
+}
+
+template<std::size_t N = 256>
+constexpr fixed_name<N> demangle_type(std::string_view name)
+{
+  fixed_name<N> result;
+  result.ok = detail::run(result.text, N, name, true);
+  return result;
+}
+
+} // namespace compile_time
+} // namespace demangling
+
+#endif /* _DEMANGLE_CONSTEXPR_HPP */
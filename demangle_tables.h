@@ -0,0 +1,135 @@
+/* GNU C++ symbol name demangler
+ * Tables with the codes of the Itanium C++ ABI mangling scheme, shared by
+ * the demangler and the symbol classifier. This is an internal header.
+ *
+ * Copyright 2022-2024, CompuPhase
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _DEMANGLE_TABLES_H
+#define _DEMANGLE_TABLES_H
+
+struct operator_def {
+  const char *abbrev;
+  const char *name;
+  short operands;
+};
+
+static const struct operator_def operators[] = {
+  { "cv", "(?)", 1 },           /* type cast */
+  { "nw", "new", 1 },
+  { "na", "new[]", 1 },
+  { "dl", "delete", 1 },
+  { "da", "delete[]", 1 },
+  { "ng", "-", 1 },             /* (unary) */
+  { "ad", "&", 1 },             /* (unary) */
+  { "de", "*", 1 },             /* (unary) */
+  { "co", "~", 2 },
+  { "pl", "+", 2 },
+  { "mi", "-", 2 },
+  { "ml", "*", 2 },
+  { "dv", "/", 2 },
+  { "rm", "%", 2 },
+  { "an", "&", 2 },
+  { "or", "|", 2 },
+  { "eo", "^", 2 },
+  { "aS", "=", 2 },
+  { "pL", "+=", 2 },
+  { "mI", "-=", 2 },
+  { "mL", "*=", 2 },
+  { "dV", "/=", 2 },
+  { "rM", "%=", 2 },
+  { "aN", "&=", 2 },
+  { "oR", "|=", 2 },
+  { "eO", "^=", 2 },
+  { "ls", "<<", 2 },
+  { "rs", ">>", 2 },
+  { "lS", "<<=", 2 },
+  { "rS", ">>=", 2 },
+  { "eq", "==", 2 },
+  { "ne", "!=", 2 },
+  { "lt", "<", 2 },
+  { "gt", ">", 2 },
+  { "le", "<=", 2 },
+  { "ge", ">=", 2 },
+  { "ss", "<=>", 2 },
+  { "nt", "!", 1 },
+  { "aa", "&&", 2 },
+  { "oo", "||", 2 },
+  { "pp", "++", 1 },            /* postfix in <expression> context */
+  { "mm", "--", 1 },            /* postfix in <expression> context */
+  { "cm", ",", 2 },
+  { "pm", "->*", 2 },
+  { "pt", "->", 2 },
+  { "cl", "()", 0 },            /* arbitrary number of operands */
+  { "ix", "[]", 2 },
+  { "qu", "?", 3 },
+  /* ----- for use in <expression> context only */
+  { "pp_", "++", 1 },           /* prefix */
+  { "mm_", "--", 1 },           /* prefix */
+  { "dt", ".", 2 },
+  { "pt", "->", 2 },
+  { "ds", ".*", 2 },
+  { "sr", "::", 2 },
+};
+
+struct stringpair {
+  const char *abbrev;
+  const char *name;
+};
+
+static const struct stringpair types[] = {
+  { "v", "void" },
+  { "w", "wchar_t" },
+  { "b", "bool" },
+  { "c", "char" },
+  { "a", "signed char" },
+  { "h", "unsigned char" },
+  { "s", "short" },
+  { "t", "unsigned short" },
+  { "i", "int" },
+  { "j", "unsigned int" },
+  { "l", "long" },
+  { "m", "unsigned long" },
+  { "x", "long long" },         /* __int64 */
+  { "y", "unsigned long long" },/* __int64 */
+  { "n", "__int128" },
+  { "o", "unsigned __int128" },
+  { "f", "float" },
+  { "d", "double" },
+  { "e", "long double" },       /* __float80 */
+  { "g", "__float128" },
+  { "z", "..." },
+  { "Da","auto" },
+  { "Dc","decltype(auto)" },
+  { "Dn","decltype(nullptr)" },
+  { "Dh","decimal16" },
+  { "Df","decimal32" },
+  { "Dd","decimal64" },
+  { "De","decimal128" },
+  { "Du","char8_t" },
+  { "Ds","char16_t" },
+  { "Di","char32_t" },
+};
+
+static const struct stringpair abbreviations[] = {
+  { "St", "std" },              /* also ::std:: */
+  { "Sa", "std::allocator" },
+  { "Sb", "std::basic_string" },
+  { "Ss", "std::string" },      /* std::basic_string<char,::std::char_traits<char>,::std::allocator<char>>*/
+  { "Si", "std::istream" },     /* std::basic_istream<char,std::char_traits<char>> */
+  { "So", "std::ostream" },     /* std::basic_ostream<char,std::char_traits<char>> */
+  { "Sd", "std::iostream" },    /* std::basic_iostream<char,std::char_traits<char>> */
+};
+
+#endif /* _DEMANGLE_TABLES_H */
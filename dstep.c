@@ -0,0 +1,225 @@
+/* GNU C++ symbol name demangler
+ * Resumable demangling, with a budget of parse steps per call.
+ *
+ * Threads that run an event loop cannot block on a single pathological
+ * symbol. With this module, such a thread demangles a name in slices: each
+ * call to dstep_run() performs at most the given number of parse steps, and
+ * then returns DEMANGLE_PENDING; the next call resumes exactly where the
+ * previous one stopped. The output is the same as that of demangle().
+ *
+ * The parser is recursive, and its state is spread over the native stack, so
+ * it is not unwound on a suspension. Instead, the parser runs on a stack of
+ * its own (a ucontext fiber), and the step hook of demangle_steps() switches
+ * back to the caller when the budget is used up. The stack usage of the
+ * parser is bounded (see MAX_PARSE_DEPTH in demangle.c), so that a small
+ * fixed-size stack suffices.
+ *
+ * While a name is pending, the input string and the output buffer must stay
+ * valid; the output buffer holds a partial result until dstep_run() returns
+ * a code other than DEMANGLE_PENDING. A context handles one name at a time,
+ * and it must not be run from two threads at once.
+ *
+ * On systems without <ucontext.h>, dstep_run() completes the name in the
+ * first call, regardless of the budget.
+ *
+ * Copyright 2022-2024, CompuPhase
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#if defined __unix__ || defined __APPLE__
+# if !defined _XOPEN_SOURCE
+#   define _XOPEN_SOURCE 700  /* for ucontext on macOS */
+# endif
+# include <ucontext.h>
+# define HAVE_UCONTEXT
+#endif
+#include <assert.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "demangle.h"
+#include "dstep.h"
+
+#define DSTEP_STACK   (128 * 1024)  /* default stack size of the parser */
+#define DSTEP_MINSTACK (16 * 1024)
+
+enum {
+  STATE_IDLE,           /* no name, or the result was returned */
+  STATE_READY,          /* dstep_start() was called, the parser has not run */
+  STATE_SUSPENDED,      /* the parser is halfway, on its own stack */
+  STATE_DONE,           /* the parser finished, "result" is valid */
+};
+
+struct dstep {
+  char *plain;
+  size_t size;
+  const char *mangled;
+  int state;
+  int result;
+  unsigned long budget; /**< steps left in the current dstep_run() */
+  bool cancel;          /**< unwind the parser on the next step */
+#if defined HAVE_UCONTEXT
+  ucontext_t caller;
+  ucontext_t fiber;
+  char *stack;
+  size_t stacksize;
+#endif
+};
+
+#if defined HAVE_UCONTEXT
+
+/** step() - the step hook for demangle_steps(): it suspends the parser when
+ *  the budget is used up. Returning false makes the parser unwind.
+ */
+static bool step(void *arg)
+{
+  struct dstep *ds = arg;
+  if (ds->budget == 0)
+    swapcontext(&ds->fiber, &ds->caller);
+  ds->budget--;
+  return !ds->cancel;
+}
+
+/** fiber_main() - the entry point of the parser stack; makecontext() only
+ *  passes int arguments, so the pointer is split in two halves.
+ */
+static void fiber_main(unsigned int high, unsigned int low)
+{
+  struct dstep *ds = (struct dstep*)((((uintptr_t)high << 16) << 16) | (uintptr_t)low);
+  ds->result = demangle_steps(ds->plain, ds->size, ds->mangled, step, ds);
+  ds->state = STATE_DONE;
+  /* returning switches to uc_link, which is the caller */
+}
+
+/** resume() - switches to the parser, which runs until it is done or until
+ *  the budget is used up.
+ */
+static void resume(struct dstep *ds)
+{
+  if (ds->state == STATE_READY) {
+    getcontext(&ds->fiber);
+    ds->fiber.uc_stack.ss_sp = ds->stack;
+    ds->fiber.uc_stack.ss_size = ds->stacksize;
+    ds->fiber.uc_link = &ds->caller;
+    uintptr_t address = (uintptr_t)ds;
+    makecontext(&ds->fiber, (void (*)(void))fiber_main, 2,
+                (unsigned int)((address >> 16) >> 16), (unsigned int)(address & 0xffffffffu));
+    ds->state = STATE_SUSPENDED;
+  }
+  swapcontext(&ds->caller, &ds->fiber);
+}
+
+#endif /* HAVE_UCONTEXT */
+
+/** dstep_create() - allocates a context for resumable demangling. The
+ *  "stacksize" is the size of the native stack for the parser; pass 0 for the
+ *  default (128 KiB, which is more than the parser needs at MAX_PARSE_DEPTH).
+ *  Returns NULL when out of memory.
+ */
+struct dstep *dstep_create(size_t stacksize)
+{
+  struct dstep *ds = calloc(1, sizeof(struct dstep));
+  if (ds == NULL)
+    return NULL;
+  ds->state = STATE_IDLE;
+#if defined HAVE_UCONTEXT
+  if (stacksize == 0)
+    stacksize = DSTEP_STACK;
+  if (stacksize < DSTEP_MINSTACK)
+    stacksize = DSTEP_MINSTACK;
+  ds->stacksize = stacksize;
+  ds->stack = malloc(stacksize);
+  if (ds->stack == NULL) {
+    free(ds);
+    return NULL;
+  }
+#else
+  (void)stacksize;
+#endif
+  return ds;
+}
+
+void dstep_destroy(struct dstep *ds)
+{
+  if (ds == NULL)
+    return;
+  dstep_cancel(ds);
+#if defined HAVE_UCONTEXT
+  free(ds->stack);
+#endif
+  free(ds);
+}
+
+/** dstep_start() - sets the name to demangle, for the next dstep_run().
+ *  If a previous name is still pending, it is cancelled. The arguments are
+ *  the same as for demangle(); "plain" and "mangled" must stay valid until
+ *  the name is complete (or cancelled).
+ */
+void dstep_start(struct dstep *ds, char *plain, size_t size, const char *mangled)
+{
+  assert(ds != NULL);
+  assert(plain != NULL);
+  assert(size > 0);
+  assert(mangled != NULL);
+  dstep_cancel(ds);
+  ds->plain = plain;
+  ds->size = size;
+  ds->mangled = mangled;
+  ds->cancel = false;
+  ds->result = DEMANGLE_INVALID;
+  ds->state = STATE_READY;
+}
+
+/** dstep_run() - continues demangling the name set by dstep_start(), for at
+ *  most "steps" parse steps (a step is roughly one type in the mangled name).
+ *  Returns DEMANGLE_PENDING if the name is not complete yet, or otherwise the
+ *  result code of demangle_scratch() (DEMANGLE_OK on success). Once complete,
+ *  further calls return the same code, until the next dstep_start().
+ */
+int dstep_run(struct dstep *ds, unsigned long steps)
+{
+  assert(ds != NULL);
+  assert(steps > 0);
+  assert(ds->state != STATE_IDLE);
+  if (ds->state == STATE_DONE)
+    return ds->result;
+#if defined HAVE_UCONTEXT
+  ds->budget = steps;
+  resume(ds);
+  return (ds->state == STATE_DONE) ? ds->result : DEMANGLE_PENDING;
+#else
+  (void)steps;
+  ds->result = demangle_n(ds->plain, ds->size, ds->mangled, strlen(ds->mangled), NULL, 0);
+  ds->state = STATE_DONE;
+  return ds->result;
+#endif
+}
+
+/** dstep_cancel() - abandons the pending name (if any), and releases the
+ *  memory that the parser holds for it.
+ */
+void dstep_cancel(struct dstep *ds)
+{
+  assert(ds != NULL);
+#if defined HAVE_UCONTEXT
+  if (ds->state == STATE_SUSPENDED) {
+    /* let the parser unwind, so that it frees its arena */
+    ds->cancel = true;
+    ds->budget = ULONG_MAX;
+    resume(ds);
+    assert(ds->state == STATE_DONE);
+  }
+#endif
+  ds->state = STATE_IDLE;
+}
@@ -0,0 +1,40 @@
+/* GNU C++ symbol name demangler
+ * Resumable demangling, with a budget of parse steps per call.
+ *
+ * Copyright 2022-2024, CompuPhase
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _DSTEP_H
+#define _DSTEP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+struct dstep;
+
+struct dstep *dstep_create(size_t stacksize);
+void dstep_destroy(struct dstep *ds);
+void dstep_start(struct dstep *ds, char *plain, size_t size, const char *mangled);
+int dstep_run(struct dstep *ds, unsigned long steps);
+void dstep_cancel(struct dstep *ds);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif /* _DSTEP_H */
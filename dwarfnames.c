@@ -0,0 +1,638 @@
+/* GNU C++ symbol name demangler
+ * Reading the linkage names from the DWARF debug information.
+ *
+ * Debuggers and coverage tools take the names of functions from the debug
+ * information rather than from the symbol table, because inlined functions
+ * only exist there. This reader walks the debug information entries of the
+ * compilation units in .debug_info (DWARF versions 2 to 5), and passes the
+ * value of every DW_AT_linkage_name and DW_AT_MIPS_linkage_name attribute to
+ * a callback. The strings may be inline (DW_FORM_string), in .debug_str
+ * (DW_FORM_strp, and the DWARF 5 DW_FORM_strx forms through
+ * .debug_str_offsets) or in .debug_line_str.
+ *
+ * The same linkage name is typically referenced from many compilation units
+ * (every unit that inlines std::vector<int>::size() has a DIE for it), but
+ * the linker merges .debug_str, so that the string exists once. The callback
+ * receives a key for each string, which is its offset in the section (with
+ * the section coded in the top bits), so that a caller can deduplicate the
+ * names on an integer before demangling them.
+ *
+ * Each unit is walked independently, so that the units can be distributed
+ * over threads: dwarfnames_units() returns the offsets of the units, and
+ * dwarfnames_unit() walks a single unit. The reader does not modify any
+ * state, and it can be called from several threads at once.
+ *
+ * Compressed debug sections and split DWARF (.dwo files) are not supported.
+ * Object files are rejected, because their string offsets are relocations
+ * that have not been applied yet.
+ *
+ * Copyright 2022-2024, CompuPhase
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined __unix__ || defined __APPLE__
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+# define HAVE_MMAP
+#endif
+#include "dwarfnames.h"
+#include "elfsym.h"
+
+#define DW_AT_linkage_name        0x6e
+#define DW_AT_str_offsets_base    0x72
+#define DW_AT_MIPS_linkage_name   0x2007
+
+#define DW_FORM_addr            0x01
+#define DW_FORM_block2          0x03
+#define DW_FORM_block4          0x04
+#define DW_FORM_data2           0x05
+#define DW_FORM_data4           0x06
+#define DW_FORM_data8           0x07
+#define DW_FORM_string          0x08
+#define DW_FORM_block           0x09
+#define DW_FORM_block1          0x0a
+#define DW_FORM_data1           0x0b
+#define DW_FORM_flag            0x0c
+#define DW_FORM_sdata           0x0d
+#define DW_FORM_strp            0x0e
+#define DW_FORM_udata           0x0f
+#define DW_FORM_ref_addr        0x10
+#define DW_FORM_ref1            0x11
+#define DW_FORM_ref2            0x12
+#define DW_FORM_ref4            0x13
+#define DW_FORM_ref8            0x14
+#define DW_FORM_ref_udata       0x15
+#define DW_FORM_indirect        0x16
+#define DW_FORM_sec_offset      0x17
+#define DW_FORM_exprloc         0x18
+#define DW_FORM_flag_present    0x19
+#define DW_FORM_strx            0x1a
+#define DW_FORM_addrx           0x1b
+#define DW_FORM_ref_sup4        0x1c
+#define DW_FORM_strp_sup        0x1d
+#define DW_FORM_data16          0x1e
+#define DW_FORM_line_strp       0x1f
+#define DW_FORM_ref_sig8        0x20
+#define DW_FORM_implicit_const  0x21
+#define DW_FORM_loclistx        0x22
+#define DW_FORM_rnglistx        0x23
+#define DW_FORM_ref_sup8        0x24
+#define DW_FORM_strx1           0x25
+#define DW_FORM_strx2           0x26
+#define DW_FORM_strx3           0x27
+#define DW_FORM_strx4           0x28
+#define DW_FORM_addrx1          0x29
+#define DW_FORM_addrx2          0x2a
+#define DW_FORM_addrx3          0x2b
+#define DW_FORM_addrx4          0x2c
+#define DW_FORM_GNU_addr_index  0x1f01
+#define DW_FORM_GNU_str_index   0x1f02
+#define DW_FORM_GNU_ref_alt     0x1f20
+#define DW_FORM_GNU_strp_alt    0x1f21
+
+#define DW_UT_type              0x02
+#define DW_UT_skeleton          0x04
+#define DW_UT_split_compile     0x05
+#define DW_UT_split_type        0x06
+
+#define KEY_STR       ((uint64_t)0 << 62)  /* offset in .debug_str */
+#define KEY_LINE_STR  ((uint64_t)1 << 62)  /* offset in .debug_line_str */
+#define KEY_INFO      ((uint64_t)2 << 62)  /* offset in .debug_info (inline string) */
+
+#define MAX_ABBREV_CODE (1 << 20)
+
+struct dsection {
+  const unsigned char *data;
+  size_t size;
+};
+
+struct dwarfnames {
+  const unsigned char *data;
+  size_t size;
+  bool mapped;          /* data is mapped from a file (rather than attached) */
+  bool bigendian;
+  struct dsection info;
+  struct dsection abbrev;
+  struct dsection str;
+  struct dsection str_offsets;
+  struct dsection line_str;
+};
+
+struct reader {
+  const unsigned char *pos, *end;
+  bool bigendian;
+  bool valid;
+};
+
+struct unit {
+  uint64_t offset;      /* offset of the unit header in .debug_info */
+  uint64_t end;         /* offset of the next unit */
+  uint64_t dies;        /* offset of the first entry */
+  int version;
+  int offset_size;      /* 4 for 32-bit DWARF, 8 for 64-bit DWARF */
+  int address_size;
+  uint64_t abbrev_offset;
+};
+
+struct attrspec {
+  uint32_t name;
+  uint32_t form;
+  int64_t value;        /* for DW_FORM_implicit_const */
+};
+
+struct abbrev {
+  uint32_t first;       /* index of the first attribute in the spec array */
+  uint32_t count;
+  bool valid;
+};
+
+struct abbrevtab {
+  struct abbrev *codes; /* indexed by abbreviation code */
+  size_t maxcode;
+  struct attrspec *specs;
+  size_t nspecs, maxspecs;
+};
+
+static uint64_t read_fixed(struct reader *r, int bytes)
+{
+  if (!r->valid || r->end - r->pos < bytes) {
+    r->valid = false;
+    return 0;
+  }
+  uint64_t value = 0;
+  for (int i = 0; i < bytes; i++) {
+    int idx = r->bigendian ? i : bytes - 1 - i;
+    value = (value << 8) | r->pos[idx];
+  }
+  r->pos += bytes;
+  return value;
+}
+
+static uint64_t read_uleb(struct reader *r)
+{
+  uint64_t value = 0;
+  for (int shift = 0; r->valid && r->pos < r->end; shift += 7) {
+    unsigned char byte = *r->pos++;
+    if (shift < 64)
+      value |= (uint64_t)(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0)
+      return value;
+  }
+  r->valid = false;
+  return 0;
+}
+
+static int64_t read_sleb(struct reader *r)
+{
+  uint64_t value = 0;
+  int shift = 0;
+  while (r->valid && r->pos < r->end) {
+    unsigned char byte = *r->pos++;
+    if (shift < 64)
+      value |= (uint64_t)(byte & 0x7f) << shift;
+    shift += 7;
+    if ((byte & 0x80) == 0) {
+      if (shift < 64 && (byte & 0x40) != 0)
+        value |= ~(uint64_t)0 << shift;
+      return (int64_t)value;
+    }
+  }
+  r->valid = false;
+  return 0;
+}
+
+static void skip(struct reader *r, uint64_t bytes)
+{
+  if (!r->valid || (uint64_t)(r->end - r->pos) < bytes)
+    r->valid = false;
+  else
+    r->pos += bytes;
+}
+
+static const char *read_cstring(struct reader *r)
+{
+  if (!r->valid)
+    return NULL;
+  const unsigned char *nul = memchr(r->pos, '\0', r->end - r->pos);
+  if (nul == NULL) {
+    r->valid = false;
+    return NULL;
+  }
+  const char *text = (const char*)r->pos;
+  r->pos = nul + 1;
+  return text;
+}
+
+/** string_at() - returns the zero-terminated string at an offset in a
+ *  section, or NULL if the offset is out of range.
+ */
+static const char *string_at(const struct dsection *section, uint64_t offset)
+{
+  if (section->data == NULL || offset >= section->size)
+    return NULL;
+  const unsigned char *text = section->data + offset;
+  return (memchr(text, '\0', section->size - offset) != NULL) ? (const char*)text : NULL;
+}
+
+static bool parse_unit(const struct dwarfnames *dw, uint64_t offset, struct unit *unit)
+{
+  struct reader r = { dw->info.data + offset, dw->info.data + dw->info.size, dw->bigendian, offset < dw->info.size };
+  unit->offset = offset;
+  unit->offset_size = 4;
+  uint64_t length = read_fixed(&r, 4);
+  if (length == 0xffffffff) {
+    unit->offset_size = 8;
+    length = read_fixed(&r, 8);
+  } else if (length >= 0xfffffff0) {
+    return false;   /* reserved values */
+  }
+  if (!r.valid || length > (uint64_t)(r.end - r.pos))
+    return false;
+  unit->end = (r.pos - dw->info.data) + length;
+  r.end = r.pos + length;
+  unit->version = (int)read_fixed(&r, 2);
+  if (unit->version >= 5) {
+    int unit_type = (int)read_fixed(&r, 1);
+    unit->address_size = (int)read_fixed(&r, 1);
+    unit->abbrev_offset = read_fixed(&r, unit->offset_size);
+    if (unit_type == DW_UT_skeleton || unit_type == DW_UT_split_compile)
+      skip(&r, 8);  /* dwo_id */
+    else if (unit_type == DW_UT_type || unit_type == DW_UT_split_type)
+      skip(&r, 8 + unit->offset_size);  /* type signature and offset */
+  } else {
+    unit->abbrev_offset = read_fixed(&r, unit->offset_size);
+    unit->address_size = (int)read_fixed(&r, 1);
+  }
+  unit->dies = r.pos - dw->info.data;
+  return r.valid;
+}
+
+static void abbrev_free(struct abbrevtab *tab)
+{
+  free(tab->codes);
+  free(tab->specs);
+}
+
+/** parse_abbrevs() - reads the abbreviation table of a unit. */
+static bool parse_abbrevs(const struct dwarfnames *dw, uint64_t offset, struct abbrevtab *tab)
+{
+  memset(tab, 0, sizeof(struct abbrevtab));
+  if (offset >= dw->abbrev.size)
+    return false;
+  struct reader r = { dw->abbrev.data + offset, dw->abbrev.data + dw->abbrev.size, dw->bigendian, true };
+  size_t maxcodes = 0;
+  for ( ;; ) {
+    uint64_t code = read_uleb(&r);
+    if (!r.valid || code == 0)
+      break;
+    if (code >= MAX_ABBREV_CODE) {
+      r.valid = false;
+      break;
+    }
+    if (code >= maxcodes) {
+      size_t size = (maxcodes > 0) ? maxcodes : 64;
+      while (size <= code)
+        size *= 2;
+      struct abbrev *codes = realloc(tab->codes, size * sizeof(struct abbrev));
+      if (codes == NULL) {
+        r.valid = false;
+        break;
+      }
+      memset(codes + maxcodes, 0, (size - maxcodes) * sizeof(struct abbrev));
+      tab->codes = codes;
+      maxcodes = size;
+    }
+    if (code > tab->maxcode)
+      tab->maxcode = code;
+    struct abbrev *abbrev = &tab->codes[code];
+    read_uleb(&r);      /* tag */
+    skip(&r, 1);        /* has children */
+    abbrev->first = (uint32_t)tab->nspecs;
+    abbrev->count = 0;
+    abbrev->valid = true;
+    for ( ;; ) {
+      uint64_t name = read_uleb(&r);
+      uint64_t form = read_uleb(&r);
+      if (!r.valid || (name == 0 && form == 0))
+        break;
+      if (tab->nspecs == tab->maxspecs) {
+        size_t size = (tab->maxspecs > 0) ? 2 * tab->maxspecs : 256;
+        struct attrspec *specs = realloc(tab->specs, size * sizeof(struct attrspec));
+        if (specs == NULL) {
+          r.valid = false;
+          break;
+        }
+        tab->specs = specs;
+        tab->maxspecs = size;
+      }
+      struct attrspec *spec = &tab->specs[tab->nspecs++];
+      spec->name = (uint32_t)name;
+      spec->form = (uint32_t)form;
+      spec->value = (form == DW_FORM_implicit_const) ? read_sleb(&r) : 0;
+      abbrev->count++;
+    }
+  }
+  if (!r.valid)
+    abbrev_free(tab);
+  return r.valid;
+}
+
+/** read_attribute() - reads (or skips) an attribute value. For the string
+ *  forms, it returns the string and sets the key; for other forms, it returns
+ *  NULL, and sets "value" for the forms of integers, offsets and indices.
+ */
+static const char *read_attribute(const struct dwarfnames *dw, const struct unit *unit, struct reader *r,
+                                  uint32_t form, uint64_t str_base, uint64_t *value, uint64_t *key)
+{
+  uint64_t index;
+  *value = 0;
+  switch (form) {
+  case DW_FORM_addr:
+    skip(r, unit->address_size);
+    return NULL;
+  case DW_FORM_block1:
+    skip(r, read_fixed(r, 1));
+    return NULL;
+  case DW_FORM_block2:
+    skip(r, read_fixed(r, 2));
+    return NULL;
+  case DW_FORM_block4:
+    skip(r, read_fixed(r, 4));
+    return NULL;
+  case DW_FORM_block:
+  case DW_FORM_exprloc:
+    skip(r, read_uleb(r));
+    return NULL;
+  case DW_FORM_data1:
+  case DW_FORM_ref1:
+  case DW_FORM_flag:
+  case DW_FORM_strx1:
+  case DW_FORM_addrx1:
+    *value = read_fixed(r, 1);
+    break;
+  case DW_FORM_data2:
+  case DW_FORM_ref2:
+  case DW_FORM_strx2:
+  case DW_FORM_addrx2:
+    *value = read_fixed(r, 2);
+    break;
+  case DW_FORM_strx3:
+  case DW_FORM_addrx3:
+    *value = read_fixed(r, 3);
+    break;
+  case DW_FORM_data4:
+  case DW_FORM_ref4:
+  case DW_FORM_ref_sup4:
+  case DW_FORM_strx4:
+  case DW_FORM_addrx4:
+    *value = read_fixed(r, 4);
+    break;
+  case DW_FORM_data8:
+  case DW_FORM_ref8:
+  case DW_FORM_ref_sig8:
+  case DW_FORM_ref_sup8:
+    *value = read_fixed(r, 8);
+    break;
+  case DW_FORM_data16:
+    skip(r, 16);
+    return NULL;
+  case DW_FORM_sdata:
+    *value = (uint64_t)read_sleb(r);
+    break;
+  case DW_FORM_udata:
+  case DW_FORM_ref_udata:
+  case DW_FORM_strx:
+  case DW_FORM_addrx:
+  case DW_FORM_loclistx:
+  case DW_FORM_rnglistx:
+  case DW_FORM_GNU_addr_index:
+  case DW_FORM_GNU_str_index:
+    *value = read_uleb(r);
+    break;
+  case DW_FORM_ref_addr:
+    *value = read_fixed(r, (unit->version <= 2) ? unit->address_size : unit->offset_size);
+    break;
+  case DW_FORM_strp:
+  case DW_FORM_line_strp:
+  case DW_FORM_sec_offset:
+  case DW_FORM_strp_sup:
+  case DW_FORM_GNU_ref_alt:
+  case DW_FORM_GNU_strp_alt:
+    *value = read_fixed(r, unit->offset_size);
+    break;
+  case DW_FORM_flag_present:
+  case DW_FORM_implicit_const:
+    break;
+  case DW_FORM_string: {
+    const unsigned char *start = r->pos;
+    const char *text = read_cstring(r);
+    *key = KEY_INFO | (uint64_t)(start - dw->info.data);
+    return text;
+  }
+  default:
+    r->valid = false;   /* unknown form, the rest of the unit cannot be parsed */
+    return NULL;
+  }
+
+  switch (form) {
+  case DW_FORM_strp:
+    *key = KEY_STR | *value;
+    return string_at(&dw->str, *value);
+  case DW_FORM_line_strp:
+    *key = KEY_LINE_STR | *value;
+    return string_at(&dw->line_str, *value);
+  case DW_FORM_strx:
+  case DW_FORM_strx1:
+  case DW_FORM_strx2:
+  case DW_FORM_strx3:
+  case DW_FORM_strx4:
+  case DW_FORM_GNU_str_index:
+    index = str_base + *value * unit->offset_size;
+    if (dw->str_offsets.data == NULL || index >= dw->str_offsets.size
+        || dw->str_offsets.size - index < (uint64_t)unit->offset_size)
+      return NULL;
+    {
+      struct reader sr = { dw->str_offsets.data + index, dw->str_offsets.data + dw->str_offsets.size, dw->bigendian, true };
+      uint64_t offset = read_fixed(&sr, unit->offset_size);
+      *key = KEY_STR | offset;
+      return string_at(&dw->str, offset);
+    }
+  }
+  return NULL;
+}
+
+/** dwarfnames_unit() - walks the debug information entries of a unit, and
+ *  calls the callback for each linkage name. The argument "unit" is the offset
+ *  of the unit in .debug_info (see dwarfnames_units()).
+ *
+ *  Returns the number of linkage names, or -1 if the unit is invalid (or uses
+ *  an unsupported form). On an error halfway a unit, the callback has already
+ *  been called for the names before it.
+ */
+long dwarfnames_unit(const struct dwarfnames *dw, uint64_t unit, dwarfnames_callback callback, void *arg)
+{
+  assert(dw != NULL);
+  assert(callback != NULL);
+  struct unit u;
+  if (!parse_unit(dw, unit, &u))
+    return -1;
+  if (u.version < 2 || u.version > 5 || u.offset_size > 8)
+    return -1;
+  struct abbrevtab tab;
+  if (!parse_abbrevs(dw, u.abbrev_offset, &tab))
+    return -1;
+
+  /* without a DW_AT_str_offsets_base, the offsets follow the header of the
+     .debug_str_offsets section (DWARF 5) or start at its beginning */
+  uint64_t str_base = (u.version >= 5) ? 2 * u.offset_size : 0;
+  long count = 0;
+  struct reader r = { dw->info.data + u.dies, dw->info.data + u.end, dw->bigendian, true };
+  while (r.valid && r.pos < r.end) {
+    uint64_t code = read_uleb(&r);
+    if (code == 0)
+      continue;   /* end of a list of children */
+    if (code > tab.maxcode || !tab.codes[code].valid) {
+      r.valid = false;
+      break;
+    }
+    const struct abbrev *abbrev = &tab.codes[code];
+    for (uint32_t i = 0; i < abbrev->count && r.valid; i++) {
+      const struct attrspec *spec = &tab.specs[abbrev->first + i];
+      uint32_t form = spec->form;
+      while (form == DW_FORM_indirect && r.valid)
+        form = (uint32_t)read_uleb(&r);
+      uint64_t value, key;
+      const char *text = read_attribute(dw, &u, &r, form, str_base, &value, &key);
+      if (spec->name == DW_AT_str_offsets_base) {
+        str_base = value;
+      } else if ((spec->name == DW_AT_linkage_name || spec->name == DW_AT_MIPS_linkage_name) && text != NULL) {
+        callback(text, key, arg);
+        count++;
+      }
+    }
+  }
+  abbrev_free(&tab);
+  return r.valid ? count : -1;
+}
+
+/** dwarfnames_units() - stores the offsets of the units in .debug_info in
+ *  "units" (up to "max" of them). Returns the number of units, which may be
+ *  larger than "max".
+ */
+size_t dwarfnames_units(const struct dwarfnames *dw, uint64_t *units, size_t max)
+{
+  assert(dw != NULL);
+  assert(units != NULL || max == 0);
+  size_t count = 0;
+  struct unit unit;
+  for (uint64_t offset = 0; offset < dw->info.size && parse_unit(dw, offset, &unit); offset = unit.end) {
+    if (count < max)
+      units[count] = offset;
+    count++;
+  }
+  return count;
+}
+
+/** dwarfnames_attach() - uses an ELF file that is in memory (for example,
+ *  mapped by the caller). The memory must stay valid until
+ *  dwarfnames_close(). Returns NULL if the data is not an ELF file, if it has
+ *  no (uncompressed) debug information, or if it is an object file.
+ */
+struct dwarfnames *dwarfnames_attach(const void *data, size_t size)
+{
+  assert(data != NULL || size == 0);
+  const unsigned char *bytes = data;
+  if (size < 64 || memcmp(bytes, "\x7f" "ELF", 4) != 0)
+    return NULL;
+  bool bigendian = (bytes[5] == 2);
+  unsigned type = bigendian ? (bytes[16] << 8) | bytes[17] : (bytes[17] << 8) | bytes[16];
+  if (type == 1)
+    return NULL;  /* ET_REL */
+  struct dwarfnames *dw = calloc(1, sizeof(struct dwarfnames));
+  if (dw == NULL)
+    return NULL;
+  dw->data = bytes;
+  dw->size = size;
+  dw->bigendian = bigendian;
+  dw->info.data = elfsym_section(data, size, ".debug_info", &dw->info.size);
+  dw->abbrev.data = elfsym_section(data, size, ".debug_abbrev", &dw->abbrev.size);
+  dw->str.data = elfsym_section(data, size, ".debug_str", &dw->str.size);
+  dw->str_offsets.data = elfsym_section(data, size, ".debug_str_offsets", &dw->str_offsets.size);
+  dw->line_str.data = elfsym_section(data, size, ".debug_line_str", &dw->line_str.size);
+  if (dw->info.data == NULL || dw->abbrev.data == NULL) {
+    free(dw);
+    return NULL;
+  }
+  return dw;
+}
+
+/** dwarfnames_open() - maps an ELF file into memory; see dwarfnames_attach().
+ */
+struct dwarfnames *dwarfnames_open(const char *filename)
+{
+  assert(filename != NULL);
+  struct dwarfnames *dw = NULL;
+#if defined HAVE_MMAP
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0)
+    return NULL;
+  struct stat st;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data != MAP_FAILED) {
+      dw = dwarfnames_attach(data, st.st_size);
+      if (dw != NULL)
+        dw->mapped = true;
+      else
+        munmap(data, st.st_size);
+    }
+  }
+  close(fd);
+#else
+  FILE *fp = fopen(filename, "rb");
+  if (fp == NULL)
+    return NULL;
+  fseek(fp, 0, SEEK_END);
+  long size = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  void *data = (size > 0) ? malloc(size) : NULL;
+  if (data != NULL && fread(data, 1, size, fp) == (size_t)size)
+    dw = dwarfnames_attach(data, size);
+  if (dw != NULL)
+    dw->mapped = true;
+  else
+    free(data);
+  fclose(fp);
+#endif
+  return dw;
+}
+
+void dwarfnames_close(struct dwarfnames *dw)
+{
+  if (dw == NULL)
+    return;
+  if (dw->mapped) {
+#if defined HAVE_MMAP
+    munmap((void*)dw->data, dw->size);
+#else
+    free((void*)dw->data);
+#endif
+  }
+  free(dw);
+}
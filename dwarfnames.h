@@ -0,0 +1,44 @@
+/* GNU C++ symbol name demangler
+ * Reading the linkage names from the DWARF debug information.
+ *
+ * Copyright 2022-2024, CompuPhase
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _DWARFNAMES_H
+#define _DWARFNAMES_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+struct dwarfnames;
+
+/* "key" identifies the string in the file: equal keys mean the same string */
+typedef void (*dwarfnames_callback)(const char *name, uint64_t key, void *arg);
+
+struct dwarfnames *dwarfnames_open(const char *filename);
+struct dwarfnames *dwarfnames_attach(const void *data, size_t size);
+void dwarfnames_close(struct dwarfnames *dw);
+size_t dwarfnames_units(const struct dwarfnames *dw, uint64_t *units, size_t max);
+long dwarfnames_unit(const struct dwarfnames *dw, uint64_t unit, dwarfnames_callback callback, void *arg);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif /* _DWARFNAMES_H */
@@ -0,0 +1,331 @@
+/* GNU C++ symbol name demangler
+ * Reading the symbol tables of ELF files and archives.
+ *
+ * The reader runs over the symbol table of an ELF file (32-bit or 64-bit, in
+ * either byte order) and passes each named symbol to a callback. It uses the
+ * full symbol table (.symtab) when present, and the dynamic symbol table
+ * (.dynsym) of stripped shared libraries otherwise. Static libraries (ar
+ * archives) are handled member by member. elfsym_section() gives access to
+ * other sections by name, such as the DWARF debug information.
+ *
+ * The names are passed as pointers into the file data, so nothing is copied;
+ * they are valid during the callback only. All offsets and sizes in the file
+ * are checked against the size of the data, so that a corrupt file cannot
+ * cause a read outside of it.
+ *
+ * Copyright 2022-2024, CompuPhase
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined __unix__ || defined __APPLE__
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+# define HAVE_MMAP
+#endif
+#include "elfsym.h"
+
+#define SHT_SYMTAB      2
+#define SHT_NOBITS      8
+#define SHT_DYNSYM      11
+#define SHN_UNDEF       0
+#define SHN_XINDEX      0xffff
+#define SHF_COMPRESSED  0x800
+
+struct elf {
+  const unsigned char *data;
+  size_t size;
+  bool is64;
+  bool bigendian;
+};
+
+static uint64_t get(const struct elf *elf, size_t offset, int bytes)
+{
+  assert(offset + bytes <= elf->size);
+  const unsigned char *p = elf->data + offset;
+  uint64_t value = 0;
+  for (int i = 0; i < bytes; i++) {
+    int idx = elf->bigendian ? i : bytes - 1 - i;
+    value = (value << 8) | p[idx];
+  }
+  return value;
+}
+
+static bool in_range(const struct elf *elf, uint64_t offset, uint64_t size)
+{
+  return offset <= elf->size && size <= elf->size - offset;
+}
+
+struct section {
+  uint32_t name;
+  uint32_t type;
+  uint64_t flags;
+  uint64_t offset;
+  uint64_t size;
+  uint32_t link;
+  uint64_t entsize;
+};
+
+static bool get_section(const struct elf *elf, uint64_t shoff, uint32_t shentsize, uint32_t index,
+                        struct section *section)
+{
+  uint64_t base = shoff + (uint64_t)index * shentsize;
+  if (!in_range(elf, base, elf->is64 ? 64 : 40))
+    return false;
+  section->name = (uint32_t)get(elf, base, 4);
+  section->type = (uint32_t)get(elf, base + 4, 4);
+  section->flags = get(elf, base + 8, elf->is64 ? 8 : 4);
+  if (elf->is64) {
+    section->offset = get(elf, base + 24, 8);
+    section->size = get(elf, base + 32, 8);
+    section->link = (uint32_t)get(elf, base + 40, 4);
+    section->entsize = get(elf, base + 56, 8);
+  } else {
+    section->offset = get(elf, base + 16, 4);
+    section->size = get(elf, base + 20, 4);
+    section->link = (uint32_t)get(elf, base + 24, 4);
+    section->entsize = get(elf, base + 36, 4);
+  }
+  return true;
+}
+
+/** parse_header() - checks the ELF header and reads the position of the
+ *  section headers. Returns -1 if the data is not a (valid) ELF file, 0 if it
+ *  has no section headers, and 1 on success.
+ */
+static int parse_header(struct elf *elf, uint64_t *shoff, uint32_t *shentsize, uint32_t *shnum)
+{
+  const unsigned char *data = elf->data;
+  if (elf->size < 52 || memcmp(data, "\x7f" "ELF", 4) != 0)
+    return -1;
+  if (data[4] != 1 && data[4] != 2)
+    return -1;
+  if (data[5] != 1 && data[5] != 2)
+    return -1;
+  elf->is64 = (data[4] == 2);
+  elf->bigendian = (data[5] == 2);
+  if (elf->is64 && elf->size < 64)
+    return -1;
+
+  *shoff = get(elf, elf->is64 ? 0x28 : 0x20, elf->is64 ? 8 : 4);
+  *shentsize = (uint32_t)get(elf, elf->is64 ? 0x3a : 0x2e, 2);
+  *shnum = (uint32_t)get(elf, elf->is64 ? 0x3c : 0x30, 2);
+  if (*shoff == 0 || *shentsize < (elf->is64 ? 64u : 40u))
+    return 0;
+  if (*shnum == 0) {
+    /* more than 0xff00 sections: the count is in the first section header */
+    if (!in_range(elf, *shoff, *shentsize))
+      return -1;
+    *shnum = (uint32_t)get(elf, *shoff + (elf->is64 ? 32 : 20), elf->is64 ? 8 : 4);
+  }
+  if (!in_range(elf, *shoff, (uint64_t)*shnum * *shentsize))
+    return -1;
+  return 1;
+}
+
+static long parse_elf(const unsigned char *data, size_t size, elfsym_callback callback, void *arg)
+{
+  struct elf elf = { data, size, false, false };
+  uint64_t shoff;
+  uint32_t shentsize, shnum;
+  int result = parse_header(&elf, &shoff, &shentsize, &shnum);
+  if (result <= 0)
+    return result;  /* not an ELF file, or no section headers (so no symbols) */
+  struct section section;
+
+  /* prefer the full symbol table over the dynamic one */
+  struct section symtab = { 0, 0, 0, 0, 0, 0, 0 };
+  bool found = false;
+  for (uint32_t i = 0; i < shnum; i++) {
+    if (!get_section(&elf, shoff, shentsize, i, &section))
+      return -1;
+    if (section.type == SHT_SYMTAB || (section.type == SHT_DYNSYM && !found)) {
+      symtab = section;
+      found = true;
+    }
+  }
+  if (!found)
+    return 0;
+  struct section strtab;
+  uint32_t symsize = elf.is64 ? 24 : 16;
+  if (symtab.link >= shnum || !get_section(&elf, shoff, shentsize, symtab.link, &strtab))
+    return -1;
+  if (!in_range(&elf, symtab.offset, symtab.size) || !in_range(&elf, strtab.offset, strtab.size))
+    return -1;
+  if (symtab.entsize != 0 && symtab.entsize < symsize)
+    return -1;
+  if (symtab.entsize > symsize)
+    symsize = (uint32_t)symtab.entsize;
+
+  const char *strings = (const char*)data + strtab.offset;
+  long count = 0;
+  for (uint64_t pos = symtab.offset; pos + symsize <= symtab.offset + symtab.size; pos += symsize) {
+    uint32_t name = (uint32_t)get(&elf, pos, 4);
+    if (name == 0 || name >= strtab.size)
+      continue;
+    const char *end = memchr(strings + name, '\0', strtab.size - name);
+    if (end == NULL)
+      continue;   /* name is not terminated inside the string table */
+    struct elfsym sym;
+    unsigned info;
+    unsigned shndx;
+    sym.name = strings + name;
+    sym.length = end - sym.name;
+    if (elf.is64) {
+      info = (unsigned)get(&elf, pos + 4, 1);
+      shndx = (unsigned)get(&elf, pos + 6, 2);
+      sym.value = get(&elf, pos + 8, 8);
+      sym.size = get(&elf, pos + 16, 8);
+    } else {
+      sym.value = get(&elf, pos + 4, 4);
+      sym.size = get(&elf, pos + 8, 4);
+      info = (unsigned)get(&elf, pos + 12, 1);
+      shndx = (unsigned)get(&elf, pos + 14, 2);
+    }
+    sym.type = (unsigned char)(info & 0x0f);
+    sym.bind = (unsigned char)(info >> 4);
+    sym.section = shndx;
+    sym.defined = (shndx != SHN_UNDEF);
+    callback(&sym, arg);
+    count++;
+  }
+  return count;
+}
+
+static uint64_t parse_decimal(const unsigned char *field, int width)
+{
+  uint64_t value = 0;
+  for (int i = 0; i < width && field[i] >= '0' && field[i] <= '9'; i++)
+    value = value * 10 + (field[i] - '0');
+  return value;
+}
+
+/** parse_archive() - runs over the members of an ar archive, and reads the
+ *  symbols of the members that are ELF files. Members that are not ELF files
+ *  (the archive symbol table, the long name table) are skipped.
+ */
+static long parse_archive(const unsigned char *data, size_t size, elfsym_callback callback, void *arg)
+{
+  long count = 0;
+  size_t pos = 8;   /* "!<arch>\n" */
+  while (pos + 60 <= size) {
+    const unsigned char *header = data + pos;
+    if (header[58] != '`' || header[59] != '\n')
+      return (count > 0) ? count : -1;
+    uint64_t member = parse_decimal(header + 48, 10);
+    pos += 60;
+    if (member > size - pos)
+      return (count > 0) ? count : -1;
+    if (member >= 4 && memcmp(data + pos, "\x7f" "ELF", 4) == 0) {
+      long result = parse_elf(data + pos, (size_t)member, callback, arg);
+      if (result > 0)
+        count += result;
+    }
+    pos += (size_t)member + (member & 1);
+  }
+  return count;
+}
+
+/** elfsym_parse() - calls the callback for each named symbol in the ELF file
+ *  or ar archive in the memory block. Returns the number of symbols, or -1 if
+ *  the data is not an ELF file or archive (or if it is corrupt).
+ */
+long elfsym_parse(const void *data, size_t size, elfsym_callback callback, void *arg)
+{
+  assert(data != NULL || size == 0);
+  assert(callback != NULL);
+  const unsigned char *bytes = data;
+  if (size >= 8 && memcmp(bytes, "!<arch>\n", 8) == 0)
+    return parse_archive(bytes, size, callback, arg);
+  return parse_elf(bytes, size, callback, arg);
+}
+
+/** elfsym_section() - looks up a section of an ELF file by its name (such as
+ *  ".debug_info"). Returns a pointer to the contents of the section and sets
+ *  "length" to its size, or returns NULL if the file has no such section (or
+ *  if the section is compressed, or has no contents in the file).
+ */
+const void *elfsym_section(const void *data, size_t size, const char *name, size_t *length)
+{
+  assert(data != NULL || size == 0);
+  assert(name != NULL);
+  assert(length != NULL);
+  struct elf elf = { data, size, false, false };
+  uint64_t shoff;
+  uint32_t shentsize, shnum;
+  if (parse_header(&elf, &shoff, &shentsize, &shnum) <= 0)
+    return NULL;
+  uint32_t shstrndx = (uint32_t)get(&elf, elf.is64 ? 0x3e : 0x32, 2);
+  struct section section, names;
+  if (shstrndx == SHN_XINDEX && get_section(&elf, shoff, shentsize, 0, &section))
+    shstrndx = section.link;
+  if (shstrndx >= shnum || !get_section(&elf, shoff, shentsize, shstrndx, &names)
+      || !in_range(&elf, names.offset, names.size))
+    return NULL;
+  size_t namelength = strlen(name);
+  for (uint32_t i = 1; i < shnum; i++) {
+    if (!get_section(&elf, shoff, shentsize, i, &section))
+      return NULL;
+    if (section.name >= names.size || namelength >= names.size - section.name
+        || memcmp(elf.data + names.offset + section.name, name, namelength + 1) != 0)
+      continue;
+    if (section.type == SHT_NOBITS || (section.flags & SHF_COMPRESSED) != 0
+        || !in_range(&elf, section.offset, section.size))
+      return NULL;
+    *length = (size_t)section.size;
+    return elf.data + section.offset;
+  }
+  return NULL;
+}
+
+/** elfsym_read() - reads the symbols from a file; see elfsym_parse(). The
+ *  file is mapped into memory, so that only the pages with the symbol and
+ *  string tables are read from disk.
+ */
+long elfsym_read(const char *filename, elfsym_callback callback, void *arg)
+{
+  assert(filename != NULL);
+  long result = -1;
+#if defined HAVE_MMAP
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0)
+    return -1;
+  struct stat st;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data != MAP_FAILED) {
+      result = elfsym_parse(data, st.st_size, callback, arg);
+      munmap(data, st.st_size);
+    }
+  }
+  close(fd);
+#else
+  FILE *fp = fopen(filename, "rb");
+  if (fp == NULL)
+    return -1;
+  fseek(fp, 0, SEEK_END);
+  long size = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  void *data = (size > 0) ? malloc(size) : NULL;
+  if (data != NULL && fread(data, 1, size, fp) == (size_t)size)
+    result = elfsym_parse(data, size, callback, arg);
+  free(data);
+  fclose(fp);
+#endif
+  return result;
+}
@@ -0,0 +1,55 @@
+/* GNU C++ symbol name demangler
+ * Reading the symbol tables of ELF files and archives.
+ *
+ * Copyright 2022-2024, CompuPhase
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _ELFSYM_H
+#define _ELFSYM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* symbol types (the values of STT_xxx in the ELF specification) */
+#define ELFSYM_NOTYPE   0
+#define ELFSYM_OBJECT   1
+#define ELFSYM_FUNC     2
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+struct elfsym {
+  const char *name;     /**< zero-terminated, points into the file data */
+  size_t length;        /**< length of the name */
+  uint64_t value;       /**< address (or section offset, in object files) */
+  uint64_t size;        /**< size in bytes */
+  unsigned char type;   /**< ELFSYM_FUNC, ELFSYM_OBJECT, ... */
+  unsigned char bind;   /**< 0 = local, 1 = global, 2 = weak */
+  unsigned section;     /**< index of the section that holds the symbol */
+  bool defined;         /**< false for references to other modules */
+};
+
+typedef void (*elfsym_callback)(const struct elfsym *sym, void *arg);
+
+long elfsym_parse(const void *data, size_t size, elfsym_callback callback, void *arg);
+long elfsym_read(const char *filename, elfsym_callback callback, void *arg);
+const void *elfsym_section(const void *data, size_t size, const char *name, size_t *length);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif /* _ELFSYM_H */
@@ -0,0 +1,250 @@
+/* GNU C++ symbol name demangler
+ * Performance fuzzing harness: searches for inputs that make demangle()
+ * disproportionately slow relative to their length.
+ *
+ * The harness measures the CPU time of each call and normalizes it by the
+ * input length. Whenever an input is slower (per byte) than any input seen
+ * before, it is written to the "slow unit" directory (set with the environment
+ * variable FUZZ_SLOW_DIR, default "fuzz/slow"). That directory is the
+ * regression corpus that the benchmark program replays:
+ *
+ *     bench -corpus fuzz/slow -limit 10000
+ *
+ * Build modes:
+ * - libFuzzer:  clang -O2 -fsanitize=fuzzer -DFUZZ_LIBFUZZER fuzz/fuzz_slow.c demangle.c
+ *   The time-per-byte ratio is bucketed into libFuzzer "extra counters", so
+ *   that slower inputs count as new coverage and are kept in the corpus.
+ * - AFL:        afl-clang-fast -O2 fuzz/fuzz_slow.c demangle.c
+ *   Reads the input from stdin (persistent mode when available).
+ * - standalone: cc -O2 fuzz/fuzz_slow.c demangle.c
+ *   fuzz_slow -seeds dir      writes the test vectors as seed files
+ *   fuzz_slow -search n       runs n random mutations of the test vectors
+ *   fuzz_slow file ...        runs the given files (or stdin)
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../demangle.h"
+
+#define MAX_INPUT       8192
+#define MIN_SLOW_NS     20000   /* ignore anything below 20 us (timer noise) */
+#define RETRIES         3       /* re-measure candidates, keep the fastest run */
+#define NUM_BUCKETS     64
+
+static const char *testcases[] = {
+#define TESTCASE(m, p)  m,
+#include "../testcases.h"
+#undef TESTCASE
+};
+
+#if defined FUZZ_LIBFUZZER && defined __clang__ && defined __ELF__
+  /* libFuzzer treats non-zero bytes in this section as coverage features */
+  static uint8_t slow_counters[NUM_BUCKETS] __attribute__((used, section("__libfuzzer_extra_counters")));
+#else
+  static uint8_t slow_counters[NUM_BUCKETS];
+#endif
+
+static double worst_ratio = 0;  /* slowest ns-per-byte seen so far */
+static char plain[4 * MAX_INPUT];
+
+static long cputime_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+static long time_demangle(const char *mangled)
+{
+  long start = cputime_ns();
+  demangle(plain, sizeof plain, mangled);
+  return cputime_ns() - start;
+}
+
+static void save_slow_unit(const char *mangled, size_t length, long ns)
+{
+  const char *dir = getenv("FUZZ_SLOW_DIR");
+  if (dir == NULL)
+    dir = "fuzz/slow";
+  /* FNV-1a hash of the input, for a stable file name */
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < length; i++)
+    hash = (hash ^ (uint8_t)mangled[i]) * 16777619u;
+  char path[1024];
+  snprintf(path, sizeof path, "%s/slow-%08lx", dir, (unsigned long)hash);
+  FILE *fp = fopen(path, "wb");
+  if (fp != NULL) {
+    fwrite(mangled, 1, length, fp);
+    fputc('\n', fp);
+    fclose(fp);
+  }
+  fprintf(stderr, "slow unit: %lu bytes, %ld ns (%.0f ns/byte) -> %s\n",
+          (unsigned long)length, ns, (double)ns / length, path);
+}
+
+/** run_one() demangles a single input, and records it if it is the slowest
+ *  one so far (relative to its length). Inputs that do not start with "_Z"
+ *  are prefixed with it, so that every mutation exercises the parser.
+ */
+static void run_one(const uint8_t *data, size_t size)
+{
+  static char mangled[MAX_INPUT + 3];
+  if (size > MAX_INPUT)
+    size = MAX_INPUT;
+  size_t offs = 0;
+  if (size < 2 || data[0] != '_' || data[1] != 'Z') {
+    memcpy(mangled, "_Z", 2);
+    offs = 2;
+  }
+  memcpy(mangled + offs, data, size);
+  size_t length = offs + size;
+  mangled[length] = '\0';
+  length = strlen(mangled); /* input may hold embedded zero bytes */
+
+  long ns = time_demangle(mangled);
+  if (ns < MIN_SLOW_NS)
+    return;
+  for (int r = 1; r < RETRIES; r++) {
+    long t = time_demangle(mangled);
+    if (t < ns)
+      ns = t;
+  }
+  double ratio = (double)ns / length;
+  int bucket = 0;
+  while (bucket < NUM_BUCKETS - 1 && (1L << bucket) < (long)ratio)
+    bucket++;
+  slow_counters[bucket] = 1;
+  if (ns >= MIN_SLOW_NS && ratio > worst_ratio) {
+    worst_ratio = ratio;
+    save_slow_unit(mangled, length, ns);
+  }
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+  run_one(data, size);
+  return 0;
+}
+
+#if !defined FUZZ_LIBFUZZER
+
+static const char alphabet[] = "0123456789_ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+
+/** mutate() applies one random edit: insert, delete, duplicate a range, or
+ *  splice in a chunk of another test vector.
+ */
+static size_t mutate(char *buffer, size_t length, size_t maxlength)
+{
+  size_t pos = (length > 0) ? (size_t)rand() % length : 0;
+  switch (rand() % 4) {
+  case 0:   /* insert a character */
+    if (length + 1 < maxlength) {
+      memmove(buffer + pos + 1, buffer + pos, length - pos);
+      buffer[pos] = alphabet[rand() % (sizeof alphabet - 1)];
+      length++;
+    }
+    break;
+  case 1:   /* delete a character */
+    if (length > 2) {
+      memmove(buffer + pos, buffer + pos + 1, length - pos - 1);
+      length--;
+    }
+    break;
+  case 2: { /* duplicate a range (grows nesting and substitution counts) */
+    size_t len = (length > pos) ? 1 + (size_t)rand() % (length - pos) : 0;
+    if (length + len < maxlength) {
+      memmove(buffer + pos + len, buffer + pos, length - pos);
+      length += len;
+    }
+    break;
+  }
+  case 3: { /* splice in a chunk of another test vector */
+    const char *src = testcases[rand() % (sizeof testcases / sizeof testcases[0])];
+    size_t srclen = strlen(src);
+    size_t start = (size_t)rand() % srclen;
+    size_t len = 1 + (size_t)rand() % (srclen - start);
+    if (length + len < maxlength) {
+      memmove(buffer + pos + len, buffer + pos, length - pos);
+      memcpy(buffer + pos, src + start, len);
+      length += len;
+    }
+    break;
+  }
+  }
+  return length;
+}
+
+static void search(long iterations)
+{
+  static char buffer[MAX_INPUT];
+  size_t count = sizeof testcases / sizeof testcases[0];
+  for (long i = 0; i < iterations; i++) {
+    const char *seed = testcases[(size_t)rand() % count];
+    size_t length = strlen(seed);
+    memcpy(buffer, seed, length);
+    int edits = 1 + rand() % 16;
+    for (int e = 0; e < edits; e++)
+      length = mutate(buffer, length, sizeof buffer);
+    run_one((const uint8_t*)buffer, length);
+  }
+}
+
+static int write_seeds(const char *dir)
+{
+  size_t count = sizeof testcases / sizeof testcases[0];
+  for (size_t i = 0; i < count; i++) {
+    char path[1024];
+    snprintf(path, sizeof path, "%s/seed-%03lu", dir, (unsigned long)i);
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL) {
+      fprintf(stderr, "cannot write %s\n", path);
+      return 1;
+    }
+    fputs(testcases[i], fp);
+    fclose(fp);
+  }
+  return 0;
+}
+
+static void run_file(FILE *fp)
+{
+  static uint8_t buffer[MAX_INPUT];
+  size_t size = fread(buffer, 1, sizeof buffer, fp);
+  while (size > 0 && (buffer[size - 1] == '\n' || buffer[size - 1] == '\r'))
+    size--;
+  run_one(buffer, size);
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc == 3 && strcmp(argv[1], "-seeds") == 0)
+    return write_seeds(argv[2]);
+  if (argc == 3 && strcmp(argv[1], "-search") == 0) {
+    search(strtol(argv[2], NULL, 10));
+    return 0;
+  }
+
+  if (argc == 1) {
+#   if defined __AFL_HAVE_MANUAL_CONTROL
+      while (__AFL_LOOP(10000)) {
+        run_file(stdin);
+        clearerr(stdin);
+      }
+#   else
+      run_file(stdin);
+#   endif
+  }
+  for (int i = 1; i < argc; i++) {
+    FILE *fp = fopen(argv[i], "rb");
+    if (fp != NULL) {
+      run_file(fp);
+      fclose(fp);
+    }
+  }
+  return 0;
+}
+
+#endif /* FUZZ_LIBFUZZER */
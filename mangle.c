@@ -0,0 +1,1312 @@
+/* GNU C++ symbol name demangler
+ * Encoding of plain C++ names and signatures into mangled names.
+ *
+ * This is the inverse of demangle(): it takes a name in the form that
+ * demangle() produces, such as "ns::Class<int>::method(char const*) const",
+ * and returns the mangled name ("_ZNK2ns5ClassIiE6methodEPKc"). With it, a
+ * symbol can be looked up in a symbol table by its mangled name, without
+ * demangling the table.
+ *
+ * The input is parsed into a tree of types and names, which is then encoded
+ * with the same tables as the demangler uses. The substitution rules need the
+ * identity of each entity that is a substitution candidate; this is the full
+ * encoding of the entity without any substitutions (its "key").
+ *
+ * The demangled form does not tell everything that the mangled name encodes:
+ * whether template arguments were a pack (IJdEE or IdE), the type of an
+ * integer literal (Li250E or Lm250E), which parameter types of a function
+ * template were written as template parameters (T_ or the type itself), and
+ * whether an operator with one parameter in a qualified name is a member.
+ * For such names, the encoder returns its best guess (no pack, "int", the
+ * template parameter, a member) with the result DEMANGLE_AMBIGUOUS, so that
+ * a wrong guess is not taken for the mangled name. Not supported are local
+ * names, lambdas, thunks and expressions in template arguments. For
+ * constructors and destructors, the name for the complete object (C1 and D1)
+ * is returned; the base object variants (C2, D2) have the same demangled form.
+ *
+ * Copyright 2022-2024, CompuPhase
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "demangle.h"
+#include "demangle_tables.h"
+#include "mangle.h"
+
+#define sizearray(a)        (sizeof(a) / sizeof((a)[0]))
+#if !defined MAX_PARSE_DEPTH
+# define MAX_PARSE_DEPTH    128   /* same limit as in demangle.c */
+#endif
+
+enum {
+  NODE_BUILTIN,         /* text = code from types[] */
+  NODE_NAME,            /* list of components (in "child") */
+  NODE_COMPONENT,       /* text = identifier, args = template arguments */
+  NODE_QUALIFIED,       /* quals, child */
+  NODE_POINTER,         /* child */
+  NODE_LREF,            /* child */
+  NODE_RREF,            /* child */
+  NODE_ARRAY,           /* text = dimension (may be empty), child = element type */
+  NODE_FUNCTION,        /* child = return type, args = parameters, quals, ref */
+  NODE_MEMBER,          /* child = member type, type = class */
+  NODE_LITERAL,         /* text = value, type = literal type */
+};
+
+/* qualifiers, in the order of the mangled form (rVK) */
+#define QUAL_RESTRICT   0x01
+#define QUAL_VOLATILE   0x02
+#define QUAL_CONST      0x04
+
+/* special components */
+enum {
+  COMP_PLAIN,
+  COMP_CTOR,
+  COMP_DTOR,
+  COMP_OPERATOR,        /* operator = index in operators[] */
+  COMP_CONVERSION,      /* type = the target type */
+  COMP_ABBREVIATION,    /* text = code from abbreviations[] ("St", "Ss", ...) */
+};
+
+struct node {
+  int kind;
+  const char *text;
+  size_t length;
+  struct node *child;
+  struct node *args;    /* template arguments or parameters (a list linked by "next") */
+  struct node *type;
+  struct node *next;
+  unsigned quals;
+  char ref;             /* '\0', 'R' (&) or 'O' (&&) */
+  int special;          /* for components */
+  int opindex;          /* for operator components */
+};
+
+struct strbuf {
+  char *text;
+  size_t length;
+  size_t size;
+};
+
+struct encoder {
+  const char *pos;      /**< parse position */
+  bool valid;
+  bool nomemory;
+  bool ambiguous;       /**< whether the encoding is a guess */
+  short level;          /**< recursion depth */
+  struct node *nodes;
+  size_t count, max;
+  struct strbuf keys;   /**< keys of the substitution candidates, zero-terminated */
+  size_t *subs;         /**< offsets in "keys" */
+  size_t nsubs, maxsubs;
+  char **tkeys;         /**< keys of the template arguments of a function template */
+  int ntparams;         /**< number of template arguments that may be referred to */
+};
+
+static struct node *parse_type(struct encoder *enc, bool suffixes);
+static struct node *parse_name(struct encoder *enc);
+static void encode_type(struct encoder *enc, const struct node *node, struct strbuf *out, bool subst);
+static void encode_name(struct encoder *enc, const struct node *name, struct strbuf *out, bool subst,
+                        bool entity, unsigned quals, char ref);
+static void encode_prefix(struct encoder *enc, const struct node *name, struct strbuf *out);
+
+static bool is_digit(char c)
+{
+  return c >= '0' && c <= '9';
+}
+
+static bool is_ident(char c)
+{
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || is_digit(c) || c == '_' || c == '$';
+}
+
+/* ----- output buffers */
+
+static void sb_append(struct encoder *enc, struct strbuf *sb, const char *text, size_t length)
+{
+  if (sb->length + length + 1 > sb->size) {
+    size_t size = (sb->size > 0) ? sb->size : 128;
+    while (size < sb->length + length + 1)
+      size *= 2;
+    char *p = realloc(sb->text, size);
+    if (p == NULL) {
+      enc->nomemory = true;
+      enc->valid = false;
+      return;
+    }
+    sb->text = p;
+    sb->size = size;
+  }
+  memcpy(sb->text + sb->length, text, length);
+  sb->length += length;
+  sb->text[sb->length] = '\0';
+}
+
+static void sb_puts(struct encoder *enc, struct strbuf *sb, const char *text)
+{
+  sb_append(enc, sb, text, strlen(text));
+}
+
+static void sb_number(struct encoder *enc, struct strbuf *sb, size_t value)
+{
+  char field[24];
+  sprintf(field, "%lu", (unsigned long)value);
+  sb_puts(enc, sb, field);
+}
+
+/* ----- parsing */
+
+static struct node *new_node(struct encoder *enc, int kind)
+{
+  if (enc->count >= enc->max) {
+    enc->valid = false;
+    return NULL;
+  }
+  struct node *node = &enc->nodes[enc->count++];
+  memset(node, 0, sizeof(struct node));
+  node->kind = kind;
+  return node;
+}
+
+static void skip_spaces(struct encoder *enc)
+{
+  while (*enc->pos == ' ')
+    enc->pos++;
+}
+
+static bool match(struct encoder *enc, const char *keyword)
+{
+  size_t len = strlen(keyword);
+  if (enc->valid && strncmp(enc->pos, keyword, len) == 0) {
+    enc->pos += len;
+    return true;
+  }
+  return false;
+}
+
+/** match_word() - like match(), but the keyword must not be followed by an
+ *  identifier character ("const" does not match "constant").
+ */
+static bool match_word(struct encoder *enc, const char *keyword)
+{
+  size_t len = strlen(keyword);
+  if (enc->valid && strncmp(enc->pos, keyword, len) == 0 && !(is_ident(keyword[len - 1]) && is_ident(enc->pos[len]))) {
+    enc->pos += len;
+    return true;
+  }
+  return false;
+}
+
+static bool peek_word(struct encoder *enc, const char *keyword)
+{
+  const char *mark = enc->pos;
+  bool found = match_word(enc, keyword);
+  enc->pos = mark;
+  return found;
+}
+
+static void expect(struct encoder *enc, const char *keyword)
+{
+  skip_spaces(enc);
+  if (!match(enc, keyword))
+    enc->valid = false;
+}
+
+static bool enter_level(struct encoder *enc)
+{
+  enc->level += 1;
+  if (enc->level > MAX_PARSE_DEPTH)
+    enc->valid = false;
+  return enc->valid;
+}
+
+static void leave_level(struct encoder *enc)
+{
+  assert(enc->level > 0);
+  enc->level -= 1;
+}
+
+static struct node *parse_builtin(struct encoder *enc)
+{
+  /* longest match, so that "long long" is not taken as "long" */
+  int best = -1;
+  size_t bestlen = 0;
+  for (size_t i = 0; i < sizearray(types); i++) {
+    size_t len = strlen(types[i].name);
+    if (len > bestlen && strncmp(enc->pos, types[i].name, len) == 0
+        && !(is_ident(types[i].name[len - 1]) && is_ident(enc->pos[len]))) {
+      best = (int)i;
+      bestlen = len;
+    }
+  }
+  if (best < 0)
+    return NULL;
+  struct node *node = new_node(enc, NODE_BUILTIN);
+  if (node != NULL) {
+    node->text = types[best].abbrev;
+    node->length = strlen(types[best].abbrev);
+    enc->pos += bestlen;
+  }
+  return node;
+}
+
+static struct node *parse_literal(struct encoder *enc)
+{
+  /* true, false, (type)value, or an integer (of type int) */
+  struct node *node = new_node(enc, NODE_LITERAL);
+  if (node == NULL)
+    return NULL;
+  if (peek_word(enc, "true") || peek_word(enc, "false")) {
+    node->text = match_word(enc, "true") ? "1" : "0";
+    node->length = 1;
+    match_word(enc, "false");
+    node->type = new_node(enc, NODE_BUILTIN);
+    if (node->type != NULL) {
+      node->type->text = "b";
+      node->type->length = 1;
+    }
+    return node;
+  }
+  if (match(enc, "(")) {
+    node->type = parse_type(enc, false);
+    expect(enc, ")");
+  } else {
+    /* the demangler omits the type of integer literals, "int" is a guess */
+    node->type = new_node(enc, NODE_BUILTIN);
+    if (node->type != NULL) {
+      node->type->text = "i";
+      node->type->length = 1;
+    }
+    enc->ambiguous = true;
+  }
+  const char *start = enc->pos;
+  if (*enc->pos == '-')
+    enc->pos++;
+  if (!is_digit(*enc->pos))
+    enc->valid = false;
+  while (is_digit(*enc->pos))
+    enc->pos++;
+  node->text = start;
+  node->length = enc->pos - start;
+  return node;
+}
+
+static struct node *parse_template_args(struct encoder *enc)
+{
+  /* '<' arg (',' arg)* '>'; the '<' is already matched */
+  struct node *head = NULL, **tail = &head;
+  skip_spaces(enc);
+  while (enc->valid && !match(enc, ">")) {
+    if (head != NULL)
+      expect(enc, ",");
+    skip_spaces(enc);
+    struct node *arg;
+    if (is_digit(*enc->pos) || *enc->pos == '-' || *enc->pos == '(' || peek_word(enc, "true") || peek_word(enc, "false")) {
+      arg = parse_literal(enc);
+    } else {
+      arg = parse_type(enc, true);
+    }
+    if (arg == NULL || !enc->valid) {
+      enc->valid = false;
+      return NULL;
+    }
+    *tail = arg;
+    tail = &arg->next;
+    skip_spaces(enc);
+  }
+  if (head == NULL)
+    enc->valid = false;   /* "<>" is not supported */
+  enc->ambiguous = true;  /* the arguments may be a pack (J...E) */
+  return head;
+}
+
+/** find_operator() - looks up an operator name (the text after "operator")
+ *  in the table; returns the length of the name or 0. The index is of the
+ *  first matching entry; the arity is resolved later.
+ */
+static size_t find_operator(const char *text, int *index)
+{
+  size_t best = 0;
+  for (size_t i = 1; i < sizearray(operators); i++) {
+    if (strlen(operators[i].abbrev) != 2)
+      break;    /* the remainder is for <expression> context */
+    size_t len = strlen(operators[i].name);
+    if (len > best && strncmp(text, operators[i].name, len) == 0
+        && !(is_ident(operators[i].name[len - 1]) && is_ident(text[len]))) {
+      best = len;
+      *index = (int)i;
+    }
+  }
+  return best;
+}
+
+static struct node *parse_component(struct encoder *enc, const struct node *previous)
+{
+  struct node *comp = new_node(enc, NODE_COMPONENT);
+  if (comp == NULL)
+    return NULL;
+  skip_spaces(enc);
+  if (match(enc, "~")) {
+    comp->special = COMP_DTOR;
+  } else if (match_word(enc, "operator")) {
+    skip_spaces(enc);
+    int index;
+    size_t len = find_operator(enc->pos, &index);
+    if (len > 0) {
+      comp->special = COMP_OPERATOR;
+      comp->opindex = index;
+      comp->text = enc->pos;
+      comp->length = len;
+      enc->pos += len;
+      /* template arguments: "operator-<42>", "operator<< <T>" */
+      if ((*enc->pos == '<' && comp->text[len - 1] != '<') || (enc->pos[0] == ' ' && enc->pos[1] == '<')) {
+        enc->pos = strchr(enc->pos, '<') + 1;
+        comp->args = parse_template_args(enc);
+      }
+    } else {
+      comp->special = COMP_CONVERSION;
+      comp->type = parse_type(enc, false);
+      if (comp->type == NULL)
+        enc->valid = false;
+    }
+    return comp;
+  }
+  const char *start = enc->pos;
+  while (is_ident(*enc->pos))
+    enc->pos++;
+  if (enc->pos == start || is_digit(*start)) {
+    enc->valid = false;
+    return NULL;
+  }
+  comp->text = start;
+  comp->length = enc->pos - start;
+  if (comp->special == COMP_DTOR) {
+    if (previous == NULL || previous->length != comp->length || strncmp(previous->text, start, comp->length) != 0)
+      enc->valid = false;
+  } else if (previous != NULL && previous->special != COMP_ABBREVIATION
+             && previous->length == comp->length && strncmp(previous->text, start, comp->length) == 0) {
+    comp->special = COMP_CTOR;
+  }
+  /* [abi:tag] is kept as part of the text, and split on encoding */
+  while (strncmp(enc->pos, "[abi:", 5) == 0) {
+    const char *end = strchr(enc->pos, ']');
+    if (end == NULL) {
+      enc->valid = false;
+      return NULL;
+    }
+    enc->pos = end + 1;
+    comp->length = enc->pos - start;
+  }
+  if (comp->special != COMP_CTOR && comp->special != COMP_DTOR && *enc->pos == '<') {
+    enc->pos++;
+    comp->args = parse_template_args(enc);
+  }
+  return comp;
+}
+
+/** parse_name() - parses a qualified name; it stops before a "::*" (of a
+ *  pointer to member).
+ */
+static struct node *parse_name(struct encoder *enc)
+{
+  struct node *name = new_node(enc, NODE_NAME);
+  if (!enter_level(enc) || name == NULL) {
+    enc->valid = false;
+    leave_level(enc);
+    return NULL;
+  }
+  skip_spaces(enc);
+  match(enc, "::");
+  struct node **tail = &name->child;
+  struct node *previous = NULL;
+  for (;;) {
+    struct node *comp = parse_component(enc, previous);
+    if (comp == NULL || !enc->valid)
+      break;
+    *tail = comp;
+    tail = &comp->next;
+    if (comp->special != COMP_PLAIN && comp->special != COMP_CTOR)
+      break;    /* operators, destructors, conversions are the last component */
+    if (strncmp(enc->pos, "::", 2) != 0 || enc->pos[2] == '*')
+      break;
+    enc->pos += 2;
+    previous = comp;
+  }
+  leave_level(enc);
+
+  /* replace std::string and the like by their abbreviation */
+  struct node *first = name->child;
+  if (enc->valid && first != NULL && first->length == 3 && strncmp(first->text, "std", 3) == 0 && first->args == NULL) {
+    struct node *second = first->next;
+    for (size_t i = 1; second != NULL && second->special == COMP_PLAIN && i < sizearray(abbreviations); i++) {
+      const char *abbr = abbreviations[i].name + 5;   /* skip "std::" */
+      if (strlen(abbr) == second->length && strncmp(abbr, second->text, second->length) == 0
+          && (second->args == NULL || i <= 2)) {
+        /* std::allocator and std::basic_string take template arguments, the
+           others are complete types */
+        second->special = COMP_ABBREVIATION;
+        second->text = abbreviations[i].abbrev;
+        second->length = 2;
+        name->child = second;
+        break;
+      }
+    }
+    if (name->child == first && first->next != NULL) {
+      first->special = COMP_ABBREVIATION;
+      first->text = "St";
+      first->length = 2;
+    }
+  }
+  return name;
+}
+
+/** is_inner_declarator() - checks whether a '(' starts a nested abstract
+ *  declarator, as in "int(*)[4]" or "void (A::*)()", rather than a parameter
+ *  list.
+ */
+static bool is_inner_declarator(const char *p)
+{
+  while (*p == ' ')
+    p++;
+  if (*p == '*' || *p == '&' || *p == '(')
+    return true;
+  int depth = 0;
+  for (; *p != '\0'; p++) {
+    if (*p == '<')
+      depth++;
+    else if (*p == '>')
+      depth--;
+    else if (depth == 0 && (*p == '(' || *p == ')' || *p == ','))
+      return false;
+    else if (depth == 0 && strncmp(p, "::*", 3) == 0)
+      return true;
+  }
+  return false;
+}
+
+static struct node *wrap(struct encoder *enc, int kind, struct node *child)
+{
+  struct node *node = new_node(enc, kind);
+  if (node != NULL)
+    node->child = child;
+  return node;
+}
+
+static struct node *qualify(struct encoder *enc, struct node *child, unsigned quals)
+{
+  if (child != NULL && child->kind == NODE_QUALIFIED) {
+    child->quals |= quals;
+    return child;
+  }
+  struct node *node = wrap(enc, NODE_QUALIFIED, child);
+  if (node != NULL)
+    node->quals = quals;
+  return node;
+}
+
+static unsigned parse_cv(struct encoder *enc)
+{
+  unsigned quals = 0;
+  for (;;) {
+    const char *mark = enc->pos;
+    skip_spaces(enc);
+    if (match_word(enc, "const"))
+      quals |= QUAL_CONST;
+    else if (match_word(enc, "volatile"))
+      quals |= QUAL_VOLATILE;
+    else if (match_word(enc, "restrict"))
+      quals |= QUAL_RESTRICT;
+    else {
+      enc->pos = mark;
+      return quals;
+    }
+  }
+}
+
+static struct node *parse_params(struct encoder *enc)
+{
+  /* '(' [type (',' type)*] ')'; the '(' is already matched */
+  struct node *head = NULL, **tail = &head;
+  skip_spaces(enc);
+  while (enc->valid && !match(enc, ")")) {
+    if (head != NULL)
+      expect(enc, ",");
+    skip_spaces(enc);
+    struct node *param;
+    if (match(enc, "...")) {
+      param = new_node(enc, NODE_BUILTIN);
+      if (param != NULL) {
+        param->text = "z";
+        param->length = 1;
+      }
+    } else {
+      param = parse_type(enc, true);
+    }
+    if (param == NULL || !enc->valid) {
+      enc->valid = false;
+      return NULL;
+    }
+    *tail = param;
+    tail = &param->next;
+    skip_spaces(enc);
+  }
+  return head;
+}
+
+/** parse_declarator() - parses an abstract declarator (pointers, references,
+ *  array and function suffixes, with nesting in parentheses) that applies to
+ *  the type "base".
+ */
+static struct node *parse_declarator(struct encoder *enc, struct node *base, bool suffixes)
+{
+  struct node *type = base;
+  if (!enter_level(enc)) {
+    leave_level(enc);
+    return NULL;
+  }
+  /* prefix operators bind to the base type first */
+  for (;;) {
+    unsigned quals = parse_cv(enc);
+    if (quals != 0)
+      type = qualify(enc, type, quals);
+    skip_spaces(enc);
+    if (match(enc, "&&")) {
+      type = wrap(enc, NODE_RREF, type);
+    } else if (match(enc, "&")) {
+      type = wrap(enc, NODE_LREF, type);
+    } else if (match(enc, "*")) {
+      type = wrap(enc, NODE_POINTER, type);
+    } else if (is_ident(*enc->pos) && is_inner_declarator(enc->pos)) {
+      /* Class::* */
+      struct node *member = wrap(enc, NODE_MEMBER, type);
+      if (member != NULL)
+        member->type = parse_name(enc);
+      expect(enc, "::*");
+      type = member;
+    } else {
+      break;
+    }
+    if (type == NULL || !enc->valid)
+      break;
+  }
+
+  if (suffixes && enc->valid) {
+    const char *inner = NULL;
+    skip_spaces(enc);
+    if (*enc->pos == '(' && is_inner_declarator(enc->pos + 1)) {
+      /* skip the nested declarator, it applies after the suffixes */
+      inner = ++enc->pos;
+      int depth = 1;
+      while (*enc->pos != '\0' && depth > 0) {
+        if (*enc->pos == '(')
+          depth++;
+        else if (*enc->pos == ')')
+          depth--;
+        enc->pos++;
+      }
+      if (depth != 0)
+        enc->valid = false;
+    }
+    /* suffixes apply right to left: int[2][3] is an array of 2 arrays of 3 */
+    struct node *list[16];
+    int count = 0;
+    for (;;) {
+      skip_spaces(enc);
+      if (*enc->pos != '[' && *enc->pos != '(')
+        break;
+      if (count >= (int)sizearray(list) || !enc->valid) {
+        enc->valid = false;
+        break;
+      }
+      struct node *suffix;
+      if (match(enc, "[")) {
+        suffix = new_node(enc, NODE_ARRAY);
+        if (suffix == NULL)
+          break;
+        suffix->text = enc->pos;
+        while (is_digit(*enc->pos))
+          enc->pos++;
+        suffix->length = enc->pos - suffix->text;
+        expect(enc, "]");
+      } else {
+        enc->pos++;
+        suffix = new_node(enc, NODE_FUNCTION);
+        if (suffix == NULL)
+          break;
+        suffix->args = parse_params(enc);
+        suffix->quals = parse_cv(enc);
+        skip_spaces(enc);
+        if (match(enc, "&&"))
+          suffix->ref = 'O';
+        else if (match(enc, "&"))
+          suffix->ref = 'R';
+      }
+      list[count++] = suffix;
+    }
+    while (count > 0 && enc->valid) {
+      struct node *suffix = list[--count];
+      suffix->child = type;
+      type = suffix;
+      if (suffix->kind == NODE_FUNCTION && suffix->quals != 0) {
+        /* "void() const" is a cv-qualified function type */
+        type = qualify(enc, NULL, suffix->quals);
+        if (type != NULL)
+          type->child = suffix;
+        suffix->quals = 0;
+      }
+    }
+    if (inner != NULL && enc->valid) {
+      const char *end = enc->pos;
+      enc->pos = inner;
+      type = parse_declarator(enc, type, true);
+      expect(enc, ")");
+      enc->pos = end;
+    }
+  }
+  leave_level(enc);
+  return enc->valid ? type : NULL;
+}
+
+static struct node *parse_type(struct encoder *enc, bool suffixes)
+{
+  skip_spaces(enc);
+  unsigned quals = parse_cv(enc);   /* prefix form "const int" */
+  skip_spaces(enc);
+  struct node *base = parse_builtin(enc);
+  if (base == NULL)
+    base = parse_name(enc);
+  if (base == NULL || !enc->valid)
+    return NULL;
+  if (base->kind == NODE_NAME) {
+    /* a name of a type must not end in a special component */
+    const struct node *comp = base->child;
+    while (comp->next != NULL)
+      comp = comp->next;
+    if (comp->special != COMP_PLAIN && comp->special != COMP_ABBREVIATION)
+      enc->valid = false;
+  }
+  if (quals != 0)
+    base = qualify(enc, base, quals);
+  return parse_declarator(enc, base, suffixes);
+}
+
+/* ----- encoding */
+
+static long find_substitution(const struct encoder *enc, const char *key)
+{
+  for (size_t i = 0; i < enc->nsubs; i++)
+    if (strcmp(enc->keys.text + enc->subs[i], key) == 0)
+      return (long)i;
+  return -1;
+}
+
+static void add_substitution(struct encoder *enc, const char *key)
+{
+  if (enc->nsubs >= enc->maxsubs) {
+    size_t max = (enc->maxsubs > 0) ? 2 * enc->maxsubs : 32;
+    size_t *p = realloc(enc->subs, max * sizeof(size_t));
+    if (p == NULL) {
+      enc->nomemory = true;
+      enc->valid = false;
+      return;
+    }
+    enc->subs = p;
+    enc->maxsubs = max;
+  }
+  size_t offset = enc->keys.length;
+  sb_append(enc, &enc->keys, key, strlen(key) + 1);
+  enc->subs[enc->nsubs++] = offset;
+}
+
+static void encode_substitution(struct encoder *enc, struct strbuf *out, long index)
+{
+  /* S_, S0_, S1_, ... S9_, SA_, ... SZ_, S10_, ... */
+  char field[16];
+  int pos = sizeof field - 1;
+  field[pos] = '\0';
+  field[--pos] = '_';
+  if (index > 0) {
+    index -= 1;
+    do {
+      int digit = index % 36;
+      field[--pos] = (char)(digit < 10 ? '0' + digit : 'A' + digit - 10);
+      index /= 36;
+    } while (index > 0);
+  }
+  field[--pos] = 'S';
+  sb_puts(enc, out, field + pos);
+}
+
+/** try_substitution() - when "subst" is set and the key is in the table,
+ *  writes the substitution and returns true.
+ */
+static bool try_substitution(struct encoder *enc, const char *key, struct strbuf *out, bool subst)
+{
+  if (!subst)
+    return false;
+  long index = find_substitution(enc, key);
+  if (index < 0)
+    return false;
+  encode_substitution(enc, out, index);
+  return true;
+}
+
+static void free_key(struct strbuf *key)
+{
+  free(key->text);
+}
+
+/** make_key() - the encoding of a type without substitutions, which is what
+ *  identifies it in the substitution table.
+ */
+static void make_key(struct encoder *enc, const struct node *node, struct strbuf *key)
+{
+  key->text = NULL;
+  key->length = key->size = 0;
+  sb_puts(enc, key, "");
+  if (node->kind == NODE_NAME)
+    encode_prefix(enc, node, key);  /* same form as the prefixes of a nested name */
+  else
+    encode_type(enc, node, key, false);
+}
+
+static void encode_source_name(struct encoder *enc, const struct node *comp, struct strbuf *out)
+{
+  /* an identifier with ABI tags: "f[abi:cxx11]" -> 1fB5cxx11 */
+  const char *tag = memchr(comp->text, '[', comp->length);
+  size_t len = (tag != NULL) ? (size_t)(tag - comp->text) : comp->length;
+  sb_number(enc, out, len);
+  sb_append(enc, out, comp->text, len);
+  while (tag != NULL && tag < comp->text + comp->length) {
+    const char *end = memchr(tag, ']', comp->text + comp->length - tag);
+    assert(end != NULL);
+    sb_puts(enc, out, "B");
+    sb_number(enc, out, end - (tag + 5));
+    sb_append(enc, out, tag + 5, end - (tag + 5));
+    tag = end + 1;
+  }
+}
+
+static void encode_template_args(struct encoder *enc, const struct node *arg, struct strbuf *out, bool subst)
+{
+  sb_puts(enc, out, "I");
+  for (; arg != NULL && enc->valid; arg = arg->next) {
+    if (arg->kind == NODE_LITERAL) {
+      sb_puts(enc, out, "L");
+      encode_type(enc, arg->type, out, subst);
+      if (arg->text[0] == '-') {
+        sb_puts(enc, out, "n");
+        sb_append(enc, out, arg->text + 1, arg->length - 1);
+      } else {
+        sb_append(enc, out, arg->text, arg->length);
+      }
+      sb_puts(enc, out, "E");
+    } else {
+      encode_type(enc, arg, out, subst);
+    }
+  }
+  sb_puts(enc, out, "E");
+}
+
+static int count_list(const struct node *node)
+{
+  int count = 0;
+  for (; node != NULL; node = node->next)
+    count++;
+  return count;
+}
+
+/** find_arity() - returns the index of the operator with the given name and
+ *  number of operands, or -1.
+ */
+static int find_arity(const char *name, int operands)
+{
+  for (size_t i = 1; i < sizearray(operators) && strlen(operators[i].abbrev) == 2; i++)
+    if (strcmp(operators[i].name, name) == 0 && operators[i].operands == operands)
+      return (int)i;
+  return -1;
+}
+
+/** resolve_operator() - chooses between the unary and binary form of an
+ *  operator ("-" is "ng" or "mi"), from the number of parameters. A member
+ *  function has the object as an extra operand, but a qualified name may also
+ *  be in a namespace: only a member of a class template, a function with cv-
+ *  or ref-qualifiers, or a function without parameters is certainly a member. With two parameters, the operator is
+ *  binary in either case. Returns -1 if the name can be either form.
+ */
+static int resolve_operator(int index, int params, bool qualified, bool member)
+{
+  const char *name = operators[index].name;
+  int found;
+  if (params >= 2 || !qualified)
+    found = find_arity(name, params);
+  else if (member || params == 0)
+    found = find_arity(name, params + 1);
+  else if (find_arity(name, 1) >= 0 && find_arity(name, 2) >= 0)
+    return -1;
+  else
+    return index;
+  return (found >= 0) ? found : index;
+}
+
+static void encode_component(struct encoder *enc, const struct node *comp, struct strbuf *out, bool subst)
+{
+  switch (comp->special) {
+  case COMP_PLAIN:
+    encode_source_name(enc, comp, out);
+    break;
+  case COMP_CTOR:
+    sb_puts(enc, out, "C1");
+    break;
+  case COMP_DTOR:
+    sb_puts(enc, out, "D1");
+    break;
+  case COMP_OPERATOR:
+    sb_puts(enc, out, operators[comp->opindex].abbrev);
+    break;
+  case COMP_CONVERSION:
+    sb_puts(enc, out, "cv");
+    encode_type(enc, comp->type, out, subst);
+    break;
+  case COMP_ABBREVIATION:
+    sb_append(enc, out, comp->text, comp->length);
+    break;
+  }
+}
+
+/** encode_prefix() - encodes the components of a name without substitutions
+ *  and without the N...E of a nested name; this is the key of a name.
+ */
+static void encode_prefix(struct encoder *enc, const struct node *name, struct strbuf *out)
+{
+  for (const struct node *comp = name->child; comp != NULL && enc->valid; comp = comp->next) {
+    encode_component(enc, comp, out, false);
+    if (comp->args != NULL)
+      encode_template_args(enc, comp->args, out, false);
+  }
+}
+
+/** encode_name() - encodes a (qualified) name. For the name of the symbol
+ *  ("entity" is true), the full name is not a substitution candidate, and it
+ *  may carry cv- and ref-qualifiers (of a member function). For a type, the
+ *  caller handles the substitution of the full name.
+ *
+ *  The candidates are the successive prefixes: each component, and each
+ *  component with its template arguments. When an earlier prefix is in the
+ *  substitution table, it replaces the components that it covers.
+ */
+static void encode_name(struct encoder *enc, const struct node *name, struct strbuf *out, bool subst,
+                        bool entity, unsigned quals, char ref)
+{
+  if (!enter_level(enc)) {
+    leave_level(enc);
+    return;
+  }
+  /* collect the components, and the keys of all prefixes; piece 2*i is
+     component i without template arguments, piece 2*i+1 is with them */
+  const struct node *comps[64];
+  int count = 0;
+  for (const struct node *comp = name->child; comp != NULL; comp = comp->next) {
+    if (count >= (int)sizearray(comps)) {
+      enc->valid = false;
+      leave_level(enc);
+      return;
+    }
+    comps[count++] = comp;
+  }
+  /* a name is nested if it has more than one component, where "St" does not
+     count for a single component that follows it; cv-qualifiers also force
+     a nested name */
+  bool std_prefix = comps[0]->special == COMP_ABBREVIATION && strcmp(comps[0]->text, "St") == 0;
+  bool nested = count > (std_prefix ? 2 : 1) || quals != 0 || ref != '\0';
+
+  /* build the keys of the prefixes */
+  struct strbuf prefix = { NULL, 0, 0 };
+  sb_puts(enc, &prefix, "");
+  size_t offsets[2 * 64];
+  bool candidate[2 * 64];
+  int pieces = 0;
+  for (int i = 0; i < count && enc->valid; i++) {
+    encode_component(enc, comps[i], &prefix, false);
+    offsets[pieces] = prefix.length;
+    /* "St" alone and the abbreviations are not candidates, nor are operators
+       (unless they are templates), nor is the last
+       component of the symbol (or of a type, which the caller adds) */
+    candidate[pieces] = comps[i]->special != COMP_ABBREVIATION && comps[i]->special != COMP_CTOR
+                        && comps[i]->special != COMP_DTOR && comps[i]->special != COMP_CONVERSION
+                        && (comps[i]->special != COMP_OPERATOR || comps[i]->args != NULL)
+                        && (i < count - 1 || comps[i]->args != NULL);
+    pieces++;
+    if (comps[i]->args != NULL) {
+      encode_template_args(enc, comps[i]->args, &prefix, false);
+      offsets[pieces] = prefix.length;
+      candidate[pieces] = i < count - 1;
+      pieces++;
+    }
+  }
+  if (!enc->valid) {
+    free(prefix.text);
+    leave_level(enc);
+    return;
+  }
+
+  /* find the longest prefix that can be substituted */
+  int start = 0;      /* first piece to encode */
+  long index = -1;
+  if (subst) {
+    for (int p = pieces - 1; p >= 0 && index < 0; p--) {
+      if (!candidate[p])
+        continue;
+      char save = prefix.text[offsets[p]];
+      prefix.text[offsets[p]] = '\0';
+      index = find_substitution(enc, prefix.text);
+      prefix.text[offsets[p]] = save;
+      if (index >= 0)
+        start = p + 1;
+    }
+  }
+  if (nested) {
+    sb_puts(enc, out, "N");
+    if (quals & QUAL_RESTRICT)
+      sb_puts(enc, out, "r");
+    if (quals & QUAL_VOLATILE)
+      sb_puts(enc, out, "V");
+    if (quals & QUAL_CONST)
+      sb_puts(enc, out, "K");
+    if (ref != '\0')
+      sb_append(enc, out, &ref, 1);
+  }
+  if (index >= 0)
+    encode_substitution(enc, out, index);
+
+  /* encode the remaining pieces, with substitutions inside template
+     arguments, and add the new prefixes as candidates */
+  int piece = 0;
+  for (int i = 0; i < count && enc->valid; i++) {
+    if (piece >= start)
+      encode_component(enc, comps[i], out, subst);
+    if (piece >= start && subst && candidate[piece]) {
+      char save = prefix.text[offsets[piece]];
+      prefix.text[offsets[piece]] = '\0';
+      add_substitution(enc, prefix.text);
+      prefix.text[offsets[piece]] = save;
+    }
+    piece++;
+    if (comps[i]->args != NULL) {
+      if (piece >= start)
+        encode_template_args(enc, comps[i]->args, out, subst);
+      if (piece >= start && subst && candidate[piece]) {
+        char save = prefix.text[offsets[piece]];
+        prefix.text[offsets[piece]] = '\0';
+        add_substitution(enc, prefix.text);
+        prefix.text[offsets[piece]] = save;
+      }
+      piece++;
+    }
+  }
+  if (nested)
+    sb_puts(enc, out, "E");
+  free(prefix.text);
+  leave_level(enc);
+}
+
+static void encode_function(struct encoder *enc, const struct node *node, struct strbuf *out, bool subst)
+{
+  /* F [Y] <return type> <parameters> [<ref-qualifier>] E */
+  sb_puts(enc, out, "F");
+  encode_type(enc, node->child, out, subst);
+  if (node->args == NULL)
+    sb_puts(enc, out, "v");
+  for (const struct node *param = node->args; param != NULL && enc->valid; param = param->next)
+    encode_type(enc, param, out, subst);
+  if (node->ref != '\0')
+    sb_append(enc, out, &node->ref, 1);
+  sb_puts(enc, out, "E");
+}
+
+/** encode_template_param() - in the signature of a function template, a type
+ *  that is equal to one of the template arguments is encoded as a reference
+ *  to the template parameter (T_, T0_, ...). This is a guess: the declaration
+ *  may have used the type itself, but template parameters are far more
+ *  common. Returns true if the type was encoded.
+ */
+static bool encode_template_param(struct encoder *enc, const struct node *node, struct strbuf *out, bool subst)
+{
+  int ntparams = enc->ntparams;
+  struct strbuf key;
+  enc->ntparams = 0;    /* compare the plain encodings */
+  make_key(enc, node, &key);
+  enc->ntparams = ntparams;
+  int index = -1;
+  for (int i = 0; i < ntparams && index < 0 && enc->valid; i++)
+    if (enc->tkeys[i] != NULL && strcmp(enc->tkeys[i], key.text) == 0)
+      index = i;
+  free_key(&key);
+  if (index < 0)
+    return false;
+  char field[24];
+  if (index == 0)
+    strcpy(field, "T_");
+  else
+    sprintf(field, "T%d_", index - 1);
+  if (!try_substitution(enc, field, out, subst)) {
+    sb_puts(enc, out, field);
+    if (subst)
+      add_substitution(enc, field);
+  }
+  return true;
+}
+
+/** encode_type() - encodes a type; with "subst" set, it uses and adds
+ *  substitutions, otherwise it produces the key of the type.
+ */
+static void encode_type(struct encoder *enc, const struct node *node, struct strbuf *out, bool subst)
+{
+  if (!enter_level(enc) || node == NULL) {
+    enc->valid = false;
+    leave_level(enc);
+    return;
+  }
+  if (enc->ntparams > 0 && encode_template_param(enc, node, out, subst)) {
+    leave_level(enc);
+    return;
+  }
+  if (node->kind == NODE_BUILTIN) {
+    sb_append(enc, out, node->text, node->length);  /* never substituted */
+    leave_level(enc);
+    return;
+  }
+  if (node->kind == NODE_NAME && node->child->next == NULL && node->child->special == COMP_ABBREVIATION
+      && node->child->args == NULL) {
+    sb_append(enc, out, node->child->text, node->child->length);  /* "Ss", not a candidate */
+    leave_level(enc);
+    return;
+  }
+
+  struct strbuf key = { NULL, 0, 0 };
+  if (subst) {
+    make_key(enc, node, &key);
+    if (enc->valid && try_substitution(enc, key.text, out, subst)) {
+      free_key(&key);
+      leave_level(enc);
+      return;
+    }
+  }
+  switch (node->kind) {
+  case NODE_NAME:
+    encode_name(enc, node, out, subst, false, 0, '\0');
+    break;
+  case NODE_QUALIFIED:
+    if (node->quals & QUAL_RESTRICT)
+      sb_puts(enc, out, "r");
+    if (node->quals & QUAL_VOLATILE)
+      sb_puts(enc, out, "V");
+    if (node->quals & QUAL_CONST)
+      sb_puts(enc, out, "K");
+    encode_type(enc, node->child, out, subst);
+    break;
+  case NODE_POINTER:
+    sb_puts(enc, out, "P");
+    encode_type(enc, node->child, out, subst);
+    break;
+  case NODE_LREF:
+    sb_puts(enc, out, "R");
+    encode_type(enc, node->child, out, subst);
+    break;
+  case NODE_RREF:
+    sb_puts(enc, out, "O");
+    encode_type(enc, node->child, out, subst);
+    break;
+  case NODE_ARRAY:
+    sb_puts(enc, out, "A");
+    sb_append(enc, out, node->text, node->length);
+    sb_puts(enc, out, "_");
+    encode_type(enc, node->child, out, subst);
+    break;
+  case NODE_FUNCTION:
+    encode_function(enc, node, out, subst);
+    break;
+  case NODE_MEMBER:
+    sb_puts(enc, out, "M");
+    encode_type(enc, node->type, out, subst);
+    encode_type(enc, node->child, out, subst);
+    break;
+  default:
+    enc->valid = false;
+  }
+  if (subst && enc->valid)
+    add_substitution(enc, key.text);
+  free_key(&key);
+  leave_level(enc);
+}
+
+/** mangle() - encodes a plain C++ name, in the format that demangle()
+ *  produces, into a mangled name. Examples of input:
+ *
+ *      ns::Class<int>::method(char const*) const
+ *      operator<<(std::ostream&,std::string const&)
+ *      std::state
+ *      void swap<Foo>(Foo&,Foo&)
+ *      vtable for ns::Class
+ *
+ *  Returns DEMANGLE_OK on success, DEMANGLE_AMBIGUOUS if the plain name
+ *  allows more than one encoding (the most likely one is in "mangled", see the
+ *  top of this file), DEMANGLE_INVALID if the name cannot be parsed or is not
+ *  supported, DEMANGLE_OVERFLOW if the output buffer is too small, and
+ *  DEMANGLE_NOSCRATCH if memory allocation fails.
+ */
+int mangle(char *mangled, size_t size, const char *plain)
+{
+  assert(mangled != NULL && size > 0);
+  assert(plain != NULL);
+  *mangled = '\0';
+
+  struct encoder enc;
+  memset(&enc, 0, sizeof enc);
+  enc.pos = plain;
+  enc.valid = true;
+  enc.max = 3 * strlen(plain) + 16;
+  enc.nodes = malloc(enc.max * sizeof(struct node));
+  if (enc.nodes == NULL)
+    return DEMANGLE_NOSCRATCH;
+
+  struct strbuf out = { NULL, 0, 0 };
+  sb_puts(&enc, &out, "_Z");
+  static const struct stringpair specials[] = {
+    { "TV", "vtable for " },
+    { "TT", "VTT for " },
+    { "TS", "typeinfo name for " },
+    { "TI", "typeinfo for " },
+  };
+  bool special = false;
+  for (size_t i = 0; i < sizearray(specials) && !special; i++) {
+    if (match(&enc, specials[i].name)) {
+      sb_puts(&enc, &out, specials[i].abbrev);
+      struct node *type = parse_type(&enc, true);
+      if (type != NULL)
+        encode_type(&enc, type, &out, true);
+      special = true;
+    }
+  }
+  if (!special) {
+    const char *mark = enc.pos;
+    struct node *name = parse_name(&enc);
+    struct node *rettype = NULL;
+    if (name != NULL && enc.valid && *enc.pos != '(' && *enc.pos != '\0') {
+      /* the signature of a function template starts with the return type */
+      enc.pos = mark;
+      rettype = parse_type(&enc, false);
+      skip_spaces(&enc);
+      name = parse_name(&enc);
+    }
+    struct node *last = NULL;
+    if (name != NULL && enc.valid) {
+      last = name->child;
+      while (last->next != NULL)
+        last = last->next;
+    }
+    struct node *function = NULL;
+    if (last != NULL && match(&enc, "(")) {
+      function = new_node(&enc, NODE_FUNCTION);
+      if (function != NULL) {
+        function->args = parse_params(&enc);
+        function->quals = parse_cv(&enc);
+        skip_spaces(&enc);
+        if (match(&enc, "&&"))
+          function->ref = 'O';
+        else if (match(&enc, "&"))
+          function->ref = 'R';
+      }
+    }
+    /* a function template has a return type, other names have none */
+    if (last != NULL && (rettype != NULL) != (function != NULL && last->args != NULL))
+      enc.valid = false;
+    if (last != NULL && enc.valid) {
+      if (last->special == COMP_OPERATOR) {
+        /* the arity of an operator follows from the parameters */
+        int params = (function != NULL) ? count_list(function->args) : 0;
+        bool qualified = name->child->next != NULL
+                         && !(name->child->special == COMP_ABBREVIATION && name->child->next == last);
+        const struct node *scope = name->child;
+        while (scope->next != NULL && scope->next != last)
+          scope = scope->next;
+        bool member = qualified && (scope->args != NULL || (function != NULL && (function->quals != 0 || function->ref != '\0')));
+        int index = resolve_operator(last->opindex, params, qualified, member);
+        if (index < 0) {
+          /* member or namespace scope: the plain name does not tell */
+          index = resolve_operator(last->opindex, params, qualified, true);
+          enc.ambiguous = true;
+        }
+        last->opindex = index;
+      }
+      if (function != NULL) {
+        encode_name(&enc, name, &out, true, true, function->quals, function->ref);
+        if (rettype != NULL) {
+          /* the types in the signature may refer to the template parameters */
+          enc.ntparams = count_list(last->args);
+          enc.tkeys = calloc(enc.ntparams, sizeof(char*));
+          if (enc.tkeys == NULL) {
+            enc.nomemory = true;
+            enc.valid = false;
+            enc.ntparams = 0;
+          }
+          int i = 0;
+          for (const struct node *arg = last->args; arg != NULL && enc.valid; arg = arg->next, i++) {
+            if (arg->kind != NODE_LITERAL) {
+              struct strbuf key;
+              int ntparams = enc.ntparams;
+              enc.ntparams = 0;
+              make_key(&enc, arg, &key);
+              enc.ntparams = ntparams;
+              enc.tkeys[i] = key.text;
+            }
+          }
+          encode_type(&enc, rettype, &out, true);
+        }
+        if (function->args == NULL)
+          sb_puts(&enc, &out, "v");
+        for (const struct node *param = function->args; param != NULL && enc.valid; param = param->next)
+          encode_type(&enc, param, &out, true);
+        if (enc.tkeys != NULL) {
+          for (int i = 0; i < enc.ntparams; i++)
+            free(enc.tkeys[i]);
+          free(enc.tkeys);
+        }
+      } else {
+        encode_name(&enc, name, &out, true, true, 0, '\0');
+      }
+    }
+  }
+  skip_spaces(&enc);
+  if (*enc.pos != '\0')
+    enc.valid = false;
+
+  int result = DEMANGLE_OK;
+  if (enc.nomemory)
+    result = DEMANGLE_NOSCRATCH;
+  else if (!enc.valid)
+    result = DEMANGLE_INVALID;
+  else if (out.length >= size)
+    result = DEMANGLE_OVERFLOW;
+  else
+    memcpy(mangled, out.text, out.length + 1);
+  if (result == DEMANGLE_OK && enc.ambiguous)
+    result = DEMANGLE_AMBIGUOUS;
+  free(out.text);
+  free(enc.keys.text);
+  free(enc.subs);
+  free(enc.nodes);
+  return result;
+}
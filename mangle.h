@@ -0,0 +1,33 @@
+/* GNU C++ symbol name demangler
+ * Encoding of plain C++ names and signatures into mangled names.
+ *
+ * Copyright 2022-2024, CompuPhase
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _MANGLE_H
+#define _MANGLE_H
+
+#include <stddef.h>
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+int mangle(char *mangled, size_t size, const char *plain);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif /* _MANGLE_H */
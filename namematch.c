@@ -0,0 +1,313 @@
+/* GNU C++ symbol name demangler
+ * Matching qualified-name patterns against mangled names.
+ *
+ * A pattern is a qualified name, in which components may be wildcards:
+ *
+ *     mylib::detail::**        everything in namespace mylib::detail
+ *     HashSet<*>::*            all members of all instances of HashSet
+ *     *::~Widget               the destructors of any class Widget
+ *     std::vector<*>::push_*   push_back() and the like
+ *
+ * "*" matches a single component, and "**" matches zero or more components.
+ * Inside an identifier, "*" matches any run of characters. A "<*>" suffix
+ * requires that the component has template arguments (a component without it
+ * matches both template instances and plain names). Operators are written as
+ * "operator+", "operator[]" and so on; a bare "operator" matches conversion
+ * operators. Template arguments cannot be matched on their contents.
+ *
+ * The pattern is evaluated on the mangled form: classify_name() walks the
+ * <source-name> lengths and the N...E nesting of the name, and skips over
+ * template arguments and parameter types without decoding them. Before that,
+ * the mangled name is checked for the presence of a literal component of the
+ * pattern (in its mangled form, "6detail"), which rejects most symbols with a
+ * single strstr().
+ *
+ * Copyright 2022-2024, CompuPhase
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "classify.h"
+#include "demangle.h"
+#include "namematch.h"
+
+#define MAX_COMPONENTS  64    /* names with more components never match */
+#define INIT_PLAIN      1024  /* initial size of the output buffer of namematch_strtab() */
+
+enum {
+  PART_NAME,            /* identifier, may contain '*' wildcards */
+  PART_DTOR,            /* "~" followed by an identifier */
+  PART_OPERATOR,        /* "operator" followed by the operator */
+  PART_ANY,             /* "*" */
+  PART_ANY_SEQ,         /* "**" */
+};
+
+struct pattern_part {
+  const char *text;     /* zero-terminated, points into namematch.buffer */
+  int kind;
+  bool templated;       /* "<*>" suffix */
+};
+
+struct namematch {
+  char *buffer;         /* copy of the pattern, split into components */
+  char needle[24];      /* mangled form of a literal component, or empty */
+  int count;
+  struct pattern_part parts[];
+};
+
+/* names that may come from an abbreviation (like "Ss" for std::string), so
+   that they do not appear in the mangled name */
+static const char *const abbreviated[] = {
+  "std", "allocator", "basic_string", "string", "istream", "ostream", "iostream"
+};
+
+static char *trim(char *text)
+{
+  while (*text == ' ')
+    text++;
+  size_t len = strlen(text);
+  while (len > 0 && text[len - 1] == ' ')
+    text[--len] = '\0';
+  return text;
+}
+
+static bool compile_part(struct pattern_part *part, char *text)
+{
+  text = trim(text);
+  part->templated = false;
+  if (strncmp(text, "operator", 8) == 0) {
+    part->kind = PART_OPERATOR;
+    part->text = trim(text + 8);
+    return true;
+  }
+  size_t len = strlen(text);
+  if (len >= 3 && strcmp(text + len - 3, "<*>") == 0) {
+    part->templated = true;
+    text[len - 3] = '\0';
+    text = trim(text);
+  }
+  if (strcmp(text, "**") == 0) {
+    part->kind = PART_ANY_SEQ;
+  } else if (strcmp(text, "*") == 0) {
+    part->kind = PART_ANY;
+  } else if (text[0] == '~') {
+    part->kind = PART_DTOR;
+    text = trim(text + 1);
+  } else {
+    part->kind = PART_NAME;
+  }
+  part->text = text;
+  if (*text == '\0' || strpbrk(text, "<>(),:~ ") != NULL)
+    return false;
+  if (part->kind == PART_ANY_SEQ && part->templated)
+    return false;
+  return true;
+}
+
+static void choose_needle(struct namematch *pattern)
+{
+  size_t best = 0;
+  pattern->needle[0] = '\0';
+  for (int i = 0; i < pattern->count; i++) {
+    const struct pattern_part *part = &pattern->parts[i];
+    if (part->kind != PART_NAME && part->kind != PART_DTOR)
+      continue;
+    size_t len = strlen(part->text);
+    if (strchr(part->text, '*') != NULL || len <= best || len + 6 > sizeof pattern->needle)
+      continue;
+    bool skip = false;
+    for (size_t a = 0; a < sizeof abbreviated / sizeof abbreviated[0] && !skip; a++)
+      skip = strcmp(part->text, abbreviated[a]) == 0;
+    if (skip)
+      continue;
+    sprintf(pattern->needle, "%u%s", (unsigned)len, part->text);
+    best = len;
+  }
+}
+
+/** namematch_compile() - compiles a pattern (see the top of this file).
+ *  Returns NULL if the pattern is invalid or on a memory allocation failure.
+ *  Free it with namematch_free().
+ */
+struct namematch *namematch_compile(const char *pattern)
+{
+  assert(pattern != NULL);
+  while (*pattern == ' ')
+    pattern++;
+  if (strncmp(pattern, "::", 2) == 0)
+    pattern += 2;   /* global scope */
+
+  int count = 1;
+  for (const char *p = strstr(pattern, "::"); p != NULL; p = strstr(p + 2, "::"))
+    count++;
+  struct namematch *match = malloc(sizeof(struct namematch) + count * sizeof(struct pattern_part));
+  if (match == NULL)
+    return NULL;
+  match->buffer = malloc(strlen(pattern) + 1);
+  if (match->buffer == NULL) {
+    free(match);
+    return NULL;
+  }
+  strcpy(match->buffer, pattern);
+  match->count = count;
+
+  char *text = match->buffer;
+  for (int i = 0; i < count; i++) {
+    char *sep = strstr(text, "::");
+    if (sep != NULL)
+      *sep = '\0';
+    if (!compile_part(&match->parts[i], text)) {
+      namematch_free(match);
+      return NULL;
+    }
+    text = (sep != NULL) ? sep + 2 : NULL;
+  }
+  choose_needle(match);
+  return match;
+}
+
+void namematch_free(struct namematch *pattern)
+{
+  if (pattern != NULL) {
+    free(pattern->buffer);
+    free(pattern);
+  }
+}
+
+/** glob() - matches a pattern with '*' wildcards against a string of the
+ *  given length (that need not be zero-terminated).
+ */
+static bool glob(const char *pattern, const char *text, size_t length)
+{
+  const char *star = NULL;
+  size_t pos = 0, restart = 0;
+  while (pos < length) {
+    if (*pattern == '*') {
+      star = ++pattern;
+      restart = pos;
+    } else if (*pattern != '\0' && *pattern == text[pos]) {
+      pattern++;
+      pos++;
+    } else if (star != NULL) {
+      pattern = star;
+      pos = ++restart;
+    } else {
+      return false;
+    }
+  }
+  while (*pattern == '*')
+    pattern++;
+  return *pattern == '\0';
+}
+
+static bool match_component(const struct pattern_part *part, const struct name_component *comp)
+{
+  if (part->templated && !comp->templated)
+    return false;
+  switch (part->kind) {
+  case PART_ANY:
+    return true;
+  case PART_NAME:
+    return (comp->kind == COMPONENT_NAME || comp->kind == COMPONENT_CTOR)
+           && glob(part->text, comp->text, comp->length);
+  case PART_DTOR:
+    return comp->kind == COMPONENT_DTOR && glob(part->text, comp->text, comp->length);
+  case PART_OPERATOR:
+    return comp->kind == COMPONENT_OPERATOR && strlen(part->text) == comp->length
+           && memcmp(part->text, comp->text, comp->length) == 0;
+  }
+  return false;
+}
+
+static bool match_parts(const struct pattern_part *part, int nparts,
+                        const struct name_component *comp, int ncomps)
+{
+  while (nparts > 0) {
+    if (part->kind == PART_ANY_SEQ) {
+      while (nparts > 1 && (part + 1)->kind == PART_ANY_SEQ) {
+        part++;   /* "**::**" is the same as "**" */
+        nparts--;
+      }
+      for (int skip = 0; skip <= ncomps; skip++)
+        if (match_parts(part + 1, nparts - 1, comp + skip, ncomps - skip))
+          return true;
+      return false;
+    }
+    if (ncomps == 0 || !match_component(part, comp))
+      return false;
+    part++;
+    nparts--;
+    comp++;
+    ncomps--;
+  }
+  return ncomps == 0;
+}
+
+/** namematch() - returns true if the mangled name refers to an entity whose
+ *  qualified name matches the pattern. Names that are not mangled (C symbols)
+ *  never match.
+ */
+bool namematch(const struct namematch *pattern, const char *mangled)
+{
+  assert(pattern != NULL);
+  assert(mangled != NULL);
+  if (mangled[0] != '_' || mangled[1] != 'Z')
+    return false;
+  if (pattern->needle[0] != '\0' && strstr(mangled + 2, pattern->needle) == NULL)
+    return false;
+  struct name_component components[MAX_COMPONENTS];
+  int count = classify_name(mangled, components, MAX_COMPONENTS);
+  if (count < 0 || count > MAX_COMPONENTS)
+    return false;
+  return match_parts(pattern->parts, pattern->count, components, count);
+}
+
+/** namematch_strtab() - runs over all names in a string table (a block of
+ *  zero-terminated strings, such as the .strtab section of an ELF file), and
+ *  calls the callback with the mangled and demangled forms of the names that
+ *  match the pattern. Only these names are demangled. Returns the number of
+ *  names passed to the callback.
+ */
+size_t namematch_strtab(const struct namematch *pattern, const char *strtab, size_t size,
+                        void (*callback)(const char *mangled, const char *plain, void *arg),
+                        void *arg)
+{
+  assert(pattern != NULL);
+  assert(strtab != NULL || size == 0);
+  assert(callback != NULL);
+  char local[INIT_PLAIN];
+  char *plain = local;
+  size_t plainsize = sizeof local;
+  size_t matches = 0;
+  const char *end = strtab + size;
+  const char *p = strtab;
+  while (p < end) {
+    const char *next = memchr(p, '\0', end - p);
+    if (next == NULL)
+      break;    /* last string is not terminated, ignore it */
+    if (namematch(pattern, p)) {
+      /* an entry that cannot be demangled within DEMANGLE_MAX_PLAIN is skipped */
+      if (demangle_grow(&plain, &plainsize, local, p, next - p) == DEMANGLE_OK) {
+        callback(p, plain, arg);
+        matches++;
+      }
+    }
+    p = next + 1;
+  }
+  if (plain != local)
+    free(plain);
+  return matches;
+}
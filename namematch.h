@@ -0,0 +1,41 @@
+/* GNU C++ symbol name demangler
+ * Matching qualified-name patterns against mangled names.
+ *
+ * Copyright 2022-2024, CompuPhase
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _NAMEMATCH_H
+#define _NAMEMATCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+struct namematch;
+
+struct namematch *namematch_compile(const char *pattern);
+void namematch_free(struct namematch *pattern);
+bool namematch(const struct namematch *pattern, const char *mangled);
+size_t namematch_strtab(const struct namematch *pattern, const char *strtab, size_t size,
+                        void (*callback)(const char *mangled, const char *plain, void *arg),
+                        void *arg);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif /* _NAMEMATCH_H */
@@ -0,0 +1,578 @@
+/* GNU C++ symbol name demangler
+ * Sorted, front-coded store of demangled names.
+ *
+ * The builder collects demangled names, and writes them to a file in sorted
+ * order, without duplicates. Sorted demangled names share long prefixes
+ * ("std::__detail::_Hashtable<...", "llvm::DenseMapBase<..."), so each name
+ * is stored as the length of the prefix that it shares with the name before
+ * it, plus the remaining text ("front coding"). The names are grouped in
+ * blocks of NAMESTORE_BLOCK names; the first name of each block is stored in
+ * full, so that a block can be decoded on its own.
+ *
+ * A name is looked up with a binary search on the first names of the blocks
+ * (which are read in place, without decoding), followed by a scan of a
+ * single block. The id of a name is its position in the sorted order; a name
+ * is fetched by its id by decoding the block up to it. namestore_prefix()
+ * iterates over all names that start with a given text.
+ *
+ * The file is a header followed by the block index and the block data (in
+ * the byte order of the machine that wrote it). It is used in place, like the
+ * file of symindex.c: namestore_open() maps it into memory.
+ *
+ *     header
+ *     uint64_t block_index[blocks + 1]   offsets in block_data
+ *     block_data[]                       per block: the first name
+ *                                        (zero-terminated), then for each
+ *                                        further name: varint shared length,
+ *                                        varint suffix length, suffix
+ *
+ * Copyright 2022-2024, CompuPhase
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined __unix__ || defined __APPLE__
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+# define HAVE_MMAP
+#endif
+#include "demangle.h"
+#include "namestore.h"
+
+#define NAMESTORE_MAGIC   "NSTO"
+#define NAMESTORE_VERSION 1
+#define INIT_PLAIN        1024  /* size of the buffers on the stack */
+
+struct namestore_header {
+  char magic[4];
+  uint32_t version;
+  uint32_t blocksize;   /* names per block */
+  uint32_t maxlength;   /* length of the longest name */
+  uint64_t count;       /* number of names */
+  uint64_t blocks;
+  uint64_t block_index; /* file offsets of the sections */
+  uint64_t block_data;
+  uint64_t size;        /* total file size */
+};
+
+struct namestore_builder {
+  char *text;           /* all names, zero-terminated */
+  size_t size, capacity;
+  uint64_t *offsets;
+  size_t count, max;
+};
+
+struct namestore {
+  const unsigned char *data;
+  size_t size;
+  bool mapped;          /* data is mapped from a file (rather than attached) */
+  const struct namestore_header *header;
+  const uint64_t *block_index;
+  const unsigned char *block_data;
+};
+
+/* position in the store while decoding */
+struct cursor {
+  uint64_t id;
+  const unsigned char *pos, *end;
+  char *name;           /* maxlength + 1 bytes */
+  size_t length;
+};
+
+struct namestore_iter {
+  const struct namestore *store;
+  struct cursor cursor;
+  bool started;
+  size_t prefixlength;
+  char *prefix;
+};
+
+struct namestore_builder *namestore_builder_create(void)
+{
+  return calloc(1, sizeof(struct namestore_builder));
+}
+
+void namestore_builder_destroy(struct namestore_builder *builder)
+{
+  if (builder == NULL)
+    return;
+  free(builder->text);
+  free(builder->offsets);
+  free(builder);
+}
+
+/** namestore_builder_add_plain() - adds a name (which is normally a
+ *  demangled name, but any text can be stored). Returns false on failure
+ *  (out of memory).
+ */
+bool namestore_builder_add_plain(struct namestore_builder *builder, const char *plain)
+{
+  assert(builder != NULL);
+  assert(plain != NULL);
+  size_t length = strlen(plain);
+  if (builder->size + length + 1 > builder->capacity) {
+    size_t capacity = (builder->capacity > 0) ? builder->capacity : 65536;
+    while (capacity < builder->size + length + 1)
+      capacity *= 2;
+    char *text = realloc(builder->text, capacity);
+    if (text == NULL)
+      return false;
+    builder->text = text;
+    builder->capacity = capacity;
+  }
+  if (builder->count == builder->max) {
+    size_t max = (builder->max > 0) ? 2 * builder->max : 1024;
+    uint64_t *offsets = realloc(builder->offsets, max * sizeof(uint64_t));
+    if (offsets == NULL)
+      return false;
+    builder->offsets = offsets;
+    builder->max = max;
+  }
+  builder->offsets[builder->count++] = builder->size;
+  memcpy(builder->text + builder->size, plain, length + 1);
+  builder->size += length + 1;
+  return true;
+}
+
+/** namestore_builder_add() - demangles a name and adds it. Returns
+ *  DEMANGLE_OK on success, or the error code of the demangler (with
+ *  DEMANGLE_NOSCRATCH for out of memory, and DEMANGLE_OVERFLOW for a name
+ *  whose demangled form exceeds DEMANGLE_MAX_PLAIN); names that fail to
+ *  demangle are not added.
+ */
+int namestore_builder_add(struct namestore_builder *builder, const char *mangled)
+{
+  assert(builder != NULL);
+  assert(mangled != NULL);
+  char local[INIT_PLAIN];
+  char *plain = local;
+  size_t size = sizeof local;
+  local[0] = '\0';   /* only its address is passed, but gcc warns otherwise */
+  int result = demangle_grow(&plain, &size, local, mangled, strlen(mangled));
+  if (result == DEMANGLE_OK && !namestore_builder_add_plain(builder, plain))
+    result = DEMANGLE_NOSCRATCH;
+  if (plain != local)
+    free(plain);
+  return result;
+}
+
+static int compare_names(const void *a, const void *b)
+{
+  return strcmp(*(const char * const *)a, *(const char * const *)b);
+}
+
+static size_t put_varint(unsigned char *buffer, uint64_t value)
+{
+  size_t pos = 0;
+  while (value >= 0x80) {
+    buffer[pos++] = (unsigned char)(value | 0x80);
+    value >>= 7;
+  }
+  buffer[pos++] = (unsigned char)value;
+  return pos;
+}
+
+static uint64_t align8(uint64_t offset)
+{
+  return (offset + 7) & ~(uint64_t)7;
+}
+
+/** namestore_builder_write() - sorts the names, removes duplicates, and
+ *  writes the store to a file. Returns false on failure.
+ */
+bool namestore_builder_write(struct namestore_builder *builder, const char *filename)
+{
+  assert(builder != NULL);
+  assert(filename != NULL);
+  const char **order = malloc((builder->count + 1) * sizeof(char*));
+  uint64_t *block_index = NULL;
+  unsigned char *data = NULL;
+  FILE *fp = NULL;
+  bool ok = false;
+  if (order == NULL)
+    goto done;
+  for (size_t i = 0; i < builder->count; i++)
+    order[i] = builder->text + builder->offsets[i];
+  qsort(order, builder->count, sizeof(char*), compare_names);
+  size_t count = 0;
+  size_t maxlength = 0;
+  for (size_t i = 0; i < builder->count; i++) {
+    if (count == 0 || strcmp(order[count - 1], order[i]) != 0) {
+      size_t length = strlen(order[i]);
+      if (length > maxlength)
+        maxlength = length;
+      order[count++] = order[i];
+    }
+  }
+  if (maxlength >= UINT32_MAX)
+    goto done;
+
+  /* the encoding is never larger than the text plus two varints per name */
+  size_t blocks = (count + NAMESTORE_BLOCK - 1) / NAMESTORE_BLOCK;
+  block_index = malloc((blocks + 1) * sizeof(uint64_t));
+  data = malloc(builder->size + 20 * count + 1);
+  if (block_index == NULL || data == NULL)
+    goto done;
+  size_t pos = 0;
+  size_t prevlength = 0;
+  for (size_t i = 0; i < count; i++) {
+    const char *name = order[i];
+    size_t length = strlen(name);
+    if (i % NAMESTORE_BLOCK == 0) {
+      block_index[i / NAMESTORE_BLOCK] = pos;
+      memcpy(data + pos, name, length + 1);
+      pos += length + 1;
+    } else {
+      const char *prev = order[i - 1];
+      size_t shared = 0;
+      while (shared < prevlength && prev[shared] == name[shared])
+        shared++;
+      pos += put_varint(data + pos, shared);
+      pos += put_varint(data + pos, length - shared);
+      memcpy(data + pos, name + shared, length - shared);
+      pos += length - shared;
+    }
+    prevlength = length;
+  }
+  block_index[blocks] = pos;
+
+  struct namestore_header header;
+  memset(&header, 0, sizeof header);
+  memcpy(header.magic, NAMESTORE_MAGIC, 4);
+  header.version = NAMESTORE_VERSION;
+  header.blocksize = NAMESTORE_BLOCK;
+  header.maxlength = (uint32_t)maxlength;
+  header.count = count;
+  header.blocks = blocks;
+  header.block_index = align8(sizeof header);
+  header.block_data = header.block_index + (blocks + 1) * sizeof(uint64_t);
+  header.size = header.block_data + pos;
+
+  fp = fopen(filename, "wb");
+  if (fp == NULL)
+    goto done;
+  ok = fwrite(&header, sizeof header, 1, fp) == 1
+       && fwrite(block_index, sizeof(uint64_t), blocks + 1, fp) == blocks + 1
+       && (pos == 0 || fwrite(data, 1, pos, fp) == pos);
+done:
+  if (fp != NULL && fclose(fp) != 0)
+    ok = false;
+  free(order);
+  free(block_index);
+  free(data);
+  return ok;
+}
+
+/** namestore_attach() - uses a store that is in memory (for example, mapped
+ *  by the caller). The memory must stay valid until namestore_close().
+ *  Returns NULL if the data is not a valid store.
+ */
+struct namestore *namestore_attach(const void *data, size_t size)
+{
+  assert(data != NULL || size == 0);
+  const struct namestore_header *header = data;
+  if (size < sizeof(struct namestore_header) || memcmp(header->magic, NAMESTORE_MAGIC, 4) != 0
+      || header->version != NAMESTORE_VERSION || header->size != size || header->blocksize == 0
+      || header->blocks != (header->count + header->blocksize - 1) / header->blocksize
+      || header->block_index % 8 != 0 || header->block_index > size
+      || header->blocks >= (size - header->block_index) / sizeof(uint64_t)
+      || header->block_data != header->block_index + (header->blocks + 1) * sizeof(uint64_t))
+    return NULL;
+  struct namestore *store = malloc(sizeof(struct namestore));
+  if (store == NULL)
+    return NULL;
+  store->data = data;
+  store->size = size;
+  store->mapped = false;
+  store->header = header;
+  store->block_index = (const uint64_t*)(store->data + header->block_index);
+  store->block_data = store->data + header->block_data;
+  if (store->block_index[header->blocks] != size - header->block_data) {
+    free(store);
+    return NULL;
+  }
+  return store;
+}
+
+/** namestore_open() - maps a store file into memory. Returns NULL if the file
+ *  cannot be read, or if it is not a valid store.
+ */
+struct namestore *namestore_open(const char *filename)
+{
+  assert(filename != NULL);
+  struct namestore *store = NULL;
+#if defined HAVE_MMAP
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0)
+    return NULL;
+  struct stat st;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data != MAP_FAILED) {
+      store = namestore_attach(data, st.st_size);
+      if (store != NULL)
+        store->mapped = true;
+      else
+        munmap(data, st.st_size);
+    }
+  }
+  close(fd);
+#else
+  FILE *fp = fopen(filename, "rb");
+  if (fp == NULL)
+    return NULL;
+  fseek(fp, 0, SEEK_END);
+  long size = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  void *data = (size > 0) ? malloc(size) : NULL;
+  if (data != NULL && fread(data, 1, size, fp) == (size_t)size)
+    store = namestore_attach(data, size);
+  if (store != NULL)
+    store->mapped = true;
+  else
+    free(data);
+  fclose(fp);
+#endif
+  return store;
+}
+
+void namestore_close(struct namestore *store)
+{
+  if (store == NULL)
+    return;
+  if (store->mapped) {
+#if defined HAVE_MMAP
+    munmap((void*)store->data, store->size);
+#else
+    free((void*)store->data);
+#endif
+  }
+  free(store);
+}
+
+uint64_t namestore_count(const struct namestore *store)
+{
+  assert(store != NULL);
+  return store->header->count;
+}
+
+static bool get_varint(const unsigned char **pos, const unsigned char *end, uint64_t *value)
+{
+  const unsigned char *p = *pos;
+  *value = 0;
+  for (int shift = 0; p < end && shift < 64; shift += 7) {
+    *value |= (uint64_t)(*p & 0x7f) << shift;
+    if ((*p++ & 0x80) == 0) {
+      *pos = p;
+      return true;
+    }
+  }
+  return false;
+}
+
+/** cursor_block() - positions the cursor on the first name of a block. All
+ *  offsets and lengths are checked, so that a corrupt file gives an error
+ *  rather than a read outside of it.
+ */
+static bool cursor_block(const struct namestore *store, struct cursor *cursor, uint64_t block)
+{
+  assert(block < store->header->blocks);
+  uint64_t start = store->block_index[block];
+  uint64_t stop = store->block_index[block + 1];
+  if (start >= stop || stop > store->size - store->header->block_data)
+    return false;
+  const unsigned char *name = store->block_data + start;
+  const unsigned char *nul = memchr(name, '\0', stop - start);
+  if (nul == NULL || (size_t)(nul - name) > store->header->maxlength)
+    return false;
+  cursor->id = block * store->header->blocksize;
+  cursor->length = nul - name;
+  memcpy(cursor->name, name, cursor->length + 1);
+  cursor->pos = nul + 1;
+  cursor->end = store->block_data + stop;
+  return true;
+}
+
+/** cursor_next() - moves the cursor to the next name. Returns false at the
+ *  end of the store (or on a corrupt file).
+ */
+static bool cursor_next(const struct namestore *store, struct cursor *cursor)
+{
+  uint64_t id = cursor->id + 1;
+  if (id >= store->header->count)
+    return false;
+  if (id % store->header->blocksize == 0)
+    return cursor_block(store, cursor, id / store->header->blocksize);
+  uint64_t shared, suffix;
+  if (!get_varint(&cursor->pos, cursor->end, &shared) || !get_varint(&cursor->pos, cursor->end, &suffix)
+      || shared > cursor->length || suffix > store->header->maxlength - shared
+      || suffix > (uint64_t)(cursor->end - cursor->pos))
+    return false;
+  memcpy(cursor->name + shared, cursor->pos, suffix);
+  cursor->pos += suffix;
+  cursor->length = shared + suffix;
+  cursor->name[cursor->length] = '\0';
+  cursor->id = id;
+  return true;
+}
+
+/** first_name() - returns the first name of a block (which is stored in
+ *  full), or NULL if the block is invalid.
+ */
+static const char *first_name(const struct namestore *store, uint64_t block)
+{
+  uint64_t start = store->block_index[block];
+  uint64_t stop = store->block_index[block + 1];
+  if (start >= stop || stop > store->size - store->header->block_data)
+    return NULL;
+  const unsigned char *name = store->block_data + start;
+  return (memchr(name, '\0', stop - start) != NULL) ? (const char*)name : NULL;
+}
+
+/** cursor_seek() - positions the cursor on the first name that is equal to
+ *  or greater than the text. Returns false if there is no such name.
+ */
+static bool cursor_seek(const struct namestore *store, struct cursor *cursor, const char *text)
+{
+  if (store->header->count == 0)
+    return false;
+  /* find the last block whose first name is below the text */
+  uint64_t low = 0, high = store->header->blocks;
+  while (high - low > 1) {
+    uint64_t mid = low + (high - low) / 2;
+    const char *first = first_name(store, mid);
+    if (first != NULL && strcmp(first, text) < 0)
+      low = mid;
+    else
+      high = mid;
+  }
+  if (!cursor_block(store, cursor, low))
+    return false;
+  while (strcmp(cursor->name, text) < 0)
+    if (!cursor_next(store, cursor))
+      return false;
+  return true;
+}
+
+static char *alloc_name(const struct namestore *store, char *local, size_t size)
+{
+  if (store->header->maxlength < size)
+    return local;
+  return malloc((size_t)store->header->maxlength + 1);
+}
+
+/** namestore_get() - copies the name with the given id into "plain", which
+ *  has "size" bytes (a longer name is truncated). Returns the length of the
+ *  name, or 0 if the id is out of range.
+ */
+size_t namestore_get(const struct namestore *store, uint64_t id, char *plain, size_t size)
+{
+  assert(store != NULL);
+  assert(plain != NULL && size > 0);
+  plain[0] = '\0';
+  if (id >= store->header->count)
+    return 0;
+  char local[INIT_PLAIN];
+  struct cursor cursor;
+  cursor.name = alloc_name(store, local, sizeof local);
+  if (cursor.name == NULL)
+    return 0;
+  size_t length = 0;
+  bool ok = cursor_block(store, &cursor, id / store->header->blocksize);
+  while (ok && cursor.id < id)
+    ok = cursor_next(store, &cursor);
+  if (ok) {
+    length = cursor.length;
+    size_t copy = (length < size) ? length : size - 1;
+    memcpy(plain, cursor.name, copy);
+    plain[copy] = '\0';
+  }
+  if (cursor.name != local)
+    free(cursor.name);
+  return length;
+}
+
+/** namestore_find() - looks up a name. Returns true if it is found, and sets
+ *  "id" to its position in the sorted order.
+ */
+bool namestore_find(const struct namestore *store, const char *plain, uint64_t *id)
+{
+  assert(store != NULL);
+  assert(plain != NULL);
+  char local[INIT_PLAIN];
+  struct cursor cursor;
+  cursor.name = alloc_name(store, local, sizeof local);
+  if (cursor.name == NULL)
+    return false;
+  bool found = cursor_seek(store, &cursor, plain) && strcmp(cursor.name, plain) == 0;
+  if (found && id != NULL)
+    *id = cursor.id;
+  if (cursor.name != local)
+    free(cursor.name);
+  return found;
+}
+
+/** namestore_prefix() - starts an iteration over all names that start with
+ *  the prefix (an empty prefix gives all names). Call namestore_next() for
+ *  each name, and namestore_iter_free() at the end. Returns NULL on failure
+ *  (out of memory).
+ */
+struct namestore_iter *namestore_prefix(const struct namestore *store, const char *prefix)
+{
+  assert(store != NULL);
+  assert(prefix != NULL);
+  size_t length = strlen(prefix);
+  struct namestore_iter *iter = malloc(sizeof(struct namestore_iter) + store->header->maxlength + 1 + length + 1);
+  if (iter == NULL)
+    return NULL;
+  iter->store = store;
+  iter->cursor.name = (char*)(iter + 1);
+  iter->prefix = iter->cursor.name + store->header->maxlength + 1;
+  memcpy(iter->prefix, prefix, length + 1);
+  iter->prefixlength = length;
+  iter->started = false;
+  return iter;
+}
+
+/** namestore_next() - returns the next name of the iteration, or NULL at the
+ *  end. The name remains valid until the next call. If "id" is not NULL, it
+ *  is set to the id of the name.
+ */
+const char *namestore_next(struct namestore_iter *iter, uint64_t *id)
+{
+  assert(iter != NULL);
+  bool ok;
+  if (!iter->started) {
+    iter->started = true;
+    ok = cursor_seek(iter->store, &iter->cursor, iter->prefix);
+  } else {
+    ok = cursor_next(iter->store, &iter->cursor);
+  }
+  if (!ok || strncmp(iter->cursor.name, iter->prefix, iter->prefixlength) != 0) {
+    iter->cursor.id = iter->store->header->count;  /* stays at the end */
+    return NULL;
+  }
+  if (id != NULL)
+    *id = iter->cursor.id;
+  return iter->cursor.name;
+}
+
+void namestore_iter_free(struct namestore_iter *iter)
+{
+  free(iter);
+}
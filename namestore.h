@@ -0,0 +1,58 @@
+/* GNU C++ symbol name demangler
+ * Sorted, front-coded store of demangled names.
+ *
+ * Copyright 2022-2024, CompuPhase
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _NAMESTORE_H
+#define _NAMESTORE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if !defined NAMESTORE_BLOCK
+# define NAMESTORE_BLOCK 16 /* names per front-coded block */
+#endif
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+struct namestore_builder;
+struct namestore;
+struct namestore_iter;
+
+struct namestore_builder *namestore_builder_create(void);
+void namestore_builder_destroy(struct namestore_builder *builder);
+int namestore_builder_add(struct namestore_builder *builder, const char *mangled);
+bool namestore_builder_add_plain(struct namestore_builder *builder, const char *plain);
+bool namestore_builder_write(struct namestore_builder *builder, const char *filename);
+
+struct namestore *namestore_open(const char *filename);
+struct namestore *namestore_attach(const void *data, size_t size);
+void namestore_close(struct namestore *store);
+uint64_t namestore_count(const struct namestore *store);
+size_t namestore_get(const struct namestore *store, uint64_t id, char *plain, size_t size);
+bool namestore_find(const struct namestore *store, const char *plain, uint64_t *id);
+
+struct namestore_iter *namestore_prefix(const struct namestore *store, const char *prefix);
+const char *namestore_next(struct namestore_iter *iter, uint64_t *id);
+void namestore_iter_free(struct namestore_iter *iter);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif /* _NAMESTORE_H */
@@ -0,0 +1,329 @@
+/* GNU C++ symbol name demangler
+ * Demangled names as streams of interned tokens.
+ *
+ * A store with millions of demangled names holds the same pieces over and
+ * over: "std::", "allocator<", "basic_string<", "char> >", and the names of
+ * the own namespaces and classes. Here, a name is split into tokens and each
+ * distinct token is stored once, in a shared table; a name becomes an array
+ * of token ids. Two names (interned in the same table) are equal if their
+ * token arrays are equal.
+ *
+ * A token is an identifier with the punctuation that follows it ("std::",
+ * "vector<", "int> >::"), or a run of punctuation at the start of the name.
+ * Splitting after the punctuation rather than before it halves the number of
+ * tokens, while the number of distinct tokens stays small. The demangler
+ * builds its output by insertion (the return type and the declarator of a
+ * function pointer are placed around text that was produced earlier), so the
+ * tokens are taken from the completed name, not at the points where the
+ * demangler writes the text. The identifiers are the same either way: source
+ * names, operator names and the builtin types.
+ *
+ * For storage, nametok_pack() encodes the ids as variable-length integers;
+ * tokens get their ids in order of first appearance, so the common ones have
+ * the short codes. For the 160 thousand distinct C++ symbols of /usr/lib
+ * (19 MB of demangled text), the packed ids take 3.3 MB and the table with
+ * 117 thousand tokens takes 5 MB.
+ *
+ * The table is not thread-safe.
+ *
+ * Copyright 2022-2024, CompuPhase
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "demangle.h"
+#include "nametok.h"
+
+#define TEXT_BLOCK  65536   /* size of the blocks for the token text */
+#define INIT_PLAIN  1024    /* size of the output buffer on the stack */
+#define INIT_SLOTS  1024
+
+struct textblock {
+  struct textblock *next;
+  size_t size;
+  size_t used;
+  char text[];
+};
+
+struct token {
+  const char *text;
+  uint32_t length;
+  uint32_t hash;
+};
+
+struct nametok {
+  struct token *tokens; /**< indexed by token id */
+  uint32_t count;
+  uint32_t max;
+  uint32_t *slots;      /**< hash index, holds id + 1 (0 = empty) */
+  uint32_t mask;
+  struct textblock *blocks;
+};
+
+/** nametok_create() - creates an empty token table. Returns NULL on failure
+ *  (out of memory).
+ */
+struct nametok *nametok_create(void)
+{
+  struct nametok *tab = calloc(1, sizeof(struct nametok));
+  if (tab == NULL)
+    return NULL;
+  tab->slots = calloc(INIT_SLOTS, sizeof(uint32_t));
+  if (tab->slots == NULL) {
+    free(tab);
+    return NULL;
+  }
+  tab->mask = INIT_SLOTS - 1;
+  return tab;
+}
+
+void nametok_destroy(struct nametok *tab)
+{
+  if (tab == NULL)
+    return;
+  while (tab->blocks != NULL) {
+    struct textblock *block = tab->blocks;
+    tab->blocks = block->next;
+    free(block);
+  }
+  free(tab->tokens);
+  free(tab->slots);
+  free(tab);
+}
+
+/** nametok_count() - returns the number of distinct tokens in the table. */
+uint32_t nametok_count(const struct nametok *tab)
+{
+  assert(tab != NULL);
+  return tab->count;
+}
+
+/** nametok_text() - returns the text of a token (not zero-terminated), and
+ *  its length in "length".
+ */
+const char *nametok_text(const struct nametok *tab, uint32_t id, size_t *length)
+{
+  assert(tab != NULL);
+  assert(id < tab->count);
+  assert(length != NULL);
+  *length = tab->tokens[id].length;
+  return tab->tokens[id].text;
+}
+
+static uint32_t hash_token(const char *text, size_t length)
+{
+  return (uint32_t)demangle_hash_text(text, length);
+}
+
+static bool grow_index(struct nametok *tab)
+{
+  uint32_t size = 2 * (tab->mask + 1);
+  uint32_t *slots = calloc(size, sizeof(uint32_t));
+  if (slots == NULL)
+    return false;
+  for (uint32_t id = 0; id < tab->count; id++) {
+    uint32_t idx = tab->tokens[id].hash & (size - 1);
+    while (slots[idx] != 0)
+      idx = (idx + 1) & (size - 1);
+    slots[idx] = id + 1;
+  }
+  free(tab->slots);
+  tab->slots = slots;
+  tab->mask = size - 1;
+  return true;
+}
+
+static const char *store_text(struct nametok *tab, const char *text, size_t length)
+{
+  struct textblock *block = tab->blocks;
+  if (block == NULL || block->used + length > block->size) {
+    size_t size = (length > TEXT_BLOCK) ? length : TEXT_BLOCK;
+    block = malloc(sizeof(struct textblock) + size);
+    if (block == NULL)
+      return NULL;
+    block->size = size;
+    block->used = 0;
+    block->next = tab->blocks;
+    tab->blocks = block;
+  }
+  char *copy = block->text + block->used;
+  memcpy(copy, text, length);
+  block->used += length;
+  return copy;
+}
+
+/** intern() - returns the id of the token, adding it to the table if needed.
+ *  Returns -1 on failure (out of memory).
+ */
+static long intern(struct nametok *tab, const char *text, size_t length)
+{
+  uint32_t hash = hash_token(text, length);
+  uint32_t idx = hash & tab->mask;
+  for (uint32_t slot; (slot = tab->slots[idx]) != 0; idx = (idx + 1) & tab->mask) {
+    const struct token *token = &tab->tokens[slot - 1];
+    if (token->hash == hash && token->length == length && memcmp(token->text, text, length) == 0)
+      return slot - 1;
+  }
+
+  if (tab->count == tab->max) {
+    uint32_t max = (tab->max > 0) ? 2 * tab->max : 256;
+    struct token *tokens = realloc(tab->tokens, max * sizeof(struct token));
+    if (tokens == NULL)
+      return -1;
+    tab->tokens = tokens;
+    tab->max = max;
+  }
+  struct token *token = &tab->tokens[tab->count];
+  token->text = store_text(tab, text, length);
+  if (token->text == NULL)
+    return -1;
+  token->length = (uint32_t)length;
+  token->hash = hash;
+  tab->slots[idx] = ++tab->count;
+  if (2 * tab->count > tab->mask && !grow_index(tab))
+    return -1;
+  return tab->count - 1;
+}
+
+static bool is_ident(char c)
+{
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '$';
+}
+
+/** nametok_intern() - splits a (demangled) name into tokens and interns them.
+ *  The ids are stored in "tokens", up to "max" of them.
+ *
+ *  Returns the number of tokens of the name, which may be larger than "max"
+ *  (then only the first "max" ids were stored), or -1 on failure (out of
+ *  memory).
+ */
+long nametok_intern(struct nametok *tab, const char *plain, uint32_t *tokens, size_t max)
+{
+  assert(tab != NULL);
+  assert(plain != NULL);
+  assert(tokens != NULL || max == 0);
+  long count = 0;
+  const char *p = plain;
+  while (*p != '\0') {
+    const char *start = p;
+    while (is_ident(*p))
+      p++;
+    while (*p != '\0' && !is_ident(*p))
+      p++;
+    long id = intern(tab, start, p - start);
+    if (id < 0)
+      return -1;
+    if ((size_t)count < max)
+      tokens[count] = (uint32_t)id;
+    count++;
+  }
+  return count;
+}
+
+/** nametok_demangle() - demangles a name and interns its tokens; see
+ *  nametok_intern(). Returns -1 if the name cannot be demangled (or if its
+ *  demangled form exceeds DEMANGLE_MAX_PLAIN).
+ */
+long nametok_demangle(struct nametok *tab, const char *mangled, uint32_t *tokens, size_t max)
+{
+  assert(tab != NULL);
+  assert(mangled != NULL);
+  char local[INIT_PLAIN];
+  char *plain = local;
+  size_t size = sizeof local;
+  local[0] = '\0';   /* only its address is passed, but gcc warns otherwise */
+  int result = demangle_grow(&plain, &size, local, mangled, strlen(mangled));
+  long count = (result == DEMANGLE_OK) ? nametok_intern(tab, plain, tokens, max) : -1;
+  if (plain != local)
+    free(plain);
+  return count;
+}
+
+/** nametok_render() - converts a token stream back to text. The text is
+ *  truncated to "size" bytes (including the zero terminator). Returns the
+ *  length of the complete text, so that a return value of "size" or more
+ *  means that the buffer was too small.
+ */
+size_t nametok_render(const struct nametok *tab, const uint32_t *tokens, size_t count, char *plain, size_t size)
+{
+  assert(tab != NULL);
+  assert(tokens != NULL || count == 0);
+  assert(plain != NULL || size == 0);
+  size_t pos = 0;
+  for (size_t i = 0; i < count; i++) {
+    assert(tokens[i] < tab->count);
+    const struct token *token = &tab->tokens[tokens[i]];
+    if (pos + token->length < size)
+      memcpy(plain + pos, token->text, token->length);
+    else if (pos < size)
+      memcpy(plain + pos, token->text, size - 1 - pos);
+    pos += token->length;
+  }
+  if (size > 0)
+    plain[(pos < size) ? pos : size - 1] = '\0';
+  return pos;
+}
+
+/** nametok_pack() - encodes the token ids as variable-length integers (seven
+ *  bits per byte, the high bit set on all but the last byte of an id). The
+ *  encoding is unique, so packed names can be compared with memcmp().
+ *
+ *  Returns the number of bytes of the encoding, which may be larger than
+ *  "size" (then the buffer holds an incomplete encoding).
+ */
+size_t nametok_pack(const uint32_t *tokens, size_t count, unsigned char *buffer, size_t size)
+{
+  assert(tokens != NULL || count == 0);
+  assert(buffer != NULL || size == 0);
+  size_t pos = 0;
+  for (size_t i = 0; i < count; i++) {
+    uint32_t id = tokens[i];
+    while (id >= 0x80) {
+      if (pos < size)
+        buffer[pos] = (unsigned char)(id | 0x80);
+      pos++;
+      id >>= 7;
+    }
+    if (pos < size)
+      buffer[pos] = (unsigned char)id;
+    pos++;
+  }
+  return pos;
+}
+
+/** nametok_unpack() - decodes the result of nametok_pack(). Returns the number
+ *  of tokens, which may be larger than "max" (only "max" ids are stored).
+ */
+size_t nametok_unpack(const unsigned char *buffer, size_t length, uint32_t *tokens, size_t max)
+{
+  assert(buffer != NULL || length == 0);
+  assert(tokens != NULL || max == 0);
+  size_t count = 0;
+  size_t pos = 0;
+  while (pos < length) {
+    uint32_t id = 0;
+    int shift = 0;
+    while (pos < length && (buffer[pos] & 0x80) != 0 && shift < 28) {
+      id |= (uint32_t)(buffer[pos++] & 0x7f) << shift;
+      shift += 7;
+    }
+    if (pos < length)
+      id |= (uint32_t)buffer[pos++] << shift;
+    if (count < max)
+      tokens[count] = id;
+    count++;
+  }
+  return count;
+}
@@ -0,0 +1,46 @@
+/* GNU C++ symbol name demangler
+ * Demangled names as streams of interned tokens.
+ *
+ * Copyright 2022-2024, CompuPhase
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _NAMETOK_H
+#define _NAMETOK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+struct nametok;
+
+struct nametok *nametok_create(void);
+void nametok_destroy(struct nametok *tab);
+uint32_t nametok_count(const struct nametok *tab);
+const char *nametok_text(const struct nametok *tab, uint32_t id, size_t *length);
+
+long nametok_intern(struct nametok *tab, const char *plain, uint32_t *tokens, size_t max);
+long nametok_demangle(struct nametok *tab, const char *mangled, uint32_t *tokens, size_t max);
+size_t nametok_render(const struct nametok *tab, const uint32_t *tokens, size_t count, char *plain, size_t size);
+
+size_t nametok_pack(const uint32_t *tokens, size_t count, unsigned char *buffer, size_t size);
+size_t nametok_unpack(const unsigned char *buffer, size_t length, uint32_t *tokens, size_t max);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif /* _NAMETOK_H */
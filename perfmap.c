@@ -0,0 +1,379 @@
+/* GNU C++ symbol name demangler
+ * Incremental reader for perf map files (/tmp/perf-<pid>.map).
+ *
+ * A JIT compiler writes a line to the perf map file for every function that
+ * it generates:
+ *
+ *     <start> <size> <name>
+ *
+ * where the start address and the size are in hexadecimal. The file only
+ * grows while the process runs, so the reader remembers how many bytes it has
+ * processed, and perfmap_update() only reads (and demangles) the lines that
+ * were appended since the previous call. A line that is not yet terminated
+ * (because the JIT is still writing it) is left for the next update. If the
+ * file became shorter, it was replaced, and it is read from the start.
+ *
+ * Names that start with "_Z" are demangled (when that fails, the name is kept
+ * as is), other names are kept as they are. The entries are kept sorted on
+ * address; new entries are sorted among themselves and then merged into the
+ * table, so an update costs time in proportion to the new lines (plus the
+ * entries that must move up to make room). When code is generated again at
+ * the same address, the later entry replaces the earlier one.
+ *
+ * Copyright 2022-2024, CompuPhase
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "demangle.h"
+#include "perfmap.h"
+
+#define READ_CHUNK  65536   /* initial size of the read buffer (grows for longer lines) */
+#define TEXT_BLOCK  65536   /* size of the blocks for the names */
+#define INIT_PLAIN  1024    /* initial size of the demangle buffer */
+
+struct textblock {
+  struct textblock *next;
+  size_t size;
+  size_t used;
+  char text[];
+};
+
+struct pending {
+  struct perfmap_entry entry;
+  size_t seq;           /**< line number in this update, the later line wins */
+};
+
+struct perfmap {
+  char *filename;
+  long offset;          /**< bytes of the file that have been processed */
+  struct perfmap_entry *entries;  /**< sorted on start address */
+  size_t count, maxentries;
+  struct pending *pending;        /**< new entries of the current update */
+  size_t npending, maxpending;
+  struct textblock *blocks;
+  char *plain;          /**< demangle buffer */
+  size_t plainsize;
+};
+
+/** perfmap_open() - creates a reader for the perf map file; the file is read
+ *  on perfmap_update(). Returns NULL on a memory allocation failure.
+ */
+struct perfmap *perfmap_open(const char *filename)
+{
+  assert(filename != NULL);
+  struct perfmap *map = calloc(1, sizeof(struct perfmap));
+  if (map == NULL)
+    return NULL;
+  map->filename = malloc(strlen(filename) + 1);
+  if (map->filename == NULL) {
+    free(map);
+    return NULL;
+  }
+  strcpy(map->filename, filename);
+  return map;
+}
+
+static void reset(struct perfmap *map)
+{
+  while (map->blocks != NULL) {
+    struct textblock *block = map->blocks;
+    map->blocks = block->next;
+    free(block);
+  }
+  free(map->entries);
+  map->entries = NULL;
+  map->count = map->maxentries = 0;
+  map->offset = 0;
+}
+
+void perfmap_close(struct perfmap *map)
+{
+  if (map != NULL) {
+    reset(map);
+    free(map->pending);
+    free(map->plain);
+    free(map->filename);
+    free(map);
+  }
+}
+
+/** store_name() - copies the name into the text blocks, where it remains
+ *  until the map is closed (or the file is replaced).
+ */
+static const char *store_name(struct perfmap *map, const char *name, size_t length)
+{
+  struct textblock *block = map->blocks;
+  if (block == NULL || block->used + length + 1 > block->size) {
+    size_t size = (length + 1 > TEXT_BLOCK) ? length + 1 : TEXT_BLOCK;
+    block = malloc(sizeof(struct textblock) + size);
+    if (block == NULL)
+      return NULL;
+    block->size = size;
+    block->used = 0;
+    block->next = map->blocks;
+    map->blocks = block;
+  }
+  char *text = block->text + block->used;
+  memcpy(text, name, length);
+  text[length] = '\0';
+  block->used += length + 1;
+  return text;
+}
+
+/** demangled() - returns the demangled form of the name (in the demangle
+ *  buffer of the map), or NULL if the name is not mangled or invalid, or if
+ *  its demangled form exceeds DEMANGLE_MAX_PLAIN (the raw name is then kept).
+ */
+static const char *demangled(struct perfmap *map, const char *name, size_t length)
+{
+  if (length < 2 || name[0] != '_' || name[1] != 'Z')
+    return NULL;
+  if (map->plain == NULL) {
+    map->plain = malloc(INIT_PLAIN);
+    if (map->plain == NULL)
+      return NULL;
+    map->plainsize = INIT_PLAIN;
+  }
+  if (demangle_grow(&map->plain, &map->plainsize, NULL, name, length) != DEMANGLE_OK)
+    return NULL;
+  return map->plain;
+}
+
+static bool parse_hex(const char **pos, const char *end, uint64_t *value)
+{
+  const char *p = *pos;
+  if (end - p > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X'))
+    p += 2;
+  const char *start = p;
+  *value = 0;
+  for ( ; p < end; p++) {
+    int digit;
+    if (*p >= '0' && *p <= '9')
+      digit = *p - '0';
+    else if (*p >= 'a' && *p <= 'f')
+      digit = *p - 'a' + 10;
+    else if (*p >= 'A' && *p <= 'F')
+      digit = *p - 'A' + 10;
+    else
+      break;
+    *value = (*value << 4) | (uint64_t)digit;
+  }
+  if (p == start || p - start > 16)
+    return false;
+  *pos = p;
+  return true;
+}
+
+/** parse_line() - adds the entry on a line to the pending list. Lines that do
+ *  not have the expected format are skipped. Returns false on a memory
+ *  allocation failure.
+ */
+static bool parse_line(struct perfmap *map, const char *line, const char *end)
+{
+  while (end > line && (end[-1] == '\r' || end[-1] == ' '))
+    end--;
+  const char *p = line;
+  uint64_t start, size;
+  if (!parse_hex(&p, end, &start) || p == end || *p != ' ')
+    return true;
+  while (p < end && *p == ' ')
+    p++;
+  if (!parse_hex(&p, end, &size) || p == end || *p != ' ')
+    return true;
+  while (p < end && *p == ' ')
+    p++;
+  if (p == end)
+    return true;
+
+  if (map->npending == map->maxpending) {
+    size_t max = (map->maxpending > 0) ? 2 * map->maxpending : 256;
+    struct pending *list = realloc(map->pending, max * sizeof(struct pending));
+    if (list == NULL)
+      return false;
+    map->pending = list;
+    map->maxpending = max;
+  }
+  const char *name = p;
+  size_t length = end - p;
+  const char *plain = demangled(map, name, length);
+  if (plain != NULL) {
+    name = plain;
+    length = strlen(plain);
+  }
+  struct pending *item = &map->pending[map->npending];
+  item->entry.start = start;
+  item->entry.size = size;
+  item->entry.name = store_name(map, name, length);
+  if (item->entry.name == NULL)
+    return false;
+  item->seq = map->npending++;
+  return true;
+}
+
+static int compare_pending(const void *a, const void *b)
+{
+  const struct pending *p1 = a;
+  const struct pending *p2 = b;
+  if (p1->entry.start != p2->entry.start)
+    return (p1->entry.start < p2->entry.start) ? -1 : 1;
+  return (p1->seq < p2->seq) ? -1 : (p1->seq > p2->seq);
+}
+
+/** merge_pending() - sorts the new entries and merges them into the table.
+ *  For equal start addresses, only the last new entry is kept. The merge runs
+ *  from the top of the table down, so that entries below the lowest new
+ *  address are not moved (JIT code is mostly allocated at rising addresses).
+ */
+static bool merge_pending(struct perfmap *map)
+{
+  if (map->npending == 0)
+    return true;
+  qsort(map->pending, map->npending, sizeof(struct pending), compare_pending);
+  size_t count = 0;
+  for (size_t j = 0; j < map->npending; j++)
+    if (j + 1 == map->npending || map->pending[j].entry.start != map->pending[j + 1].entry.start)
+      map->pending[count++] = map->pending[j];   /* drop lines that were superseded */
+  map->npending = count;
+
+  if (map->count + map->npending > map->maxentries) {
+    size_t max = (map->maxentries > 0) ? 2 * map->maxentries : 1024;
+    while (max < map->count + map->npending)
+      max *= 2;
+    struct perfmap_entry *list = realloc(map->entries, max * sizeof(struct perfmap_entry));
+    if (list == NULL)
+      return false;
+    map->entries = list;
+    map->maxentries = max;
+  }
+  size_t i = map->count, j = map->npending, w = map->count + map->npending;
+  while (j > 0) {
+    if (i > 0 && map->entries[i - 1].start > map->pending[j - 1].entry.start) {
+      map->entries[--w] = map->entries[--i];
+    } else {
+      if (i > 0 && map->entries[i - 1].start == map->pending[j - 1].entry.start)
+        i--;  /* replaced */
+      map->entries[--w] = map->pending[--j].entry;
+    }
+  }
+  /* entries below "i" are in place, close the gap left by replaced entries */
+  size_t tail = map->count + map->npending - w;
+  if (w > i)
+    memmove(map->entries + i, map->entries + w, tail * sizeof(struct perfmap_entry));
+  map->count = i + tail;
+  map->npending = 0;
+  return true;
+}
+
+/** perfmap_update() - reads the lines that were added to the file since the
+ *  previous call. Returns the number of new entries, or -1 if the file cannot
+ *  be read or on a memory allocation failure. Pointers returned by
+ *  perfmap_lookup() are invalid after this call (but the names stay valid).
+ */
+long perfmap_update(struct perfmap *map)
+{
+  assert(map != NULL);
+  FILE *fp = fopen(map->filename, "rb");
+  if (fp == NULL)
+    return -1;
+  if (fseek(fp, 0, SEEK_END) != 0) {
+    fclose(fp);
+    return -1;
+  }
+  long filesize = ftell(fp);
+  if (filesize < map->offset)
+    reset(map);   /* the file was replaced */
+  if (filesize <= map->offset || fseek(fp, map->offset, SEEK_SET) != 0) {
+    fclose(fp);
+    return (filesize < 0) ? -1 : 0;
+  }
+
+  size_t bufsize = READ_CHUNK;
+  char *buffer = malloc(bufsize);
+  bool ok = (buffer != NULL);
+  size_t fill = 0;      /* bytes in the buffer */
+  long offset = map->offset;
+  map->npending = 0;
+  while (ok) {
+    if (fill == bufsize) {
+      /* a line that does not fit in the buffer */
+      char *bigger = realloc(buffer, 2 * bufsize);
+      if (bigger == NULL) {
+        ok = false;
+        break;
+      }
+      buffer = bigger;
+      bufsize *= 2;
+    }
+    size_t count = fread(buffer + fill, 1, bufsize - fill, fp);
+    if (count == 0)
+      break;
+    fill += count;
+    /* handle all complete lines, keep the remainder */
+    char *line = buffer;
+    char *eol;
+    while (ok && (eol = memchr(line, '\n', fill - (line - buffer))) != NULL) {
+      ok = parse_line(map, line, eol);
+      line = eol + 1;
+    }
+    size_t used = line - buffer;
+    offset += used;
+    memmove(buffer, line, fill - used);
+    fill -= used;
+  }
+  free(buffer);
+  fclose(fp);
+
+  long added = (long)map->npending;
+  if (ok)
+    ok = merge_pending(map);
+  if (!ok) {
+    map->npending = 0;
+    return -1;
+  }
+  map->offset = offset;
+  return added;
+}
+
+size_t perfmap_count(const struct perfmap *map)
+{
+  assert(map != NULL);
+  return map->count;
+}
+
+/** perfmap_lookup() - returns the entry for the code that contains the
+ *  address, or NULL if no entry covers it.
+ */
+const struct perfmap_entry *perfmap_lookup(const struct perfmap *map, uint64_t address)
+{
+  assert(map != NULL);
+  /* find the last entry with a start address at or below the address */
+  size_t low = 0, high = map->count;
+  while (low < high) {
+    size_t mid = low + (high - low) / 2;
+    if (map->entries[mid].start <= address)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+  if (low == 0)
+    return NULL;
+  const struct perfmap_entry *entry = &map->entries[low - 1];
+  if (address - entry->start < entry->size || address == entry->start)
+    return entry;
+  return NULL;
+}
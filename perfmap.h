@@ -0,0 +1,46 @@
+/* GNU C++ symbol name demangler
+ * Incremental reader for perf map files (/tmp/perf-<pid>.map).
+ *
+ * Copyright 2022-2024, CompuPhase
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _PERFMAP_H
+#define _PERFMAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+struct perfmap_entry {
+  uint64_t start;       /**< address of the code */
+  uint64_t size;        /**< size of the code in bytes */
+  const char *name;     /**< demangled name (or the name as it is in the file) */
+};
+
+struct perfmap;
+
+struct perfmap *perfmap_open(const char *filename);
+void perfmap_close(struct perfmap *map);
+long perfmap_update(struct perfmap *map);
+size_t perfmap_count(const struct perfmap *map);
+const struct perfmap_entry *perfmap_lookup(const struct perfmap *map, uint64_t address);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif /* _PERFMAP_H */
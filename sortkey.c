@@ -0,0 +1,195 @@
+/* GNU C++ symbol name demangler
+ * Ordering mangled names by their demangled form.
+ *
+ * demangle_compare() orders two mangled names in the same way as strcmp() on
+ * their demangled forms. Names that are not mangled (or that fail to
+ * demangle) take part in the ordering with their own text, which is also how
+ * symbol listings show them.
+ *
+ * For sorting large sets of symbols, a sort key holds the first bytes of the
+ * demangled name (and its length), next to a pointer to the mangled name.
+ * Each symbol is demangled once to build its key; nearly all comparisons are
+ * then decided on the prefixes, and only ties on a full prefix demangle the
+ * two names again. The demangled names are never stored, so the memory for
+ * the sort is a fixed amount per symbol. The prefix is long enough to get
+ * past the common namespace and class prefixes (std::, llvm::), so that ties
+ * stay rare.
+ *
+ * Sets with many names in one class template still tie on long runs of keys.
+ * sortkey_sort() therefore sorts on the prefixes first, and then demangles
+ * each name in a run of equal prefixes once (instead of twice per
+ * comparison), keeping the text of only that run in memory while it sorts it.
+ *
+ * The demangler builds its output by insertion (for function pointers and
+ * arrays, the declarator ends up in the middle of the type), so the output
+ * cannot be compared while it is being produced; the prefix of the key is
+ * taken from the completed name.
+ *
+ * Copyright 2022-2024, CompuPhase
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "demangle.h"
+#include "sortkey.h"
+
+#define INIT_PLAIN  2048  /* size of the output buffers on the stack */
+
+/** plain_text() - returns the demangled form of the name, or the name itself
+ *  if it cannot be demangled (or if its demangled form exceeds
+ *  DEMANGLE_MAX_PLAIN). The text is in "local", or in a heap block that is
+ *  returned in "heap" (which the caller must free).
+ */
+static const char *plain_text(const char *mangled, char *local, size_t size, char **heap)
+{
+  char *plain = local;
+  int result = demangle_grow(&plain, &size, local, mangled, strlen(mangled));
+  *heap = (plain != local) ? plain : NULL;
+  return (result == DEMANGLE_OK) ? plain : mangled;
+}
+
+/** demangle_compare() - compares two mangled names on their demangled forms.
+ *  Returns a value below zero, zero, or above zero, like strcmp().
+ */
+int demangle_compare(const char *mangled1, const char *mangled2)
+{
+  assert(mangled1 != NULL);
+  assert(mangled2 != NULL);
+  if (strcmp(mangled1, mangled2) == 0)
+    return 0;
+  char local1[INIT_PLAIN], local2[INIT_PLAIN];
+  char *heap1, *heap2;
+  const char *plain1 = plain_text(mangled1, local1, sizeof local1, &heap1);
+  const char *plain2 = plain_text(mangled2, local2, sizeof local2, &heap2);
+  int result = strcmp(plain1, plain2);
+  free(heap1);
+  free(heap2);
+  return result;
+}
+
+/** demangle_sortkey() - fills in the sort key for a mangled name. The key
+ *  refers to the mangled name, which must stay valid while the key is used.
+ */
+void demangle_sortkey(struct sortkey *key, const char *mangled)
+{
+  assert(key != NULL);
+  assert(mangled != NULL);
+  char local[INIT_PLAIN];
+  char *heap;
+  const char *plain = plain_text(mangled, local, sizeof local, &heap);
+  key->mangled = mangled;
+  key->length = strlen(plain);
+  size_t count = (key->length < SORTKEY_PREFIX) ? key->length : SORTKEY_PREFIX;
+  memcpy(key->prefix, plain, count);
+  memset(key->prefix + count, 0, SORTKEY_PREFIX - count);
+  free(heap);
+}
+
+/** sortkey_compare() - compares two sort keys (pointers to struct sortkey),
+ *  with the same result as demangle_compare() on the names. It has the
+ *  signature of a qsort() comparison function.
+ */
+int sortkey_compare(const void *key1, const void *key2)
+{
+  const struct sortkey *k1 = key1;
+  const struct sortkey *k2 = key2;
+  assert(k1 != NULL && k2 != NULL);
+  int result = memcmp(k1->prefix, k2->prefix, SORTKEY_PREFIX);
+  if (result != 0)
+    return result;
+  /* with equal prefixes, a name that is shorter than the prefix is equal to
+     the other name (the zero padding would differ otherwise) */
+  if (k1->length < SORTKEY_PREFIX || k2->length < SORTKEY_PREFIX)
+    return 0;
+  return demangle_compare(k1->mangled, k2->mangled);
+}
+
+static int prefix_compare(const void *key1, const void *key2)
+{
+  const struct sortkey *k1 = key1;
+  const struct sortkey *k2 = key2;
+  return memcmp(k1->prefix, k2->prefix, SORTKEY_PREFIX);
+}
+
+struct tail {
+  const char *text;     /* demangled name after the prefix */
+  struct sortkey key;
+};
+
+static int tail_compare(const void *tail1, const void *tail2)
+{
+  return strcmp(((const struct tail*)tail1)->text, ((const struct tail*)tail2)->text);
+}
+
+/** sort_run() - sorts keys that have equal prefixes, on the remainder of the
+ *  demangled names. Returns false if memory runs out (the keys are then left
+ *  as they are).
+ */
+static bool sort_run(struct sortkey *keys, size_t count)
+{
+  struct tail *tails = malloc(count * sizeof(struct tail));
+  if (tails == NULL)
+    return false;
+  size_t done;
+  for (done = 0; done < count; done++) {
+    char local[INIT_PLAIN];
+    char *heap;
+    const char *plain = plain_text(keys[done].mangled, local, sizeof local, &heap);
+    char *text = NULL;
+    if (strlen(plain) == keys[done].length) {  /* may differ when out of memory */
+      size_t length = keys[done].length - SORTKEY_PREFIX;
+      text = malloc(length + 1);
+      if (text != NULL)
+        memcpy(text, plain + SORTKEY_PREFIX, length + 1);
+    }
+    free(heap);
+    if (text == NULL)
+      break;
+    tails[done].text = text;
+    tails[done].key = keys[done];
+  }
+  bool complete = (done == count);
+  if (complete) {
+    qsort(tails, count, sizeof(struct tail), tail_compare);
+    for (size_t i = 0; i < count; i++)
+      keys[i] = tails[i].key;
+  }
+  while (done > 0)
+    free((char*)tails[--done].text);
+  free(tails);
+  return complete;
+}
+
+/** sortkey_sort() - sorts an array of sort keys, with the same result as
+ *  qsort() with sortkey_compare(), but each name is demangled at most once
+ *  more (for ties on the prefix), rather than on every comparison.
+ */
+void sortkey_sort(struct sortkey *keys, size_t count)
+{
+  assert(keys != NULL || count == 0);
+  qsort(keys, count, sizeof(struct sortkey), prefix_compare);
+  size_t start = 0;
+  while (start < count) {
+    size_t stop = start + 1;
+    if (keys[start].length >= SORTKEY_PREFIX)
+      while (stop < count && keys[stop].length >= SORTKEY_PREFIX
+             && memcmp(keys[stop].prefix, keys[start].prefix, SORTKEY_PREFIX) == 0)
+        stop++;
+    if (stop - start > 1 && !sort_run(keys + start, stop - start))
+      qsort(keys + start, stop - start, sizeof(struct sortkey), sortkey_compare);
+    start = stop;
+  }
+}
@@ -0,0 +1,46 @@
+/* GNU C++ symbol name demangler
+ * Ordering mangled names by their demangled form.
+ *
+ * Copyright 2022-2024, CompuPhase
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _SORTKEY_H
+#define _SORTKEY_H
+
+#include <stddef.h>
+
+#if !defined SORTKEY_PREFIX
+# define SORTKEY_PREFIX 48  /* bytes of the demangled name stored in a sort key */
+#endif
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+struct sortkey {
+  const char *mangled;  /**< the symbol (not copied) */
+  size_t length;        /**< length of the demangled name */
+  char prefix[SORTKEY_PREFIX];  /**< start of the demangled name, zero-padded */
+};
+
+int demangle_compare(const char *mangled1, const char *mangled2);
+void demangle_sortkey(struct sortkey *key, const char *mangled);
+int sortkey_compare(const void *key1, const void *key2);
+void sortkey_sort(struct sortkey *keys, size_t count);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif /* _SORTKEY_H */
@@ -0,0 +1,725 @@
+/* GNU C++ symbol name demangler
+ * Inverted index from the components of qualified names to symbols.
+ *
+ * The builder splits each mangled name into the components of its qualified
+ * name (with classify_name(), so without demangling), interns the components,
+ * and keeps for each symbol the list of its component ids (its "path"). When
+ * written to a file, the components are sorted, and each component gets a
+ * posting list: the ids of all symbols that have the component somewhere in
+ * their path. A query for "X::Y" (everything under namespace X, class Y) takes
+ * the shorter posting list of X and Y, and checks the path of each symbol in
+ * it; no name is decoded at query time.
+ *
+ * The file is a header followed by arrays of fixed-size integers (in the byte
+ * order of the machine that wrote it), with offsets relative to the start of
+ * the file. It is used in place: symindex_open() maps the file into memory,
+ * and there is no loading step.
+ *
+ *     header
+ *     uint64_t name_index[symbols + 1]     offsets in name_text
+ *     char     name_text[]                 zero-terminated mangled names
+ *     uint32_t comp_index[components + 1]  offsets in comp_text, sorted by text
+ *     char     comp_text[]                 zero-terminated component names
+ *     uint32_t post_index[components + 1]  offsets in postings
+ *     uint32_t postings[]                  symbol ids, ascending per component
+ *     uint32_t path_index[symbols + 1]     offsets in paths
+ *     uint32_t paths[]                     component ids (or NO_COMPONENT)
+ *
+ * Copyright 2022-2024, CompuPhase
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined __unix__ || defined __APPLE__
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+# define HAVE_MMAP
+#endif
+#include "classify.h"
+#include "symindex.h"
+
+#define SYMINDEX_MAGIC    "SYMX"
+#define SYMINDEX_VERSION  1
+#define NO_COMPONENT      UINT32_MAX  /* component that is not indexed (lambda, substitution) */
+#define MAX_COMPONENTS    64
+#define MAX_QUERY         16          /* maximum number of components in a query */
+
+struct symindex_header {
+  char magic[4];
+  uint32_t version;
+  uint32_t symbols;
+  uint32_t components;
+  uint64_t name_index;  /* file offsets of the sections */
+  uint64_t name_text;
+  uint64_t comp_index;
+  uint64_t comp_text;
+  uint64_t post_index;
+  uint64_t postings;
+  uint64_t path_index;
+  uint64_t paths;
+  uint64_t size;        /* total file size */
+};
+
+/* a set of interned strings, with ids in order of insertion */
+struct strpool {
+  char *text;
+  size_t size, capacity;
+  uint64_t *offsets;    /* start of each string in "text" */
+  uint32_t count, max;
+  uint32_t *slots;      /* hash table: id + 1, or 0 for an empty slot */
+  size_t mask;
+};
+
+struct symindex_builder {
+  struct strpool symbols;
+  struct strpool components;
+  uint32_t *paths;      /* component ids of all symbols, concatenated */
+  size_t pathsize, pathmax;
+  uint64_t *path_index; /* start of the path of each symbol (symbols.count + 1 entries) */
+  size_t indexmax;
+};
+
+struct symindex {
+  const unsigned char *data;
+  size_t size;
+  bool mapped;          /* data is mapped from a file (rather than attached) */
+  const struct symindex_header *header;
+  const uint64_t *name_index;
+  const char *name_text;
+  const uint32_t *comp_index;
+  const char *comp_text;
+  const uint32_t *post_index;
+  const uint32_t *postings;
+  const uint32_t *path_index;
+  const uint32_t *paths;
+};
+
+static uint64_t hash_text(const char *text, size_t length)
+{
+  /* FNV-1a */
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < length; i++)
+    hash = (hash ^ (uint8_t)text[i]) * 1099511628211ULL;
+  return hash;
+}
+
+static bool grow(void **array, uint32_t *max, size_t itemsize, size_t needed)
+{
+  if (needed <= *max)
+    return true;
+  size_t newmax = (*max > 0) ? *max : 64;
+  while (newmax < needed)
+    newmax *= 2;
+  if (newmax > UINT32_MAX)
+    return false;
+  void *p = realloc(*array, newmax * itemsize);
+  if (p == NULL)
+    return false;
+  *array = p;
+  *max = (uint32_t)newmax;
+  return true;
+}
+
+static void pool_free(struct strpool *pool)
+{
+  free(pool->text);
+  free(pool->offsets);
+  free(pool->slots);
+}
+
+static bool pool_rehash(struct strpool *pool)
+{
+  size_t slots = (pool->mask + 1) * 2;
+  if (slots < 256)
+    slots = 256;
+  uint32_t *table = calloc(slots, sizeof(uint32_t));
+  if (table == NULL)
+    return false;
+  for (uint32_t id = 0; id < pool->count; id++) {
+    const char *text = pool->text + pool->offsets[id];
+    size_t s = hash_text(text, strlen(text)) & (slots - 1);
+    while (table[s] != 0)
+      s = (s + 1) & (slots - 1);
+    table[s] = id + 1;
+  }
+  free(pool->slots);
+  pool->slots = table;
+  pool->mask = slots - 1;
+  return true;
+}
+
+/** pool_intern() - returns the id of the string (adding it if it is new), or
+ *  -1 on a memory allocation failure.
+ */
+static long pool_intern(struct strpool *pool, const char *text, size_t length, bool *added)
+{
+  *added = false;
+  if (pool->slots == NULL || 2 * (pool->count + 1) > pool->mask + 1)
+    if (!pool_rehash(pool))
+      return -1;
+  size_t s = hash_text(text, length) & pool->mask;
+  while (pool->slots[s] != 0) {
+    uint32_t id = pool->slots[s] - 1;
+    const char *str = pool->text + pool->offsets[id];
+    if (strncmp(str, text, length) == 0 && str[length] == '\0')
+      return id;
+    s = (s + 1) & pool->mask;
+  }
+  if (pool->count == UINT32_MAX - 1)
+    return -1;
+  if (!grow((void**)&pool->offsets, &pool->max, sizeof(uint64_t), pool->count + 1))
+    return -1;
+  if (pool->size + length + 1 > pool->capacity) {
+    size_t capacity = (pool->capacity > 0) ? pool->capacity : 4096;
+    while (capacity < pool->size + length + 1)
+      capacity *= 2;
+    char *p = realloc(pool->text, capacity);
+    if (p == NULL)
+      return -1;
+    pool->text = p;
+    pool->capacity = capacity;
+  }
+  memcpy(pool->text + pool->size, text, length);
+  pool->text[pool->size + length] = '\0';
+  pool->offsets[pool->count] = pool->size;
+  pool->size += length + 1;
+  pool->slots[s] = pool->count + 1;
+  *added = true;
+  return pool->count++;
+}
+
+struct symindex_builder *symindex_builder_create(void)
+{
+  struct symindex_builder *builder = calloc(1, sizeof(struct symindex_builder));
+  return builder;
+}
+
+void symindex_builder_destroy(struct symindex_builder *builder)
+{
+  if (builder == NULL)
+    return;
+  pool_free(&builder->symbols);
+  pool_free(&builder->components);
+  free(builder->paths);
+  free(builder->path_index);
+  free(builder);
+}
+
+/** component_text() - the text under which a component is indexed: the name
+ *  for identifiers and constructors, "~Name" for destructors, "operator+" for
+ *  operators. Returns the length, or 0 for components that are not indexed.
+ */
+static size_t component_text(const struct name_component *comp, char *buffer, size_t size)
+{
+  const char *prefix = "";
+  switch (comp->kind) {
+  case COMPONENT_NAME:
+  case COMPONENT_CTOR:
+    break;
+  case COMPONENT_DTOR:
+    prefix = "~";
+    break;
+  case COMPONENT_OPERATOR:
+    prefix = "operator";
+    break;
+  default:
+    return 0;
+  }
+  size_t plen = strlen(prefix);
+  if (plen + comp->length + 1 > size || plen + comp->length == 0)
+    return 0;
+  memcpy(buffer, prefix, plen);
+  memcpy(buffer + plen, comp->text, comp->length);
+  buffer[plen + comp->length] = '\0';
+  return plen + comp->length;
+}
+
+static bool reserve(struct symindex_builder *builder, size_t count)
+{
+  if (builder->pathsize + count > builder->pathmax) {
+    size_t newmax = (builder->pathmax > 0) ? builder->pathmax : 1024;
+    while (newmax < builder->pathsize + count)
+      newmax *= 2;
+    uint32_t *p = realloc(builder->paths, newmax * sizeof(uint32_t));
+    if (p == NULL)
+      return false;
+    builder->paths = p;
+    builder->pathmax = newmax;
+  }
+  if (builder->symbols.count + 2 > builder->indexmax) {
+    size_t newmax = (builder->indexmax > 0) ? 2 * builder->indexmax : 1024;
+    uint64_t *p = realloc(builder->path_index, newmax * sizeof(uint64_t));
+    if (p == NULL)
+      return false;
+    if (builder->indexmax == 0)
+      p[0] = 0;
+    builder->path_index = p;
+    builder->indexmax = newmax;
+  }
+  return true;
+}
+
+/** symindex_builder_add() - adds a symbol to the index, and returns its id.
+ *  A symbol that was added before keeps its id. Returns -1 if the name is not
+ *  a mangled name (or it is invalid), or on a memory allocation failure.
+ */
+long symindex_builder_add(struct symindex_builder *builder, const char *mangled)
+{
+  assert(builder != NULL);
+  assert(mangled != NULL);
+  struct name_component components[MAX_COMPONENTS];
+  int count = classify_name(mangled, components, MAX_COMPONENTS);
+  if (count < 0 || count > MAX_COMPONENTS)
+    return -1;
+
+  uint32_t path[MAX_COMPONENTS];
+  bool added;
+  for (int i = 0; i < count; i++) {
+    char text[1024];
+    size_t length = component_text(&components[i], text, sizeof text);
+    long comp = NO_COMPONENT;
+    if (length > 0 && (comp = pool_intern(&builder->components, text, length, &added)) < 0)
+      return -1;
+    path[i] = (uint32_t)comp;
+  }
+  if (!reserve(builder, count))
+    return -1;
+  long id = pool_intern(&builder->symbols, mangled, strlen(mangled), &added);
+  if (id < 0 || !added)
+    return id;
+  memcpy(builder->paths + builder->pathsize, path, count * sizeof(uint32_t));
+  builder->pathsize += count;
+  builder->path_index[id + 1] = builder->pathsize;
+  return id;
+}
+
+struct sortitem {
+  const char *text;
+  uint32_t id;
+};
+
+static int compare_items(const void *a, const void *b)
+{
+  const struct sortitem *pa = a, *pb = b;
+  return strcmp(pa->text, pb->text);
+}
+
+static uint64_t align8(uint64_t offset)
+{
+  return (offset + 7) & ~(uint64_t)7;
+}
+
+static bool write_section(FILE *fp, const void *data, size_t size, uint64_t offset, uint64_t *pos)
+{
+  /* pad up to the (aligned) offset of the section */
+  assert(offset >= *pos && offset - *pos < 8);
+  while (*pos < offset) {
+    if (fputc(0, fp) == EOF)
+      return false;
+    *pos += 1;
+  }
+  if (size > 0 && fwrite(data, 1, size, fp) != size)
+    return false;
+  *pos += size;
+  return true;
+}
+
+/** symindex_builder_write() - sorts the components, builds the posting lists,
+ *  and writes the index to a file. Returns false on failure.
+ */
+bool symindex_builder_write(struct symindex_builder *builder, const char *filename)
+{
+  assert(builder != NULL);
+  assert(filename != NULL);
+  uint32_t symbols = builder->symbols.count;
+  uint32_t components = builder->components.count;
+  size_t pathsize = builder->pathsize;
+  if (pathsize >= UINT32_MAX || builder->components.size >= UINT32_MAX)
+    return false;
+
+  struct sortitem *order = malloc((components + 1) * sizeof(struct sortitem));
+  uint32_t *remap = malloc((components + 1) * sizeof(uint32_t));
+  uint32_t *last = malloc((components + 1) * sizeof(uint32_t));
+  uint32_t *comp_index = malloc((components + 1) * sizeof(uint32_t));
+  uint32_t *post_index = calloc(components + 2, sizeof(uint32_t));
+  uint32_t *path_index = malloc((symbols + 1) * sizeof(uint32_t));
+  uint32_t *paths = malloc((pathsize + 1) * sizeof(uint32_t));
+  uint32_t *postings = malloc((pathsize + 1) * sizeof(uint32_t));
+  uint64_t *name_index = malloc((symbols + 1) * sizeof(uint64_t));
+  char *comp_text = malloc(builder->components.size + 1);
+  bool ok = false;
+  FILE *fp = NULL;
+  if (order == NULL || remap == NULL || last == NULL || comp_index == NULL || post_index == NULL
+      || path_index == NULL || paths == NULL || postings == NULL || name_index == NULL || comp_text == NULL)
+    goto done;
+
+  /* sort the components on their text, so that a query can look them up
+     with a binary search */
+  for (uint32_t i = 0; i < components; i++) {
+    order[i].text = builder->components.text + builder->components.offsets[i];
+    order[i].id = i;
+  }
+  qsort(order, components, sizeof(struct sortitem), compare_items);
+  uint32_t textpos = 0;
+  for (uint32_t i = 0; i < components; i++) {
+    size_t len = strlen(order[i].text) + 1;
+    comp_index[i] = textpos;
+    memcpy(comp_text + textpos, order[i].text, len);
+    textpos += (uint32_t)len;
+    remap[order[i].id] = i;
+  }
+  comp_index[components] = textpos;
+
+  /* renumber the paths; count the postings per component (a component that
+     occurs twice in a path, as in "Bar::Bar", is posted once) */
+  for (uint32_t c = 0; c < components; c++)
+    last[c] = UINT32_MAX;
+  for (uint32_t id = 0; id < symbols; id++) {
+    path_index[id] = (uint32_t)builder->path_index[id];
+    for (uint64_t p = builder->path_index[id]; p < builder->path_index[id + 1]; p++) {
+      uint32_t c = builder->paths[p];
+      if (c != NO_COMPONENT) {
+        c = remap[c];
+        if (last[c] != id) {
+          last[c] = id;
+          post_index[c + 1] += 1;
+        }
+      }
+      paths[p] = c;
+    }
+  }
+  path_index[symbols] = (uint32_t)pathsize;
+  for (uint32_t c = 0; c < components; c++)
+    post_index[c + 1] += post_index[c];
+  /* fill in the postings, using "last" as the fill position */
+  for (uint32_t c = 0; c < components; c++)
+    last[c] = post_index[c];
+  for (uint32_t id = 0; id < symbols; id++) {
+    for (uint32_t p = path_index[id]; p < path_index[id + 1]; p++) {
+      uint32_t c = paths[p];
+      if (c != NO_COMPONENT && (last[c] == post_index[c] || postings[last[c] - 1] != id))
+        postings[last[c]++] = id;
+    }
+  }
+  uint32_t postsize = post_index[components];
+
+  for (uint32_t id = 0; id < symbols; id++)
+    name_index[id] = builder->symbols.offsets[id];
+  name_index[symbols] = builder->symbols.size;
+
+  struct symindex_header header;
+  memset(&header, 0, sizeof header);
+  memcpy(header.magic, SYMINDEX_MAGIC, 4);
+  header.version = SYMINDEX_VERSION;
+  header.symbols = symbols;
+  header.components = components;
+  header.name_index = align8(sizeof header);
+  header.name_text = align8(header.name_index + (symbols + 1) * sizeof(uint64_t));
+  header.comp_index = align8(header.name_text + builder->symbols.size);
+  header.comp_text = align8(header.comp_index + (components + 1) * sizeof(uint32_t));
+  header.post_index = align8(header.comp_text + textpos);
+  header.postings = align8(header.post_index + (components + 1) * sizeof(uint32_t));
+  header.path_index = align8(header.postings + postsize * sizeof(uint32_t));
+  header.paths = align8(header.path_index + (symbols + 1) * sizeof(uint32_t));
+  header.size = header.paths + pathsize * sizeof(uint32_t);
+
+  fp = fopen(filename, "wb");
+  if (fp == NULL)
+    goto done;
+  uint64_t pos = 0;
+  ok = write_section(fp, &header, sizeof header, 0, &pos)
+       && write_section(fp, name_index, (symbols + 1) * sizeof(uint64_t), header.name_index, &pos)
+       && write_section(fp, builder->symbols.text, builder->symbols.size, header.name_text, &pos)
+       && write_section(fp, comp_index, (components + 1) * sizeof(uint32_t), header.comp_index, &pos)
+       && write_section(fp, comp_text, textpos, header.comp_text, &pos)
+       && write_section(fp, post_index, (components + 1) * sizeof(uint32_t), header.post_index, &pos)
+       && write_section(fp, postings, postsize * sizeof(uint32_t), header.postings, &pos)
+       && write_section(fp, path_index, (symbols + 1) * sizeof(uint32_t), header.path_index, &pos)
+       && write_section(fp, paths, pathsize * sizeof(uint32_t), header.paths, &pos);
+  assert(!ok || pos == header.size);
+done:
+  if (fp != NULL && fclose(fp) != 0)
+    ok = false;
+  free(order);
+  free(remap);
+  free(last);
+  free(comp_index);
+  free(post_index);
+  free(path_index);
+  free(paths);
+  free(postings);
+  free(name_index);
+  free(comp_text);
+  return ok;
+}
+
+static bool section_valid(const struct symindex *index, uint64_t offset, uint64_t count, size_t itemsize)
+{
+  return offset % 8 == 0 && offset <= index->size && count <= (index->size - offset) / itemsize;
+}
+
+/** symindex_attach() - uses an index that is in memory (for example, mapped
+ *  by the caller). The memory must stay valid until symindex_close(). Returns
+ *  NULL if the data is not a valid index.
+ */
+struct symindex *symindex_attach(const void *data, size_t size)
+{
+  assert(data != NULL || size == 0);
+  const struct symindex_header *header = data;
+  if (size < sizeof(struct symindex_header) || memcmp(header->magic, SYMINDEX_MAGIC, 4) != 0
+      || header->version != SYMINDEX_VERSION || header->size != size)
+    return NULL;
+  struct symindex *index = malloc(sizeof(struct symindex));
+  if (index == NULL)
+    return NULL;
+  index->data = data;
+  index->size = size;
+  index->mapped = false;
+  index->header = header;
+  uint64_t symbols = header->symbols;
+  uint64_t components = header->components;
+  if (!section_valid(index, header->name_index, symbols + 1, sizeof(uint64_t))
+      || !section_valid(index, header->comp_index, components + 1, sizeof(uint32_t))
+      || !section_valid(index, header->post_index, components + 1, sizeof(uint32_t))
+      || !section_valid(index, header->path_index, symbols + 1, sizeof(uint32_t))
+      || header->name_text > size || header->comp_text > size
+      || header->postings % 8 != 0 || header->postings > size
+      || header->paths % 8 != 0 || header->paths > size) {
+    free(index);
+    return NULL;
+  }
+  index->name_index = (const uint64_t*)(index->data + header->name_index);
+  index->name_text = (const char*)(index->data + header->name_text);
+  index->comp_index = (const uint32_t*)(index->data + header->comp_index);
+  index->comp_text = (const char*)(index->data + header->comp_text);
+  index->post_index = (const uint32_t*)(index->data + header->post_index);
+  index->postings = (const uint32_t*)(index->data + header->postings);
+  index->path_index = (const uint32_t*)(index->data + header->path_index);
+  index->paths = (const uint32_t*)(index->data + header->paths);
+  /* the ends of the variable-length sections */
+  if (index->name_index[symbols] > size - header->name_text
+      || index->comp_index[components] > size - header->comp_text
+      || index->post_index[components] > (size - header->postings) / sizeof(uint32_t)
+      || index->path_index[symbols] > (size - header->paths) / sizeof(uint32_t)) {
+    free(index);
+    return NULL;
+  }
+  return index;
+}
+
+/** symindex_open() - maps an index file into memory. Returns NULL if the file
+ *  cannot be read, or if it is not a valid index.
+ */
+struct symindex *symindex_open(const char *filename)
+{
+  assert(filename != NULL);
+  struct symindex *index = NULL;
+#if defined HAVE_MMAP
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0)
+    return NULL;
+  struct stat st;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data != MAP_FAILED) {
+      index = symindex_attach(data, st.st_size);
+      if (index != NULL)
+        index->mapped = true;
+      else
+        munmap(data, st.st_size);
+    }
+  }
+  close(fd);
+#else
+  FILE *fp = fopen(filename, "rb");
+  if (fp == NULL)
+    return NULL;
+  fseek(fp, 0, SEEK_END);
+  long size = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  void *data = (size > 0) ? malloc(size) : NULL;
+  if (data != NULL && fread(data, 1, size, fp) == (size_t)size)
+    index = symindex_attach(data, size);
+  if (index != NULL)
+    index->mapped = true;
+  else
+    free(data);
+  fclose(fp);
+#endif
+  return index;
+}
+
+void symindex_close(struct symindex *index)
+{
+  if (index == NULL)
+    return;
+  if (index->mapped) {
+#if defined HAVE_MMAP
+    munmap((void*)index->data, index->size);
+#else
+    free((void*)index->data);
+#endif
+  }
+  free(index);
+}
+
+size_t symindex_count(const struct symindex *index)
+{
+  assert(index != NULL);
+  return index->header->symbols;
+}
+
+/** symindex_symbol() - returns the mangled name of a symbol, or NULL if the
+ *  id is out of range.
+ */
+const char *symindex_symbol(const struct symindex *index, uint32_t id)
+{
+  assert(index != NULL);
+  if (id >= index->header->symbols)
+    return NULL;
+  return index->name_text + index->name_index[id];
+}
+
+static long find_component(const struct symindex *index, const char *text, size_t length)
+{
+  uint32_t low = 0, high = index->header->components;
+  while (low < high) {
+    uint32_t mid = low + (high - low) / 2;
+    const char *str = index->comp_text + index->comp_index[mid];
+    int cmp = strncmp(str, text, length);
+    if (cmp == 0 && str[length] != '\0')
+      cmp = 1;
+    if (cmp == 0)
+      return mid;
+    if (cmp < 0)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+  return -1;
+}
+
+/** symindex_postings() - returns the ids of all symbols that have the given
+ *  component (such as "detail", "HashSet", "~Widget" or "operator+")
+ *  anywhere in their qualified name, in ascending order. Returns NULL (and
+ *  sets "count" to 0) if there are none.
+ */
+const uint32_t *symindex_postings(const struct symindex *index, const char *component, size_t *count)
+{
+  assert(index != NULL);
+  assert(component != NULL);
+  assert(count != NULL);
+  *count = 0;
+  long c = find_component(index, component, strlen(component));
+  if (c < 0)
+    return NULL;
+  *count = index->post_index[c + 1] - index->post_index[c];
+  return index->postings + index->post_index[c];
+}
+
+/** gallop() - returns the position of the first entry in the (sorted) list
+ *  at or after "start" that is not smaller than "id".
+ */
+static uint32_t gallop(const uint32_t *list, uint32_t size, uint32_t start, uint32_t id)
+{
+  uint32_t step = 1;
+  uint32_t low = start, high = start;
+  while (high < size && list[high] < id) {
+    low = high + 1;
+    high += step;
+    step *= 2;
+  }
+  if (high > size)
+    high = size;
+  while (low < high) {
+    uint32_t mid = low + (high - low) / 2;
+    if (list[mid] < id)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+  return low;
+}
+
+/** symindex_find() - finds the symbols whose qualified name starts with the
+ *  components in "qualified" (for example "mylib::detail" or "Foo::bar"),
+ *  that is, the entity itself and everything declared inside it. Stores up to
+ *  "max" symbol ids in "ids", in ascending order, and returns the total
+ *  number of symbols found.
+ */
+size_t symindex_find(const struct symindex *index, const char *qualified, uint32_t *ids, size_t max)
+{
+  assert(index != NULL);
+  assert(qualified != NULL);
+  assert(ids != NULL || max == 0);
+  uint32_t query[MAX_QUERY];
+  int length = 0;
+  if (strncmp(qualified, "::", 2) == 0)
+    qualified += 2;
+  while (*qualified != '\0') {
+    const char *sep = strstr(qualified, "::");
+    size_t len = (sep != NULL) ? (size_t)(sep - qualified) : strlen(qualified);
+    if (length >= MAX_QUERY)
+      return 0;
+    long c = find_component(index, qualified, len);
+    if (c < 0)
+      return 0;
+    query[length++] = (uint32_t)c;
+    qualified += len;
+    if (sep != NULL)
+      qualified += 2;
+  }
+  if (length == 0)
+    return 0;
+
+  /* intersect the posting lists, starting from the shortest one; a galloping
+     search skips over long runs in the other lists. The positions of the
+     components are only checked (in the paths) for the symbols that are in
+     all lists. */
+  const uint32_t *list[MAX_QUERY];
+  uint32_t size[MAX_QUERY], cursor[MAX_QUERY];
+  int best = 0;
+  for (int i = 0; i < length; i++) {
+    list[i] = index->postings + index->post_index[query[i]];
+    size[i] = index->post_index[query[i] + 1] - index->post_index[query[i]];
+    cursor[i] = 0;
+    if (size[i] < size[best])
+      best = i;
+  }
+  size_t found = 0;
+  for (uint32_t p = 0; p < size[best]; p++) {
+    uint32_t id = list[best][p];
+    bool present = true;
+    for (int i = 0; i < length && present; i++) {
+      if (i == best)
+        continue;
+      cursor[i] = gallop(list[i], size[i], cursor[i], id);
+      present = cursor[i] < size[i] && list[i][cursor[i]] == id;
+    }
+    if (!present)
+      continue;
+    const uint32_t *path = index->paths + index->path_index[id];
+    uint32_t pathlength = index->path_index[id + 1] - index->path_index[id];
+    if (pathlength < (uint32_t)length || memcmp(path, query, length * sizeof(uint32_t)) != 0)
+      continue;
+    if (found < max)
+      ids[found] = id;
+    found++;
+  }
+  return found;
+}
@@ -0,0 +1,49 @@
+/* GNU C++ symbol name demangler
+ * Inverted index from the components of qualified names to symbols.
+ *
+ * Copyright 2022-2024, CompuPhase
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _SYMINDEX_H
+#define _SYMINDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+struct symindex_builder;
+struct symindex;
+
+struct symindex_builder *symindex_builder_create(void);
+void symindex_builder_destroy(struct symindex_builder *builder);
+long symindex_builder_add(struct symindex_builder *builder, const char *mangled);
+bool symindex_builder_write(struct symindex_builder *builder, const char *filename);
+
+struct symindex *symindex_open(const char *filename);
+struct symindex *symindex_attach(const void *data, size_t size);
+void symindex_close(struct symindex *index);
+size_t symindex_count(const struct symindex *index);
+const char *symindex_symbol(const struct symindex *index, uint32_t id);
+const uint32_t *symindex_postings(const struct symindex *index, const char *component, size_t *count);
+size_t symindex_find(const struct symindex *index, const char *qualified, uint32_t *ids, size_t max);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif /* _SYMINDEX_H */
@@ -3,8 +3,25 @@
  */
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include "classify.h"
+#include "dcache.h"
 #include "demangle.h"
+#include "dstep.h"
+#include "dwarfnames.h"
+#include "elfsym.h"
+#include "mangle.h"
+#include "namematch.h"
+#include "namestore.h"
+#include "nametok.h"
+#include "perfmap.h"
+#include "sortkey.h"
+#include "symindex.h"
+
+/* a name of 300 bytes, whose demangled form doubles in length with every
+   "1bI...E" that follows, to several gigabytes */
+static const char expanding[] = "_Z1f1a1bIS_S_E1bIS1_S1_E1bIS3_S3_E1bIS5_S5_E1bIS7_S7_E1bIS9_S9_E1bISB_SB_E1bISD_SD_E1bISF_SF_E1bISH_SH_E1bISJ_SJ_E1bISL_SL_E1bISN_SN_E1bISP_SP_E1bISR_SR_E1bIST_ST_E1bISV_SV_E1bISX_SX_E1bISZ_SZ_E1bIS11_S11_E1bIS13_S13_E1bIS15_S15_E1bIS17_S17_E1bIS19_S19_E1bIS1B_S1B_E1bIS1D_S1D_E1bIS1F_S1F_E1bIS1H_S1H_E";
 
 void test(const char *mangled, const char *plain)
 {
@@ -17,153 +34,945 @@ void test(const char *mangled, const char *plain)
   assert(strcmp(name, plain) == 0);
 }
 
+void test_hash(const char *mangled, const char *plain)
+{
+  uint64_t hash;
+  int result = demangle_hash(&hash, mangled);
+  if (strcmp(plain, "failed") != 0) {
+    assert(result == DEMANGLE_OK);
+    assert(hash == demangle_hash_text(plain, strlen(plain)));
+  }
+}
+
+static struct demangle_memo *memo;
+
+void test_memo(const char *mangled, const char *plain)
+{
+  char name[256];
+  if (demangle_memoized(memo, name, sizeof name, mangled) != DEMANGLE_OK)
+    strcpy(name, "failed");
+  assert(strcmp(name, plain) == 0);
+}
+
+static struct dstep *stepper;
+
+void test_dstep(const char *mangled, const char *plain)
+{
+  char name[256];
+  dstep_start(stepper, name, sizeof name, mangled);
+  int result;
+  while ((result = dstep_run(stepper, 1)) == DEMANGLE_PENDING)
+    {}
+  if (result != DEMANGLE_OK)
+    strcpy(name, "failed");
+  /* dstep has the recursion limit for small stacks, like demangle_scratch() */
+  static char scratch[16384];
+  char expected[256];
+  if (demangle_scratch(expected, sizeof expected, mangled, scratch, sizeof scratch) != DEMANGLE_OK)
+    strcpy(expected, "failed");
+  assert(strcmp(name, expected) == 0);
+  assert(strcmp(expected, plain) == 0 || strcmp(expected, "failed") == 0);
+  assert(dstep_run(stepper, 1) == result);
+}
+
+static struct nametok *tokentab;
+
+void test_nametok(const char *mangled, const char *plain)
+{
+  uint32_t tokens[512];
+  char text[2048];
+  long count = nametok_demangle(tokentab, mangled, tokens, 512);
+  if (strcmp(plain, "failed") == 0) {
+    assert(count < 0);
+    return;
+  }
+  assert(count > 0 && count <= 512);
+  size_t length = nametok_render(tokentab, tokens, count, text, sizeof text);
+  assert(length == strlen(plain) && strcmp(text, plain) == 0);
+  unsigned char packed[2048];
+  uint32_t unpacked[512];
+  size_t size = nametok_pack(tokens, count, packed, sizeof packed);
+  assert(size <= sizeof packed);
+  assert(nametok_unpack(packed, size, unpacked, 512) == (size_t)count);
+  assert(memcmp(tokens, unpacked, count * sizeof(uint32_t)) == 0);
+}
+
+void test_scratch(void)
+{
+  char name[256];
+  char scratch[4096];
+  const char *mangled = "_ZN5libcw5debug13cwprint_usingINS_9_private_12GlobalObjectEEENS0_17cwprint_using_tctIT_EERKS5_MS5_KFvRSt7ostreamE";
+  int result = demangle_scratch(name, sizeof name, mangled, scratch, sizeof scratch);
+  assert(result == DEMANGLE_OK);
+  char expected[256];
+  assert(demangle(expected, sizeof expected, mangled));
+  assert(strcmp(name, expected) == 0);
+  printf("%s -> %s (scratch)\n", mangled, name);
+  /* error codes */
+  assert(demangle_scratch(name, sizeof name, mangled, scratch, 64) == DEMANGLE_NOSCRATCH);
+  assert(demangle_scratch(name, 20, mangled, scratch, sizeof scratch) == DEMANGLE_OVERFLOW);
+  assert(demangle_scratch(name, sizeof name, "_ZN1fIL_", scratch, sizeof scratch) == DEMANGLE_INVALID);
+  assert(demangle_scratch(name, sizeof name, "main", scratch, sizeof scratch) == DEMANGLE_INVALID);
+  /* length-bounded input, with and without scratch buffer */
+  assert(demangle_n(name, sizeof name, "_Z1fv_Z1gv", 5, NULL, 0) == DEMANGLE_OK);
+  assert(strcmp(name, "f()") == 0);
+  assert(demangle_n(name, sizeof name, "_Z1fv_Z1gv", 3, scratch, sizeof scratch) == DEMANGLE_INVALID);
+  assert(demangle_type_n(name, sizeof name, "PKcXXX", 3, NULL, 0) == DEMANGLE_OK);
+  assert(strcmp(name, "char const*") == 0);
+  /* names that nest deeper than MAX_PARSE_DEPTH are only rejected by the
+     entry points for small stacks */
+  char deep[300] = "_Z1f";
+  memset(deep + 4, 'P', 200);
+  strcpy(deep + 204, "i");
+  assert(demangle_scratch(name, sizeof name, deep, scratch, sizeof scratch) == DEMANGLE_INVALID);
+  assert(demangle_n(name, sizeof name, deep, strlen(deep), NULL, 0) == DEMANGLE_OK);
+  assert(demangle(name, sizeof name, deep) && strlen(name) == 206);
+  /* the output never runs past "size", also not with the space in "> >" */
+  mangled = "_ZN4llvm3orc16ExecutionSession18createBareJITDylibENSt7__cxx1112basic_stringIcSt11char_traitsIcESaIcEEE";
+  assert(demangle(expected, sizeof expected, mangled));
+  size_t length = strlen(expected);
+  for (size_t size = 1; size <= length + 1; size++) {
+    memset(name, '#', sizeof name);
+    result = demangle_scratch(name, size, mangled, scratch, sizeof scratch);
+    assert(result == ((size > length) ? DEMANGLE_OK : DEMANGLE_OVERFLOW));
+    assert(name[size] == '#');  /* guard byte */
+  }
+}
+
+void test_dcache(void)
+{
+  struct dcache *cache = dcache_create(256);
+  assert(cache != NULL);
+  const char *mangled = "_ZN3foo3BarIiE11some_methodEPS1_";
+  char name[256], expected[256];
+  assert(demangle(expected, sizeof expected, mangled));
+  /* an output buffer that is too small is not a negative entry */
+  assert(dcache_demangle(cache, name, 8, mangled) == DEMANGLE_OVERFLOW);
+  assert(dcache_lookup(cache, mangled, NULL, 0) == 0);
+  assert(dcache_demangle(cache, name, sizeof name, mangled) == DEMANGLE_OK);
+  assert(strcmp(name, expected) == 0);
+  /* now a hit, also when the buffer is too small for it */
+  assert(dcache_lookup(cache, mangled, NULL, 0) == strlen(expected) + 1);
+  memset(name, 0, sizeof name);
+  assert(dcache_demangle(cache, name, sizeof name, mangled) == DEMANGLE_OK);
+  assert(strcmp(name, expected) == 0);
+  assert(dcache_demangle(cache, name, 8, mangled) == DEMANGLE_OVERFLOW);
+  /* an invalid name is a negative entry */
+  assert(dcache_demangle(cache, name, sizeof name, "_ZN1fIL_") == DEMANGLE_INVALID);
+  assert(dcache_lookup(cache, "_ZN1fIL_", NULL, 0) == DCACHE_INVALID);
+  assert(dcache_demangle(cache, name, sizeof name, "_ZN1fIL_") == DEMANGLE_INVALID);
+  /* type names, keyed on the pointer */
+  static const char type[] = "N3foo3BarIiEE";
+  assert(dcache_typename(cache, name, sizeof name, type) && strcmp(name, "foo::Bar<int>") == 0);
+  assert(dcache_typename(cache, name, sizeof name, type) && strcmp(name, "foo::Bar<int>") == 0);
+  assert(!dcache_typename(cache, name, 4, type));
+  assert(!dcache_typename(cache, name, sizeof name, "N3foo3BarE3"));
+#if defined __GNUC__
+  /* more names than slots: new names must still get cached; a cached name is
+     not decoded again, so changing the string shows whether it is a hit */
+  static char types[4096][2];
+  for (int i = 0; i < 4096; i++) {
+    strcpy(types[i], "i");
+    assert(dcache_typename(cache, name, sizeof name, types[i]) && strcmp(name, "int") == 0);
+    types[i][0] = 'c';
+    assert(dcache_typename(cache, name, sizeof name, types[i]) && strcmp(name, "int") == 0);
+  }
+#endif
+  dcache_destroy(cache);
+}
+
+char *__cxa_demangle(const char *mangled_name, char *output_buffer, size_t *length, int *status);
+
+void test_cxa_demangle(void)
+{
+  const char *mangled = "_ZN3foo3BarIiE11some_methodEPS1_";
+  char expected[256];
+  assert(demangle(expected, sizeof expected, mangled));
+  for (int pass = 0; pass < 2; pass++) {
+    /* the second pass takes the names from the cache */
+    int status = 99;
+    size_t length = 0;
+    char *text = __cxa_demangle(mangled, NULL, &length, &status);
+    assert(status == 0 && text != NULL && strcmp(text, expected) == 0);
+    assert(length == strlen(expected) + 1);
+    free(text);
+    /* a buffer that is too small is reallocated, a large one is reused */
+    char *buffer = malloc(4);
+    length = 4;
+    text = __cxa_demangle(mangled, buffer, &length, &status);
+    assert(status == 0 && text != NULL && strcmp(text, expected) == 0);
+    assert(length >= strlen(expected) + 1);
+    char *reused = __cxa_demangle(mangled, text, &length, &status);
+    assert(status == 0 && reused == text);
+    free(reused);
+    /* the size of a buffer that is large enough is left alone, on a cache
+       hit as well as on a miss */
+    buffer = malloc(512);
+    length = 512;
+    text = __cxa_demangle(mangled, buffer, &length, &status);
+    assert(status == 0 && text == buffer && length == 512);
+    text = __cxa_demangle(pass == 0 ? "_ZN3foo3BarIiE4sizeEv" : mangled, buffer, &length, &status);
+    assert(status == 0 && text == buffer && length == 512);
+    free(buffer);
+    text = __cxa_demangle("PKc", NULL, NULL, &status);
+    assert(status == 0 && strcmp(text, "char const*") == 0);
+    free(text);
+    assert(__cxa_demangle("_ZN1fIL_", NULL, NULL, &status) == NULL && status == -2);
+    assert(__cxa_demangle(NULL, NULL, NULL, &status) == NULL && status == -3);
+    assert(__cxa_demangle(expanding, NULL, NULL, &status) == NULL && status == -1);
+    buffer = malloc(16);
+    assert(__cxa_demangle(mangled, buffer, NULL, &status) == NULL && status == -3);
+    free(buffer);
+  }
+}
+
+void test_type(const char *name, const char *plain)
+{
+  char text[256];
+  int result = demangle_type(text, sizeof text, name);
+  if (!result)
+    strcpy(text, "failed");
+  printf("%s -> %s (type)\n", name, text);
+  assert(strcmp(text, plain) == 0);
+}
+
+void test_classify(const char *mangled, enum symbol_kind kind, unsigned flags, int depth)
+{
+  struct symbol_info info;
+  classify(mangled, &info);
+  printf("%s -> kind %d, flags 0x%02x, depth %d\n", mangled, info.kind, info.flags, info.depth);
+  assert(info.kind == kind);
+  assert(info.flags == flags);
+  assert(info.depth == depth);
+}
+
+static void count_strtab(const char *name, const struct symbol_info *info, void *arg)
+{
+  (void)name;
+  (void)info;
+  *(int*)arg += 1;
+}
+
+void test_namematch(const char *pattern, const char *mangled, bool expected)
+{
+  struct namematch *match = namematch_compile(pattern);
+  assert(match != NULL);
+  bool result = namematch(match, mangled);
+  printf("%s ~ %s -> %s\n", pattern, mangled, result ? "match" : "no match");
+  assert(result == expected);
+  namematch_free(match);
+}
+
+static void collect_matches(const char *mangled, const char *plain, void *arg)
+{
+  (void)mangled;
+  strcat((char*)arg, plain);
+  strcat((char*)arg, ";");
+}
+
+void test_mangle(const char *plain, const char *expected)
+{
+  char mangled[256];
+  int result = mangle(mangled, sizeof mangled, plain);
+  if (result != DEMANGLE_OK)
+    strcpy(mangled, "failed");
+  printf("%s -> %s (mangle)\n", plain, mangled);
+  assert(strcmp(mangled, expected) == 0);
+}
+
+/* names for which the plain form allows more than one encoding */
+void test_mangle_guess(const char *plain, const char *expected)
+{
+  char mangled[256];
+  int result = mangle(mangled, sizeof mangled, plain);
+  printf("%s -> %s (mangle, guess)\n", plain, (result == DEMANGLE_AMBIGUOUS) ? mangled : "failed");
+  assert(result == DEMANGLE_AMBIGUOUS && strcmp(mangled, expected) == 0);
+}
+
+/* a symbol emitted by a compiler (g++ on x86-64) must come back from its
+   demangled form; where that form allows several encodings, the result must
+   say so, and the guess may be another symbol ("same" is false) */
+void test_mangle_symbol(const char *symbol, int expected, bool same)
+{
+  char plain[512], mangled[512];
+  assert(demangle(plain, sizeof plain, symbol));
+  int result = mangle(mangled, sizeof mangled, plain);
+  printf("%s -> %s -> %s (mangle)\n", symbol, plain, (result == DEMANGLE_OK || result == DEMANGLE_AMBIGUOUS) ? mangled : "failed");
+  assert(result == expected);
+  assert((strcmp(mangled, symbol) == 0) == same);
+}
+
+/* names that the mangler supports must demangle back to the same name; the
+   mangled form may differ from the original (D1 versus D0, for example) */
+void test_mangle_roundtrip(const char *original, const char *plain)
+{
+  if (strcmp(plain, "failed") == 0 || strchr(original, '.') != NULL)
+    return;
+  char mangled[512], name[512];
+  int result = mangle(mangled, sizeof mangled, plain);
+  assert(result == DEMANGLE_OK || result == DEMANGLE_AMBIGUOUS || result == DEMANGLE_INVALID);
+  if (result != DEMANGLE_INVALID) {
+    assert(demangle(name, sizeof name, mangled));
+    assert(strcmp(name, plain) == 0);
+  }
+}
+
+static int compare_names(const void *a, const void *b)
+{
+  return demangle_compare(*(const char *const*)a, *(const char *const*)b);
+}
+
+static int sign(int value)
+{
+  return (value > 0) - (value < 0);
+}
+
+void test_sortkey(void)
+{
+  static const char *names[] = {
+#define TESTCASE(m, p)  m,
+#include "testcases.h"
+#undef TESTCASE
+    "main", "_Z1fv", "_Z1fv",
+  };
+  enum { COUNT = sizeof names / sizeof names[0] };
+  static struct sortkey keys[COUNT];
+  static const char *sorted[COUNT];
+  for (int i = 0; i < COUNT; i++) {
+    demangle_sortkey(&keys[i], names[i]);
+    sorted[i] = names[i];
+  }
+  static struct sortkey keys2[COUNT];
+  memcpy(keys2, keys, sizeof keys);
+  qsort(keys, COUNT, sizeof keys[0], sortkey_compare);
+  sortkey_sort(keys2, COUNT);
+  qsort(sorted, COUNT, sizeof sorted[0], compare_names);
+  for (int i = 0; i < COUNT; i++) {
+    char plain1[1024], plain2[1024];
+    if (!demangle(plain1, sizeof plain1, keys[i].mangled))
+      strcpy(plain1, keys[i].mangled);
+    if (!demangle(plain2, sizeof plain2, sorted[i]))
+      strcpy(plain2, sorted[i]);
+    assert(strcmp(plain1, plain2) == 0);  /* same order (equal names may swap) */
+    if (i > 0)
+      assert(sortkey_compare(&keys[i - 1], &keys[i]) <= 0);
+    assert(sortkey_compare(&keys[i], &keys2[i]) == 0);
+  }
+  assert(demangle_compare("_Z1fv", "_Z1gv") < 0);
+  assert(demangle_compare("_ZN1a1bEv", "_Z1fv") < 0);    /* "a::b()" before "f()" */
+  assert(demangle_compare("_ZN3foo3BarC1Ev", "_ZN3foo3BarC2Ev") == 0);
+  assert(sign(demangle_compare("main", "_Z4mainv")) == sign(strcmp("main", "main()")));
+
+  /* names with a common prefix that is longer than the key */
+  struct sortkey tie[3];
+  demangle_sortkey(&tie[0], "_ZNSt6vectorIN4llvm5ValueESaIS1_EE5beginEv");
+  demangle_sortkey(&tie[1], "_ZNSt6vectorIN4llvm5ValueESaIS1_EE4sizeEv");
+  demangle_sortkey(&tie[2], "a_plain_function_name_that_is_longer_than_the_prefix");
+  assert(tie[0].length > SORTKEY_PREFIX && tie[2].length > SORTKEY_PREFIX);
+  assert(sortkey_compare(&tie[0], &tie[1]) < 0 && sortkey_compare(&tie[1], &tie[0]) > 0);
+  assert(sortkey_compare(&tie[0], &tie[0]) == 0);
+  assert(sign(sortkey_compare(&tie[1], &tie[2])) == sign(demangle_compare(tie[1].mangled, tie[2].mangled)));
+  sortkey_sort(tie, 3);
+  assert(strcmp(tie[0].mangled, "a_plain_function_name_that_is_longer_than_the_prefix") == 0);
+  assert(strcmp(tie[1].mangled, "_ZNSt6vectorIN4llvm5ValueESaIS1_EE5beginEv") == 0);
+  printf("sort on demangled names: %d names\n", COUNT);
+}
+
+void test_perfmap(void)
+{
+  const char *filename = "test_perfmap.tmp";
+  FILE *fp = fopen(filename, "w");
+  assert(fp != NULL);
+  fputs("1000 20 _ZN3foo3barEv\n3000 10 LazyCompile:*main app.js:1\n2000 80 _Z1fi\nnot a line\n4000 8 _Z1", fp);
+  fclose(fp);
+  struct perfmap *map = perfmap_open(filename);
+  assert(map != NULL);
+  assert(perfmap_update(map) == 3);   /* the last line is not complete */
+  assert(perfmap_count(map) == 3);
+  const struct perfmap_entry *entry = perfmap_lookup(map, 0x1010);
+  assert(entry != NULL && strcmp(entry->name, "foo::bar()") == 0);
+  entry = perfmap_lookup(map, 0x3004);
+  assert(entry != NULL && strcmp(entry->name, "LazyCompile:*main app.js:1") == 0);
+  assert(perfmap_lookup(map, 0x1020) == NULL);
+  assert(perfmap_lookup(map, 0x0fff) == NULL);
+  assert(perfmap_update(map) == 0);
+
+  fp = fopen(filename, "a");
+  assert(fp != NULL);
+  fputs("gv\n0x1000 40 _Z3bazv\n", fp); /* completes the line, and replaces foo::bar() */
+  fclose(fp);
+  assert(perfmap_update(map) == 2);
+  assert(perfmap_count(map) == 4);
+  entry = perfmap_lookup(map, 0x4007);
+  assert(entry != NULL && strcmp(entry->name, "g()") == 0);
+  entry = perfmap_lookup(map, 0x1030);
+  assert(entry != NULL && strcmp(entry->name, "baz()") == 0);
+
+  /* a name that expands beyond DEMANGLE_MAX_PLAIN keeps its raw form */
+  fp = fopen(filename, "a");
+  assert(fp != NULL);
+  fprintf(fp, "5000 10 %s\n", expanding);
+  fclose(fp);
+  assert(perfmap_update(map) == 1);
+  entry = perfmap_lookup(map, 0x5000);
+  assert(entry != NULL && strcmp(entry->name, expanding) == 0);
+  perfmap_close(map);
+  remove(filename);
+}
+
+static void put_le(unsigned char *p, uint64_t value, int bytes)
+{
+  for (int i = 0; i < bytes; i++, value >>= 8)
+    p[i] = (unsigned char)value;
+}
+
+static void collect_symbol(const struct elfsym *sym, void *arg)
+{
+  char *found = arg;
+  if (sym->defined && sym->type == ELFSYM_FUNC)
+    sprintf(found + strlen(found), "%.*s@%x;", (int)sym->length, sym->name, (unsigned)sym->value);
+  else
+    sprintf(found + strlen(found), "%.*s;", (int)sym->length, sym->name);
+}
+
+void test_elfsym(void)
+{
+  /* a minimal 64-bit ELF file: the header, three section headers (null,
+     .symtab and .strtab), three symbols and the string table */
+  static const char strings[] = "\0_ZN3foo3barEv\0_Z1fi";
+  unsigned char elf[328 + sizeof strings];
+  memset(elf, 0, sizeof elf);
+  memcpy(elf, "\x7f" "ELF\2\1\1", 7);
+  put_le(elf + 0x28, 64, 8);          /* section header offset */
+  put_le(elf + 0x3a, 64, 2);          /* section header size */
+  put_le(elf + 0x3c, 3, 2);           /* number of sections */
+  unsigned char *section = elf + 64 + 64;
+  put_le(section + 4, 2, 4);          /* SHT_SYMTAB */
+  put_le(section + 24, 256, 8);
+  put_le(section + 32, 3 * 24, 8);
+  put_le(section + 40, 2, 4);         /* link to the string table */
+  put_le(section + 56, 24, 8);
+  section += 64;
+  put_le(section + 4, 3, 4);          /* SHT_STRTAB */
+  put_le(section + 24, 328, 8);
+  put_le(section + 32, sizeof strings, 8);
+  unsigned char *sym = elf + 256 + 24;
+  put_le(sym, 1, 4);
+  sym[4] = 0x12;                      /* global function */
+  put_le(sym + 6, 1, 2);
+  put_le(sym + 8, 0x1000, 8);
+  put_le(sym + 16, 0x20, 8);
+  sym += 24;
+  put_le(sym, 15, 4);
+  sym[4] = 0x10;                      /* undefined global */
+  memcpy(elf + 328, strings, sizeof strings);
+
+  char found[128] = "";
+  assert(elfsym_parse(elf, sizeof elf, collect_symbol, found) == 2);
+  printf("elfsym -> %s\n", found);
+  assert(strcmp(found, "_ZN3foo3barEv@1000;_Z1fi;") == 0);
+  /* a truncated file is rejected as a whole */
+  found[0] = '\0';
+  assert(elfsym_parse(elf, 300, collect_symbol, found) == -1 && found[0] == '\0');
+  assert(elfsym_parse("not an ELF file", 15, collect_symbol, found) == -1);
+
+  /* the same file as the only member of an archive */
+  unsigned char archive[8 + 60 + sizeof elf + 1];
+  memcpy(archive, "!<arch>\n", 8);
+  memset(archive + 8, ' ', 60);
+  memcpy(archive + 8, "elf.o/", 6);
+  char field[11];
+  sprintf(field, "%-10u", (unsigned)sizeof elf);
+  memcpy(archive + 8 + 48, field, 10);
+  memcpy(archive + 8 + 58, "`\n", 2);
+  memcpy(archive + 8 + 60, elf, sizeof elf);
+  archive[sizeof archive - 1] = '\n';
+  found[0] = '\0';
+  assert(elfsym_parse(archive, sizeof archive, collect_symbol, found) == 2);
+  assert(strcmp(found, "_ZN3foo3barEv@1000;_Z1fi;") == 0);
+}
+
+static void collect_linkage(const char *name, uint64_t key, void *arg)
+{
+  char *found = arg;
+  sprintf(found + strlen(found), "%s@%llx;", name, (unsigned long long)key);
+}
+
+void test_dwarfnames(void)
+{
+  /* an executable with .debug_info (a DWARF 4 and a DWARF 5 unit),
+     .debug_abbrev, .debug_str, .debug_str_offsets and .shstrtab */
+  static const unsigned char info[] = {
+    31, 0, 0, 0, 4, 0, 0, 0, 0, 0, 8,         /* DWARF 4 header, abbrev 0 */
+    1, 'a', '.', 'c', 'c', 0,                 /* compile unit, name inline */
+    2, 1, 0, 0, 0,                            /* linkage name, strp */
+    2, 1, 0, 0, 0,                            /* the same name again */
+    3, '_', 'Z', '1', 'g', 'v', 0,            /* MIPS linkage name, inline */
+    0,
+    18, 0, 0, 0, 5, 0, 1, 8, 26, 0, 0, 0,     /* DWARF 5 header, abbrev 26 */
+    1, 8, 0, 0, 0,                            /* compile unit, str_offsets_base */
+    2, 1,                                     /* linkage name, strx1 */
+    2, 0,
+    0
+  };
+  static const unsigned char abbrev[] = {
+    1, 0x11, 1, 0x03, 0x08, 0, 0,
+    2, 0x2e, 0, 0x6e, 0x0e, 0x3a, 0x21, 1, 0, 0,  /* with an implicit_const */
+    3, 0x2e, 0, 0x87, 0x40, 0x08, 0, 0,
+    0,
+    1, 0x11, 1, 0x72, 0x17, 0, 0,
+    2, 0x2e, 0, 0x6e, 0x25, 0, 0,
+    0
+  };
+  static const char str[] = "\0_ZN3foo3barEv\0_Z1fi";
+  static const unsigned char str_offsets[] = { 12, 0, 0, 0, 5, 0, 0, 0, 1, 0, 0, 0, 15, 0, 0, 0 };
+  static const char shstrtab[] = "\0.debug_info\0.debug_abbrev\0.debug_str\0.debug_str_offsets\0.shstrtab";
+  struct { const void *data; size_t size; } sections[] = {
+    { info, sizeof info }, { abbrev, sizeof abbrev }, { str, sizeof str },
+    { str_offsets, sizeof str_offsets }, { shstrtab, sizeof shstrtab }
+  };
+  unsigned char elf[1024];
+  memset(elf, 0, sizeof elf);
+  memcpy(elf, "\x7f" "ELF\2\1\1", 7);
+  put_le(elf + 0x10, 2, 2);           /* ET_EXEC */
+  put_le(elf + 0x28, 64, 8);          /* section header offset */
+  put_le(elf + 0x3a, 64, 2);          /* section header size */
+  put_le(elf + 0x3c, 6, 2);           /* number of sections */
+  put_le(elf + 0x3e, 5, 2);           /* section name string table */
+  size_t offset = 64 + 6 * 64;
+  const char *name = shstrtab + 1;
+  for (int i = 0; i < 5; i++) {
+    unsigned char *section = elf + 64 + (i + 1) * 64;
+    put_le(section, name - shstrtab, 4);
+    put_le(section + 4, (i < 4) ? 1 : 3, 4);  /* SHT_PROGBITS or SHT_STRTAB */
+    put_le(section + 24, offset, 8);
+    put_le(section + 32, sections[i].size, 8);
+    memcpy(elf + offset, sections[i].data, sections[i].size);
+    offset += sections[i].size;
+    name += strlen(name) + 1;
+  }
+  assert(offset <= sizeof elf);
+
+  struct dwarfnames *dw = dwarfnames_attach(elf, offset);
+  assert(dw != NULL);
+  uint64_t units[4];
+  assert(dwarfnames_units(dw, units, 4) == 2);
+  assert(units[0] == 0 && units[1] == 35);
+  char found[256] = "";
+  assert(dwarfnames_unit(dw, units[0], collect_linkage, found) == 3);
+  assert(dwarfnames_unit(dw, units[1], collect_linkage, found) == 2);
+  printf("dwarfnames -> %s\n", found);
+  /* the duplicate strp has the same key; the inline name is keyed on its
+     offset in .debug_info */
+  assert(strcmp(found, "_ZN3foo3barEv@1;_ZN3foo3barEv@1;_Z1gv@800000000000001c;"
+                       "_Z1fi@f;_ZN3foo3barEv@1;") == 0);
+  assert(dwarfnames_unit(dw, 1, collect_linkage, found) == -1);
+  dwarfnames_close(dw);
+
+  /* object files are rejected (their string offsets are not relocated) */
+  put_le(elf + 0x10, 1, 2);
+  assert(dwarfnames_attach(elf, offset) == NULL);
+}
+
+void test_namestore(void)
+{
+  const char *filename = "test_namestore.tmp";
+  struct namestore_builder *builder = namestore_builder_create();
+  assert(builder != NULL);
+  for (int i = 39; i >= 0; i--) {
+    char name[64];
+    sprintf(name, "std::__detail::_Hashtable<int,%02d>::find()", i);
+    assert(namestore_builder_add_plain(builder, name));
+  }
+  assert(namestore_builder_add(builder, "_ZN3foo3barEv") == DEMANGLE_OK);
+  assert(namestore_builder_add(builder, "_ZN3foo3barEv") == DEMANGLE_OK); /* duplicate */
+  assert(namestore_builder_add(builder, "_Z1fi") == DEMANGLE_OK);
+  assert(namestore_builder_add(builder, "_ZN1fIL_") == DEMANGLE_INVALID);
+  assert(namestore_builder_add(builder, expanding) == DEMANGLE_OVERFLOW);
+  assert(namestore_builder_write(builder, filename));
+  namestore_builder_destroy(builder);
+
+  struct namestore *store = namestore_open(filename);
+  assert(store != NULL);
+  assert(namestore_count(store) == 42);
+  char name[64];
+  assert(namestore_get(store, 0, name, sizeof name) == 6 && strcmp(name, "f(int)") == 0);
+  assert(namestore_get(store, 1, name, sizeof name) == 10 && strcmp(name, "foo::bar()") == 0);
+  assert(namestore_get(store, 2 + 17, name, sizeof name) == 41);
+  assert(strcmp(name, "std::__detail::_Hashtable<int,17>::find()") == 0);
+  assert(namestore_get(store, 41, name, 10) == 41 && strcmp(name, "std::__de") == 0);
+  assert(namestore_get(store, 42, name, sizeof name) == 0);
+  uint64_t id;
+  assert(namestore_find(store, "std::__detail::_Hashtable<int,33>::find()", &id) && id == 35);
+  assert(namestore_find(store, "f(int)", &id) && id == 0);
+  assert(!namestore_find(store, "std::__detail::_Hashtable<int,33>::find", &id));
+  assert(!namestore_find(store, "zzz", &id));
+  assert(!namestore_find(store, "", &id));
+
+  struct namestore_iter *iter = namestore_prefix(store, "std::__detail::_Hashtable<int,1");
+  assert(iter != NULL);
+  int count = 0;
+  const char *text;
+  while ((text = namestore_next(iter, &id)) != NULL) {
+    assert(id == (uint64_t)(12 + count));
+    count++;
+  }
+  assert(count == 10 && namestore_next(iter, NULL) == NULL);
+  namestore_iter_free(iter);
+  iter = namestore_prefix(store, "");
+  for (count = 0; namestore_next(iter, NULL) != NULL; count++)
+    {}
+  assert(count == 42);
+  namestore_iter_free(iter);
+  iter = namestore_prefix(store, "g");
+  assert(namestore_next(iter, NULL) == NULL);
+  namestore_iter_free(iter);
+  printf("namestore -> %lu names\n", (unsigned long)namestore_count(store));
+  namestore_close(store);
+  remove(filename);
+}
+
+void test_symindex(void)
+{
+  static const char *names[] = {
+    "_ZN5mylib6detail4hashEPKvm",
+    "_ZN5mylib6detail7HashSetIiE6insertERKi",
+    "_ZN5mylib6detail7HashSetIiEC2Ev",
+    "_ZN5mylib6detail7HashSetIiED2Ev",
+    "_ZN5mylib4openEPKc",
+    "_ZN5other6detail4hashEPKvm",
+    "_ZN3foo3BarC1Ev",
+    "_ZTVN5mylib6detail7HashSetIiEE",
+    "_ZN5mylib6detail4hashEPKvm",     /* duplicate */
+  };
+  const char *filename = "test_symindex.tmp";
+  struct symindex_builder *builder = symindex_builder_create();
+  assert(builder != NULL);
+  for (size_t i = 0; i < sizeof names / sizeof names[0]; i++)
+    assert(symindex_builder_add(builder, names[i]) >= 0);
+  assert(symindex_builder_add(builder, "_ZN5mylib6detail4hashEPKvm") == 0);
+  assert(symindex_builder_add(builder, "main") < 0);
+  assert(symindex_builder_write(builder, filename));
+  symindex_builder_destroy(builder);
+
+  struct symindex *index = symindex_open(filename);
+  assert(index != NULL);
+  assert(symindex_count(index) == 8);
+  uint32_t ids[16];
+  size_t count = symindex_find(index, "mylib::detail", ids, 16);
+  printf("mylib::detail -> %u symbols\n", (unsigned)count);
+  assert(count == 5);
+  count = symindex_find(index, "mylib::detail::HashSet", ids, 16);
+  assert(count == 4);
+  count = symindex_find(index, "mylib::detail::HashSet::~HashSet", ids, 16);
+  assert(count == 1 && strcmp(symindex_symbol(index, ids[0]), "_ZN5mylib6detail7HashSetIiED2Ev") == 0);
+  assert(symindex_find(index, "detail", ids, 16) == 0);
+  assert(symindex_find(index, "mylib::nothing", ids, 16) == 0);
+  assert(symindex_find(index, "mylib", ids, 2) == 6);
+  const uint32_t *postings = symindex_postings(index, "detail", &count);
+  assert(postings != NULL && count == 6);
+  postings = symindex_postings(index, "hash", &count);
+  assert(count == 2 && postings[0] == 0 && postings[1] == 5);
+  symindex_close(index);
+  remove(filename);
+}
+
 int main(int argc,char *argv[])
 {
-  test("_Z3funi", "fun(int)");
-  test("_Z3funv", "fun()");
-  test("_Z3foocis", "foo(char,int,short)");
-  test("_Z3fooPKi", "foo(int const*)");
-  test("_Z3fooPKiS_", "foo(int const*,int const)");
-  test("_Z3fooPKiS0_", "foo(int const*,int const*)");
-  test("_Z3foo3bar", "foo(bar)");
-  test("_Z3fooPKiS1_", "failed");
-  test("_Z10wxOnAssertPKciS0_S0_PKw@@WXU_3.0", "wxOnAssert(char const*,int,char const*,char const*,wchar_t const*)");
-  test("_ZN11KeyCfgFrame10GetKeyModeEi", "KeyCfgFrame::GetKeyMode(int)");
-  test("_ZN11wxAnyButton19DoSetBitmapPositionE11wxDirection@@WXU_3.0", "wxAnyButton::DoSetBitmapPosition(wxDirection)");
-  test("_Z1AIcfE", "A<char,float>");
-  test("_ZN19wxNavigationEnabledI16wxTopLevelWindowE8SetFocusEv", "wxNavigationEnabled<wxTopLevelWindow>::SetFocus()");
-  test("_ZN10GameOfLifeC1Eii", "GameOfLife::GameOfLife(int,int)");
-  test("_ZN10GameOfLifeD1Eii", "GameOfLife::~GameOfLife(int,int)");
-  test("_ZN3foo3BarIPcE11some_methodEPS2_S3_S3_", "foo::Bar<char*>::some_method(foo::Bar<char*>*,foo::Bar<char*>*,foo::Bar<char*>*)");
-  test("_ZN3foo3BarIiE11some_methodEPS1_S2_S2_", "foo::Bar<int>::some_method(foo::Bar<int>*,foo::Bar<int>*,foo::Bar<int>*)");
-  test("_ZN1a3fooENS_1AES0_", "a::foo(a::A,a::A)");
-  test("_ZmmAtl", "failed");
-  test("_ZZaSFvOEES_", "failed");
-  test("_ZZeqFvOEES_z", "failed");
-  test("_Z3fo5n", "fo5(__int128)");
-  test("_Z3fo5o", "fo5(unsigned __int128)");
-  test("_Zrm1XS_", "operator%(X,X)");
-  test("_ZplR1XS0_", "operator+(X&,X&)");
-  test("_ZlsRK1XS1_", "operator<<(X const&,X const&)");
-  test("_ZN3FooIA4_iE3barE", "Foo<int[4]>::bar");
-  test("_Z1fIiEvi", "void f<int>(int)");
-  test("_Z5firstI3DuoEvS0_", "void first<Duo>(Duo)");
-  test("_Z5firstI3DuoEvT_", "void first<Duo>(Duo)");
-  test("_Z3fooIiFvdEiEvv", "void foo<int,void(double),int>()");
-  test("_Z1fIFvvEEvv", "void f<void()>()");
-  test("_ZN6System5Sound4beepEv", "System::Sound::beep()");
-  test("_ZN5StackIiiE5levelE", "Stack<int,int>::level");
-  test("_Z1fI1XEvPVN1AIT_E1TE", "void f<X>(A<X>::T volatile*)");
-  test("_Z4makeI7FactoryiET_IT0_Ev", "Factory<int> make<Factory,int>()");
-  test("_Z3foo5Hello5WorldS0_S_", "foo(Hello,World,World,Hello)");
-  test("_ZlsRSoRKSs", "operator<<(std::ostream&,std::string const&)");
-  test("_Z3fooPM2ABi", "foo(int AB::**)");
-  test("_Z1fM1AKFvvE", "f(void (A::*)() const)");
-  test("_Z2f0Pu8char16_t", "f0(char16_t*)");
-  test("_ZZN1N1fEiE1p", "N::f(int)::p");
-  test("_ZZN1N1fEiEs", "N::f(int)::{string-literal}");
-  test("_Z1fPFvvEM1SFvvE", "f(void(*)(),void (S::*)())");
-  test("_ZN1N1TIiiE2mfES0_IddE", "N::T<int,int>::mf(N::T<double,double>)");
-  test("_ZSt5state", "std::state");
-  test("_ZNSt3_In4wardE", "std::_In::ward");
-  test("_Z1fA37_iPS_", "f(int[37],int(*)[37])");
-  test("_Z1fM1AFivEPS0_", "f(int (A::*)(),int(*)())");
-  test("_Z1fPKM1AFivE", "f(int (A::**)() const)");
-  test("_Z1jM1AFivEPS1_", "j(int (A::*)(),int (A::**)())");
-  test("_Z1sPA37_iPS0_", "s(int(*)[37],int(**)[37])");
-  test("_Z3fooA30_A_i", "foo(int[30][])");
-  test("_Z3kooPA28_A30_i", "koo(int(*)[28][30])");
-  test("_Z1fILin1EEvv", "void f<-1>()");
-  test("_ZlsRKU3fooU4bart1XS0_", "operator<<(X bart foo const&,X bart)");
-  test("_Z1fM1AKFivE", "f(int (A::*)() const)");
-  test("_Z3absILi11EEvv", "void abs<11>()");
-  test("_Z1fP1cIPFiiEE", "f(c<int(*)(int)>*)");
-  test("_Z1fPFPA1_ivE", "f(int(*(*)())[1])");
-  test("_ZN1AIsE1BIcEEiT_", "int A<short>::B<char>(char)");
-  test("_ZN12libcw_app_ct10add_optionIS_EEvMT_FvPKcES3_cS3_S3_", "void libcw_app_ct::add_option<libcw_app_ct>(void (libcw_app_ct::*)(char const*),char const*,char,char const*,char const*)");
-  test("_ZN5libcw5debug13cwprint_usingINS_9_private_12GlobalObjectEEENS0_17cwprint_using_tctIT_EERKS5_MS5_KFvRSt7ostreamE", "libcw::debug::cwprint_using_tct<libcw::_private_::GlobalObject> libcw::debug::cwprint_using<libcw::_private_::GlobalObject>(libcw::_private_::GlobalObject const&,void (libcw::_private_::GlobalObject::*)(std::ostream&) const)");
-  test("_ZNKSt15_Deque_iteratorIP15memory_block_stRKS1_PS2_EeqERKS5_", "std::_Deque_iterator<memory_block_st*,memory_block_st* const&,memory_block_st* const*>::operator==(std::_Deque_iterator<memory_block_st*,memory_block_st* const&,memory_block_st* const*> const&) const");
-  test("_Z1fI1APS0_PKS0_EvT_T0_T1_PA4_S3_M1CS8_", "void f<A,A*,A const*>(A,A*,A const*,A const*(*)[4],A const*(* C::*)[4])");
-  test("_ZNKSt17__normal_iteratorIPK6optionSt6vectorIS0_SaIS0_EEEmiERKS6_", "std::__normal_iterator<option const*,std::vector<option,std::allocator<option> > >::operator-(std::__normal_iterator<option const*,std::vector<option,std::allocator<option> > > const&) const");
-  test("_ZNSbIcSt11char_traitsIcEN5libcw5debug27no_alloc_checking_allocatorEE12_S_constructIPcEES6_T_S7_RKS3_", "char* std::basic_string<char,std::char_traits<char>,libcw::debug::no_alloc_checking_allocator>::_S_construct<char*>(char*,char*,libcw::debug::no_alloc_checking_allocator const&)");
-  test("_Z10hairyfunc5PFPFilEPcE", "hairyfunc5(int(*(*)(char*))(long))");
-  test("_ZNK11__gnu_debug16_Error_formatter14_M_format_wordImEEvPciPKcT_", "void __gnu_debug::_Error_formatter::_M_format_word<unsigned long>(char*,int,char const*,unsigned long) const");
-  test("_ZNSdD0Ev", "std::iostream::~iostream()");
-  test("_Z1fM1AKiPKS1_", "f(int const A::*,int const A::* const*)");
-  test("_ZSA", "failed");
-  test("_ZN1fIL_", "failed");
-  test("_Za", "failed");
-  test("_ZNSA", "failed");
-  test("_ZNT", "failed");
-  test("_Z1aMark", "failed");
-  test("_Z1fM1AKiPKS1_", "f(int const A::*,int const A::* const*)");
-  test("_ZZL3foo_2vE4var1", "foo()::var1");
-  test("_ZZL3foo_2vE4var1_0", "foo()::var1");
-  test("_Z1fN1SUt_E", "f(S::{unnamed type})");
-  test("_Z5outerIsEcPFilE", "char outer<short>(int(*)(long))");
-  test("_Z6outer2IsEPFilES1_", "int(*outer2<short>(int(*)(long)))(long)");
-  test("_Z5outerIsEcPFilE", "char outer<short>(int(*)(long))");
-  test("_Z5outerPFsiEl", "outer(short(*)(int),long)");
-  test("_Z3fooIA3_iEvRKT_", "void foo<int[3]>(int(&)[3] const)");
-  test("_Z3fooIPA3_iEvRKT_", "void foo<int(*)[3]>(int(*&)[3] const)");
-  test("_ZZ3BBdI3FooEvvENK3Fob3FabEv", "BBd<Foo>()::Fob::Fab() const");
-  test("_ZZZ3BBdI3FooEvvENK3Fob3FabEvENK3Gob3GabEv", "BBd<Foo>()::Fob::Fab() const::Gob::Gab() const");
-  test("_ZNK5boost6spirit5matchI13rcs_deltatextEcvMNS0_4impl5dummyEFvvEEv", "boost::spirit::match<rcs_deltatext>::operator void (boost::spirit::impl::dummy::*)()() const");
-  test("_ZNK1C1fIiEEPFivEv", "int(*C::f<int>() const)()");
-  test("_ZZN7myspaceL3foo_1EvEN11localstruct1fEZNS_3fooEvE16otherlocalstruct", "myspace::foo()::localstruct::f(myspace::foo()::otherlocalstruct)");
-  test("_Z1fDfDdDeDhDsDi", "f(decimal32,decimal64,decimal128,decimal16,char16_t,char32_t)");
-  test("_ZN1AdlEPv", "A::operator delete(void*)");
-  test("_Z1fIiERDaRKT_S1_", "auto& f<int>(int const&,int)");
-  test("_Z5totalIdEiT_S0_", "int total<double>(double,double)");
-  test("_Z5totalIidEiT_T0_", "int total<int,double>(int,double)");
-  test("_Z5totalIidfEiT_T0_T1_", "int total<int,double,float>(int,double,float)");
-  test("_ZStlsISt11char_traitsIcEERSt13basic_ostreamIcT_ES5_PKc@@GLIBCXX_3.4", "std::basic_ostream<char,std::char_traits<char> >& std::operator<< <std::char_traits<char> >(std::basic_ostream<char,std::char_traits<char> >&,char const*)");
-  test("_Z1gIJidEEvDpT_", "void g<int,double>(int,double)");
-  test("_Z1gIidEvDpT_", "void g<int,double>((int)...)");
-  test("_Z1fI1SENDtfp_E4typeET_", "decltype({parm#0})::type f<S>(S)");
-  test("_Z1fI1AEDtdtfp_srT_1xES1_", "decltype({parm#0}.A::x) f<A>(A)");
-  test("_Z3addIidEDTplL_Z1gEfp0_ET_T0_", "decltype(g+{parm#1}) add<int,double>(int,double)");
-  test("_Z1fIJPiPfPdEEvDpT_", "void f<int*,float*,double*>(int*,float*,double*)");
-  test("_ZngILi42EEvN1AIXplT_Li2EEE1TE", "void operator-<42>(A<42+2>::T)");
-  test("_Z1fIT_EvT_", "failed");
-  test("_Z20instantiate_with_intI3FooET_IiEv", "Foo<int> instantiate_with_int<Foo>()");
-  test("_Z3fooISt6vectorIiEEvv", "void foo<std::vector<int> >()");
-  test("_ZN3foo3barE3quxS0_", "foo::bar(qux,qux)");
-  test("_ZN4funcI2TyEEN6ResultIT_EES3_", "Result<Ty> func<Ty>(Result<Ty>)");
-  test("_ZN4funcI2TyEEN6ResultIT_EES2_", "Result<Ty> func<Ty>(Ty)");
-  test("_ZN4funcI2TyEEN6ResultIT_EES1_", "Result<Ty> func<Ty>(Result)");
-  test("_ZN4funcI2TyEEN6ResultIT_EES0_", "Result<Ty> func<Ty>(Ty)");
-  test("_ZN4funcI2TyEEN6ResultIT_EES_", "Result<Ty> func<Ty>(func)");
-  test("_ZN2Ty6methodIS_EEvMT_FvPKcES_", "void Ty::method<Ty>(void (Ty::*)(char const*),Ty)");
-  test("_ZN2Ty6methodIS_EEvMT_FvPKcES0_", "void Ty::method<Ty>(void (Ty::*)(char const*),Ty::method)");
-  test("_ZN2Ty6methodIS_EEvMT_FvPKcES1_", "void Ty::method<Ty>(void (Ty::*)(char const*),Ty)");
-  test("_ZN2Ty6methodIS_EEvMT_FvPKcES2_", "void Ty::method<Ty>(void (Ty::*)(char const*),char const)");
-  test("_ZN2Ty6methodIS_EEvMT_FvPKcES3_", "void Ty::method<Ty>(void (Ty::*)(char const*),char const*)");
-  test("_ZN2Ty6methodIS_EEvMT_FvPKcES4_", "void Ty::method<Ty>(void (Ty::*)(char const*),void(char const*))");
-  test("_ZN2Ty6methodIS_EEvMT_FvPKcES5_", "void Ty::method<Ty>(void (Ty::*)(char const*),void (Ty::*)(char const*))");
-  test("_ZNK1fB5cxx11Ev", "f[abi:cxx11]() const");
-  test("_ZUlvE_", "{lambda()#1}");
-  test("_ZUlisE_", "{lambda(int,short)#1}");
-  test("_ZZ3aaavEUlvE_", "aaa()::{lambda()#1}");
-  test("_ZZ3aaavENUlvE_3bbbE", "aaa()::{lambda()#1}::bbb");
-  test("_ZN3aaaUlvE_D1Ev", "aaa::{lambda()#1}::~aaa()");
-  test("_ZZ3aaavEN3bbbD1Ev", "aaa()::bbb::~bbb()");
-  test("_ZZ3aaavENUlvE_D1Ev", "aaa()::{lambda()#1}::~aaa()");
-  test("_Z3fooILb0EEvi", "void foo<false>(int)");
-  test("_Z3fooILb1EEvi", "void foo<true>(int)");
-  test("_Z3fooILb2EEvi", "void foo<(bool)2>(int)");
-  test("_ZN6WebKit25WebCacheStorageConnection17didReceiveMessageERN3IPC10ConnectionERNS1_7DecoderE", "WebKit::WebCacheStorageConnection::didReceiveMessage(IPC::Connection&,IPC::Decoder&)");
-  test("_ZN3IPC10Connection15dispatchMessageESt10unique_ptrINS_7DecoderESt14default_deleteIS2_EE", "IPC::Connection::dispatchMessage(std::unique_ptr<IPC::Decoder,std::default_delete<IPC::Decoder> >)");
-  test("_ZNK1QssERKS_", "Q::operator<=>(Q const&) const");
-  test("_ZNSt17_Function_handlerIFviEN3JPH19JobSystemThreadPool19mThreadInitFunctionMUliE_EE9_M_invokeERKSt9_Any_dataOi", "std::_Function_handler<void(int),JPH::JobSystemThreadPool::mThreadInitFunction::{lambda(int)#1}>::_M_invoke(std::_Any_data const&,int&&)");
-  test("_ZZZ1fILb0EJiiEEvvENKUlvE_clEvE1n", "f<false,int,int>()::{lambda()#1}::operator()() const::n");
-  test("_ZZZ1fILb0EJiiEEvvENKUlvE0_clEvE1n", "f<false,int,int>()::{lambda()#2}::operator()() const::n");
-  test("_ZN7HashSetI5IVec29AllocatorE11AddInternalIRKS0_EEbiOT_bPNS2_4IterE", "bool HashSet<IVec2,Allocator>::AddInternal<IVec2 const&>(int,IVec2 const&,bool,HashSet<IVec2,Allocator>::Iter*)");
-  test("_ZThn24_N13ZipFileStreamD1Ev", "non-virtual thunk to ZipFileStream::~ZipFileStream()");
-  test("_ZTvn24_n24_N13ZipFileStreamD1Ev", "virtual thunk to ZipFileStream::~ZipFileStream()");
-  test("_Z9gCatTraceIJRA17_KciEEvi7CStrArgDpOT_", "void gCatTrace<char const(&)[17],int>(int,CStrArg,char const(&)[17],int&&)");
-  test("_ZN12HashMultiMapIPK4RTTIS2_9AllocatorED1Ev", "HashMultiMap<RTTI const*,RTTI const*,Allocator>::~HashMultiMap()");
-  test("_Z18gQuickSortInternalIPi4LessIiEEvRKT_S5_RKT0_Ri", "void gQuickSortInternal<int*,Less<int> >(int* const&,int* const&,Less<int> const&,int&)");
+#define TESTCASE(m, p)  test(m, p);
+#include "testcases.h"
+#undef TESTCASE
+#define TESTCASE(m, p)  test_hash(m, p);
+#include "testcases.h"
+#undef TESTCASE
+  memo = demangle_memo_create(0);
+  assert(memo != NULL);
+  for (int pass = 0; pass < 2; pass++) {
+    /* the second pass replays the fragments that the first pass stored */
+#define TESTCASE(m, p)  test_memo(m, p);
+#include "testcases.h"
+#undef TESTCASE
+  }
+  {
+    unsigned long hits, misses;
+    demangle_memo_stats(memo, &hits, &misses);
+    assert(hits > 0);
+    demangle_memo_destroy(memo);
+    memo = demangle_memo_create(1024);  /* mostly full: fragments are no longer stored */
+    assert(memo != NULL);
+#define TESTCASE(m, p)  test_memo(m, p);
+#include "testcases.h"
+#undef TESTCASE
+    demangle_memo_destroy(memo);
+  }
+  stepper = dstep_create(0);
+  assert(stepper != NULL);
+#define TESTCASE(m, p)  test_dstep(m, p);
+#include "testcases.h"
+#undef TESTCASE
+  {
+    /* a name in slices of 2 steps, and a name that is abandoned halfway */
+    const char *mangled = "_ZN5libcw5debug13cwprint_usingINS_9_private_12GlobalObjectEEENS0_17cwprint_using_tctIT_EERKS5_MS5_KFvRSt7ostreamE";
+    char name[256], expected[256];
+    assert(demangle(expected, sizeof expected, mangled));
+    dstep_start(stepper, name, sizeof name, mangled);
+    int slices = 1;
+    while (dstep_run(stepper, 2) == DEMANGLE_PENDING)
+      slices++;
+    printf("%s -> %s (%d slices)\n", mangled, name, slices);
+    assert(slices > 2 && strcmp(name, expected) == 0);
+    dstep_start(stepper, name, sizeof name, mangled);
+    assert(dstep_run(stepper, 3) == DEMANGLE_PENDING);
+    dstep_start(stepper, name, 20, mangled);
+    assert(dstep_run(stepper, 1000) == DEMANGLE_OVERFLOW);
+    dstep_start(stepper, name, sizeof name, mangled);
+    assert(dstep_run(stepper, 1) == DEMANGLE_PENDING);
+    dstep_destroy(stepper);
+  }
+  tokentab = nametok_create();
+  assert(tokentab != NULL);
+#define TESTCASE(m, p)  test_nametok(m, p);
+#include "testcases.h"
+#undef TESTCASE
+  test_nametok(expanding, "failed");
+  {
+    uint32_t t1[16], t2[16], t3[16];
+    long c1 = nametok_intern(tokentab, "std::vector<int,std::allocator<int> >::size() const", t1, 16);
+    long c2 = nametok_intern(tokentab, "std::vector<int,std::allocator<int> >::size() const", t2, 16);
+    long c3 = nametok_intern(tokentab, "std::vector<int,std::allocator<int> >::empty() const", t3, 16);
+    printf("std::vector<int,std::allocator<int> >::size() const -> %ld tokens\n", c1);
+    assert(c1 == 8 && c2 == c1 && memcmp(t1, t2, c1 * sizeof(uint32_t)) == 0);
+    assert(c3 == c1 && memcmp(t1, t3, c1 * sizeof(uint32_t)) != 0);
+    size_t length;
+    const char *text = nametok_text(tokentab, t1[0], &length);
+    assert(length == 5 && memcmp(text, "std::", 5) == 0);
+    char name[20];
+    assert(nametok_render(tokentab, t1, c1, name, sizeof name) == 51 && strcmp(name, "std::vector<int,std") == 0);
+    assert(nametok_intern(tokentab, "", t1, 16) == 0);
+    assert(nametok_intern(tokentab, "::f", t1, 1) == 2);
+    unsigned char packed[8];
+    uint32_t ids[2] = { 5, 300 };
+    assert(nametok_pack(ids, 2, packed, sizeof packed) == 3 && packed[0] == 5);
+    nametok_destroy(tokentab);
+  }
+  {
+    /* a name that is longer than the initial buffer of demangle_hash() */
+    static char mangled[2048], plain[2048];
+    strcpy(mangled, "_ZN");
+    for (int i = 0; i < 300; i++)
+      strcat(mangled, "3abc");
+    strcat(mangled, "Ev");
+    assert(demangle(plain, sizeof plain, mangled));
+    uint64_t hash;
+    assert(demangle_hash(&hash, mangled) == DEMANGLE_OK);
+    assert(hash == demangle_hash_text(plain, strlen(plain)));
+    assert(demangle_hash(&hash, "_ZN1fIL_") == DEMANGLE_INVALID);
+    assert(demangle_hash(&hash, expanding) == DEMANGLE_OVERFLOW && hash == 0);
+
+    /* growing the output buffer stops at DEMANGLE_MAX_PLAIN */
+    char local[16], *buffer = local;
+    size_t size = sizeof local;
+    assert(demangle_grow(&buffer, &size, local, mangled, strlen(mangled)) == DEMANGLE_OK);
+    assert(buffer != local && strcmp(buffer, plain) == 0);
+    assert(demangle_grow(&buffer, &size, local, expanding, strlen(expanding)) == DEMANGLE_OVERFLOW);
+    assert(size == DEMANGLE_MAX_PLAIN);
+    free(buffer);
+  }
+  {
+    char name[64];
+    const char *mangled = "_ZNSt6vectorIS_IiSaIiEESaIS0_EE9push_backERKS0_";
+    assert(demangle_abbrev(name, sizeof name, mangled, 1) == DEMANGLE_OK);
+    assert(strcmp(name, "std::vector<std::vector<...>,std::allocator<...> >::push_bac...") == 0);
+    assert(demangle_abbrev(name, sizeof name, mangled, 0) == DEMANGLE_OK);
+    assert(strcmp(name, "std::vector<...>::push_back(std::allocator<...> const&)") == 0);
+    assert(demangle_abbrev(name, sizeof name, "_Z1fI1AIiEEvT_", 0) == DEMANGLE_OK);
+    assert(strcmp(name, "void f<...>(A<...>)") == 0);
+    assert(demangle_abbrev(name, sizeof name, "_ZStlsISt11char_traitsIcEERSt13basic_ostreamIcT_ES5_PKc", 0) == DEMANGLE_OK);
+    assert(strcmp(name, "std::basic_ostream<...>& std::operator<< <...>(std::basic_os...") == 0);
+    assert(demangle_abbrev(name, 4, "_Z1fv", -1) == DEMANGLE_OK && strcmp(name, "f()") == 0);
+    assert(demangle_abbrev(name, 3, "_Z1fv", -1) == DEMANGLE_OK && strcmp(name, "f(") == 0);
+    assert(demangle_abbrev(name, sizeof name, "_ZN1fIL_", 1) == DEMANGLE_INVALID);
+    /* the output is cut where it is full, without decoding the complete name
+       (which would take gigabytes for this one) */
+    assert(demangle_abbrev(name, sizeof name, expanding, -1) == DEMANGLE_OK);
+    assert(strlen(name) == sizeof name - 1 && strncmp(name, "f(a,b<a,a>,b<b<a,a>,", 20) == 0);
+    assert(strcmp(name + sizeof name - 4, "...") == 0);
+    assert(demangle_abbrev(name, sizeof name, expanding, 0) == DEMANGLE_OK);
+    assert(strcmp(name, "f(a,b<...>,b<...>,b<...>,b<...>,b<...>,b<...>,b<...>,b<...>,...") == 0);
+    /* elided arguments whose text is longer than the buffer for it */
+    char *longname = malloc(16 * 1024);
+    assert(longname != NULL);
+    strcpy(longname, "_Z1fI1XI");
+    for (int i = 0; i < 600; i++)
+      strcat(longname, "10abcdefghij");
+    strcat(longname, "EEvi");
+    size_t size = 1 << 20;
+    char *buffer = malloc(size);
+    assert(buffer != NULL);
+    assert(demangle_abbrev(buffer, size, longname, 0) == DEMANGLE_OK);
+    assert(strcmp(buffer, "void f<...>(int)") == 0);
+    assert(demangle_abbrev(buffer, size, longname, 1) == DEMANGLE_OK);
+    assert(strcmp(buffer, "void f<X<...> >(int)") == 0);
+    free(buffer);
+    free(longname);
+  }
+  test_scratch();
+  test_dcache();
+  test_cxa_demangle();
+  test_type("i", "int");
+  test_type("PKc", "char const*");
+  test_type("N3foo3BarIiEE", "foo::Bar<int>");
+  test_type("St6vectorIiSaIiEE", "std::vector<int,std::allocator<int> >");
+  test_type("FvRKSsE", "void(std::string const&)");
+  test_type("N3foo3BarE3", "failed");
+  test_type("", "failed");
+
+  test_classify("main", SYMBOL_NOT_MANGLED, 0, 0);
+  test_classify("_Z1fv", SYMBOL_FUNCTION, 0, 1);
+  test_classify("_ZSt4cout", SYMBOL_VARIABLE, 0, 2);
+  test_classify("_ZN3foo3BarC1Ev", SYMBOL_FUNCTION, SYMBOL_CTOR, 3);
+  test_classify("_ZN3foo3BarD2Ev", SYMBOL_FUNCTION, SYMBOL_DTOR, 3);
+  test_classify("_ZN3fooplERKS_S1_", SYMBOL_FUNCTION, SYMBOL_OPERATOR, 2);
+  test_classify("_ZNK3foo3BarcviEv", SYMBOL_FUNCTION, SYMBOL_OPERATOR, 3);
+  test_classify("_Z3maxIiET_S0_S0_", SYMBOL_FUNCTION, SYMBOL_TEMPLATE, 1);
+  test_classify("_ZNSt6vectorIiSaIiEE9push_backERKi", SYMBOL_FUNCTION, 0, 3);
+  test_classify("_ZZN3foo3barEvE5count", SYMBOL_VARIABLE, SYMBOL_LOCAL, 3);
+  test_classify("_Z1fv.cold", SYMBOL_FUNCTION, SYMBOL_CLONE, 1);
+  test_classify("_ZTV3Foo", SYMBOL_VTABLE, 0, 0);
+  test_classify("_ZTIN3foo3BarE", SYMBOL_TYPEINFO, 0, 0);
+  test_classify("_ZTSi", SYMBOL_TYPEINFO_NAME, 0, 0);
+  test_classify("_ZThn8_N3Foo3barEv", SYMBOL_THUNK, 0, 2);
+  test_classify("_ZGVZ4mainE1x", SYMBOL_GUARD, SYMBOL_LOCAL, 2);
+  test_classify("_ZGR1x_", SYMBOL_TEMPORARY, 0, 1);
+  test_classify("_ZN1fIL_", SYMBOL_INVALID, 0, 0);
+  {
+    static const char strtab[] = "\0main\0_Z1fv\0_ZTV3Foo\0_ZN3foo3barEv\0_ZTSi";
+    int count = 0;
+    size_t found = classify_strtab(strtab, sizeof strtab, SYMBOL_KIND_MASK(SYMBOL_FUNCTION), count_strtab, &count);
+    assert(found == 2 && count == 2);
+  }
+
+  test_namematch("foo::bar", "_ZN3foo3barEv", true);
+  test_namematch("foo::bar", "_ZN3foo3bazEv", false);
+  test_namematch("foo::bar", "_ZN3foo3bar3bazEv", false);
+  test_namematch("foo::**", "_ZN3foo3bar3bazEv", true);
+  test_namematch("foo::**", "_ZN4foo23barEv", false);
+  test_namematch("**::baz", "_ZN3foo3bar3bazEv", true);
+  test_namematch("foo::*::baz", "_ZN3foo3bar3bazEv", true);
+  test_namematch("foo::ba*", "_ZN3foo3barEv", true);
+  test_namematch("f", "_Z1fv", true);
+  test_namematch("f", "_Z1f", true);
+  test_namematch("HashSet<*>::*", "_ZN7HashSetIiE6insertERKi", true);
+  test_namematch("HashSet<*>::*", "_ZN7HashSet6insertERKi", false);
+  test_namematch("HashSet::*", "_ZN7HashSetIiE6insertERKi", true);
+  test_namematch("std::vector<*>::push_*", "_ZNSt6vectorIiSaIiEE9push_backERKi", true);
+  test_namematch("std::string::*", "_ZNSs6appendEPKc", true);
+  test_namematch("foo::Bar::Bar", "_ZN3foo3BarC1Ev", true);
+  test_namematch("foo::Bar::~Bar", "_ZN3foo3BarD2Ev", true);
+  test_namematch("foo::Bar::~Bar", "_ZN3foo3BarC2Ev", false);
+  test_namematch("foo::operator+", "_ZN3fooplERKS_S1_", true);
+  test_namematch("foo::operator-", "_ZN3fooplERKS_S1_", false);
+  test_namematch("foo::Bar::operator", "_ZNK3foo3BarcviEv", true);
+  test_namematch("foo::bar::count", "_ZZN3foo3barEvE5count", true);
+  test_namematch("Foo", "_ZTV3Foo", true);
+  test_namematch("Foo::bar", "_ZThn8_N3Foo3barEv", true);
+  test_namematch("max<*>", "_Z3maxIiET_S0_S0_", true);
+  test_namematch("**", "main", false);
+  assert(namematch_compile("foo::<int>") == NULL);
+  assert(namematch_compile("foo::") == NULL);
+  {
+    static const char strtab[] = "\0main\0_ZN3foo3barEv\0_ZN3baz3barEv\0_ZN3foo1XC1Ev";
+    char found[256] = "";
+    struct namematch *match = namematch_compile("foo::**");
+    assert(match != NULL);
+    size_t count = namematch_strtab(match, strtab, sizeof strtab, collect_matches, found);
+    printf("foo::** in strtab -> %s\n", found);
+    assert(count == 2 && strcmp(found, "foo::bar();foo::X::X();") == 0);
+    namematch_free(match);
+  }
+  {
+    /* an entry that expands beyond DEMANGLE_MAX_PLAIN is skipped */
+    static char strtab[sizeof expanding + 16];
+    memcpy(strtab, "\0_Z1fv", 7);
+    memcpy(strtab + 7, expanding, sizeof expanding);
+    char found[256] = "";
+    struct namematch *match = namematch_compile("f");
+    assert(match != NULL);
+    size_t count = namematch_strtab(match, strtab, 7 + sizeof expanding, collect_matches, found);
+    assert(count == 1 && strcmp(found, "f();") == 0);
+    namematch_free(match);
+  }
+
+  test_sortkey();
+  test_perfmap();
+  test_elfsym();
+  test_dwarfnames();
+  test_namestore();
+  test_symindex();
+
+#define TESTCASE(m, p)  test_mangle_roundtrip(m, p);
+#include "testcases.h"
+#undef TESTCASE
+  test_mangle("f()", "_Z1fv");
+  test_mangle_guess("foo::Bar<int>::some_method(foo::Bar<int>*,foo::Bar<int>*,foo::Bar<int>*)",
+                    "_ZN3foo3BarIiE11some_methodEPS1_S2_S2_");
+  test_mangle("operator<<(std::ostream&,std::string const&)", "_ZlsRSoRKSs");
+  test_mangle("Q::operator<<(Q const&) const", "_ZNK1QlsERKS_");
+  test_mangle("YAML::operator&(YAML::RegEx const&,YAML::RegEx const&)", "_ZN4YAMLanERKNS_5RegExES2_");
+  test_mangle("boost::mpi::operator-(boost::mpi::group const&,boost::mpi::group const&)", "_ZN5boost3mpimiERKNS0_5groupES3_");
+  test_mangle_guess("boost::mpi::operator-(boost::mpi::group const&)", "_ZN5boost3mpimiERKNS0_5groupE");  /* member or not */
+  test_mangle("YAML::operator!(YAML::RegEx const&)", "_ZN4YAMLntERKNS_5RegExE");
+  test_mangle_guess("V<int>::operator-(V<int> const&)", "_ZN1VIiEmiERKS0_");
+  test_mangle_guess("V<int>::operator-() const", "_ZNK1VIiEngEv");
+  test_mangle("Q::operator*(int) const", "_ZNK1QmlEi");
+  test_mangle("Q::operator*()", "_ZN1QdeEv");
+  test_mangle_guess("N::T<int,int>::mf(N::T<double,double>)", "_ZN1N1TIiiE2mfENS0_IddEE");
+  test_mangle_guess("f(A<int>,A<double>)", "_Z1f1AIiES_IdE");
+  test_mangle_guess("f(std::vector<int>,std::vector<double>)", "_Z1fSt6vectorIiES_IdE");
+  test_mangle_guess("Buf<250>::clear()", "_ZN3BufILi250EE5clearEv");
+  test_mangle_guess("Buf<(char)65>::clear()", "_ZN3BufILc65EE5clearEv");
+  test_mangle("j(int (A::*)(),A*)", "_Z1jM1AFivEPS_");
+  test_mangle("a::foo(a::A,a::A)", "_ZN1a3fooENS_1AES0_");
+  test_mangle("foo::Bar::~Bar()", "_ZN3foo3BarD1Ev");
+  test_mangle_guess("int max<int>(int,int)", "_Z3maxIiET_S0_S0_");
+  test_mangle_symbol("_ZN1a3fooENS_1AES0_", DEMANGLE_OK, true);
+  test_mangle_symbol("_Z8callbackPFviEPA4_i", DEMANGLE_OK, true);
+  test_mangle_symbol("_ZN2ns6Widget5countE", DEMANGLE_OK, true);
+  test_mangle_symbol("_ZN2ns6WidgetC1Ei", DEMANGLE_OK, true);
+  test_mangle_symbol("_ZN2ns6WidgetD1Ev", DEMANGLE_OK, true);
+  test_mangle_symbol("_ZN4YAMLanERKNS_5RegExES2_", DEMANGLE_OK, true);
+  test_mangle_symbol("_ZN4YAMLntERKNS_5RegExE", DEMANGLE_OK, true);
+  test_mangle_symbol("_ZN5boost3mpimiERKNS0_5groupES3_", DEMANGLE_OK, true);
+  test_mangle_symbol("_ZNK1QmlEi", DEMANGLE_OK, true);
+  test_mangle_symbol("_ZN1QdeEv", DEMANGLE_OK, true);
+  test_mangle_symbol("_ZN1N1TIiiE2mfENS0_IddEE", DEMANGLE_AMBIGUOUS, true);
+  test_mangle_symbol("_Z5twiceIdET_S0_S0_", DEMANGLE_AMBIGUOUS, true);
+  test_mangle_symbol("_ZN4IBufILi250EE5clearEv", DEMANGLE_AMBIGUOUS, true);
+  test_mangle_symbol("_ZNSt6vectorIiSaIiEE11_S_max_sizeERKS0_", DEMANGLE_AMBIGUOUS, true);
+  test_mangle_symbol("_ZNK2ns6Widget4drawERKNSt7__cxx1112basic_stringIcSt11char_traitsIcESaIcEEEi", DEMANGLE_AMBIGUOUS, true);
+  test_mangle_symbol("_ZNSt3mapINSt7__cxx1112basic_stringIcSt11char_traitsIcESaIcEEEiSt4lessIS5_ESaISt4pairIKS5_iEEEixEOS5_", DEMANGLE_AMBIGUOUS, true);
+  test_mangle_symbol("_ZNK9__gnu_cxx17__normal_iteratorIPiSt6vectorIiSaIiEEEmiEl", DEMANGLE_AMBIGUOUS, true);
+  test_mangle_symbol("_ZNK9__gnu_cxx17__normal_iteratorIPiSt6vectorIiSaIiEEEdeEv", DEMANGLE_AMBIGUOUS, true);
+  test_mangle_symbol("_ZN5boost3mpingERKNS0_5groupE", DEMANGLE_AMBIGUOUS, false);
+  test_mangle_symbol("_ZN4llvm13format_objectIJdEE4homeEv", DEMANGLE_AMBIGUOUS, false);
+  test_mangle_symbol("_ZN3BufILm250EE5clearEv", DEMANGLE_AMBIGUOUS, false);
+  test_mangle("vtable for Foo", "_ZTV3Foo");
+  test_mangle("typeinfo for foo::Bar", "_ZTIN3foo3BarE");
+  test_mangle("std::cout", "_ZSt4cout");
+  test_mangle("f(", "failed");
+  test_mangle("foo()::var", "failed");
+  {
+    /* a declarator that needs more nodes (or levels) than the encoder has */
+    char plain[400] = "f(int";
+    memset(plain + 5, '*', 300);
+    strcpy(plain + 305, ")");
+    char mangled[512];
+    assert(mangle(mangled, sizeof mangled, plain) == DEMANGLE_INVALID);
+  }
+  {
+    char mangled[8];
+    assert(mangle(mangled, sizeof mangled, "ns::Class<int>::method(char const*)") == DEMANGLE_OVERFLOW);
+  }
 
   printf("\nAll tests passed.\n");
   return 0;
@@ -0,0 +1,136 @@
+/* GNU C++ symbol name demangler
+ * Test file for the C++ interfaces (demangle.hpp and demangle_constexpr.hpp).
+ */
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include "demangle.hpp"
+#include "demangle_constexpr.hpp"
+
+struct testcase {
+  const char *mangled;
+  const char *plain;
+};
+
+constexpr testcase testcases[] = {
+#define TESTCASE(m, p)  { m, p },
+#include "testcases.h"
+#undef TESTCASE
+};
+
+/* returns the index of the first test vector that the constexpr demangler
+   gets wrong, or -1 if all are correct */
+constexpr int constexpr_mismatch()
+{
+  for (int i = 0; i < (int)std::size(testcases); i++) {
+    char plain[1024] = {};
+    bool ok = demangling::compile_time::demangle(plain, sizeof plain, testcases[i].mangled);
+    if (std::string_view(ok ? plain : "failed") != testcases[i].plain)
+      return i;
+  }
+  return -1;
+}
+static_assert(constexpr_mismatch() == -1, "constexpr demangler differs from the test vectors");
+static_assert(demangling::compile_time::demangle("_ZN3foo3barEv").view() == "foo::bar()");
+static_assert(demangling::compile_time::demangle_type("N3foo3BarIiEE").view() == "foo::Bar<int>");
+static_assert(!demangling::compile_time::demangle<8>("_ZN3foo3barEv").valid());
+
+/* a name of 300 bytes, whose demangled form doubles in length with every
+   "1bI...E" that follows, to several gigabytes */
+static const char expanding[] = "_Z1f1a1bIS_S_E1bIS1_S1_E1bIS3_S3_E1bIS5_S5_E1bIS7_S7_E1bIS9_S9_E1bISB_SB_E1bISD_SD_E1bISF_SF_E1bISH_SH_E1bISJ_SJ_E1bISL_SL_E1bISN_SN_E1bISP_SP_E1bISR_SR_E1bIST_ST_E1bISV_SV_E1bISX_SX_E1bISZ_SZ_E1bIS11_S11_E1bIS13_S13_E1bIS15_S15_E1bIS17_S17_E1bIS19_S19_E1bIS1B_S1B_E1bIS1D_S1D_E1bIS1F_S1F_E1bIS1H_S1H_E";
+
+/* for the test of an allocation failure in a context: when set, allocations
+   of this size or larger fail */
+static std::size_t fail_array_new = 0;
+void *operator new[](std::size_t size)
+{
+  void *block = (fail_array_new > 0 && size >= fail_array_new) ? nullptr : std::malloc(size ? size : 1);
+  if (block == nullptr)
+    throw std::bad_alloc();
+  return block;
+}
+void operator delete[](void *block) noexcept { std::free(block); }
+void operator delete[](void *block, std::size_t) noexcept { std::free(block); }
+
+static demangling::context ctx(64, 16);  /* small, to exercise the growing */
+
+void test(const char *mangled, const char *plain)
+{
+  std::string expected = std::strcmp(plain, "failed") == 0 ? "" : plain;
+
+  /* string_view over a buffer that is not zero-terminated */
+  std::string padded = std::string(mangled) + "###";
+  std::string_view input(padded.data(), std::strlen(mangled));
+  assert(ctx.demangle(input) == expected);
+
+  std::string str = "old contents";
+  bool ok = ctx.demangle(input, str);
+  assert(ok == !expected.empty() || (!ok && str.empty()));
+  assert(str == expected);
+
+  char pool[4096];
+  std::pmr::monotonic_buffer_resource resource(pool, sizeof pool);
+  std::pmr::string pstr("prefix: ", &resource);
+  ctx.append(input, pstr);
+  assert(std::string_view(pstr) == "prefix: " + expected);
+
+  demangling::small_name<32> small;
+  ctx.demangle(input, small);
+  assert(small.view() == expected);
+
+  /* the constexpr version, run at run time, must match demangle() */
+  char reference[1024], plain_ct[1024];
+  bool ok_c = demangle(reference, sizeof reference, mangled);
+  bool ok_ct = demangling::compile_time::demangle(plain_ct, sizeof plain_ct, mangled);
+  assert(ok_c == ok_ct);
+  assert(!ok_c || std::strcmp(reference, plain_ct) == 0);
+  printf("%s -> %s\n", mangled, str.c_str());
+}
+
+int main()
+{
+  for (const testcase &tc : testcases)
+    test(tc.mangled, tc.plain);
+
+  /* steady state: a reused string does not grow */
+  std::string out;
+  demangling::demangle("_ZN3foo3barEv", out);
+  const char *data = out.data();
+  demangling::demangle("_ZN3foo3bazEv", out);
+  assert(out == "foo::baz()" && out.data() == data);
+  assert(demangling::demangle("_Z1fv") == "f()");
+
+  std::string type;
+  assert(demangling::demangle_type("N3foo3BarIiEE", type) && type == "foo::Bar<int>");
+  assert(ctx.demangle_type("PKc") == "char const*");
+
+  /* a name whose output doubles with every component is refused, rather than
+     growing the buffers without bound */
+  std::string big = "prefix";
+  assert(ctx.demangle(expanding).empty());
+  assert(!ctx.append(expanding, big) && big == "prefix");
+  demangling::small_name<32> small;
+  assert(!ctx.demangle(expanding, small) && small.empty());
+
+  /* when growing the scratch memory fails, the context stays usable */
+  {
+    demangling::context tiny(16, 1024);
+    fail_array_new = 1024;
+    bool thrown = false;
+    try {
+      tiny.demangle("_ZN3foo3BarIiE11some_methodEPS1_S2_S2_");
+    } catch (const std::bad_alloc &) {
+      thrown = true;
+    }
+    fail_array_new = 0;
+    assert(thrown);
+    assert(tiny.demangle("_ZN3foo3BarIiE11some_methodEPS1_S2_S2_") == "foo::Bar<int>::some_method(foo::Bar<int>*,foo::Bar<int>*,foo::Bar<int>*)");
+  }
+
+  printf("\nAll tests passed.\n");
+  return 0;
+}
@@ -0,0 +1,156 @@
+/* GNU C++ symbol name demangler
+ * Test vectors, shared by the test, benchmark and fuzzing programs.
+ *
+ * Each line is a TESTCASE(mangled, plain) macro; define TESTCASE before
+ * including this file. Where the demangler must reject the input, "plain" is
+ * the string "failed".
+ */
+TESTCASE("_Z3funi", "fun(int)")
+TESTCASE("_Z3funv", "fun()")
+TESTCASE("_Z3foocis", "foo(char,int,short)")
+TESTCASE("_Z3fooPKi", "foo(int const*)")
+TESTCASE("_Z3fooPKiS_", "foo(int const*,int const)")
+TESTCASE("_Z3fooPKiS0_", "foo(int const*,int const*)")
+TESTCASE("_Z3foo3bar", "foo(bar)")
+TESTCASE("_Z3fooPKiS1_", "failed")
+TESTCASE("_Z10wxOnAssertPKciS0_S0_PKw@@WXU_3.0", "wxOnAssert(char const*,int,char const*,char const*,wchar_t const*)")
+TESTCASE("_ZN11KeyCfgFrame10GetKeyModeEi", "KeyCfgFrame::GetKeyMode(int)")
+TESTCASE("_ZN11wxAnyButton19DoSetBitmapPositionE11wxDirection@@WXU_3.0", "wxAnyButton::DoSetBitmapPosition(wxDirection)")
+TESTCASE("_Z1AIcfE", "A<char,float>")
+TESTCASE("_ZN19wxNavigationEnabledI16wxTopLevelWindowE8SetFocusEv", "wxNavigationEnabled<wxTopLevelWindow>::SetFocus()")
+TESTCASE("_ZN10GameOfLifeC1Eii", "GameOfLife::GameOfLife(int,int)")
+TESTCASE("_ZN10GameOfLifeD1Eii", "GameOfLife::~GameOfLife(int,int)")
+TESTCASE("_ZN3foo3BarIPcE11some_methodEPS2_S3_S3_", "foo::Bar<char*>::some_method(foo::Bar<char*>*,foo::Bar<char*>*,foo::Bar<char*>*)")
+TESTCASE("_ZN3foo3BarIiE11some_methodEPS1_S2_S2_", "foo::Bar<int>::some_method(foo::Bar<int>*,foo::Bar<int>*,foo::Bar<int>*)")
+TESTCASE("_ZN1a3fooENS_1AES0_", "a::foo(a::A,a::A)")
+TESTCASE("_ZmmAtl", "failed")
+TESTCASE("_ZZaSFvOEES_", "failed")
+TESTCASE("_ZZeqFvOEES_z", "failed")
+TESTCASE("_Z3fo5n", "fo5(__int128)")
+TESTCASE("_Z3fo5o", "fo5(unsigned __int128)")
+TESTCASE("_Zrm1XS_", "operator%(X,X)")
+TESTCASE("_ZplR1XS0_", "operator+(X&,X&)")
+TESTCASE("_ZlsRK1XS1_", "operator<<(X const&,X const&)")
+TESTCASE("_ZN3FooIA4_iE3barE", "Foo<int[4]>::bar")
+TESTCASE("_Z1fIiEvi", "void f<int>(int)")
+TESTCASE("_Z5firstI3DuoEvS0_", "void first<Duo>(Duo)")
+TESTCASE("_Z5firstI3DuoEvT_", "void first<Duo>(Duo)")
+TESTCASE("_Z3fooIiFvdEiEvv", "void foo<int,void(double),int>()")
+TESTCASE("_Z1fIFvvEEvv", "void f<void()>()")
+TESTCASE("_ZN6System5Sound4beepEv", "System::Sound::beep()")
+TESTCASE("_ZN5StackIiiE5levelE", "Stack<int,int>::level")
+TESTCASE("_Z1fI1XEvPVN1AIT_E1TE", "void f<X>(A<X>::T volatile*)")
+TESTCASE("_Z4makeI7FactoryiET_IT0_Ev", "Factory<int> make<Factory,int>()")
+TESTCASE("_Z3foo5Hello5WorldS0_S_", "foo(Hello,World,World,Hello)")
+TESTCASE("_ZlsRSoRKSs", "operator<<(std::ostream&,std::string const&)")
+TESTCASE("_Z3fooPM2ABi", "foo(int AB::**)")
+TESTCASE("_Z1fM1AKFvvE", "f(void (A::*)() const)")
+TESTCASE("_Z2f0Pu8char16_t", "f0(char16_t*)")
+TESTCASE("_ZZN1N1fEiE1p", "N::f(int)::p")
+TESTCASE("_ZZN1N1fEiEs", "N::f(int)::{string-literal}")
+TESTCASE("_Z1fPFvvEM1SFvvE", "f(void(*)(),void (S::*)())")
+TESTCASE("_ZN1N1TIiiE2mfES0_IddE", "N::T<int,int>::mf(N::T<double,double>)")
+TESTCASE("_ZSt5state", "std::state")
+TESTCASE("_ZNSt3_In4wardE", "std::_In::ward")
+TESTCASE("_Z1fA37_iPS_", "f(int[37],int(*)[37])")
+TESTCASE("_Z1fM1AFivEPS0_", "f(int (A::*)(),int(*)())")
+TESTCASE("_Z1fPKM1AFivE", "f(int (A::**)() const)")
+TESTCASE("_Z1jM1AFivEPS1_", "j(int (A::*)(),int (A::**)())")
+TESTCASE("_Z1sPA37_iPS0_", "s(int(*)[37],int(**)[37])")
+TESTCASE("_Z3fooA30_A_i", "foo(int[30][])")
+TESTCASE("_Z3kooPA28_A30_i", "koo(int(*)[28][30])")
+TESTCASE("_Z1fA3000000000_i", "f(int[3000000000])")
+TESTCASE("_Z1fILin1EEvv", "void f<-1>()")
+TESTCASE("_ZlsRKU3fooU4bart1XS0_", "operator<<(X bart foo const&,X bart)")
+TESTCASE("_Z1fM1AKFivE", "f(int (A::*)() const)")
+TESTCASE("_Z3absILi11EEvv", "void abs<11>()")
+TESTCASE("_Z1fP1cIPFiiEE", "f(c<int(*)(int)>*)")
+TESTCASE("_Z1fPFPA1_ivE", "f(int(*(*)())[1])")
+TESTCASE("_ZN1AIsE1BIcEEiT_", "int A<short>::B<char>(char)")
+TESTCASE("_ZN12libcw_app_ct10add_optionIS_EEvMT_FvPKcES3_cS3_S3_", "void libcw_app_ct::add_option<libcw_app_ct>(void (libcw_app_ct::*)(char const*),char const*,char,char const*,char const*)")
+TESTCASE("_ZN5libcw5debug13cwprint_usingINS_9_private_12GlobalObjectEEENS0_17cwprint_using_tctIT_EERKS5_MS5_KFvRSt7ostreamE", "libcw::debug::cwprint_using_tct<libcw::_private_::GlobalObject> libcw::debug::cwprint_using<libcw::_private_::GlobalObject>(libcw::_private_::GlobalObject const&,void (libcw::_private_::GlobalObject::*)(std::ostream&) const)")
+TESTCASE("_ZNKSt15_Deque_iteratorIP15memory_block_stRKS1_PS2_EeqERKS5_", "std::_Deque_iterator<memory_block_st*,memory_block_st* const&,memory_block_st* const*>::operator==(std::_Deque_iterator<memory_block_st*,memory_block_st* const&,memory_block_st* const*> const&) const")
+TESTCASE("_Z1fI1APS0_PKS0_EvT_T0_T1_PA4_S3_M1CS8_", "void f<A,A*,A const*>(A,A*,A const*,A const*(*)[4],A const*(* C::*)[4])")
+TESTCASE("_ZNKSt17__normal_iteratorIPK6optionSt6vectorIS0_SaIS0_EEEmiERKS6_", "std::__normal_iterator<option const*,std::vector<option,std::allocator<option> > >::operator-(std::__normal_iterator<option const*,std::vector<option,std::allocator<option> > > const&) const")
+TESTCASE("_ZNSbIcSt11char_traitsIcEN5libcw5debug27no_alloc_checking_allocatorEE12_S_constructIPcEES6_T_S7_RKS3_", "char* std::basic_string<char,std::char_traits<char>,libcw::debug::no_alloc_checking_allocator>::_S_construct<char*>(char*,char*,libcw::debug::no_alloc_checking_allocator const&)")
+TESTCASE("_Z10hairyfunc5PFPFilEPcE", "hairyfunc5(int(*(*)(char*))(long))")
+TESTCASE("_ZNK11__gnu_debug16_Error_formatter14_M_format_wordImEEvPciPKcT_", "void __gnu_debug::_Error_formatter::_M_format_word<unsigned long>(char*,int,char const*,unsigned long) const")
+TESTCASE("_ZNSdD0Ev", "std::iostream::~iostream()")
+TESTCASE("_Z1fM1AKiPKS1_", "f(int const A::*,int const A::* const*)")
+TESTCASE("_ZSA", "failed")
+TESTCASE("_ZN1fIL_", "failed")
+TESTCASE("_Za", "failed")
+TESTCASE("_ZNSA", "failed")
+TESTCASE("_ZNT", "failed")
+TESTCASE("_Z1aMark", "failed")
+TESTCASE("_Z1fM1AKiPKS1_", "f(int const A::*,int const A::* const*)")
+TESTCASE("_ZZL3foo_2vE4var1", "foo()::var1")
+TESTCASE("_ZZL3foo_2vE4var1_0", "foo()::var1")
+TESTCASE("_Z1fN1SUt_E", "f(S::{unnamed type})")
+TESTCASE("_Z5outerIsEcPFilE", "char outer<short>(int(*)(long))")
+TESTCASE("_Z6outer2IsEPFilES1_", "int(*outer2<short>(int(*)(long)))(long)")
+TESTCASE("_Z5outerIsEcPFilE", "char outer<short>(int(*)(long))")
+TESTCASE("_Z5outerPFsiEl", "outer(short(*)(int),long)")
+TESTCASE("_Z3fooIA3_iEvRKT_", "void foo<int[3]>(int(&)[3] const)")
+TESTCASE("_Z3fooIPA3_iEvRKT_", "void foo<int(*)[3]>(int(*&)[3] const)")
+TESTCASE("_ZZ3BBdI3FooEvvENK3Fob3FabEv", "BBd<Foo>()::Fob::Fab() const")
+TESTCASE("_ZZZ3BBdI3FooEvvENK3Fob3FabEvENK3Gob3GabEv", "BBd<Foo>()::Fob::Fab() const::Gob::Gab() const")
+TESTCASE("_ZNK5boost6spirit5matchI13rcs_deltatextEcvMNS0_4impl5dummyEFvvEEv", "boost::spirit::match<rcs_deltatext>::operator void (boost::spirit::impl::dummy::*)()() const")
+TESTCASE("_ZNK1C1fIiEEPFivEv", "int(*C::f<int>() const)()")
+TESTCASE("_ZZN7myspaceL3foo_1EvEN11localstruct1fEZNS_3fooEvE16otherlocalstruct", "myspace::foo()::localstruct::f(myspace::foo()::otherlocalstruct)")
+TESTCASE("_Z1fDfDdDeDhDsDi", "f(decimal32,decimal64,decimal128,decimal16,char16_t,char32_t)")
+TESTCASE("_ZN1AdlEPv", "A::operator delete(void*)")
+TESTCASE("_Z1fIiERDaRKT_S1_", "auto& f<int>(int const&,int)")
+TESTCASE("_Z5totalIdEiT_S0_", "int total<double>(double,double)")
+TESTCASE("_Z5totalIidEiT_T0_", "int total<int,double>(int,double)")
+TESTCASE("_Z5totalIidfEiT_T0_T1_", "int total<int,double,float>(int,double,float)")
+TESTCASE("_ZStlsISt11char_traitsIcEERSt13basic_ostreamIcT_ES5_PKc@@GLIBCXX_3.4", "std::basic_ostream<char,std::char_traits<char> >& std::operator<< <std::char_traits<char> >(std::basic_ostream<char,std::char_traits<char> >&,char const*)")
+TESTCASE("_Z1gIJidEEvDpT_", "void g<int,double>(int,double)")
+TESTCASE("_Z1gIidEvDpT_", "void g<int,double>((int)...)")
+TESTCASE("_Z1fI1SENDtfp_E4typeET_", "decltype({parm#0})::type f<S>(S)")
+TESTCASE("_Z1fI1AEDtdtfp_srT_1xES1_", "decltype({parm#0}.A::x) f<A>(A)")
+TESTCASE("_Z3addIidEDTplL_Z1gEfp0_ET_T0_", "decltype(g+{parm#1}) add<int,double>(int,double)")
+TESTCASE("_Z1fIJPiPfPdEEvDpT_", "void f<int*,float*,double*>(int*,float*,double*)")
+TESTCASE("_ZngILi42EEvN1AIXplT_Li2EEE1TE", "void operator-<42>(A<42+2>::T)")
+TESTCASE("_Z1fIT_EvT_", "failed")
+TESTCASE("_Z20instantiate_with_intI3FooET_IiEv", "Foo<int> instantiate_with_int<Foo>()")
+TESTCASE("_Z3fooISt6vectorIiEEvv", "void foo<std::vector<int> >()")
+TESTCASE("_ZN3foo3barE3quxS0_", "foo::bar(qux,qux)")
+TESTCASE("_ZN4funcI2TyEEN6ResultIT_EES3_", "Result<Ty> func<Ty>(Result<Ty>)")
+TESTCASE("_ZN4funcI2TyEEN6ResultIT_EES2_", "Result<Ty> func<Ty>(Ty)")
+TESTCASE("_ZN4funcI2TyEEN6ResultIT_EES1_", "Result<Ty> func<Ty>(Result)")
+TESTCASE("_ZN4funcI2TyEEN6ResultIT_EES0_", "Result<Ty> func<Ty>(Ty)")
+TESTCASE("_ZN4funcI2TyEEN6ResultIT_EES_", "Result<Ty> func<Ty>(func)")
+TESTCASE("_ZN2Ty6methodIS_EEvMT_FvPKcES_", "void Ty::method<Ty>(void (Ty::*)(char const*),Ty)")
+TESTCASE("_ZN2Ty6methodIS_EEvMT_FvPKcES0_", "void Ty::method<Ty>(void (Ty::*)(char const*),Ty::method)")
+TESTCASE("_ZN2Ty6methodIS_EEvMT_FvPKcES1_", "void Ty::method<Ty>(void (Ty::*)(char const*),Ty)")
+TESTCASE("_ZN2Ty6methodIS_EEvMT_FvPKcES2_", "void Ty::method<Ty>(void (Ty::*)(char const*),char const)")
+TESTCASE("_ZN2Ty6methodIS_EEvMT_FvPKcES3_", "void Ty::method<Ty>(void (Ty::*)(char const*),char const*)")
+TESTCASE("_ZN2Ty6methodIS_EEvMT_FvPKcES4_", "void Ty::method<Ty>(void (Ty::*)(char const*),void(char const*))")
+TESTCASE("_ZN2Ty6methodIS_EEvMT_FvPKcES5_", "void Ty::method<Ty>(void (Ty::*)(char const*),void (Ty::*)(char const*))")
+TESTCASE("_ZNK1fB5cxx11Ev", "f[abi:cxx11]() const")
+TESTCASE("_ZUlvE_", "{lambda()#1}")
+TESTCASE("_ZUlisE_", "{lambda(int,short)#1}")
+TESTCASE("_ZZ3aaavEUlvE_", "aaa()::{lambda()#1}")
+TESTCASE("_ZZ3aaavENUlvE_3bbbE", "aaa()::{lambda()#1}::bbb")
+TESTCASE("_ZN3aaaUlvE_D1Ev", "aaa::{lambda()#1}::~aaa()")
+TESTCASE("_ZZ3aaavEN3bbbD1Ev", "aaa()::bbb::~bbb()")
+TESTCASE("_ZZ3aaavENUlvE_D1Ev", "aaa()::{lambda()#1}::~aaa()")
+TESTCASE("_Z3fooILb0EEvi", "void foo<false>(int)")
+TESTCASE("_Z3fooILb1EEvi", "void foo<true>(int)")
+TESTCASE("_Z3fooILb2EEvi", "void foo<(bool)2>(int)")
+TESTCASE("_ZN6WebKit25WebCacheStorageConnection17didReceiveMessageERN3IPC10ConnectionERNS1_7DecoderE", "WebKit::WebCacheStorageConnection::didReceiveMessage(IPC::Connection&,IPC::Decoder&)")
+TESTCASE("_ZN3IPC10Connection15dispatchMessageESt10unique_ptrINS_7DecoderESt14default_deleteIS2_EE", "IPC::Connection::dispatchMessage(std::unique_ptr<IPC::Decoder,std::default_delete<IPC::Decoder> >)")
+TESTCASE("_ZNK1QssERKS_", "Q::operator<=>(Q const&) const")
+TESTCASE("_ZNSt17_Function_handlerIFviEN3JPH19JobSystemThreadPool19mThreadInitFunctionMUliE_EE9_M_invokeERKSt9_Any_dataOi", "std::_Function_handler<void(int),JPH::JobSystemThreadPool::mThreadInitFunction::{lambda(int)#1}>::_M_invoke(std::_Any_data const&,int&&)")
+TESTCASE("_ZZZ1fILb0EJiiEEvvENKUlvE_clEvE1n", "f<false,int,int>()::{lambda()#1}::operator()() const::n")
+TESTCASE("_ZZZ1fILb0EJiiEEvvENKUlvE0_clEvE1n", "f<false,int,int>()::{lambda()#2}::operator()() const::n")
+TESTCASE("_ZN7HashSetI5IVec29AllocatorE11AddInternalIRKS0_EEbiOT_bPNS2_4IterE", "bool HashSet<IVec2,Allocator>::AddInternal<IVec2 const&>(int,IVec2 const&,bool,HashSet<IVec2,Allocator>::Iter*)")
+TESTCASE("_ZThn24_N13ZipFileStreamD1Ev", "non-virtual thunk to ZipFileStream::~ZipFileStream()")
+TESTCASE("_ZTvn24_n24_N13ZipFileStreamD1Ev", "virtual thunk to ZipFileStream::~ZipFileStream()")
+TESTCASE("_Z9gCatTraceIJRA17_KciEEvi7CStrArgDpOT_", "void gCatTrace<char const(&)[17],int>(int,CStrArg,char const(&)[17],int&&)")
+TESTCASE("_ZN12HashMultiMapIPK4RTTIS2_9AllocatorED1Ev", "HashMultiMap<RTTI const*,RTTI const*,Allocator>::~HashMultiMap()")
+TESTCASE("_Z18gQuickSortInternalIPi4LessIiEEvRKT_S5_RKT0_Ri", "void gQuickSortInternal<int*,Less<int> >(int* const&,int* const&,Less<int> const&,int&)")
+TESTCASE("_Z1f2aa2ab2ac2ad2ae2af2ag2ah2ai2aj2ak2al2am2an2ao2ap2aq2ar2as2at2au2av2aw2ax2ay2az2ba2bb2bc2bd2be2bf2bg2bh2bi2bj2bk2bl2bm2bnS12_", "f(aa,ab,ac,ad,ae,af,ag,ah,ai,aj,ak,al,am,an,ao,ap,aq,ar,as,at,au,av,aw,ax,ay,az,ba,bb,bc,bd,be,bf,bg,bh,bi,bj,bk,bl,bm,bn,bn)")
+TESTCASE("_Z1fIiiiiiiiiiiiiiiiiiiicEvT18_", "void f<int,int,int,int,int,int,int,int,int,int,int,int,int,int,int,int,int,int,int,char>(char)")
+TESTCASE("_Z1fPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPPi", "f(int**********************************************************************************************************************************)")
@@ -0,0 +1,323 @@
+/* GNU C++ symbol name demangler
+ * Collects and demangles the linkage names in the DWARF debug information of
+ * an ELF file.
+ *
+ * The tool runs in two phases:
+ * 1. A pool of worker threads walks the compilation units in .debug_info,
+ *    each taking the next unit. The linkage names go into a global set, keyed
+ *    on the offset of the string in .debug_str (or .debug_line_str), so that
+ *    a name that is referenced from many units is stored once, without
+ *    comparing the strings. The names are not copied: they point into the
+ *    mapped file. The set is split in shards with a lock each.
+ * 2. The unique names are demangled in parallel, by the same number of
+ *    threads, each taking blocks of names.
+ *
+ * It reports the throughput of each phase and the deduplication ratio (the
+ * number of linkage name attributes over the number of unique names). With
+ * -o, the unique names are written to a file, as the mangled name, a tab and
+ * the demangled name on each line.
+ *
+ * Build:  cc -O2 -o dwnames tools/dwnames.c dwarfnames.c elfsym.c demangle.c -lpthread
+ * Usage:  dwnames [-j threads] [-o file] elf-file
+ *
+ * Copyright 2022-2024, CompuPhase
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../demangle.h"
+#include "../dwarfnames.h"
+
+#define NUM_SHARDS    64      /* must be a power of 2 */
+#define NAME_BLOCK    1024    /* names per work item in the demangle phase */
+#define MAX_THREADS   256
+
+struct shard {
+  pthread_mutex_t lock;
+  const char **names;   /**< open addressing table */
+  uint64_t *keys;
+  size_t count;
+  size_t mask;
+};
+
+struct indexer {
+  const struct dwarfnames *dw;
+  uint64_t *units;
+  size_t nunits;
+  size_t nextunit;      /**< next unit for a worker (under "lock") */
+  const char **unique;  /**< all unique names, for the demangle phase */
+  size_t nunique;
+  size_t nextname;      /**< next block of names (under "lock") */
+  pthread_mutex_t lock;
+  struct shard shards[NUM_SHARDS];
+  /* statistics */
+  unsigned long references, badunits, demangled, failed;
+  FILE *output;
+};
+
+static void fatal(const char *message)
+{
+  fprintf(stderr, "dwnames: %s\n", message);
+  exit(1);
+}
+
+/** mix() - spreads the bits of a string offset, for the shard and the slot. */
+static uint64_t mix(uint64_t key)
+{
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdULL;
+  key ^= key >> 33;
+  return key;
+}
+
+static void grow_shard(struct shard *shard)
+{
+  size_t size = 2 * (shard->mask + 1);
+  const char **names = calloc(size, sizeof(char*));
+  uint64_t *keys = malloc(size * sizeof(uint64_t));
+  if (names == NULL || keys == NULL)
+    fatal("out of memory");
+  for (size_t i = 0; i <= shard->mask; i++) {
+    if (shard->names[i] == NULL)
+      continue;
+    size_t idx = (mix(shard->keys[i]) / NUM_SHARDS) & (size - 1);
+    while (names[idx] != NULL)
+      idx = (idx + 1) & (size - 1);
+    names[idx] = shard->names[i];
+    keys[idx] = shard->keys[i];
+  }
+  free(shard->names);
+  free(shard->keys);
+  shard->names = names;
+  shard->keys = keys;
+  shard->mask = size - 1;
+}
+
+/** insert() - adds the name to the global set (if its key is not already in
+ *  it).
+ */
+static void insert(const char *name, uint64_t key, void *arg)
+{
+  struct indexer *indexer = arg;
+  uint64_t hash = mix(key);
+  struct shard *shard = &indexer->shards[hash & (NUM_SHARDS - 1)];
+  pthread_mutex_lock(&shard->lock);
+  size_t idx = (hash / NUM_SHARDS) & shard->mask;
+  while (shard->names[idx] != NULL) {
+    if (shard->keys[idx] == key) {
+      pthread_mutex_unlock(&shard->lock);
+      return;
+    }
+    idx = (idx + 1) & shard->mask;
+  }
+  shard->names[idx] = name;
+  shard->keys[idx] = key;
+  if (2 * ++shard->count > shard->mask)
+    grow_shard(shard);
+  pthread_mutex_unlock(&shard->lock);
+}
+
+static void *read_worker(void *arg)
+{
+  struct indexer *indexer = arg;
+  for ( ;; ) {
+    pthread_mutex_lock(&indexer->lock);
+    size_t index = indexer->nextunit++;
+    pthread_mutex_unlock(&indexer->lock);
+    if (index >= indexer->nunits)
+      break;
+    long result = dwarfnames_unit(indexer->dw, indexer->units[index], insert, indexer);
+    pthread_mutex_lock(&indexer->lock);
+    if (result >= 0)
+      indexer->references += result;
+    else
+      indexer->badunits++;
+    pthread_mutex_unlock(&indexer->lock);
+  }
+  return NULL;
+}
+
+static void *demangle_worker(void *arg)
+{
+  struct indexer *indexer = arg;
+  size_t plainsize = 4096;
+  char *plain = malloc(plainsize);
+  size_t outsize = 0, outmax = 0;
+  char *out = NULL;
+  unsigned long demangled = 0, failed = 0;
+  while (plain != NULL) {
+    pthread_mutex_lock(&indexer->lock);
+    size_t start = indexer->nextname;
+    indexer->nextname += NAME_BLOCK;
+    pthread_mutex_unlock(&indexer->lock);
+    if (start >= indexer->nunique)
+      break;
+    size_t stop = (start + NAME_BLOCK < indexer->nunique) ? start + NAME_BLOCK : indexer->nunique;
+    outsize = 0;
+    for (size_t i = start; i < stop; i++) {
+      const char *name = indexer->unique[i];
+      size_t length = strlen(name);
+      int result = demangle_grow(&plain, &plainsize, NULL, name, length);
+      if (result == DEMANGLE_NOSCRATCH)
+        fatal("out of memory");
+      /* a name whose text exceeds DEMANGLE_MAX_PLAIN is listed in its mangled
+         form (but counted as failed) */
+      const char *text = (result == DEMANGLE_OK) ? plain : name;
+      if (result != DEMANGLE_OK) {
+        failed++;
+        if (result != DEMANGLE_OVERFLOW)
+          continue;
+      } else {
+        demangled++;
+      }
+      if (indexer->output != NULL) {
+        /* collect the lines of the block, and write them at once */
+        size_t need = length + strlen(text) + 2;
+        if (outsize + need > outmax) {
+          outmax = 2 * (outsize + need);
+          out = realloc(out, outmax);
+          if (out == NULL)
+            fatal("out of memory");
+        }
+        outsize += sprintf(out + outsize, "%s\t%s\n", name, text);
+      }
+    }
+    if (indexer->output != NULL && outsize > 0) {
+      pthread_mutex_lock(&indexer->lock);
+      fwrite(out, 1, outsize, indexer->output);
+      pthread_mutex_unlock(&indexer->lock);
+    }
+  }
+  if (plain == NULL)
+    fatal("out of memory");
+  free(plain);
+  free(out);
+  pthread_mutex_lock(&indexer->lock);
+  indexer->demangled += demangled;
+  indexer->failed += failed;
+  pthread_mutex_unlock(&indexer->lock);
+  return NULL;
+}
+
+static void run_threads(int count, void *(*worker)(void*), struct indexer *indexer)
+{
+  pthread_t threads[MAX_THREADS];
+  for (int i = 0; i < count; i++)
+    if (pthread_create(&threads[i], NULL, worker, indexer) != 0)
+      fatal("cannot create thread");
+  for (int i = 0; i < count; i++)
+    pthread_join(threads[i], NULL);
+}
+
+static double timestamp(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+  long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+  int threads = (ncpu > 0) ? (int)ncpu : 4;
+  const char *outname = NULL;
+  int first = 1;
+  while (first < argc && argv[first][0] == '-') {
+    if (strcmp(argv[first], "-j") == 0 && first + 1 < argc) {
+      threads = atoi(argv[first + 1]);
+      first += 2;
+    } else if (strcmp(argv[first], "-o") == 0 && first + 1 < argc) {
+      outname = argv[first + 1];
+      first += 2;
+    } else {
+      break;
+    }
+  }
+  if (first + 1 != argc || argv[first][0] == '-' || threads < 1) {
+    fprintf(stderr, "Usage: dwnames [-j threads] [-o file] elf-file\n");
+    return 1;
+  }
+  if (threads > MAX_THREADS)
+    threads = MAX_THREADS;
+
+  struct indexer indexer;
+  memset(&indexer, 0, sizeof indexer);
+  double start = timestamp();
+  struct dwarfnames *dw = dwarfnames_open(argv[first]);
+  if (dw == NULL)
+    fatal("cannot read the file, or it has no (uncompressed) debug information");
+  indexer.dw = dw;
+  indexer.nunits = dwarfnames_units(dw, NULL, 0);
+  indexer.units = malloc((indexer.nunits + 1) * sizeof(uint64_t));
+  if (indexer.units == NULL)
+    fatal("out of memory");
+  dwarfnames_units(dw, indexer.units, indexer.nunits);
+  pthread_mutex_init(&indexer.lock, NULL);
+  for (int i = 0; i < NUM_SHARDS; i++) {
+    struct shard *shard = &indexer.shards[i];
+    pthread_mutex_init(&shard->lock, NULL);
+    shard->mask = 1023;
+    shard->names = calloc(shard->mask + 1, sizeof(char*));
+    shard->keys = malloc((shard->mask + 1) * sizeof(uint64_t));
+    if (shard->names == NULL || shard->keys == NULL)
+      fatal("out of memory");
+  }
+  if (outname != NULL && (indexer.output = fopen(outname, "w")) == NULL)
+    fatal("cannot create the output file");
+
+  double opened = timestamp();
+  run_threads(threads, read_worker, &indexer);
+  double read = timestamp();
+
+  for (int i = 0; i < NUM_SHARDS; i++)
+    indexer.nunique += indexer.shards[i].count;
+  indexer.unique = malloc((indexer.nunique + 1) * sizeof(char*));
+  if (indexer.unique == NULL)
+    fatal("out of memory");
+  size_t n = 0;
+  for (int i = 0; i < NUM_SHARDS; i++)
+    for (size_t s = 0; s <= indexer.shards[i].mask; s++)
+      if (indexer.shards[i].names[s] != NULL)
+        indexer.unique[n++] = indexer.shards[i].names[s];
+  run_threads(threads, demangle_worker, &indexer);
+  double done = timestamp();
+  if (indexer.output != NULL)
+    fclose(indexer.output);
+
+  double t_read = (read - opened > 0) ? read - opened : 1e-9;
+  double t_demangle = (done - read > 0) ? done - read : 1e-9;
+  printf("%lu units (%lu invalid) in %.2f s open + %.2f s read: %.0f units/s, %.0f names/s\n",
+         (unsigned long)indexer.nunits, indexer.badunits, opened - start, read - opened,
+         indexer.nunits / t_read, indexer.references / t_read);
+  printf("%lu linkage names, %lu unique: dedup ratio %.2f\n",
+         indexer.references, (unsigned long)indexer.nunique,
+         (indexer.nunique > 0) ? (double)indexer.references / indexer.nunique : 0.0);
+  printf("demangled %lu (%lu failed) in %.2f s with %d threads: %.0f names/s\n",
+         indexer.demangled, indexer.failed, done - read, threads,
+         indexer.nunique / t_demangle);
+
+  free(indexer.units);
+  free(indexer.unique);
+  for (int i = 0; i < NUM_SHARDS; i++) {
+    free(indexer.shards[i].names);
+    free(indexer.shards[i].keys);
+  }
+  dwarfnames_close(dw);
+  return 0;
+}
@@ -0,0 +1,434 @@
+/* GNU C++ symbol name demangler
+ * Demangler for folded stacks (the input format of flamegraph.pl).
+ *
+ * Each input line is a stack of frames, separated by semicolons, followed by
+ * a sample count:
+ *
+ *     main;_ZN3foo3barEv;_ZNSt6vectorIiSaIiEE9push_backERKi 42
+ *
+ * The frames are demangled, and optionally shortened: -t replaces template
+ * arguments by "<...>", and -p removes the parameter lists of functions. As
+ * shortening makes different stacks equal, the counts of equal stacks are
+ * summed. The output has the same format as the input, with one line per
+ * distinct stack, in the order of first appearance.
+ *
+ * Every distinct frame is demangled only once: the frames are interned in a
+ * hash table, that maps each frame to the (interned) shortened text, and each
+ * stack is kept as a list of ids of shortened frames. The input is read in
+ * large blocks.
+ *
+ * Build:  cc -O2 -o foldstack tools/foldstack.c demangle.c
+ * Usage:  foldstack [-t] [-p] [file]     (reads stdin if no file is given)
+ *
+ * Copyright 2022-2024, CompuPhase
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../demangle.h"
+
+#define READ_BLOCK  (1 << 20)   /* bytes read at a time (grows for longer lines) */
+#define TEXT_BLOCK  (1 << 20)   /* size of the blocks for interned strings */
+#define INIT_SLOTS  4096        /* initial size of the hash tables (power of 2) */
+#define MAX_FRAMES  4096        /* deeper stacks are truncated at the root side */
+#define NO_ID       UINT32_MAX
+
+/* interned strings, with an open addressing hash table */
+struct textblock {
+  struct textblock *next;
+  size_t used;
+  char text[];
+};
+
+struct strtab {
+  char **text;          /**< text of each string, indexed by id */
+  uint32_t *length;
+  uint64_t *hash;
+  uint32_t count, max;
+  uint32_t *slots;      /**< ids, NO_ID for empty slots */
+  uint32_t mask;
+  struct textblock *blocks;
+};
+
+/* distinct stacks, as lists of frame ids */
+struct stack {
+  uint64_t hash;
+  uint64_t count;
+  uint32_t start;       /**< index in stacktab.ids */
+  uint32_t depth;
+};
+
+struct stacktab {
+  struct stack *stacks;
+  uint32_t count, max;
+  uint32_t *ids;
+  size_t nids, maxids;
+  uint32_t *slots;
+  uint32_t mask;
+};
+
+static void *grow(void *array, size_t *max, size_t itemsize, size_t needed)
+{
+  if (needed <= *max)
+    return array;
+  size_t size = (*max > 0) ? *max : 256;
+  while (size < needed)
+    size *= 2;
+  void *list = realloc(array, size * itemsize);
+  if (list == NULL) {
+    fprintf(stderr, "foldstack: out of memory\n");
+    exit(1);
+  }
+  *max = size;
+  return list;
+}
+
+static uint32_t *new_slots(uint32_t count)
+{
+  uint32_t *slots = malloc(count * sizeof(uint32_t));
+  if (slots == NULL) {
+    fprintf(stderr, "foldstack: out of memory\n");
+    exit(1);
+  }
+  memset(slots, 0xff, count * sizeof(uint32_t));  /* all NO_ID */
+  return slots;
+}
+
+static char *store_text(struct strtab *tab, const char *text, size_t length)
+{
+  struct textblock *block = tab->blocks;
+  if (block == NULL || block->used + length + 1 > TEXT_BLOCK) {
+    size_t size = (length + 1 > TEXT_BLOCK) ? length + 1 : TEXT_BLOCK;
+    block = malloc(sizeof(struct textblock) + size);
+    if (block == NULL) {
+      fprintf(stderr, "foldstack: out of memory\n");
+      exit(1);
+    }
+    block->used = 0;
+    block->next = tab->blocks;
+    tab->blocks = block;
+  }
+  char *copy = block->text + block->used;
+  memcpy(copy, text, length);
+  copy[length] = '\0';
+  block->used += length + 1;
+  return copy;
+}
+
+/** intern() - returns the id of the string, adding it if it is new; "added"
+ *  is set to whether it was added.
+ */
+static uint32_t intern(struct strtab *tab, const char *text, size_t length, bool *added)
+{
+  uint64_t hash = demangle_hash_text(text, length);
+  uint32_t idx = (uint32_t)hash & tab->mask;
+  for ( ;; ) {
+    uint32_t id = tab->slots[idx];
+    if (id == NO_ID)
+      break;
+    if (tab->hash[id] == hash && tab->length[id] == length && memcmp(tab->text[id], text, length) == 0) {
+      *added = false;
+      return id;
+    }
+    idx = (idx + 1) & tab->mask;
+  }
+  if (tab->count == tab->max) {
+    size_t max;
+    max = tab->max;
+    tab->text = grow(tab->text, &max, sizeof(char*), tab->count + 1);
+    max = tab->max;
+    tab->length = grow(tab->length, &max, sizeof(uint32_t), tab->count + 1);
+    max = tab->max;
+    tab->hash = grow(tab->hash, &max, sizeof(uint64_t), tab->count + 1);
+    tab->max = (uint32_t)max;
+  }
+  uint32_t id = tab->count++;
+  tab->text[id] = store_text(tab, text, length);
+  tab->length[id] = (uint32_t)length;
+  tab->hash[id] = hash;
+  tab->slots[idx] = id;
+  *added = true;
+  if (2 * tab->count > tab->mask) {
+    /* keep the load factor below 1/2 */
+    uint32_t size = 2 * (tab->mask + 1);
+    free(tab->slots);
+    tab->slots = new_slots(size);
+    tab->mask = size - 1;
+    for (uint32_t i = 0; i < tab->count; i++) {
+      idx = (uint32_t)tab->hash[i] & tab->mask;
+      while (tab->slots[idx] != NO_ID)
+        idx = (idx + 1) & tab->mask;
+      tab->slots[idx] = i;
+    }
+  }
+  return id;
+}
+
+/** strip_params() - returns the length of a demangled function name without
+ *  its parameter list (and the cv- and ref-qualifiers after it).
+ */
+static size_t strip_params(const char *text, size_t length)
+{
+  static const char *const suffixes[] = { " const", " volatile", " restrict", " &&", " &", "&&", "&" };
+  size_t full = length;
+  bool found;
+  do {
+    found = false;
+    for (size_t i = 0; i < sizeof suffixes / sizeof suffixes[0] && !found; i++) {
+      size_t len = strlen(suffixes[i]);
+      if (length > len && memcmp(text + length - len, suffixes[i], len) == 0) {
+        length -= len;
+        found = true;
+      }
+    }
+  } while (found);
+  if (length == 0 || text[length - 1] != ')')
+    return full;
+  int nest = 0;
+  for (size_t i = length; i > 0; i--) {
+    if (text[i - 1] == ')') {
+      nest++;
+    } else if (text[i - 1] == '(' && --nest == 0) {
+      /* "operator()" is the name, not the parameter list */
+      if (i > 9 && memcmp(text + i - 9, "operator", 8) == 0 && text[i - 1] == '(' && text[i] == ')')
+        continue;
+      return (i > 1) ? i - 1 : full;
+    }
+  }
+  return full;
+}
+
+struct folder {
+  bool templates;       /**< collapse template arguments */
+  bool params;          /**< remove parameter lists */
+  struct strtab frames;     /**< frames as in the input */
+  struct strtab shortened;  /**< demangled and shortened frames */
+  uint32_t *map;        /**< id in "frames" -> id in "shortened" */
+  size_t maxmap;
+  char *plain;          /**< demangle buffer */
+  size_t plainsize;
+};
+
+/** frame_id() - returns the id of the shortened (and demangled) frame, for a
+ *  frame from the input.
+ */
+static uint32_t frame_id(struct folder *folder, const char *frame, size_t length)
+{
+  bool added;
+  uint32_t raw = intern(&folder->frames, frame, length, &added);
+  if (!added)
+    return folder->map[raw];
+
+  const char *text = frame;
+  size_t textlength = length;
+  if (length > 2 && frame[0] == '_' && frame[1] == 'Z') {
+    /* the interned copy is zero-terminated, as demangle_abbrev() needs */
+    const char *name = folder->frames.text[raw];
+    if (folder->plain == NULL) {
+      fprintf(stderr, "foldstack: out of memory\n");
+      exit(1);
+    }
+    /* the buffer grows up to DEMANGLE_MAX_PLAIN; a name that needs more keeps
+       its mangled form */
+    int result;
+    if (folder->templates) {
+      /* a name that fills the buffer may have been cut off */
+      while ((result = demangle_abbrev(folder->plain, folder->plainsize, name, 0)) == DEMANGLE_OK
+             && strlen(folder->plain) + 1 == folder->plainsize) {
+        if (folder->plainsize >= DEMANGLE_MAX_PLAIN) {
+          result = DEMANGLE_OVERFLOW;
+          break;
+        }
+        free(folder->plain);
+        folder->plainsize *= 4;
+        folder->plain = malloc(folder->plainsize);
+        if (folder->plain == NULL) {
+          fprintf(stderr, "foldstack: out of memory\n");
+          exit(1);
+        }
+      }
+    } else {
+      result = demangle_grow(&folder->plain, &folder->plainsize, NULL, name, length);
+    }
+    if (result == DEMANGLE_NOSCRATCH) {
+      fprintf(stderr, "foldstack: out of memory\n");
+      exit(1);
+    }
+    if (result == DEMANGLE_OK) {
+      text = folder->plain;
+      textlength = strlen(folder->plain);
+    }
+  }
+  if (folder->params)
+    textlength = strip_params(text, textlength);
+  uint32_t id = intern(&folder->shortened, text, textlength, &added);
+  folder->map = grow(folder->map, &folder->maxmap, sizeof(uint32_t), (size_t)raw + 1);
+  folder->map[raw] = id;
+  return id;
+}
+
+static void add_stack(struct stacktab *tab, const uint32_t *ids, uint32_t depth, uint64_t count)
+{
+  uint64_t hash = demangle_hash_text((const char*)ids, depth * sizeof(uint32_t));
+  uint32_t idx = (uint32_t)hash & tab->mask;
+  for ( ;; ) {
+    uint32_t s = tab->slots[idx];
+    if (s == NO_ID)
+      break;
+    struct stack *stack = &tab->stacks[s];
+    if (stack->hash == hash && stack->depth == depth
+        && memcmp(tab->ids + stack->start, ids, depth * sizeof(uint32_t)) == 0) {
+      stack->count += count;
+      return;
+    }
+    idx = (idx + 1) & tab->mask;
+  }
+  size_t max = tab->max;
+  tab->stacks = grow(tab->stacks, &max, sizeof(struct stack), tab->count + 1);
+  tab->max = (uint32_t)max;
+  tab->ids = grow(tab->ids, &tab->maxids, sizeof(uint32_t), tab->nids + depth);
+  memcpy(tab->ids + tab->nids, ids, depth * sizeof(uint32_t));
+  struct stack *stack = &tab->stacks[tab->count];
+  stack->hash = hash;
+  stack->count = count;
+  stack->start = (uint32_t)tab->nids;
+  stack->depth = depth;
+  tab->nids += depth;
+  tab->slots[idx] = tab->count++;
+  if (2 * tab->count > tab->mask) {
+    uint32_t size = 2 * (tab->mask + 1);
+    free(tab->slots);
+    tab->slots = new_slots(size);
+    tab->mask = size - 1;
+    for (uint32_t i = 0; i < tab->count; i++) {
+      idx = (uint32_t)tab->stacks[i].hash & tab->mask;
+      while (tab->slots[idx] != NO_ID)
+        idx = (idx + 1) & tab->mask;
+      tab->slots[idx] = i;
+    }
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  struct folder folder;
+  memset(&folder, 0, sizeof folder);
+  const char *filename = NULL;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-t") == 0) {
+      folder.templates = true;
+    } else if (strcmp(argv[i], "-p") == 0) {
+      folder.params = true;
+    } else if (argv[i][0] != '-' && filename == NULL) {
+      filename = argv[i];
+    } else {
+      fprintf(stderr, "Usage: foldstack [-t] [-p] [file]\n");
+      return 1;
+    }
+  }
+  FILE *fp = (filename != NULL) ? fopen(filename, "rb") : stdin;
+  if (fp == NULL) {
+    fprintf(stderr, "foldstack: cannot open %s\n", filename);
+    return 1;
+  }
+
+  folder.frames.slots = new_slots(INIT_SLOTS);
+  folder.frames.mask = INIT_SLOTS - 1;
+  folder.shortened.slots = new_slots(INIT_SLOTS);
+  folder.shortened.mask = INIT_SLOTS - 1;
+  folder.plainsize = 1024;
+  folder.plain = malloc(folder.plainsize);
+  struct stacktab stacks;
+  memset(&stacks, 0, sizeof stacks);
+  stacks.slots = new_slots(INIT_SLOTS);
+  stacks.mask = INIT_SLOTS - 1;
+  static uint32_t ids[MAX_FRAMES];
+
+  size_t bufsize = READ_BLOCK;
+  char *buffer = malloc(bufsize);
+  size_t fill = 0;
+  bool eof = false;
+  while (buffer != NULL && !eof) {
+    if (fill == bufsize) {
+      char *bigger = realloc(buffer, 2 * bufsize);
+      if (bigger == NULL)
+        break;
+      buffer = bigger;
+      bufsize *= 2;
+    }
+    size_t count = fread(buffer + fill, 1, bufsize - fill, fp);
+    if (count == 0) {
+      eof = true;
+      if (fill == 0 || buffer[fill - 1] == '\n')
+        break;
+      buffer[fill++] = '\n';  /* last line without line terminator */
+    }
+    fill += count;
+    char *line = buffer;
+    char *eol;
+    while ((eol = memchr(line, '\n', fill - (line - buffer))) != NULL) {
+      char *end = eol;
+      if (end > line && end[-1] == '\r')
+        end--;
+      /* the count is the last field on the line */
+      char *sep = end;
+      while (sep > line && sep[-1] != ' ')
+        sep--;
+      if (sep > line && sep < end) {
+        uint64_t samples = strtoull(sep, NULL, 10);
+        uint32_t depth = 0;
+        char *frame = line;
+        char *stop = sep - 1;   /* the space before the count */
+        while (frame < stop) {
+          char *semi = memchr(frame, ';', stop - frame);
+          if (semi == NULL)
+            semi = stop;
+          if (depth < MAX_FRAMES)
+            ids[depth++] = frame_id(&folder, frame, semi - frame);
+          frame = semi + 1;
+        }
+        if (depth > 0)
+          add_stack(&stacks, ids, depth, samples);
+      }
+      line = eol + 1;
+    }
+    size_t used = line - buffer;
+    memmove(buffer, line, fill - used);
+    fill -= used;
+  }
+  if (buffer == NULL) {
+    fprintf(stderr, "foldstack: out of memory\n");
+    return 1;
+  }
+  free(buffer);
+  if (fp != stdin)
+    fclose(fp);
+
+  for (uint32_t s = 0; s < stacks.count; s++) {
+    const struct stack *stack = &stacks.stacks[s];
+    for (uint32_t d = 0; d < stack->depth; d++) {
+      if (d > 0)
+        putchar(';');
+      fputs(folder.shortened.text[stacks.ids[stack->start + d]], stdout);
+    }
+    printf(" %llu\n", (unsigned long long)stack->count);
+  }
+  fprintf(stderr, "foldstack: %lu distinct frames, %lu distinct stacks\n",
+          (unsigned long)folder.frames.count, (unsigned long)stacks.count);
+  return 0;
+}
@@ -0,0 +1,397 @@
+/* GNU C++ symbol name demangler
+ * Crawler that collects and demangles the symbols of all ELF files in one or
+ * more directory trees.
+ *
+ * The crawler runs in three phases:
+ * 1. It walks the directory trees and collects the paths of regular files
+ *    (symbolic links are not followed).
+ * 2. A pool of worker threads reads the symbol tables of the files (ELF
+ *    objects, shared libraries, executables and ar archives; other files are
+ *    skipped). The mangled names go into a global set, so that a name that
+ *    appears in many files (as the std:: instantiations do) is stored once.
+ *    The set is split in shards with a lock each, so that the workers rarely
+ *    wait for each other.
+ * 3. The unique names are demangled in parallel, by the same number of
+ *    threads, each taking blocks of names.
+ *
+ * It reports the throughput of each phase and the deduplication ratio (the
+ * number of mangled symbols over the number of unique names). With -o, the
+ * unique names are written to a file, as the mangled name, a tab and the
+ * demangled name on each line.
+ *
+ * Build:  cc -O2 -o symcrawl tools/symcrawl.c elfsym.c demangle.c -lpthread
+ * Usage:  symcrawl [-j threads] [-o file] directory ...
+ *
+ * Copyright 2022-2024, CompuPhase
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <dirent.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "../demangle.h"
+#include "../elfsym.h"
+
+#define NUM_SHARDS    64      /* must be a power of 2 */
+#define TEXT_BLOCK    (1 << 20)
+#define NAME_BLOCK    1024    /* names per work item in the demangle phase */
+#define MAX_THREADS   256
+
+struct textblock {
+  struct textblock *next;
+  size_t used;
+  char text[];
+};
+
+struct shard {
+  pthread_mutex_t lock;
+  const char **names;   /**< open addressing table */
+  uint64_t *hashes;
+  size_t count;
+  size_t mask;
+  struct textblock *blocks;
+};
+
+struct crawler {
+  char **paths;
+  size_t npaths, maxpaths;
+  size_t nextpath;      /**< next file for a worker (under "lock") */
+  const char **unique;  /**< all unique names, for the demangle phase */
+  size_t nunique;
+  size_t nextname;      /**< next block of names (under "lock") */
+  pthread_mutex_t lock;
+  struct shard shards[NUM_SHARDS];
+  /* statistics */
+  unsigned long elffiles, symbols, demangled, failed;
+  FILE *output;
+};
+
+static void fatal(const char *message)
+{
+  fprintf(stderr, "symcrawl: %s\n", message);
+  exit(1);
+}
+
+static void add_path(struct crawler *crawler, const char *path)
+{
+  if (crawler->npaths == crawler->maxpaths) {
+    crawler->maxpaths = (crawler->maxpaths > 0) ? 2 * crawler->maxpaths : 1024;
+    crawler->paths = realloc(crawler->paths, crawler->maxpaths * sizeof(char*));
+    if (crawler->paths == NULL)
+      fatal("out of memory");
+  }
+  crawler->paths[crawler->npaths] = malloc(strlen(path) + 1);
+  if (crawler->paths[crawler->npaths] == NULL)
+    fatal("out of memory");
+  strcpy(crawler->paths[crawler->npaths++], path);
+}
+
+static void walk(struct crawler *crawler, const char *path)
+{
+  struct stat st;
+  if (lstat(path, &st) != 0)
+    return;
+  if (S_ISREG(st.st_mode)) {
+    add_path(crawler, path);
+  } else if (S_ISDIR(st.st_mode)) {
+    DIR *dir = opendir(path);
+    if (dir == NULL)
+      return;
+    size_t len = strlen(path);
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+      if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+        continue;
+      char *child = malloc(len + strlen(entry->d_name) + 2);
+      if (child == NULL)
+        fatal("out of memory");
+      sprintf(child, "%s/%s", path, entry->d_name);
+      walk(crawler, child);
+      free(child);
+    }
+    closedir(dir);
+  }
+}
+
+static const char *store_name(struct shard *shard, const char *name, size_t length)
+{
+  struct textblock *block = shard->blocks;
+  if (block == NULL || block->used + length + 1 > TEXT_BLOCK) {
+    size_t size = (length + 1 > TEXT_BLOCK) ? length + 1 : TEXT_BLOCK;
+    block = malloc(sizeof(struct textblock) + size);
+    if (block == NULL)
+      fatal("out of memory");
+    block->used = 0;
+    block->next = shard->blocks;
+    shard->blocks = block;
+  }
+  char *copy = block->text + block->used;
+  memcpy(copy, name, length);
+  copy[length] = '\0';
+  block->used += length + 1;
+  return copy;
+}
+
+static void grow_shard(struct shard *shard)
+{
+  size_t size = 2 * (shard->mask + 1);
+  const char **names = calloc(size, sizeof(char*));
+  uint64_t *hashes = malloc(size * sizeof(uint64_t));
+  if (names == NULL || hashes == NULL)
+    fatal("out of memory");
+  for (size_t i = 0; i <= shard->mask; i++) {
+    if (shard->names[i] == NULL)
+      continue;
+    size_t idx = (shard->hashes[i] / NUM_SHARDS) & (size - 1);
+    while (names[idx] != NULL)
+      idx = (idx + 1) & (size - 1);
+    names[idx] = shard->names[i];
+    hashes[idx] = shard->hashes[i];
+  }
+  free(shard->names);
+  free(shard->hashes);
+  shard->names = names;
+  shard->hashes = hashes;
+  shard->mask = size - 1;
+}
+
+/** insert() - adds the name to the global set (if it is not already in it).
+ */
+static void insert(struct crawler *crawler, const char *name, size_t length)
+{
+  uint64_t hash = demangle_hash_text(name, length);
+  struct shard *shard = &crawler->shards[hash & (NUM_SHARDS - 1)];
+  pthread_mutex_lock(&shard->lock);
+  size_t idx = (hash / NUM_SHARDS) & shard->mask;
+  while (shard->names[idx] != NULL) {
+    if (shard->hashes[idx] == hash && strcmp(shard->names[idx], name) == 0) {
+      pthread_mutex_unlock(&shard->lock);
+      return;
+    }
+    idx = (idx + 1) & shard->mask;
+  }
+  shard->names[idx] = store_name(shard, name, length);
+  shard->hashes[idx] = hash;
+  if (2 * ++shard->count > shard->mask)
+    grow_shard(shard);
+  pthread_mutex_unlock(&shard->lock);
+}
+
+struct filestats {
+  struct crawler *crawler;
+  unsigned long symbols;
+};
+
+static void collect(const struct elfsym *sym, void *arg)
+{
+  struct filestats *stats = arg;
+  if (sym->length > 2 && sym->name[0] == '_' && sym->name[1] == 'Z') {
+    insert(stats->crawler, sym->name, sym->length);
+    stats->symbols++;
+  }
+}
+
+static void *read_worker(void *arg)
+{
+  struct crawler *crawler = arg;
+  for ( ;; ) {
+    pthread_mutex_lock(&crawler->lock);
+    size_t index = crawler->nextpath++;
+    pthread_mutex_unlock(&crawler->lock);
+    if (index >= crawler->npaths)
+      break;
+    struct filestats stats = { crawler, 0 };
+    long result = elfsym_read(crawler->paths[index], collect, &stats);
+    pthread_mutex_lock(&crawler->lock);
+    if (result >= 0)
+      crawler->elffiles++;
+    crawler->symbols += stats.symbols;
+    pthread_mutex_unlock(&crawler->lock);
+  }
+  return NULL;
+}
+
+static void *demangle_worker(void *arg)
+{
+  struct crawler *crawler = arg;
+  size_t plainsize = 4096;
+  char *plain = malloc(plainsize);
+  size_t outsize = 0, outmax = 0;
+  char *out = NULL;
+  unsigned long demangled = 0, failed = 0;
+  while (plain != NULL) {
+    pthread_mutex_lock(&crawler->lock);
+    size_t start = crawler->nextname;
+    crawler->nextname += NAME_BLOCK;
+    pthread_mutex_unlock(&crawler->lock);
+    if (start >= crawler->nunique)
+      break;
+    size_t stop = (start + NAME_BLOCK < crawler->nunique) ? start + NAME_BLOCK : crawler->nunique;
+    outsize = 0;
+    for (size_t i = start; i < stop; i++) {
+      const char *name = crawler->unique[i];
+      size_t length = strlen(name);
+      int result = demangle_grow(&plain, &plainsize, NULL, name, length);
+      if (result == DEMANGLE_NOSCRATCH)
+        fatal("out of memory");
+      /* a name whose text exceeds DEMANGLE_MAX_PLAIN is listed in its mangled
+         form (but counted as failed) */
+      const char *text = (result == DEMANGLE_OK) ? plain : name;
+      if (result != DEMANGLE_OK) {
+        failed++;
+        if (result != DEMANGLE_OVERFLOW)
+          continue;
+      } else {
+        demangled++;
+      }
+      if (crawler->output != NULL) {
+        /* collect the lines of the block, and write them at once */
+        size_t need = length + strlen(text) + 2;
+        if (outsize + need > outmax) {
+          outmax = 2 * (outsize + need);
+          out = realloc(out, outmax);
+          if (out == NULL)
+            fatal("out of memory");
+        }
+        outsize += sprintf(out + outsize, "%s\t%s\n", name, text);
+      }
+    }
+    if (crawler->output != NULL && outsize > 0) {
+      pthread_mutex_lock(&crawler->lock);
+      fwrite(out, 1, outsize, crawler->output);
+      pthread_mutex_unlock(&crawler->lock);
+    }
+  }
+  if (plain == NULL)
+    fatal("out of memory");
+  free(plain);
+  free(out);
+  pthread_mutex_lock(&crawler->lock);
+  crawler->demangled += demangled;
+  crawler->failed += failed;
+  pthread_mutex_unlock(&crawler->lock);
+  return NULL;
+}
+
+static void run_threads(int count, void *(*worker)(void*), struct crawler *crawler)
+{
+  pthread_t threads[MAX_THREADS];
+  for (int i = 0; i < count; i++)
+    if (pthread_create(&threads[i], NULL, worker, crawler) != 0)
+      fatal("cannot create thread");
+  for (int i = 0; i < count; i++)
+    pthread_join(threads[i], NULL);
+}
+
+static double timestamp(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+  long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+  int threads = (ncpu > 0) ? (int)ncpu : 4;
+  const char *outname = NULL;
+  int first = 1;
+  while (first < argc && argv[first][0] == '-') {
+    if (strcmp(argv[first], "-j") == 0 && first + 1 < argc) {
+      threads = atoi(argv[first + 1]);
+      first += 2;
+    } else if (strcmp(argv[first], "-o") == 0 && first + 1 < argc) {
+      outname = argv[first + 1];
+      first += 2;
+    } else {
+      break;
+    }
+  }
+  if (first >= argc || argv[first][0] == '-' || threads < 1) {
+    fprintf(stderr, "Usage: symcrawl [-j threads] [-o file] directory ...\n");
+    return 1;
+  }
+  if (threads > MAX_THREADS)
+    threads = MAX_THREADS;
+
+  struct crawler crawler;
+  memset(&crawler, 0, sizeof crawler);
+  pthread_mutex_init(&crawler.lock, NULL);
+  for (int i = 0; i < NUM_SHARDS; i++) {
+    struct shard *shard = &crawler.shards[i];
+    pthread_mutex_init(&shard->lock, NULL);
+    shard->mask = 1023;
+    shard->names = calloc(shard->mask + 1, sizeof(char*));
+    shard->hashes = malloc((shard->mask + 1) * sizeof(uint64_t));
+    if (shard->names == NULL || shard->hashes == NULL)
+      fatal("out of memory");
+  }
+  if (outname != NULL && (crawler.output = fopen(outname, "w")) == NULL)
+    fatal("cannot create the output file");
+
+  double start = timestamp();
+  for (int i = first; i < argc; i++)
+    walk(&crawler, argv[i]);
+  double walked = timestamp();
+  run_threads(threads, read_worker, &crawler);
+  double read = timestamp();
+
+  for (int i = 0; i < NUM_SHARDS; i++)
+    crawler.nunique += crawler.shards[i].count;
+  crawler.unique = malloc((crawler.nunique + 1) * sizeof(char*));
+  if (crawler.unique == NULL)
+    fatal("out of memory");
+  size_t n = 0;
+  for (int i = 0; i < NUM_SHARDS; i++)
+    for (size_t s = 0; s <= crawler.shards[i].mask; s++)
+      if (crawler.shards[i].names[s] != NULL)
+        crawler.unique[n++] = crawler.shards[i].names[s];
+  run_threads(threads, demangle_worker, &crawler);
+  double done = timestamp();
+  if (crawler.output != NULL)
+    fclose(crawler.output);
+
+  double t_read = (read - walked > 0) ? read - walked : 1e-9;
+  double t_demangle = (done - read > 0) ? done - read : 1e-9;
+  printf("%lu files (%lu ELF) in %.2f s walk + %.2f s read: %.0f files/s, %.0f symbols/s\n",
+         (unsigned long)crawler.npaths, crawler.elffiles, walked - start, read - walked,
+         crawler.npaths / t_read, crawler.symbols / t_read);
+  printf("%lu mangled symbols, %lu unique: dedup ratio %.2f\n",
+         crawler.symbols, (unsigned long)crawler.nunique,
+         (crawler.nunique > 0) ? (double)crawler.symbols / crawler.nunique : 0.0);
+  printf("demangled %lu (%lu failed) in %.2f s with %d threads: %.0f symbols/s\n",
+         crawler.demangled, crawler.failed, done - read, threads,
+         crawler.nunique / t_demangle);
+
+  for (size_t i = 0; i < crawler.npaths; i++)
+    free(crawler.paths[i]);
+  free(crawler.paths);
+  free(crawler.unique);
+  for (int i = 0; i < NUM_SHARDS; i++) {
+    struct shard *shard = &crawler.shards[i];
+    while (shard->blocks != NULL) {
+      struct textblock *next = shard->blocks->next;
+      free(shard->blocks);
+      shard->blocks = next;
+    }
+    free(shard->names);
+    free(shard->hashes);
+  }
+  return 0;
+}
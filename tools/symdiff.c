@@ -0,0 +1,469 @@
+/* GNU C++ symbol name demangler
+ * Symbol diff of two builds: added, removed and resized functions.
+ *
+ * The tool compares the symbol tables of two ELF files (typically two builds
+ * of the same program or library) and reports the functions and variables
+ * that were added, removed or changed in size, grouped per template or per
+ * namespace, with the size deltas.
+ *
+ * The symbols are matched on their mangled names, after removing the clone
+ * suffixes that the compiler adds (".cold", ".isra.0", ".constprop.1"), as
+ * these vary from build to build; the sizes of the clones are added to the
+ * symbol. The groups are found with classify_name(), which walks the mangled
+ * name, so no symbol is demangled for matching or grouping. Only the symbols
+ * that are listed in the report are demangled.
+ *
+ * For use in continuous integration, option -a sets a maximum on the number
+ * of added template instantiations; when it is exceeded, the exit code is 2.
+ *
+ * Build:  cc -O2 -o symdiff tools/symdiff.c elfsym.c classify.c demangle.c
+ * Usage:  symdiff [-g template|namespace] [-n rows] [-a max] old-file new-file
+ *
+ * Copyright 2022-2024, CompuPhase
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../classify.h"
+#include "../demangle.h"
+#include "../elfsym.h"
+
+#define TEXT_BLOCK      (1 << 20)
+#define MAX_COMPONENTS  32
+
+enum { GROUP_TEMPLATE, GROUP_NAMESPACE };
+enum { CHANGE_ADDED, CHANGE_REMOVED, CHANGE_RESIZED };
+
+struct textblock {
+  struct textblock *next;
+  size_t used;
+  char text[];
+};
+
+struct symbol {
+  uint64_t hash;
+  const char *name;     /**< mangled name, without a clone suffix */
+  size_t length;
+  uint64_t size;
+  bool matched;
+};
+
+struct symtab {
+  struct symbol *slots;
+  size_t count, mask;
+  struct textblock *blocks;
+  uint64_t bytes;
+};
+
+struct change {
+  const char *name;
+  uint64_t oldsize, newsize;
+  int kind;
+  bool templated;
+};
+
+struct group {
+  uint64_t hash;
+  const char *key;
+  size_t length;
+  long added, removed, resized;
+  int64_t delta;
+};
+
+struct grouptab {
+  struct group *slots;
+  size_t count, mask;
+  struct textblock *blocks;
+};
+
+static void fatal(const char *message)
+{
+  fprintf(stderr, "symdiff: %s\n", message);
+  exit(1);
+}
+
+static const char *store_text(struct textblock **blocks, const char *text, size_t length)
+{
+  struct textblock *block = *blocks;
+  if (block == NULL || block->used + length + 1 > TEXT_BLOCK) {
+    size_t size = (length + 1 > TEXT_BLOCK) ? length + 1 : TEXT_BLOCK;
+    block = malloc(sizeof(struct textblock) + size);
+    if (block == NULL)
+      fatal("out of memory");
+    block->used = 0;
+    block->next = *blocks;
+    *blocks = block;
+  }
+  char *copy = block->text + block->used;
+  memcpy(copy, text, length);
+  copy[length] = '\0';
+  block->used += length + 1;
+  return copy;
+}
+
+static void free_text(struct textblock *blocks)
+{
+  while (blocks != NULL) {
+    struct textblock *next = blocks->next;
+    free(blocks);
+    blocks = next;
+  }
+}
+
+static struct symbol *symtab_find(const struct symtab *tab, const char *name, size_t length, uint64_t hash)
+{
+  if (tab->slots == NULL)
+    return NULL;
+  size_t idx = hash & tab->mask;
+  while (tab->slots[idx].name != NULL) {
+    const struct symbol *sym = &tab->slots[idx];
+    if (sym->hash == hash && sym->length == length && memcmp(sym->name, name, length) == 0)
+      return &tab->slots[idx];
+    idx = (idx + 1) & tab->mask;
+  }
+  return NULL;
+}
+
+static void collect(const struct elfsym *sym, void *arg)
+{
+  struct symtab *tab = arg;
+  if (!sym->defined || sym->size == 0 || (sym->type != ELFSYM_FUNC && sym->type != ELFSYM_OBJECT))
+    return;
+  /* a '.' is not valid in a mangled name (nor in a C identifier): it starts
+     a clone suffix or a numbering suffix of a local static */
+  const char *dot = (sym->length > 1) ? memchr(sym->name + 1, '.', sym->length - 1) : NULL;
+  size_t length = (dot != NULL) ? (size_t)(dot - sym->name) : sym->length;
+  uint64_t hash = demangle_hash_text(sym->name, length);
+  tab->bytes += sym->size;
+  struct symbol *found = symtab_find(tab, sym->name, length, hash);
+  if (found != NULL) {
+    found->size += sym->size;
+    return;
+  }
+
+  if (tab->slots == NULL || 2 * (tab->count + 1) > tab->mask) {
+    size_t size = (tab->slots != NULL) ? 2 * (tab->mask + 1) : 4096;
+    struct symbol *slots = calloc(size, sizeof(struct symbol));
+    if (slots == NULL)
+      fatal("out of memory");
+    for (size_t i = 0; tab->slots != NULL && i <= tab->mask; i++) {
+      if (tab->slots[i].name == NULL)
+        continue;
+      size_t idx = tab->slots[i].hash & (size - 1);
+      while (slots[idx].name != NULL)
+        idx = (idx + 1) & (size - 1);
+      slots[idx] = tab->slots[i];
+    }
+    free(tab->slots);
+    tab->slots = slots;
+    tab->mask = size - 1;
+  }
+  size_t idx = hash & tab->mask;
+  while (tab->slots[idx].name != NULL)
+    idx = (idx + 1) & tab->mask;
+  struct symbol *entry = &tab->slots[idx];
+  entry->hash = hash;
+  entry->name = store_text(&tab->blocks, sym->name, length);
+  entry->length = length;
+  entry->size = sym->size;
+  entry->matched = false;
+  tab->count++;
+}
+
+static struct group *group_add(struct grouptab *tab, const char *key, size_t length)
+{
+  uint64_t hash = demangle_hash_text(key, length);
+  if (tab->slots == NULL || 2 * (tab->count + 1) > tab->mask) {
+    size_t size = (tab->slots != NULL) ? 2 * (tab->mask + 1) : 256;
+    struct group *slots = calloc(size, sizeof(struct group));
+    if (slots == NULL)
+      fatal("out of memory");
+    for (size_t i = 0; tab->slots != NULL && i <= tab->mask; i++) {
+      if (tab->slots[i].key == NULL)
+        continue;
+      size_t idx = tab->slots[i].hash & (size - 1);
+      while (slots[idx].key != NULL)
+        idx = (idx + 1) & (size - 1);
+      slots[idx] = tab->slots[i];
+    }
+    free(tab->slots);
+    tab->slots = slots;
+    tab->mask = size - 1;
+  }
+  size_t idx = hash & tab->mask;
+  while (tab->slots[idx].key != NULL) {
+    struct group *group = &tab->slots[idx];
+    if (group->hash == hash && group->length == length && memcmp(group->key, key, length) == 0)
+      return group;
+    idx = (idx + 1) & tab->mask;
+  }
+  struct group *group = &tab->slots[idx];
+  group->hash = hash;
+  group->key = store_text(&tab->blocks, key, length);
+  group->length = length;
+  tab->count++;
+  return group;
+}
+
+static size_t append(char *buffer, size_t size, size_t pos, const char *text, size_t length)
+{
+  if (pos + length < size) {
+    memcpy(buffer + pos, text, length);
+    pos += length;
+  }
+  return pos;
+}
+
+/** group_key() - builds the name of the group of a symbol from the
+ *  components of its (mangled) name. For templates, this is the qualified
+ *  name of the outermost template, without template arguments. Returns the
+ *  length of the key, and sets "templated" to whether the symbol is a member
+ *  of a template (or a template function).
+ */
+static size_t group_key(char *buffer, size_t size, const char *mangled, int grouping, bool *templated)
+{
+  static const char cname[] = "(C symbols)";
+  static const char invalid[] = "(not classified)";
+  static const char global[] = "(global)";
+  static const char other[] = "(not a template)";
+  struct name_component components[MAX_COMPONENTS];
+  int count = classify_name(mangled, components, MAX_COMPONENTS);
+  if (count > MAX_COMPONENTS)
+    count = MAX_COMPONENTS;
+  *templated = false;
+  for (int i = 0; i < count && !*templated; i++)
+    if (components[i].templated)
+      *templated = true;
+  if (count < 0 && mangled[0] == '_' && mangled[1] == 'Z')
+    return append(buffer, size, 0, invalid, sizeof invalid - 1);
+  if (count < 0)
+    return append(buffer, size, 0, cname, sizeof cname - 1);
+  if (grouping == GROUP_NAMESPACE) {
+    if (count < 2)
+      return append(buffer, size, 0, global, sizeof global - 1);
+    count = 1;
+  } else if (!*templated) {
+    return append(buffer, size, 0, other, sizeof other - 1);
+  }
+
+  size_t pos = 0;
+  for (int i = 0; i < count; i++) {
+    const struct name_component *c = &components[i];
+    if (i > 0)
+      pos = append(buffer, size, pos, "::", 2);
+    if (c->kind == COMPONENT_DTOR)
+      pos = append(buffer, size, pos, "~", 1);
+    else if (c->kind == COMPONENT_OPERATOR)
+      pos = append(buffer, size, pos, "operator", 8);
+    pos = append(buffer, size, pos, c->text, c->length);
+    if (c->templated && grouping == GROUP_TEMPLATE)
+      break;
+  }
+  return pos;
+}
+
+static int64_t delta(const struct change *change)
+{
+  return (int64_t)change->newsize - (int64_t)change->oldsize;
+}
+
+static int compare_changes(const void *a, const void *b)
+{
+  int64_t d1 = delta(a);
+  int64_t d2 = delta(b);
+  if (d1 < 0)
+    d1 = -d1;
+  if (d2 < 0)
+    d2 = -d2;
+  if (d1 != d2)
+    return (d1 > d2) ? -1 : 1;
+  return strcmp(((const struct change*)a)->name, ((const struct change*)b)->name);
+}
+
+static int compare_groups(const void *a, const void *b)
+{
+  const struct group *g1 = *(const struct group * const *)a;
+  const struct group *g2 = *(const struct group * const *)b;
+  int64_t d1 = (g1->delta < 0) ? -g1->delta : g1->delta;
+  int64_t d2 = (g2->delta < 0) ? -g2->delta : g2->delta;
+  if (d1 != d2)
+    return (d1 > d2) ? -1 : 1;
+  if (g1->added + g1->removed != g2->added + g2->removed)
+    return (g1->added + g1->removed > g2->added + g2->removed) ? -1 : 1;
+  if (g1->length != g2->length)
+    return (g1->length < g2->length) ? -1 : 1;
+  return memcmp(g1->key, g2->key, g1->length);
+}
+
+static void usage(void)
+{
+  fprintf(stderr, "Usage: symdiff [-g template|namespace] [-n rows] [-a max] old-file new-file\n\n"
+                  "-g  group the changes by template (default) or by namespace\n"
+                  "-n  number of groups and symbols to list (default: 20, 0 = all)\n"
+                  "-a  exit with code 2 if more than \"max\" template instantiations were added\n");
+  exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+  int grouping = GROUP_TEMPLATE;
+  long rows = 20;
+  long maxadded = -1;
+  int first = 1;
+  while (first + 1 < argc && argv[first][0] == '-') {
+    if (strcmp(argv[first], "-g") == 0) {
+      const char *arg = argv[first + 1];
+      if (strncmp(arg, "template", strlen(arg)) == 0)
+        grouping = GROUP_TEMPLATE;
+      else if (strncmp(arg, "namespace", strlen(arg)) == 0)
+        grouping = GROUP_NAMESPACE;
+      else
+        usage();
+    } else if (strcmp(argv[first], "-n") == 0) {
+      rows = atol(argv[first + 1]);
+    } else if (strcmp(argv[first], "-a") == 0) {
+      maxadded = atol(argv[first + 1]);
+    } else {
+      usage();
+    }
+    first += 2;
+  }
+  if (argc - first != 2)
+    usage();
+
+  struct symtab old, new;
+  memset(&old, 0, sizeof old);
+  memset(&new, 0, sizeof new);
+  if (elfsym_read(argv[first], collect, &old) < 0 || elfsym_read(argv[first + 1], collect, &new) < 0)
+    fatal("cannot read the symbols of the files");
+
+  /* match the symbols on the mangled names */
+  size_t maxchanges = old.count + new.count;
+  struct change *changes = malloc((maxchanges + 1) * sizeof(struct change));
+  if (changes == NULL)
+    fatal("out of memory");
+  size_t count = 0;
+  for (size_t i = 0; new.slots != NULL && i <= new.mask; i++) {
+    const struct symbol *sym = &new.slots[i];
+    if (sym->name == NULL)
+      continue;
+    struct symbol *match = symtab_find(&old, sym->name, sym->length, sym->hash);
+    if (match == NULL) {
+      changes[count].name = sym->name;
+      changes[count].oldsize = 0;
+      changes[count].newsize = sym->size;
+      changes[count++].kind = CHANGE_ADDED;
+    } else {
+      match->matched = true;
+      if (match->size != sym->size) {
+        changes[count].name = sym->name;
+        changes[count].oldsize = match->size;
+        changes[count].newsize = sym->size;
+        changes[count++].kind = CHANGE_RESIZED;
+      }
+    }
+  }
+  for (size_t i = 0; old.slots != NULL && i <= old.mask; i++) {
+    const struct symbol *sym = &old.slots[i];
+    if (sym->name == NULL || sym->matched)
+      continue;
+    changes[count].name = sym->name;
+    changes[count].oldsize = sym->size;
+    changes[count].newsize = 0;
+    changes[count++].kind = CHANGE_REMOVED;
+  }
+
+  /* group the changes (on the mangled names) */
+  struct grouptab groups;
+  memset(&groups, 0, sizeof groups);
+  long added = 0, removed = 0, resized = 0, tpladded = 0;
+  int64_t addedbytes = 0, removedbytes = 0, resizedbytes = 0;
+  for (size_t i = 0; i < count; i++) {
+    struct change *change = &changes[i];
+    char key[512];
+    size_t length = group_key(key, sizeof key, change->name, grouping, &change->templated);
+    struct group *group = group_add(&groups, key, length);
+    group->delta += delta(change);
+    switch (change->kind) {
+    case CHANGE_ADDED:
+      group->added++;
+      added++;
+      addedbytes += delta(change);
+      if (change->templated)
+        tpladded++;
+      break;
+    case CHANGE_REMOVED:
+      group->removed++;
+      removed++;
+      removedbytes += delta(change);
+      break;
+    default:
+      group->resized++;
+      resized++;
+      resizedbytes += delta(change);
+    }
+  }
+
+  printf("old: %lu symbols, %llu bytes; new: %lu symbols, %llu bytes; delta %+lld bytes\n",
+         (unsigned long)old.count, (unsigned long long)old.bytes,
+         (unsigned long)new.count, (unsigned long long)new.bytes,
+         (long long)new.bytes - (long long)old.bytes);
+  printf("added %ld (%+lld bytes, %ld template instantiations), removed %ld (%+lld bytes), resized %ld (%+lld bytes)\n",
+         added, (long long)addedbytes, tpladded, removed, (long long)removedbytes,
+         resized, (long long)resizedbytes);
+
+  struct group **list = malloc((groups.count + 1) * sizeof(struct group*));
+  if (list == NULL)
+    fatal("out of memory");
+  size_t ngroups = 0;
+  for (size_t i = 0; groups.slots != NULL && i <= groups.mask; i++)
+    if (groups.slots[i].key != NULL)
+      list[ngroups++] = &groups.slots[i];
+  qsort(list, ngroups, sizeof(struct group*), compare_groups);
+  printf("\n%12s %8s %8s %8s  %s\n", "delta", "added", "removed", "resized",
+         (grouping == GROUP_TEMPLATE) ? "template" : "namespace");
+  for (size_t i = 0; i < ngroups && (rows <= 0 || i < (size_t)rows); i++)
+    printf("%+12lld %8ld %8ld %8ld  %.*s\n", (long long)list[i]->delta, list[i]->added,
+           list[i]->removed, list[i]->resized, (int)list[i]->length, list[i]->key);
+
+  /* only the listed symbols are demangled */
+  qsort(changes, count, sizeof(struct change), compare_changes);
+  printf("\n%12s %10s %10s  %s\n", "delta", "old size", "new size", "symbol");
+  size_t plainsize = 1024;
+  char *plain = malloc(plainsize);
+  for (size_t i = 0; i < count && (rows <= 0 || i < (size_t)rows); i++) {
+    const struct change *change = &changes[i];
+    if (plain == NULL)
+      fatal("out of memory");
+    /* a name whose text exceeds DEMANGLE_MAX_PLAIN is printed in mangled form */
+    int result = demangle_grow(&plain, &plainsize, NULL, change->name, strlen(change->name));
+    if (result == DEMANGLE_NOSCRATCH)
+      fatal("out of memory");
+    printf("%+12lld %10llu %10llu  %s\n", (long long)delta(change),
+           (unsigned long long)change->oldsize, (unsigned long long)change->newsize,
+           (result == DEMANGLE_OK) ? plain : change->name);
+  }
+
+  free(plain);
+  free(list);
+  free(changes);
+  free(groups.slots);
+  free_text(groups.blocks);
+  free(old.slots);
+  free_text(old.blocks);
+  free(new.slots);
+  free_text(new.blocks);
+  return (maxadded >= 0 && tpladded > maxadded) ? 2 : 0;
+}
@@ -0,0 +1,696 @@
+/* GNU C++ symbol name demangler
+ * Template bloat analyzer: code size per template, class or namespace.
+ *
+ * The analyzer reads the symbol tables of one or more ELF files (executables,
+ * shared libraries, object files or archives), demangles the C++ functions
+ * and variables, and adds up their sizes per group:
+ * - per template (the default): all instantiations of a class template or a
+ *   function template are grouped, and the number of distinct instantiations
+ *   is counted; e.g. std::vector<int>::push_back(int const&) is counted under
+ *   "std::vector", and std::vector<int> is one of its instantiations;
+ * - per class (option -l class): the scope of the function or variable;
+ *   with option -t, the template arguments are collapsed, so that all
+ *   std::vector<...> instantiations form a single group;
+ * - per namespace (option -l namespace): the outermost scope.
+ *
+ * Symbols that are aliases of each other (the complete and base object
+ * constructors, for example) are counted once.
+ *
+ * The names are demangled in parallel. Each thread aggregates into a table of
+ * its own, and the groups are found by slicing the demangled name in place,
+ * so the only strings that are stored are the names of the groups. The
+ * tables of the threads are merged at the end.
+ *
+ * Build:  cc -O2 -o tplbloat tools/tplbloat.c elfsym.c demangle.c -lpthread
+ * Usage:  tplbloat [-j threads] [-l template|class|namespace] [-t] [-n rows] file ...
+ *
+ * Copyright 2022-2024, CompuPhase
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <ctype.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../demangle.h"
+#include "../elfsym.h"
+
+#define TEXT_BLOCK      (1 << 20)
+#define SYMBOL_BLOCK    1024    /* symbols per work item */
+#define MAX_THREADS     256
+#define MAX_COMPONENTS  64
+
+enum { LEVEL_TEMPLATE, LEVEL_CLASS, LEVEL_NAMESPACE };
+
+struct textblock {
+  struct textblock *next;
+  size_t used;
+  char text[];
+};
+
+struct symbol {
+  const char *name;
+  uint64_t value;
+  uint64_t size;
+  unsigned file;
+  unsigned section;
+};
+
+struct entry {
+  uint64_t hash;
+  const char *key;      /**< name of the group (not zero-terminated) */
+  size_t length;
+  uint64_t bytes;
+  unsigned long symbols;
+  unsigned long instances;
+};
+
+struct table {
+  struct entry *slots;
+  size_t count, mask;
+  struct textblock *blocks;
+};
+
+/** Set of instantiations (by hash), each with the hash of its template. */
+struct instset {
+  uint64_t *keys;
+  uint64_t *templates;
+  size_t count, mask;
+};
+
+struct analyzer {
+  struct symbol *symbols;
+  size_t count, max;
+  struct textblock *names;
+  unsigned file;
+  size_t next;          /**< next block of symbols (under "lock") */
+  pthread_mutex_t lock;
+  int level;
+  bool collapse;
+};
+
+struct worker {
+  struct analyzer *analyzer;
+  struct table table;
+  struct instset instances;
+  unsigned long failed;
+  uint64_t failedbytes;
+  uint64_t nontemplate;
+};
+
+struct parts {
+  const char *begin, *end;
+  int count;
+  struct {
+    const char *start, *end;
+    const char *targs;  /**< start of the template arguments, or NULL */
+  } comp[MAX_COMPONENTS];
+};
+
+static void fatal(const char *message)
+{
+  fprintf(stderr, "tplbloat: %s\n", message);
+  exit(1);
+}
+
+static const char *store_text(struct textblock **blocks, const char *text, size_t length)
+{
+  struct textblock *block = *blocks;
+  if (block == NULL || block->used + length + 1 > TEXT_BLOCK) {
+    size_t size = (length + 1 > TEXT_BLOCK) ? length + 1 : TEXT_BLOCK;
+    block = malloc(sizeof(struct textblock) + size);
+    if (block == NULL)
+      fatal("out of memory");
+    block->used = 0;
+    block->next = *blocks;
+    *blocks = block;
+  }
+  char *copy = block->text + block->used;
+  memcpy(copy, text, length);
+  copy[length] = '\0';
+  block->used += length + 1;
+  return copy;
+}
+
+static void free_text(struct textblock *blocks)
+{
+  while (blocks != NULL) {
+    struct textblock *next = blocks->next;
+    free(blocks);
+    blocks = next;
+  }
+}
+
+static void collect(const struct elfsym *sym, void *arg)
+{
+  struct analyzer *analyzer = arg;
+  if (!sym->defined || sym->size == 0 || (sym->type != ELFSYM_FUNC && sym->type != ELFSYM_OBJECT))
+    return;
+  if (sym->length < 3 || sym->name[0] != '_' || sym->name[1] != 'Z')
+    return;
+  if (analyzer->count == analyzer->max) {
+    analyzer->max = (analyzer->max > 0) ? 2 * analyzer->max : 4096;
+    analyzer->symbols = realloc(analyzer->symbols, analyzer->max * sizeof(struct symbol));
+    if (analyzer->symbols == NULL)
+      fatal("out of memory");
+  }
+  struct symbol *symbol = &analyzer->symbols[analyzer->count++];
+  symbol->name = store_text(&analyzer->names, sym->name, sym->length);
+  symbol->value = sym->value;
+  symbol->size = sym->size;
+  symbol->file = analyzer->file;
+  symbol->section = sym->section;
+}
+
+static int compare_address(const void *a, const void *b)
+{
+  const struct symbol *s1 = a;
+  const struct symbol *s2 = b;
+  if (s1->file != s2->file)
+    return (s1->file < s2->file) ? -1 : 1;
+  if (s1->section != s2->section)
+    return (s1->section < s2->section) ? -1 : 1;
+  if (s1->value != s2->value)
+    return (s1->value < s2->value) ? -1 : 1;
+  return strcmp(s1->name, s2->name);
+}
+
+/** remove_aliases() - keeps one symbol of each set of symbols at the same
+ *  address.
+ */
+static void remove_aliases(struct analyzer *analyzer)
+{
+  if (analyzer->count == 0)
+    return;
+  qsort(analyzer->symbols, analyzer->count, sizeof(struct symbol), compare_address);
+  size_t count = 1;
+  for (size_t i = 1; i < analyzer->count; i++) {
+    const struct symbol *prev = &analyzer->symbols[count - 1];
+    const struct symbol *sym = &analyzer->symbols[i];
+    if (sym->file != prev->file || sym->section != prev->section || sym->value != prev->value)
+      analyzer->symbols[count++] = *sym;
+  }
+  analyzer->count = count;
+}
+
+static struct entry *table_find(const struct table *table, uint64_t hash)
+{
+  for (size_t idx = hash & table->mask; table->slots[idx].key != NULL; idx = (idx + 1) & table->mask)
+    if (table->slots[idx].hash == hash)
+      return &table->slots[idx];
+  return NULL;
+}
+
+static struct entry *table_add(struct table *table, const char *key, size_t length, uint64_t hash)
+{
+  if (table->slots == NULL || 2 * (table->count + 1) > table->mask) {
+    size_t size = (table->slots != NULL) ? 2 * (table->mask + 1) : 1024;
+    struct entry *slots = calloc(size, sizeof(struct entry));
+    if (slots == NULL)
+      fatal("out of memory");
+    for (size_t i = 0; table->slots != NULL && i <= table->mask; i++) {
+      if (table->slots[i].key == NULL)
+        continue;
+      size_t idx = table->slots[i].hash & (size - 1);
+      while (slots[idx].key != NULL)
+        idx = (idx + 1) & (size - 1);
+      slots[idx] = table->slots[i];
+    }
+    free(table->slots);
+    table->slots = slots;
+    table->mask = size - 1;
+  }
+  size_t idx = hash & table->mask;
+  while (table->slots[idx].key != NULL) {
+    struct entry *entry = &table->slots[idx];
+    if (entry->hash == hash && entry->length == length && memcmp(entry->key, key, length) == 0)
+      return entry;
+    idx = (idx + 1) & table->mask;
+  }
+  struct entry *entry = &table->slots[idx];
+  memset(entry, 0, sizeof(struct entry));
+  entry->hash = hash;
+  entry->key = store_text(&table->blocks, key, length);
+  entry->length = length;
+  table->count++;
+  return entry;
+}
+
+/** instset_add() - returns true if the instantiation is new. */
+static bool instset_add(struct instset *set, uint64_t key, uint64_t tpl)
+{
+  if (key == 0)
+    key = 1;    /* 0 marks an empty slot */
+  if (set->keys == NULL || 2 * (set->count + 1) > set->mask) {
+    size_t size = (set->keys != NULL) ? 2 * (set->mask + 1) : 1024;
+    uint64_t *keys = calloc(size, sizeof(uint64_t));
+    uint64_t *templates = malloc(size * sizeof(uint64_t));
+    if (keys == NULL || templates == NULL)
+      fatal("out of memory");
+    for (size_t i = 0; set->keys != NULL && i <= set->mask; i++) {
+      if (set->keys[i] == 0)
+        continue;
+      size_t idx = set->keys[i] & (size - 1);
+      while (keys[idx] != 0)
+        idx = (idx + 1) & (size - 1);
+      keys[idx] = set->keys[i];
+      templates[idx] = set->templates[i];
+    }
+    free(set->keys);
+    free(set->templates);
+    set->keys = keys;
+    set->templates = templates;
+    set->mask = size - 1;
+  }
+  size_t idx = key & set->mask;
+  while (set->keys[idx] != 0) {
+    if (set->keys[idx] == key)
+      return false;
+    idx = (idx + 1) & set->mask;
+  }
+  set->keys[idx] = key;
+  set->templates[idx] = tpl;
+  set->count++;
+  return true;
+}
+
+static bool is_ident(int c)
+{
+  return isalnum(c) || c == '_' || c == '$';
+}
+
+/** operator_length() - returns the length of the operator name at "p", or 0
+ *  if "p" is not at an operator name. The template arguments of an operator
+ *  template are not included.
+ */
+static size_t operator_length(const char *p, const char *text)
+{
+  static const char *tokens[] = {
+    "->*", "<<=", ">>=", "<=>", "()", "[]", "<<", ">>", "<=", ">=", "==", "!=",
+    "&&", "||", "++", "--", "+=", "-=", "*=", "/=", "%=", "&=", "|=", "^=",
+    "->", ",", "+", "-", "*", "/", "%", "^", "&", "|", "~", "!", "=", "<", ">"
+  };
+  if (strncmp(p, "operator", 8) != 0 || (p > text && is_ident(p[-1])) || is_ident(p[8]))
+    return 0;
+  const char *q = p + 8;
+  if (*q == ' ') {
+    /* new, delete or a conversion operator: up to the parameter list */
+    int depth = 0;
+    while (*q != '\0' && (*q != '(' || depth > 0)) {
+      if (*q == '<')
+        depth++;
+      else if (*q == '>' && depth > 0)
+        depth--;
+      q++;
+    }
+    return q - p;
+  }
+  for (size_t i = 0; i < sizeof tokens / sizeof tokens[0]; i++) {
+    size_t len = strlen(tokens[i]);
+    if (strncmp(q, tokens[i], len) == 0)
+      return 8 + len;
+  }
+  return 8;
+}
+
+static void add_component(struct parts *parts, const char *start, const char *end, const char *targs)
+{
+  if (parts->count == MAX_COMPONENTS) {
+    parts->comp[MAX_COMPONENTS - 1].end = end;
+    return;
+  }
+  parts->comp[parts->count].start = start;
+  parts->comp[parts->count].end = end;
+  parts->comp[parts->count].targs = targs;
+  parts->count++;
+}
+
+/** split_name() - finds the qualified name in a demangled function or
+ *  variable name (skipping the return type and the parameter list), and
+ *  splits it into its components.
+ */
+static void split_name(const char *text, struct parts *parts)
+{
+  const char *p = text;
+  const char *start = text;
+  const char *targs = NULL;
+  int depth = 0;
+  parts->begin = text;
+  parts->count = 0;
+  while (*p != '\0') {
+    if (depth == 0) {
+      size_t len = operator_length(p, text);
+      if (len > 0) {
+        p += len;
+        continue;
+      }
+      if (*p == '(') {
+        if (strncmp(p, "(anonymous namespace)", 21) == 0) {
+          p += 21;
+          continue;
+        }
+        break;  /* start of the parameter list */
+      }
+      if (*p == ' ') {
+        if (p[1] == '<') {
+          p++;  /* template arguments of an operator */
+          continue;
+        }
+        if (strncmp(p, " [clone", 7) == 0)
+          break;
+        /* the text so far was a return type or a prefix like "vtable for" */
+        parts->begin = start = p + 1;
+        parts->count = 0;
+        targs = NULL;
+        p++;
+        continue;
+      }
+      if (p[0] == ':' && p[1] == ':') {
+        add_component(parts, start, p, targs);
+        start = p + 2;
+        targs = NULL;
+        p += 2;
+        continue;
+      }
+      if (*p == '<' && targs == NULL)
+        targs = p;
+    }
+    if (*p == '<' || *p == '(' || *p == '{' || *p == '[')
+      depth++;
+    else if ((*p == '>' || *p == ')' || *p == '}' || *p == ']') && depth > 0)
+      depth--;
+    p++;
+  }
+  add_component(parts, start, p, targs);
+  parts->end = p;
+}
+
+/** collapse() - copies the text, replacing all template argument lists by
+ *  "<...>". Returns the length of the result.
+ */
+static size_t collapse(char *buffer, size_t size, const char *text, size_t length)
+{
+  size_t pos = 0;
+  const char *end = text + length;
+  const char *p = text;
+  while (p < end && pos + 6 < size) {
+    size_t len = operator_length(p, text);
+    if (len > 0 && len <= (size_t)(end - p) && pos + len + 6 < size) {
+      memcpy(buffer + pos, p, len);
+      pos += len;
+      p += len;
+      continue;
+    }
+    if (*p == '<') {
+      int depth = 0;
+      while (p < end) {
+        if (*p == '<')
+          depth++;
+        else if (*p == '>' && --depth == 0)
+          break;
+        p++;
+      }
+      memcpy(buffer + pos, "<...>", 5);
+      pos += 5;
+      if (p < end)
+        p++;
+      continue;
+    }
+    buffer[pos++] = *p++;
+  }
+  return pos;
+}
+
+static void add_symbol(struct worker *worker, const char *key, size_t length, uint64_t size)
+{
+  struct entry *entry = table_add(&worker->table, key, length, demangle_hash_text(key, length));
+  entry->bytes += size;
+  entry->symbols++;
+}
+
+static void analyze(struct worker *worker, const struct symbol *symbol, const char *plain)
+{
+  static const char global[] = "(global)";
+  struct parts parts;
+  split_name(plain, &parts);
+  const char *key = global;
+  size_t length = sizeof global - 1;
+
+  if (worker->analyzer->level == LEVEL_TEMPLATE) {
+    int i = 0;
+    while (i < parts.count && parts.comp[i].targs == NULL)
+      i++;
+    if (i == parts.count) {
+      worker->nontemplate += symbol->size;
+      return;
+    }
+    length = parts.comp[i].targs - parts.begin;
+    while (length > 0 && parts.begin[length - 1] == ' ')
+      length--;   /* "operator<< <...>" */
+    uint64_t hash = demangle_hash_text(parts.begin, length);
+    struct entry *entry = table_add(&worker->table, parts.begin, length, hash);
+    entry->bytes += symbol->size;
+    entry->symbols++;
+    uint64_t instance = demangle_hash_text(parts.begin, parts.comp[i].end - parts.begin);
+    if (instset_add(&worker->instances, instance, hash))
+      entry->instances++;
+    return;
+  }
+
+  bool special = (symbol->name[2] == 'T' && strchr("VIST", symbol->name[3]) != NULL);
+  if (worker->analyzer->level == LEVEL_CLASS) {
+    if (special && parts.count > 0) {
+      /* vtable, typeinfo or VTT: the group is the class itself */
+      key = parts.begin;
+      length = parts.end - parts.begin;
+    } else if (parts.count >= 2) {
+      key = parts.begin;
+      length = parts.comp[parts.count - 2].end - parts.begin;
+    }
+  } else if (parts.count >= 2 || (special && parts.count > 0)) {
+    key = parts.comp[0].start;
+    length = parts.comp[0].end - parts.comp[0].start;
+  }
+  if (length == 0) {
+    key = global;
+    length = sizeof global - 1;
+  }
+  if (worker->analyzer->collapse && memchr(key, '<', length) != NULL) {
+    char buffer[1024];
+    length = collapse(buffer, sizeof buffer, key, length);
+    add_symbol(worker, buffer, length, symbol->size);
+  } else {
+    add_symbol(worker, key, length, symbol->size);
+  }
+}
+
+static void *demangle_worker(void *arg)
+{
+  struct worker *worker = arg;
+  struct analyzer *analyzer = worker->analyzer;
+  size_t plainsize = 4096;
+  char *plain = malloc(plainsize);
+  if (plain == NULL)
+    fatal("out of memory");
+  for ( ;; ) {
+    pthread_mutex_lock(&analyzer->lock);
+    size_t start = analyzer->next;
+    analyzer->next += SYMBOL_BLOCK;
+    pthread_mutex_unlock(&analyzer->lock);
+    if (start >= analyzer->count)
+      break;
+    size_t stop = (start + SYMBOL_BLOCK < analyzer->count) ? start + SYMBOL_BLOCK : analyzer->count;
+    for (size_t i = start; i < stop; i++) {
+      const struct symbol *symbol = &analyzer->symbols[i];
+      /* a symbol whose text exceeds DEMANGLE_MAX_PLAIN counts as failed */
+      int result = demangle_grow(&plain, &plainsize, NULL, symbol->name, strlen(symbol->name));
+      if (result == DEMANGLE_NOSCRATCH)
+        fatal("out of memory");
+      if (result == DEMANGLE_OK) {
+        analyze(worker, symbol, plain);
+      } else {
+        worker->failed++;
+        worker->failedbytes += symbol->size;
+      }
+    }
+  }
+  free(plain);
+  return NULL;
+}
+
+static int compare_bytes(const void *a, const void *b)
+{
+  const struct entry *e1 = *(const struct entry * const *)a;
+  const struct entry *e2 = *(const struct entry * const *)b;
+  if (e1->bytes != e2->bytes)
+    return (e1->bytes > e2->bytes) ? -1 : 1;
+  if (e1->length != e2->length)
+    return (e1->length < e2->length) ? -1 : 1;
+  return memcmp(e1->key, e2->key, e1->length);
+}
+
+static double timestamp(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void usage(void)
+{
+  fprintf(stderr, "Usage: tplbloat [-j threads] [-l template|class|namespace] [-t] [-n rows] file ...\n\n"
+                  "-j  number of threads for demangling (default: all processors)\n"
+                  "-l  group the symbols by template, class or namespace\n"
+                  "-t  collapse template arguments in class and namespace names\n"
+                  "-n  number of groups to list (default: 50, 0 = all)\n");
+  exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+  long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+  int threads = (ncpu > 0) ? (int)ncpu : 4;
+  long rows = 50;
+  struct analyzer analyzer;
+  memset(&analyzer, 0, sizeof analyzer);
+  analyzer.level = LEVEL_TEMPLATE;
+  int first = 1;
+  while (first < argc && argv[first][0] == '-') {
+    if (strcmp(argv[first], "-t") == 0) {
+      analyzer.collapse = true;
+      first++;
+    } else if (first + 1 >= argc) {
+      usage();
+    } else if (strcmp(argv[first], "-j") == 0) {
+      threads = atoi(argv[first + 1]);
+      first += 2;
+    } else if (strcmp(argv[first], "-n") == 0) {
+      rows = atol(argv[first + 1]);
+      first += 2;
+    } else if (strcmp(argv[first], "-l") == 0) {
+      const char *level = argv[first + 1];
+      if (strncmp(level, "template", strlen(level)) == 0)
+        analyzer.level = LEVEL_TEMPLATE;
+      else if (strncmp(level, "class", strlen(level)) == 0)
+        analyzer.level = LEVEL_CLASS;
+      else if (strncmp(level, "namespace", strlen(level)) == 0)
+        analyzer.level = LEVEL_NAMESPACE;
+      else
+        usage();
+      first += 2;
+    } else {
+      usage();
+    }
+  }
+  if (first >= argc || threads < 1)
+    usage();
+  if (threads > MAX_THREADS)
+    threads = MAX_THREADS;
+  pthread_mutex_init(&analyzer.lock, NULL);
+
+  double start = timestamp();
+  for (int i = first; i < argc; i++) {
+    analyzer.file = i;
+    if (elfsym_read(argv[i], collect, &analyzer) < 0)
+      fprintf(stderr, "tplbloat: %s is not an ELF file or archive\n", argv[i]);
+  }
+  remove_aliases(&analyzer);
+  double read = timestamp();
+
+  struct worker workers[MAX_THREADS];
+  pthread_t handles[MAX_THREADS];
+  memset(workers, 0, threads * sizeof(struct worker));
+  for (int i = 0; i < threads; i++) {
+    workers[i].analyzer = &analyzer;
+    if (pthread_create(&handles[i], NULL, demangle_worker, &workers[i]) != 0)
+      fatal("cannot create thread");
+  }
+  for (int i = 0; i < threads; i++)
+    pthread_join(handles[i], NULL);
+
+  /* merge the tables of the threads */
+  struct table total;
+  struct instset instances;
+  memset(&total, 0, sizeof total);
+  memset(&instances, 0, sizeof instances);
+  unsigned long failed = 0;
+  uint64_t failedbytes = 0, nontemplate = 0, bytes = 0;
+  for (int i = 0; i < threads; i++) {
+    struct worker *worker = &workers[i];
+    for (size_t s = 0; worker->table.slots != NULL && s <= worker->table.mask; s++) {
+      const struct entry *entry = &worker->table.slots[s];
+      if (entry->key == NULL)
+        continue;
+      struct entry *sum = table_add(&total, entry->key, entry->length, entry->hash);
+      sum->bytes += entry->bytes;
+      sum->symbols += entry->symbols;
+      bytes += entry->bytes;
+    }
+    for (size_t s = 0; worker->instances.keys != NULL && s <= worker->instances.mask; s++) {
+      if (worker->instances.keys[s] != 0
+          && instset_add(&instances, worker->instances.keys[s], worker->instances.templates[s]))
+        table_find(&total, worker->instances.templates[s])->instances++;
+    }
+    failed += worker->failed;
+    failedbytes += worker->failedbytes;
+    nontemplate += worker->nontemplate;
+    free(worker->table.slots);
+    free_text(worker->table.blocks);
+    free(worker->instances.keys);
+    free(worker->instances.templates);
+  }
+  double done = timestamp();
+
+  struct entry **list = malloc((total.count + 1) * sizeof(struct entry*));
+  if (list == NULL)
+    fatal("out of memory");
+  size_t count = 0;
+  for (size_t s = 0; total.slots != NULL && s <= total.mask; s++)
+    if (total.slots[s].key != NULL)
+      list[count++] = &total.slots[s];
+  qsort(list, count, sizeof(struct entry*), compare_bytes);
+
+  uint64_t all = bytes + nontemplate + failedbytes;
+  printf("%lu symbols, %llu bytes", (unsigned long)analyzer.count, (unsigned long long)all);
+  if (analyzer.level == LEVEL_TEMPLATE)
+    printf(", %llu bytes (%.1f%%) in templates", (unsigned long long)bytes, (all > 0) ? 100.0 * bytes / all : 0.0);
+  if (failed > 0)
+    printf(", %lu symbols (%llu bytes) not demangled", failed, (unsigned long long)failedbytes);
+  printf("\n\n");
+  if (analyzer.level == LEVEL_TEMPLATE)
+    printf("%12s %6s %8s %8s  %s\n", "bytes", "%", "symbols", "inst.", "template");
+  else
+    printf("%12s %6s %8s  %s\n", "bytes", "%", "symbols", (analyzer.level == LEVEL_CLASS) ? "class" : "namespace");
+  for (size_t i = 0; i < count && (rows <= 0 || i < (size_t)rows); i++) {
+    const struct entry *entry = list[i];
+    printf("%12llu %6.2f %8lu", (unsigned long long)entry->bytes,
+           (all > 0) ? 100.0 * entry->bytes / all : 0.0, entry->symbols);
+    if (analyzer.level == LEVEL_TEMPLATE)
+      printf(" %8lu", entry->instances);
+    printf("  %.*s\n", (int)entry->length, entry->key);
+  }
+  fprintf(stderr, "read in %.2f s, demangled in %.2f s with %d threads\n", read - start, done - read, threads);
+
+  free(list);
+  free(total.slots);
+  free_text(total.blocks);
+  free(instances.keys);
+  free(instances.templates);
+  free(analyzer.symbols);
+  free_text(analyzer.names);
+  return 0;
+}